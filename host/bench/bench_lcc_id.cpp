@@ -0,0 +1,59 @@
+/**
+ * @file bench_lcc_id.cpp
+ * @brief Event and node ID parsing
+ *
+ * Bytes/s is the ID text parsed, for comparison with the file parsers
+ * in bench_storage.cpp.
+ */
+
+#include "lcc_id.h"
+#include <benchmark/benchmark.h>
+#include <cstring>
+
+namespace {
+
+void BM_ParseEventDotted(benchmark::State &state)
+{
+    const char *text = "05.01.01.01.22.60.00.1A";
+    uint64_t id;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lcc_id_parse_event(text, &id));
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)strlen(text));
+}
+BENCHMARK(BM_ParseEventDotted);
+
+void BM_ParseEventPlain(benchmark::State &state)
+{
+    const char *text = "050101012260001A";
+    uint64_t id;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lcc_id_parse_event(text, &id));
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)strlen(text));
+}
+BENCHMARK(BM_ParseEventPlain);
+
+void BM_ParseNode(benchmark::State &state)
+{
+    const char *text = "05.01.01.01.22.60";
+    uint64_t id;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lcc_id_parse_node(text, &id));
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)strlen(text));
+}
+BENCHMARK(BM_ParseNode);
+
+void BM_ParseEventReject(benchmark::State &state)
+{
+    const char *text = "05.01.01.01.22.60.00.ZZ";
+    uint64_t id;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lcc_id_parse_event(text, &id));
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)strlen(text));
+}
+BENCHMARK(BM_ParseEventReject);
+
+}  // namespace
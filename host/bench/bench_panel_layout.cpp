@@ -0,0 +1,116 @@
+/**
+ * @file bench_panel_layout.cpp
+ * @brief Panel layout lookups, track resolution and edits at layout scale
+ */
+
+#include "layout_gen.h"
+#include "panel_geometry.h"
+#include "esp_log.h"
+#include <benchmark/benchmark.h>
+
+namespace {
+
+/** @brief A ladder of state.range(0) turnouts, freed with the benchmark */
+struct Ladder {
+    panel_layout_t layout;
+
+    explicit Ladder(benchmark::State &state)
+    {
+        esp_log_level_set("*", ESP_LOG_WARN);
+        std::memset(&layout, 0, sizeof(layout));
+        gen_ladder(&layout, (uint32_t)state.range(0));
+    }
+    ~Ladder() { panel_layout_free(&layout); }
+};
+
+void BM_FindItem(benchmark::State &state)
+{
+    Ladder l(state);
+    uint32_t n = (uint32_t)state.range(0);
+    uint32_t id = 0;
+    for (auto _ : state) {
+        id = id % n + 1;
+        benchmark::DoNotOptimize(panel_layout_find_item(&l.layout, id));
+    }
+}
+BENCHMARK(BM_FindItem)->Range(16, 1024);
+
+void BM_CollectTracks(benchmark::State &state)
+{
+    Ladder l(state);
+    uint32_t n = (uint32_t)state.range(0);
+    uint16_t out[8];
+    uint32_t id = 0;
+    for (auto _ : state) {
+        id = id % n + 1;
+        benchmark::DoNotOptimize(
+            panel_layout_collect_tracks(&l.layout, PANEL_REF_TURNOUT, id, out, 8));
+    }
+}
+BENCHMARK(BM_CollectTracks)->Range(16, 1024);
+
+// Every track endpoint resolved, as a full canvas redraw does
+void BM_ResolveAllTracks(benchmark::State &state)
+{
+    Ladder l(state);
+    int16_t x1, y1, x2, y2;
+    for (auto _ : state) {
+        for (size_t i = 0; i < l.layout.track_count; i++) {
+            benchmark::DoNotOptimize(panel_layout_resolve_track(&l.layout, &l.layout.tracks[i],
+                                                                &x1, &y1, &x2, &y2));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)l.layout.track_count);
+}
+BENCHMARK(BM_ResolveAllTracks)->Range(16, 1024);
+
+void BM_GeometryPoints(benchmark::State &state)
+{
+    panel_item_t item = {};
+    item.grid_x = 10;
+    item.grid_y = 10;
+    lv_point_t entry, normal, reverse;
+    uint8_t rot = 0;
+    for (auto _ : state) {
+        item.rotation = rot++ & 7;
+        item.mirrored = rot & 8;
+        panel_geometry_get_points(&item, &entry, &normal, &reverse);
+        benchmark::DoNotOptimize(entry);
+        benchmark::DoNotOptimize(reverse);
+    }
+}
+BENCHMARK(BM_GeometryPoints);
+
+// Remove a mid-ladder turnout with its tracks, then put it all back
+void BM_RemoveItemCascade(benchmark::State &state)
+{
+    Ladder l(state);
+    uint32_t id = (uint32_t)state.range(0) / 2;
+    for (auto _ : state) {
+        int idx = panel_layout_find_item(&l.layout, id);
+        panel_item_t item = l.layout.items[idx];
+        panel_track_t saved[3];
+        uint16_t tracks[3];
+        size_t n = panel_layout_collect_tracks(&l.layout, PANEL_REF_TURNOUT, id, tracks, 3);
+        for (size_t i = 0; i < n; i++) saved[i] = l.layout.tracks[tracks[i]];
+
+        panel_layout_remove_item(&l.layout, (size_t)idx);
+        panel_layout_insert_item(&l.layout, (size_t)idx, &item);
+        for (size_t i = 0; i < n; i++) {
+            panel_layout_insert_track(&l.layout, tracks[i], &saved[i]);
+        }
+    }
+}
+BENCHMARK(BM_RemoveItemCascade)->Range(16, 1024);
+
+void BM_Reindex(benchmark::State &state)
+{
+    Ladder l(state);
+    for (auto _ : state) {
+        panel_layout_reindex(&l.layout);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)l.layout.track_count);
+}
+BENCHMARK(BM_Reindex)->Range(16, 1024);
+
+}  // namespace
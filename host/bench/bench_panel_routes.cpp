@@ -0,0 +1,47 @@
+/**
+ * @file bench_panel_routes.cpp
+ * @brief Route table construction and lookup
+ */
+
+#include "panel_routes.h"
+#include "layout_gen.h"
+#include "esp_log.h"
+#include <benchmark/benchmark.h>
+
+namespace {
+
+void BM_RoutesBuild(benchmark::State &state)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    panel_layout_t layout;
+    std::memset(&layout, 0, sizeof(layout));
+    gen_ladder(&layout, (uint32_t)state.range(0));
+    for (auto _ : state) {
+        layout.revision++;   // defeat the cache
+        benchmark::DoNotOptimize(panel_routes_build(&layout));
+    }
+    state.counters["routes"] = (double)panel_routes_count();
+    panel_routes_clear();
+    panel_layout_free(&layout);
+}
+BENCHMARK(BM_RoutesBuild)->Range(8, 128);
+
+void BM_RoutesFind(benchmark::State &state)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    panel_layout_t layout;
+    std::memset(&layout, 0, sizeof(layout));
+    uint32_t n = (uint32_t)state.range(0);
+    gen_ladder(&layout, n);
+    panel_routes_build(&layout);
+    uint32_t k = 0;
+    for (auto _ : state) {
+        k = k % n + 1;
+        benchmark::DoNotOptimize(panel_routes_find(0, k));
+    }
+    panel_routes_clear();
+    panel_layout_free(&layout);
+}
+BENCHMARK(BM_RoutesFind)->Range(8, 128);
+
+}  // namespace
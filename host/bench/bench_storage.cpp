@@ -0,0 +1,156 @@
+/**
+ * @file bench_storage.cpp
+ * @brief Throughput of the SD card file parsers
+ *
+ * turnouts.json, JMRI roster and panel.json text for state.range(0)
+ * turnouts is generated in memory, in the format the panel writes, and
+ * parsed into a scratch array or layout.  Reported as bytes/s and, through
+ * the host heap's counters, allocations per record (a turnout, or a
+ * panel item with its track) — cJSON's included.
+ */
+
+#include "turnout_storage.h"
+#include "panel_storage.h"
+#include "psram_array.h"
+#include "host_heap.h"
+#include "esp_log.h"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+constexpr uint64_t kEventBase = 0x0501010122600000ULL;
+
+std::string event(uint64_t id)
+{
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%02X.%02X.%02X.%02X.%02X.%02X.%02X.%02X",
+             (unsigned)(id >> 56) & 0xFF, (unsigned)(id >> 48) & 0xFF,
+             (unsigned)(id >> 40) & 0xFF, (unsigned)(id >> 32) & 0xFF,
+             (unsigned)(id >> 24) & 0xFF, (unsigned)(id >> 16) & 0xFF,
+             (unsigned)(id >> 8) & 0xFF, (unsigned)id & 0xFF);
+    return buf;
+}
+
+std::string gen_json(int64_t turnouts)
+{
+    std::string s = "{\n  \"version\": 1,\n  \"turnouts\": [\n";
+    for (int64_t i = 0; i < turnouts; i++) {
+        s += "    {\"name\": \"Turnout " + std::to_string(i + 1) + "\", \"id\": " +
+             std::to_string(i + 1) + ", \"event_normal\": \"" + event(kEventBase + 2 * i) +
+             "\", \"event_reverse\": \"" + event(kEventBase + 2 * i + 1) + "\", \"order\": " +
+             std::to_string(i) + (i + 1 < turnouts ? "},\n" : "}\n");
+    }
+    return s + "  ]\n}\n";
+}
+
+/** @brief As app_bench.c's: every other turnout has no userName */
+std::string gen_jmri(int64_t turnouts)
+{
+    std::string s = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<layout-config>\n"
+        "  <turnouts class=\"jmri.jmrix.openlcb.configurexml.OlcbTurnoutManagerXml\">\n";
+    for (int64_t i = 0; i < turnouts; i++) {
+        s += std::string("    <turnout feedback=\"MONITORING\" inverted=\"") +
+             (i % 5 == 0 ? "true" : "false") + "\" automate=\"Off\">\n"
+             "      <systemName>MT" + event(kEventBase + 2 * i) + ";" +
+             event(kEventBase + 2 * i + 1) + "</systemName>\n";
+        if (i % 2) s += "      <userName>Yard " + std::to_string(i) + "</userName>\n";
+        s += "    </turnout>\n";
+    }
+    return s + "  </turnouts>\n</layout-config>\n";
+}
+
+/** @brief A row of turnouts between two endpoints, joined normal → entry */
+std::string gen_panel(int64_t turnouts)
+{
+    std::string s = "{\n  \"version\": 2,\n  \"items\": [\n";
+    for (int64_t i = 0; i < turnouts; i++) {
+        s += "    {\"turnout_id\": " + std::to_string(i + 1) + ", \"grid_x\": " +
+             std::to_string(2 + 3 * (i % 60)) + ", \"grid_y\": " + std::to_string(2 + 2 * (i / 60)) +
+             ", \"rotation\": 0, \"mirrored\": false}" + (i + 1 < turnouts ? ",\n" : "\n");
+    }
+    s += "  ],\n  \"endpoints\": [\n    {\"id\": 1, \"grid_x\": 0, \"grid_y\": 2},\n"
+         "    {\"id\": 2, \"grid_x\": 190, \"grid_y\": 2}\n  ],\n"
+         "  \"next_endpoint_id\": 3,\n  \"tracks\": [\n"
+         "    {\"from\": \"endpoint:1\", \"to\": \"turnout:1\", \"to_point\": \"entry\"},\n";
+    for (int64_t i = 1; i < turnouts; i++) {
+        s += "    {\"from\": \"turnout:" + std::to_string(i) + "\", \"from_point\": \"normal\", "
+             "\"to\": \"turnout:" + std::to_string(i + 1) + "\", \"to_point\": \"entry\"},\n";
+    }
+    s += "    {\"from\": \"turnout:" + std::to_string(turnouts) + "\", \"from_point\": \"normal\", "
+         "\"to\": \"endpoint:2\"}\n  ]\n}\n";
+    return s;
+}
+
+/** @brief Bytes/s and allocations per record over the timed loop */
+void report(benchmark::State &state, size_t bytes, uint64_t allocs)
+{
+    state.SetBytesProcessed((int64_t)(state.iterations() * bytes));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["allocs/record"] =
+        (double)allocs / (double)(state.iterations() * state.range(0));
+}
+
+void BM_ParseTurnoutsJson(benchmark::State &state)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    std::string json = gen_json(state.range(0));
+    turnout_t *turnouts = nullptr;
+    size_t capacity = 0, count = 0;
+    turnout_storage_parse(json.c_str(), &turnouts, &capacity, &count);     // array at size
+
+    host_heap_stats_t before, after;
+    host_heap_get_stats(&before);
+    for (auto _ : state) {
+        turnout_storage_parse(json.c_str(), &turnouts, &capacity, &count);
+    }
+    host_heap_get_stats(&after);
+    if (count != (size_t)state.range(0)) state.SkipWithError("turnouts not all parsed");
+    report(state, json.size(), after.allocs - before.allocs);
+    psram_array_free((void **)&turnouts, &capacity);
+}
+BENCHMARK(BM_ParseTurnoutsJson)->Arg(50)->Arg(500)->Arg(2000);
+
+void BM_ParseJmri(benchmark::State &state)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    std::string xml = gen_jmri(state.range(0));
+    turnout_t *turnouts = nullptr;
+    size_t capacity = 0, count = 0;
+    turnout_storage_parse_jmri(xml.c_str(), &turnouts, &capacity, &count);
+
+    host_heap_stats_t before, after;
+    host_heap_get_stats(&before);
+    for (auto _ : state) {
+        count = 0;
+        turnout_storage_parse_jmri(xml.c_str(), &turnouts, &capacity, &count);
+    }
+    host_heap_get_stats(&after);
+    if (count != (size_t)state.range(0)) state.SkipWithError("turnouts not all imported");
+    report(state, xml.size(), after.allocs - before.allocs);
+    psram_array_free((void **)&turnouts, &capacity);
+}
+BENCHMARK(BM_ParseJmri)->Arg(50)->Arg(500)->Arg(2000);
+
+void BM_ParsePanelJson(benchmark::State &state)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    std::string json = gen_panel(state.range(0));
+    panel_layout_t layout = {};
+    layout.index.valid = true;
+    panel_storage_parse(json.c_str(), &layout);
+
+    host_heap_stats_t before, after;
+    host_heap_get_stats(&before);
+    for (auto _ : state) {
+        panel_storage_parse(json.c_str(), &layout);
+    }
+    host_heap_get_stats(&after);
+    if (layout.item_count != (size_t)state.range(0)) state.SkipWithError("items not all parsed");
+    report(state, json.size(), after.allocs - before.allocs);
+    panel_layout_free(&layout);
+}
+BENCHMARK(BM_ParsePanelJson)->Arg(50)->Arg(500)->Arg(2000);
+
+}  // namespace
@@ -0,0 +1,89 @@
+/**
+ * @file bench_turnout_manager.cpp
+ * @brief Event routing and snapshot cost on the turnout table
+ *
+ * Table sizes run from 16 up to TURNOUT_MAX_COUNT, the panel's largest.
+ */
+
+#include "turnout_manager.h"
+#include "fake_turnout_storage.h"
+#include "esp_log.h"
+#include <benchmark/benchmark.h>
+
+namespace {
+
+constexpr uint64_t kEventBase = 0x0501010122600000ULL;
+
+/** @brief Reset the manager and fill it with state.range(0) turnouts */
+void fill(benchmark::State &state)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    fake_storage_reset();
+    turnout_manager_init();
+    for (int64_t i = 0; i < state.range(0); i++) {
+        turnout_manager_add(kEventBase + 2 * (uint64_t)i, kEventBase + 2 * (uint64_t)i + 1, "T");
+    }
+}
+
+void BM_FindByEvent(benchmark::State &state)
+{
+    fill(state);
+    uint64_t n = (uint64_t)state.range(0) * 2;
+    uint64_t k = 0;
+    for (auto _ : state) {
+        k = (k + 7) % n;
+        benchmark::DoNotOptimize(turnout_manager_find_by_event(kEventBase + k));
+    }
+}
+BENCHMARK(BM_FindByEvent)->Range(16, 1024)->Arg(TURNOUT_MAX_COUNT);
+
+// An event the table does not consume, the common case on a busy bus
+void BM_FindByEventMiss(benchmark::State &state)
+{
+    fill(state);
+    uint64_t k = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(turnout_manager_find_by_event(0x0201570000000000ULL + k++));
+    }
+}
+BENCHMARK(BM_FindByEventMiss)->Range(16, 1024)->Arg(TURNOUT_MAX_COUNT);
+
+void BM_SetStateByEvent(benchmark::State &state)
+{
+    fill(state);
+    uint64_t n = (uint64_t)state.range(0) * 2;
+    uint64_t k = 0;
+    for (auto _ : state) {
+        k = (k + 7) % n;
+        turnout_manager_set_state_by_event(kEventBase + k,
+                                           k & 1 ? TURNOUT_STATE_REVERSE : TURNOUT_STATE_NORMAL);
+    }
+}
+BENCHMARK(BM_SetStateByEvent)->Range(16, 1024)->Arg(TURNOUT_MAX_COUNT);
+
+void BM_SnapshotUnchanged(benchmark::State &state)
+{
+    fill(state);
+    for (auto _ : state) {
+        const turnout_snapshot_t *s = turnout_manager_snapshot_acquire();
+        benchmark::DoNotOptimize(s);
+        turnout_manager_snapshot_release(s);
+    }
+}
+BENCHMARK(BM_SnapshotUnchanged)->Range(16, 1024)->Arg(TURNOUT_MAX_COUNT);
+
+// Every acquire follows a state change, so each one publishes a fresh copy
+void BM_SnapshotAfterChange(benchmark::State &state)
+{
+    fill(state);
+    uint64_t k = 0;
+    for (auto _ : state) {
+        turnout_manager_set_state_by_event(kEventBase + (k++ & 1), TURNOUT_STATE_NORMAL);
+        const turnout_snapshot_t *s = turnout_manager_snapshot_acquire();
+        benchmark::DoNotOptimize(s);
+        turnout_manager_snapshot_release(s);
+    }
+}
+BENCHMARK(BM_SnapshotAfterChange)->Range(16, 1024)->Arg(TURNOUT_MAX_COUNT);
+
+}  // namespace
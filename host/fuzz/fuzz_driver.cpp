@@ -0,0 +1,133 @@
+/**
+ * @file fuzz_driver.cpp
+ * @brief Corpus replay for the fuzz targets when libFuzzer is not available
+ *
+ * Runs every file given (directories are read recursively) through the
+ * target as is, then --mutations mutated copies of each with the edits
+ * app_bench.c makes on the panel: random bytes, delimiters and hex
+ * digits, truncation and duplicated spans.  The mutations come from a
+ * fixed seed, so a failing run repeats; an input that breaks a check
+ * aborts the process, after the input is written to fuzz-crash.bin.
+ *
+ *   fuzz_<target> [--mutations 1000] [--seed 1] FILE|DIR...
+ */
+
+#include "fuzz_target.h"
+
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+/// Largest mutated input; duplicated spans stop growing it here
+constexpr size_t kMaxInput = 64 * 1024;
+
+uint32_t s_rng;
+std::vector<uint8_t> s_current;
+
+uint32_t next_random()
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+/** @brief Apply one to four edits, as app_bench.c's mutate() */
+void mutate(std::vector<uint8_t> *buf)
+{
+    static const char s_specials[] = ".;<>/\"{}[],:0Ff\\ -";
+    int edits = 1 + (int)(next_random() % 4);
+    for (int e = 0; e < edits && !buf->empty(); e++) {
+        uint32_t r = next_random();
+        size_t at = (r >> 8) % buf->size();
+        switch (r % 4) {
+        case 0:     // random byte
+            (*buf)[at] = (uint8_t)(r >> 24);
+            break;
+        case 1:     // delimiter or hex digit
+            (*buf)[at] = (uint8_t)s_specials[(r >> 24) % (sizeof(s_specials) - 1)];
+            break;
+        case 2:     // truncate
+            buf->resize(at);
+            break;
+        default:    // duplicate a span
+            if (buf->size() * 2 <= kMaxInput) {
+                size_t span = 1 + (r >> 24) % (buf->size() - at);
+                buf->insert(buf->begin() + at, buf->begin() + at, buf->begin() + at + span);
+            }
+            break;
+        }
+    }
+}
+
+void run(const std::vector<uint8_t> &input)
+{
+    s_current = input;
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+
+/** @brief Keep the input that aborted, for a rerun under a debugger */
+void save_crash(int sig)
+{
+    std::ofstream("fuzz-crash.bin", std::ios::binary)
+        .write(reinterpret_cast<const char *>(s_current.data()), (std::streamsize)s_current.size());
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+void collect(const std::filesystem::path &path, std::vector<std::filesystem::path> *files)
+{
+    if (std::filesystem::is_directory(path)) {
+        for (const auto &e : std::filesystem::recursive_directory_iterator(path)) {
+            if (e.is_regular_file()) files->push_back(e.path());
+        }
+    } else if (std::filesystem::is_regular_file(path)) {
+        files->push_back(path);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    long mutations = 1000;
+    s_rng = 1;
+    std::vector<std::filesystem::path> files;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--mutations" && i + 1 < argc) {
+            mutations = strtol(argv[++i], nullptr, 10);
+        } else if (a == "--seed" && i + 1 < argc) {
+            s_rng = (uint32_t)strtoul(argv[++i], nullptr, 10) | 1;
+        } else {
+            collect(a, &files);
+        }
+    }
+    if (files.empty() || mutations < 0) {
+        fprintf(stderr, "usage: %s [--mutations 1000] [--seed 1] FILE|DIR...\n", argv[0]);
+        return 2;
+    }
+    signal(SIGABRT, save_crash);
+    signal(SIGSEGV, save_crash);
+
+    size_t runs = 0;
+    for (const auto &path : files) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<uint8_t> seed((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (seed.size() > kMaxInput) seed.resize(kMaxInput);
+        run(seed);
+        runs++;
+        for (long m = 0; m < mutations; m++) {
+            std::vector<uint8_t> input = seed;
+            mutate(&input);
+            run(input);
+            runs++;
+        }
+    }
+    fprintf(stderr, "%zu seeds, %zu inputs run\n", files.size(), runs);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file fuzz_lcc_id.cpp
+ * @brief Fuzz target: event ID and node ID parsing
+ *
+ * An accepted ID must have the shape of one — all its fields, or every
+ * plain digit — and format back to the same value, dotted and plain.  A
+ * rejected one must leave the output untouched.
+ */
+
+#include "fuzz_target.h"
+#include "lcc_id.h"
+#include <algorithm>
+#include <cinttypes>
+
+namespace {
+
+constexpr uint64_t kUntouched = 0xDEADBEEFDEADBEEFULL;
+
+void check_round_trip(uint64_t id, int bytes, bool (*parse)(const char *, uint64_t *))
+{
+    char dotted[24], plain[24];
+    int n = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        n += snprintf(dotted + n, sizeof(dotted) - n, i ? "%02X." : "%02X",
+                      (unsigned)((id >> (8 * i)) & 0xFF));
+    }
+    snprintf(plain, sizeof(plain), "%0*" PRIX64, bytes * 2, id);
+
+    uint64_t again = 0;
+    FUZZ_CHECK(parse(dotted, &again) && again == id);
+    again = 0;
+    FUZZ_CHECK(parse(plain, &again) && again == id);
+}
+
+/** @brief Dotted with @p bytes fields, or exactly 2 × @p bytes plain digits */
+void check_shape(const std::string &text, int bytes)
+{
+    size_t first = text.find_first_not_of(" \t\r\n");
+    size_t last = text.find_last_not_of(" \t\r\n");
+    FUZZ_CHECK(first != std::string::npos);
+    std::string id = text.substr(first, last - first + 1);
+    size_t dots = (size_t)std::count(id.begin(), id.end(), '.');
+    if (dots == 0) {
+        FUZZ_CHECK(id.size() == (size_t)bytes * 2);
+    } else {
+        FUZZ_CHECK(dots == (size_t)bytes - 1);
+    }
+}
+
+void check(const std::string &text, int bytes, bool (*parse)(const char *, uint64_t *))
+{
+    uint64_t id = kUntouched;
+    if (parse(text.c_str(), &id)) {
+        check_shape(text, bytes);
+        check_round_trip(id, bytes, parse);
+    } else {
+        FUZZ_CHECK(id == kUntouched);
+    }
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    std::string text = fuzz_text(data, size);
+    check(text, 8, lcc_id_parse_event);
+    check(text, 6, lcc_id_parse_node);
+    return 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file fuzz_panel_storage.cpp
+ * @brief Fuzz target: panel.json parsing
+ *
+ * Whatever the text, the parsed layout must stay within its arrays and
+ * limits, and the layout must be reusable: a second parse into it starts
+ * from a cleared layout and gives the same counts.
+ */
+
+#include "fuzz_target.h"
+#include "panel_storage.h"
+
+namespace {
+
+void check_bounds(const panel_layout_t &l)
+{
+    FUZZ_CHECK(l.item_count <= l.item_capacity && l.item_count <= PANEL_MAX_ITEMS);
+    FUZZ_CHECK(l.endpoint_count <= l.endpoint_capacity && l.endpoint_count <= PANEL_MAX_ENDPOINTS);
+    FUZZ_CHECK(l.track_count <= l.track_capacity && l.track_count <= PANEL_MAX_TRACKS);
+    FUZZ_CHECK(l.block_count <= l.block_capacity && l.block_count <= PANEL_MAX_BLOCKS);
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    std::string text = fuzz_text(data, size);
+    panel_layout_t layout = {};
+    layout.index.valid = true;
+
+    esp_err_t first = panel_storage_parse(text.c_str(), &layout);
+    check_bounds(layout);
+    size_t items = layout.item_count, endpoints = layout.endpoint_count;
+    size_t tracks = layout.track_count, blocks = layout.block_count;
+
+    FUZZ_CHECK(panel_storage_parse(text.c_str(), &layout) == first);
+    check_bounds(layout);
+    FUZZ_CHECK(layout.item_count == items && layout.endpoint_count == endpoints &&
+               layout.track_count == tracks && layout.block_count == blocks);
+
+    panel_layout_free(&layout);
+    return 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file fuzz_target.h
+ * @brief libFuzzer entry point and helpers shared by the parser fuzz targets
+ *
+ * Each fuzz_*.cpp defines LLVMFuzzerTestOneInput().  Under Clang it is
+ * linked with libFuzzer; otherwise fuzz_driver.cpp supplies main() and
+ * replays a corpus with mutations (see host/CMakeLists.txt).
+ */
+
+#ifndef FUZZ_TARGET_H_
+#define FUZZ_TARGET_H_
+
+#include "esp_log.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/** @brief Abort on a broken invariant, so both fuzzers report the input */
+#define FUZZ_CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            abort(); \
+        } \
+    } while (0)
+
+/**
+ * @brief The input as the NUL-terminated text the parsers take
+ *
+ * An embedded NUL ends the text, as it would in a file read from the card.
+ * The parsers log every rejected input; the first call silences them.
+ */
+inline std::string fuzz_text(const uint8_t *data, size_t size)
+{
+    static const bool s_quiet = (esp_log_level_set("*", ESP_LOG_NONE), true);
+    (void)s_quiet;
+    const char *text = reinterpret_cast<const char *>(data);
+    return std::string(text, strnlen(text, size));
+}
+
+#endif // FUZZ_TARGET_H_
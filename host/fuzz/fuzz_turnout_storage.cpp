@@ -0,0 +1,55 @@
+/**
+ * @file fuzz_turnout_storage.cpp
+ * @brief Fuzz target: turnouts.json and JMRI roster parsing
+ *
+ * The input is parsed as turnouts.json, then imported as a JMRI roster on
+ * top of what was loaded — the order the Add Turnout tab runs them in.
+ * Both must stay within the array and the table limit and leave every
+ * name terminated; an imported turnout must not reuse a loaded event.
+ */
+
+#include "fuzz_target.h"
+#include "turnout_storage.h"
+#include "psram_array.h"
+#include <cstring>
+
+namespace {
+
+void check_names(const turnout_t *turnouts, size_t from, size_t to)
+{
+    for (size_t i = from; i < to; i++) {
+        FUZZ_CHECK(memchr(turnouts[i].name, '\0', sizeof(turnouts[i].name)) != nullptr);
+    }
+}
+
+bool shares_event(const turnout_t &a, const turnout_t &b)
+{
+    return a.event_normal == b.event_normal || a.event_normal == b.event_reverse ||
+           a.event_reverse == b.event_normal || a.event_reverse == b.event_reverse;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    std::string text = fuzz_text(data, size);
+    turnout_t *turnouts = nullptr;
+    size_t capacity = 0, count = 0;
+
+    if (turnout_storage_parse(text.c_str(), &turnouts, &capacity, &count) != ESP_OK) {
+        FUZZ_CHECK(count == 0);
+    }
+    FUZZ_CHECK(count <= capacity && count <= TURNOUT_MAX_COUNT);
+    check_names(turnouts, 0, count);
+
+    size_t loaded = count;
+    FUZZ_CHECK(turnout_storage_parse_jmri(text.c_str(), &turnouts, &capacity, &count) == ESP_OK);
+    FUZZ_CHECK(count >= loaded && count <= capacity && count <= TURNOUT_MAX_COUNT);
+    check_names(turnouts, loaded, count);
+    for (size_t i = loaded; i < count; i++) {
+        for (size_t j = 0; j < i; j++) FUZZ_CHECK(!shares_event(turnouts[i], turnouts[j]));
+    }
+
+    psram_array_free((void **)&turnouts, &capacity);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file mem_budget_check.cpp
+ * @brief The firmware's memory budget checkpoints, enforced in the host build
+ *
+ * Runs the boot sequence mem_budget.c checks on the panel — boot, panel
+ * shown, settings shown, then the settings (builder) → panel navigation
+ * soak — over a generated layout, with the budgets and leak tolerances of
+ * mem_budget.c.  Any miss or flagged leak makes the exit status 1, so the
+ * LVGL pool budgets per screen fail under ctest instead of only being
+ * logged on the device.
+ *
+ *   mem_budget_check [--items 100]
+ *
+ * The internal RAM figures are the host heap's: the framebuffer is in
+ * PSRAM and LVGL's pool is static, as on the panel, but the other numbers
+ * are not the device's.  The LVGL pool figures are exact.
+ */
+
+#include "render_host.h"
+#include "mem_budget.h"
+#include "ui_common.h"
+#include "turnout_manager.h"
+#include "fake_turnout_storage.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char **argv)
+{
+    size_t items = 100;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--items" && i + 1 < argc) {
+            items = strtoul(argv[++i], nullptr, 10);
+        } else {
+            items = 0;
+            break;
+        }
+    }
+    if (items < 2 || items > TURNOUT_MAX_COUNT) {
+        fprintf(stderr, "usage: %s [--items 2..%d]\n", argv[0], TURNOUT_MAX_COUNT);
+        return 2;
+    }
+    // Checkpoint lines are informational; misses are logged as errors
+    esp_log_level_set("*", ESP_LOG_WARN);
+    esp_log_level_set("mem_budget", ESP_LOG_INFO);
+
+    fake_storage_reset();
+    turnout_manager_init();
+    if (!render_host_init()) return 2;
+
+    panel_layout_t previous;
+    if (!render_host_load_layout(items, &previous)) {
+        fprintf(stderr, "cannot build a %zu-turnout layout\n", items);
+        return 2;
+    }
+    panel_layout_free(&previous);
+
+    // As main.c, with one visit to settings first so its checkpoint is
+    // logged (the soak checks it quietly)
+    mem_budget_checkpoint(MEM_CP_BOOT, 0);
+    ui_show_main();
+    ui_show_settings();
+    ui_show_main();
+    mem_budget_nav_soak();
+
+    uint32_t misses = mem_budget_misses();
+    printf("%zu items, %d navigation cycles: %u budget misses\n", items,
+           CONFIG_MEM_BUDGET_NAV_CYCLES, (unsigned)misses);
+    return misses ? 1 : 0;
+}
@@ -0,0 +1,309 @@
+/**
+ * @file render_bench.cpp
+ * @brief Headless render benchmark for the panel, switchboard and builder
+ *
+ * LVGL draws into an in-memory 800×480 RGB565 framebuffer through a
+ * full-screen draw buffer, as on the panel.  For each generated layout
+ * size the switchboard and builder (tabs of the settings screen) and the
+ * panel screen are built from the firmware's UI sources, then measured:
+ * build time, full and partial frame time, object count and LVGL pool use.
+ *
+ * The layouts come from render_host_load_layout(), with turnouts 1..N
+ * in the turnout manager so the switchboard lists the same turnouts the
+ * panel draws.  Nothing reaches them from the bus, so every turnout
+ * renders "unknown" and a run is deterministic: the FNV-1a hash of the
+ * framebuffer after the full frame is a golden image for that case.
+ *
+ *   render_bench [--sizes 10,50,100,200,500] [--out result.json]
+ *                [--golden result.json] [--ppm DIR]
+ *
+ * Results go to stdout as JSON (or to --out).  --golden compares the
+ * hashes with a previous result and exits 1 when any differs; --ppm writes
+ * each case's frame for a look at what changed.
+ */
+
+#include "render_host.h"
+#include "ui_common.h"
+#include "lvgl_alloc.h"
+#include "turnout_manager.h"
+#include "fake_turnout_storage.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kWidth = CONFIG_LCD_H_RES;
+constexpr int kHeight = CONFIG_LCD_V_RES;
+
+/// Partial frame: a turnout-sized square in the middle of the screen
+constexpr int kPartialSize = 64;
+
+/// Frames per measurement; the fastest is reported
+constexpr int kFrameRuns = 5;
+
+struct Options {
+    std::vector<size_t> sizes = { 10, 50, 100, 200, 500 };
+    const char *out = nullptr;
+    const char *golden = nullptr;
+    const char *ppm = nullptr;
+};
+
+struct Case {
+    std::string screen;
+    size_t items = 0;
+    uint32_t build_us = 0;
+    uint32_t full_us = 0;
+    uint32_t partial_us = 0;
+    uint32_t objects = 0;
+    uint32_t heap_used = 0;
+    uint32_t heap_peak = 0;
+    uint32_t hash = 0;
+};
+
+lv_disp_t *s_disp;
+
+uint32_t fb_hash()
+{
+    uint32_t h = 0x811c9dc5u;
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(render_host_framebuffer());
+    for (size_t i = 0; i < (size_t)kWidth * kHeight * sizeof(lv_color_t); i++) {
+        h ^= p[i];
+        h *= 0x01000193u;
+    }
+    return h;
+}
+
+uint32_t count_objects(lv_obj_t *obj)
+{
+    uint32_t n = 1;
+    uint32_t children = lv_obj_get_child_cnt(obj);
+    for (uint32_t i = 0; i < children; i++) n += count_objects(lv_obj_get_child(obj, i));
+    return n;
+}
+
+/** @brief Time kFrameRuns refreshes of @p area (NULL: the whole screen) */
+uint32_t time_frames(const lv_area_t *area)
+{
+    lv_obj_t *scr = lv_scr_act();
+    int64_t best = INT64_MAX;
+    for (int i = 0; i < kFrameRuns; i++) {
+        if (area) lv_obj_invalidate_area(scr, area);
+        else lv_obj_invalidate(scr);
+        int64_t t0 = esp_timer_get_time();
+        lv_refr_now(s_disp);
+        best = std::min(best, esp_timer_get_time() - t0);
+    }
+    return (uint32_t)best;
+}
+
+/** @brief Build a screen, then measure it: frames, objects, pool */
+void measure(Case *c, const std::function<void()> &build)
+{
+    int64_t t0 = esp_timer_get_time();
+    build();
+    c->build_us = (uint32_t)(esp_timer_get_time() - t0);
+    c->objects = count_objects(lv_scr_act());
+
+    c->full_us = time_frames(nullptr);
+    c->hash = fb_hash();
+
+    lv_area_t area = { (kWidth - kPartialSize) / 2, (kHeight - kPartialSize) / 2,
+                       (kWidth + kPartialSize) / 2 - 1, (kHeight + kPartialSize) / 2 - 1 };
+    c->partial_us = time_frames(&area);
+
+    lv_mem_monitor_t mon;
+    lvgl_alloc_monitor(&mon);
+    c->heap_used = (uint32_t)(mon.total_size - mon.free_size);
+    c->heap_peak = (uint32_t)mon.max_used;
+
+    fprintf(stderr, "%-11s %3zu items: build %6u us, full %6u us, partial %5u us, "
+            "%4u objects, heap %u KB, hash %08x\n",
+            c->screen.c_str(), c->items, c->build_us, c->full_us, c->partial_us,
+            c->objects, c->heap_used / 1024, c->hash);
+}
+
+bool write_ppm(const char *dir, const Case &c)
+{
+    std::string path = std::string(dir) + "/" + c.screen + "_" + std::to_string(c.items) + ".ppm";
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "cannot create %s\n", path.c_str());
+        return false;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", kWidth, kHeight);
+    const lv_color_t *fb = render_host_framebuffer();
+    std::vector<uint8_t> row(kWidth * 3);
+    for (int y = 0; y < kHeight; y++) {
+        for (int x = 0; x < kWidth; x++) {
+            uint32_t rgb = lv_color_to32(fb[y * kWidth + x]);
+            row[x * 3] = (uint8_t)(rgb >> 16);
+            row[x * 3 + 1] = (uint8_t)(rgb >> 8);
+            row[x * 3 + 2] = (uint8_t)rgb;
+        }
+        fwrite(row.data(), 1, row.size(), f);
+    }
+    fclose(f);
+    return true;
+}
+
+std::vector<Case> run(const Options &opt)
+{
+    std::vector<Case> cases;
+
+    for (size_t n : opt.sizes) {
+        // The previous layout is only freed once no screen shows it
+        panel_layout_t previous;
+        if (!render_host_load_layout(n, &previous)) {
+            fprintf(stderr, "cannot build a %zu-turnout layout\n", n);
+            break;
+        }
+
+        // Switchboard and builder are tabs of the same settings screen
+        const std::pair<const char *, std::function<void()>> screens[] = {
+            { "switchboard", [] { ui_show_settings_at_tab(0); } },
+            { "builder", [] { ui_show_settings_at_tab(2); } },
+            { "panel", [] { ui_create_panel_screen(); } },
+        };
+        for (const auto &s : screens) {
+            Case c;
+            c.screen = s.first;
+            c.items = n;
+            measure(&c, s.second);
+            cases.push_back(c);
+            if (opt.ppm) write_ppm(opt.ppm, c);
+        }
+        panel_layout_free(&previous);
+    }
+    return cases;
+}
+
+void write_results(FILE *f, const std::vector<Case> &cases)
+{
+    fprintf(f, "{\n  \"lvgl\": \"%d.%d.%d\",\n  \"cases\": [\n",
+            LVGL_VERSION_MAJOR, LVGL_VERSION_MINOR, LVGL_VERSION_PATCH);
+    for (size_t i = 0; i < cases.size(); i++) {
+        const Case &c = cases[i];
+        fprintf(f, "    {\"screen\": \"%s\", \"items\": %zu, \"build_us\": %u, "
+                "\"full_us\": %u, \"partial_us\": %u, \"objects\": %u, "
+                "\"heap_used\": %u, \"heap_peak\": %u, \"hash\": \"%08x\"}%s\n",
+                c.screen.c_str(), c.items, c.build_us, c.full_us, c.partial_us,
+                c.objects, c.heap_used, c.heap_peak, c.hash,
+                i + 1 < cases.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+/**
+ * @brief Compare hashes with a previous result file
+ *
+ * Reads the one-case-per-line format write_results() produces; cases
+ * missing from either side are not compared.
+ *
+ * @return Number of changed cases, or -1 if the file cannot be read
+ */
+int check_golden(const char *path, const std::vector<Case> &cases)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+    int compared = 0, changed = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char screen[32];
+        size_t items;
+        const char *h = strstr(line, "\"hash\": \"");
+        if (!h || sscanf(line, " {\"screen\": \"%31[^\"]\", \"items\": %zu", screen, &items) != 2) {
+            continue;
+        }
+        uint32_t want = (uint32_t)strtoul(h + 9, nullptr, 16);
+        for (const Case &c : cases) {
+            if (c.screen != screen || c.items != items) continue;
+            compared++;
+            if (c.hash != want) {
+                changed++;
+                fprintf(stderr, "rendering changed: %s, %zu items (%08x, golden %08x)\n",
+                        screen, items, c.hash, want);
+            }
+        }
+    }
+    fclose(f);
+    fprintf(stderr, "golden hashes: %d compared, %d changed\n", compared, changed);
+    return changed;
+}
+
+bool parse_sizes(const char *v, std::vector<size_t> *sizes)
+{
+    sizes->clear();
+    for (const char *p = v; *p;) {
+        char *end;
+        unsigned long n = strtoul(p, &end, 10);
+        if (end == p || n < 2 || n > TURNOUT_MAX_COUNT) return false;
+        sizes->push_back(n);
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    // Ascending, so the turnout table only grows
+    std::sort(sizes->begin(), sizes->end());
+    return !sizes->empty();
+}
+
+bool parse_args(int argc, char **argv, Options *opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (i + 1 >= argc) return false;
+        const char *v = argv[++i];
+        if (a == "--sizes") {
+            if (!parse_sizes(v, &opt->sizes)) return false;
+        } else if (a == "--out") opt->out = v;
+        else if (a == "--golden") opt->golden = v;
+        else if (a == "--ppm") opt->ppm = v;
+        else return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, &opt)) {
+        fprintf(stderr, "usage: %s [--sizes 10,50,100,200,500] [--out result.json]\n"
+                        "       [--golden result.json] [--ppm DIR]\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    fake_storage_reset();
+    turnout_manager_init();
+    s_disp = render_host_init();
+    if (!s_disp) return 2;
+    std::vector<Case> cases = run(opt);
+
+    FILE *out = opt.out ? fopen(opt.out, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot create %s\n", opt.out);
+        return 2;
+    }
+    write_results(out, cases);
+    if (out != stdout) fclose(out);
+
+    if (cases.size() != opt.sizes.size() * 3) return 1;
+    if (opt.golden) {
+        int changed = check_golden(opt.golden, cases);
+        if (changed != 0) return 1;
+    }
+    return 0;
+}
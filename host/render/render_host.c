@@ -0,0 +1,83 @@
+/**
+ * @file render_host.c
+ * @brief In-memory display and generated layouts for the host LVGL targets
+ */
+
+#include "render_host.h"
+#include "lvgl_alloc.h"
+#include "route_bench.h"
+#include "turnout_manager.h"
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "render";
+
+#define FB_WIDTH    CONFIG_LCD_H_RES
+#define FB_HEIGHT   CONFIG_LCD_V_RES
+
+/// Same numbering as the host tests: normal = base + 2i, reverse = base + 2i + 1
+#define EVENT_BASE  0x0501010122600000ULL
+
+static lv_color_t *s_fb = NULL;
+static lv_disp_draw_buf_t s_draw_buf;
+static lv_disp_drv_t s_drv;
+
+static void flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    int32_t w = lv_area_get_width(area);
+    for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+        memcpy(&s_fb[y * FB_WIDTH + area->x1], color_map, w * sizeof(lv_color_t));
+        color_map += w;
+    }
+    lv_disp_flush_ready(drv);
+}
+
+lv_disp_t *render_host_init(void)
+{
+    size_t draw_px = (size_t)FB_WIDTH * CONFIG_LCD_RGB_BOUNCE_BUFFER_HEIGHT;
+    s_fb = heap_caps_calloc((size_t)FB_WIDTH * FB_HEIGHT, sizeof(lv_color_t), MALLOC_CAP_SPIRAM);
+    lv_color_t *draw = heap_caps_malloc(draw_px * sizeof(lv_color_t), MALLOC_CAP_SPIRAM);
+    if (!s_fb || !draw) {
+        ESP_LOGE(TAG, "Failed to allocate the framebuffer");
+        return NULL;
+    }
+
+    lvgl_alloc_init();
+    lv_init();
+    lv_disp_draw_buf_init(&s_draw_buf, draw, NULL, (uint32_t)draw_px);
+    lv_disp_drv_init(&s_drv);
+    s_drv.hor_res = FB_WIDTH;
+    s_drv.ver_res = FB_HEIGHT;
+    s_drv.flush_cb = flush_cb;
+    s_drv.draw_buf = &s_draw_buf;
+    return lv_disp_drv_register(&s_drv);
+}
+
+const lv_color_t *render_host_framebuffer(void)
+{
+    return s_fb;
+}
+
+bool render_host_load_layout(size_t turnouts, panel_layout_t *previous)
+{
+    for (size_t i = turnout_manager_get_count(); i < turnouts; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "T%u", (unsigned)(i + 1));
+        if (turnout_manager_add(EVENT_BASE + 2 * i, EVENT_BASE + 2 * i + 1, name) < 0) {
+            return false;
+        }
+    }
+
+    panel_layout_t generated = { .index = { .valid = true } };
+    if (!route_bench_build_layout(&generated, turnouts, 0)) {
+        panel_layout_free(&generated);
+        return false;
+    }
+    panel_layout_t *live = panel_layout_get();
+    *previous = *live;
+    *live = generated;
+    return true;
+}
@@ -0,0 +1,51 @@
+/**
+ * @file render_host.h
+ * @brief In-memory display and generated layouts for the host LVGL targets
+ *
+ * Shared by render_bench and mem_budget_check.  The display is the
+ * panel's 800×480 RGB565 with one full-screen draw buffer; LVGL flushes
+ * into a framebuffer in "PSRAM", so it shows in the host heap's PSRAM
+ * figures and not against the internal RAM budget, as on the device.
+ */
+
+#ifndef RENDER_HOST_H_
+#define RENDER_HOST_H_
+
+#include "lvgl.h"
+#include "panel_layout.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialise LVGL and register the in-memory display
+ *
+ * @return The display, or NULL if the buffers cannot be allocated
+ */
+lv_disp_t *render_host_init(void);
+
+/** @brief The framebuffer, CONFIG_LCD_H_RES × CONFIG_LCD_V_RES pixels */
+const lv_color_t *render_host_framebuffer(void);
+
+/**
+ * @brief Put a generated layout of @p turnouts on the panel
+ *
+ * Turnouts 1..N are added to the turnout manager (it only grows) and the
+ * layout from route_bench_build_layout() over the same IDs replaces the
+ * panel_layout singleton.  The replaced layout is handed back: free it
+ * once no screen shows it.
+ *
+ * @param turnouts Layout size (at least 2)
+ * @param previous Receives the layout that was on the panel
+ * @return false if out of memory; the panel layout is then unchanged
+ */
+bool render_host_load_layout(size_t turnouts, panel_layout_t *previous);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RENDER_HOST_H_
@@ -0,0 +1,71 @@
+/**
+ * @file render_stubs.c
+ * @brief Display, LCC and SD hooks the screens call, for the host renderer
+ *
+ * There is one thread and no LVGL task, so the UI lock is a no-op.  Turnout
+ * commands and event registrations go nowhere, and layout saves are
+ * reported as queued.  The Add Turnout and Diagnostics tabs read the live
+ * node and hardware counters; they are left empty, so the settings screen
+ * figures cover the switchboard and builder tabs only.
+ */
+
+#include "ui_common.h"
+#include "app/lcc_node.h"
+#include "app/panel_storage.h"
+#include "esp_log.h"
+
+static const char *TAG = "render";
+
+bool ui_lock(void)
+{
+    return true;
+}
+
+void ui_unlock(void)
+{
+}
+
+void ui_set_multitouch_handler(ui_multitouch_cb_t cb)
+{
+    (void)cb;
+}
+
+void ui_create_add_turnout_tab(lv_obj_t *parent)
+{
+    (void)parent;
+}
+
+void ui_create_diagnostics_tab(lv_obj_t *parent)
+{
+    (void)parent;
+}
+
+uint16_t lcc_node_get_query_pace_ms(void)
+{
+    return 20;
+}
+
+esp_err_t lcc_node_send_event(uint64_t event_id)
+{
+    ESP_LOGD(TAG, "send_event(0x%016llx)", (unsigned long long)event_id);
+    return ESP_OK;
+}
+
+esp_err_t lcc_node_register_turnout_events(uint64_t event_normal, uint64_t event_reverse)
+{
+    (void)event_normal;
+    (void)event_reverse;
+    return ESP_OK;
+}
+
+void lcc_node_unregister_all_turnout_events(void)
+{
+}
+
+esp_err_t panel_storage_save(const panel_layout_t *layout, sd_io_done_cb_t cb, void *ctx)
+{
+    (void)layout;
+    (void)cb;
+    (void)ctx;
+    return ESP_OK;
+}
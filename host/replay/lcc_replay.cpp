@@ -0,0 +1,352 @@
+/**
+ * @file lcc_replay.cpp
+ * @brief Replay a CAN capture (can.bin) into the host build of the event path
+ *
+ * Loads the panel's turnouts.json (and panel.json for occupancy blocks)
+ * with the firmware's own parsers, then feeds every EventReport and valid
+ * ProducerIdentified in the capture through lcc_route_event() — the code
+ * TurnoutEventHandler runs on the panel — into the turnout and block
+ * managers.  Frames keep their captured spacing scaled by --speed
+ * (1 = real time, N = N× faster, max = no waiting).
+ *
+ * It prints the traffic mix, replay throughput, per-event routing cost and
+ * a digest of the final turnout and block states.  The digest does not
+ * depend on speed or timing, so a production trace and its expected
+ * result can be kept together and checked with --expect.
+ *
+ *   lcc_replay can.bin --turnouts turnouts.json [--panel panel.json]
+ *              [--speed 1|N|max] [--skip-alias 0xABC] [--dump] [--expect DIGEST]
+ */
+
+#include "lcc_route.h"
+#include "turnout_manager.h"
+#include "turnout_storage.h"
+#include "block_manager.h"
+#include "panel_storage.h"
+#include "can_capture.h"
+#include "esp_log.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace {
+
+#define CAPTURE_MAGIC       "LCCC"
+#define CAPTURE_VERSION     1
+#define CAPTURE_HEADER      16
+
+// OpenLCB message MTIs the event handler consumes
+#define MTI_EVENT_REPORT    0x5B4
+#define MTI_PC_VALID        0x544
+#define MTI_PC_INVALID      0x545
+#define MTI_PC_UNKNOWN      0x547
+
+struct Options {
+    const char *capture = nullptr;
+    const char *turnouts = nullptr;
+    const char *panel = nullptr;
+    double speed = 1;               ///< 0 = as fast as possible
+    int skip_alias = -1;
+    bool dump = false;
+    const char *expect = nullptr;
+};
+
+struct Counts {
+    uint32_t frames = 0, messages = 0, other = 0;
+    uint32_t reports = 0, pc_valid = 0, pc_other = 0, skipped = 0;
+    uint32_t routed = 0, unused = 0;
+    uint32_t turnout_changes = 0, block_changes = 0;
+};
+
+Counts s_counts;
+
+void on_turnout(int index, turnout_state_t state) { s_counts.turnout_changes++; }
+void on_block(int index, block_state_t state) { s_counts.block_changes++; }
+
+int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint32_t get_u32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+bool read_file(const char *path, std::string *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out->append(buf, n);
+    fclose(f);
+    return true;
+}
+
+/** @brief Capture records, with the header checked */
+bool load_capture(const char *path, std::vector<can_capture_record_t> *out, uint32_t *dropped)
+{
+    std::string data;
+    if (!read_file(path, &data)) {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return false;
+    }
+    const uint8_t *p = (const uint8_t *)data.data();
+    if (data.size() < CAPTURE_HEADER || memcmp(p, CAPTURE_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: not a CAN capture\n", path);
+        return false;
+    }
+    if (get_u16(p + 4) != CAPTURE_VERSION || get_u16(p + 6) != sizeof(can_capture_record_t)) {
+        fprintf(stderr, "%s: unsupported version %u / record size %u\n", path,
+                get_u16(p + 4), get_u16(p + 6));
+        return false;
+    }
+    size_t count = get_u32(p + 8);
+    *dropped = get_u32(p + 12);
+    size_t in_file = (data.size() - CAPTURE_HEADER) / sizeof(can_capture_record_t);
+    // Zero: the capture was not closed cleanly (power lost); take what was flushed
+    if (count == 0 || count > in_file) count = in_file;
+
+    out->resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *r = p + CAPTURE_HEADER + i * sizeof(can_capture_record_t);
+        can_capture_record_t &rec = (*out)[i];
+        rec.time_us = get_u32(r);
+        rec.can_id = get_u32(r + 4);
+        rec.dlc = r[8];
+        memcpy(rec.data, r + 12, 8);
+    }
+    return true;
+}
+
+bool load_turnouts(const char *path)
+{
+    std::string json;
+    if (!read_file(path, &json)) {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return false;
+    }
+    turnout_t *list = nullptr;
+    size_t capacity = 0, count = 0;
+    if (turnout_storage_parse(json.c_str(), &list, &capacity, &count) != ESP_OK) {
+        fprintf(stderr, "%s: not a turnout list\n", path);
+        free(list);
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        turnout_manager_add(list[i].event_normal, list[i].event_reverse, list[i].name);
+    }
+    free(list);
+    return true;
+}
+
+bool load_panel(const char *path, panel_layout_t *layout)
+{
+    std::string json;
+    if (!read_file(path, &json)) {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return false;
+    }
+    if (panel_storage_parse(json.c_str(), layout) != ESP_OK) {
+        fprintf(stderr, "%s: not a panel layout\n", path);
+        return false;
+    }
+    return block_manager_sync(layout) == ESP_OK;
+}
+
+/** @brief The message an OpenLCB frame carries, or false for other frames */
+bool decode(const can_capture_record_t &rec, uint16_t *mti, uint16_t *alias, uint64_t *event_id)
+{
+    if (!(rec.can_id & CAN_CAPTURE_EFF) || (rec.can_id & CAN_CAPTURE_RTR)) return false;
+    uint32_t id = rec.can_id & 0x1FFFFFFF;
+    if ((id & 0x1F000000) != 0x19000000) return false;     // single-frame message
+    *mti = (uint16_t)((id >> 12) & 0xFFF);
+    *alias = (uint16_t)(id & 0xFFF);
+    *event_id = 0;
+    if (rec.dlc == 8) {
+        for (int i = 0; i < 8; i++) *event_id = *event_id << 8 | rec.data[i];
+    }
+    return true;
+}
+
+/** @brief FNV-1a over every turnout's and block's state, in table order */
+uint64_t state_digest()
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&h](uint64_t v) {
+        for (int i = 0; i < 8; i++) {
+            h ^= (v >> (8 * i)) & 0xFF;
+            h *= 0x100000001b3ULL;
+        }
+    };
+    size_t n = turnout_manager_get_count();
+    for (size_t i = 0; i < n; i++) {
+        turnout_t t;
+        if (turnout_manager_get_by_index(i, &t) != ESP_OK) continue;
+        mix(t.event_normal);
+        mix((uint64_t)t.state);
+    }
+    n = block_manager_get_count();
+    for (size_t i = 0; i < n; i++) {
+        block_t b;
+        if (block_manager_get_by_index(i, &b) != ESP_OK) continue;
+        mix(b.event_occupied);
+        mix((uint64_t)b.state);
+    }
+    return h;
+}
+
+void dump_states()
+{
+    static const char *const turnout_names[] = { "UNKNOWN", "NORMAL", "REVERSE", "STALE" };
+    size_t n = turnout_manager_get_count();
+    for (size_t i = 0; i < n; i++) {
+        turnout_t t;
+        if (turnout_manager_get_by_index(i, &t) != ESP_OK) continue;
+        printf("turnout %-24s %016" PRIX64 " %s\n", t.name, t.event_normal,
+               (unsigned)t.state < 4 ? turnout_names[t.state] : "?");
+    }
+    n = block_manager_get_count();
+    for (size_t i = 0; i < n; i++) {
+        block_t b;
+        if (block_manager_get_by_index(i, &b) != ESP_OK) continue;
+        printf("block   %-24" PRIu32 " %016" PRIX64 " %s\n", b.id, b.event_occupied,
+               b.state == BLOCK_STATE_OCCUPIED ? "OCCUPIED" :
+               b.state == BLOCK_STATE_CLEAR ? "CLEAR" : "UNKNOWN");
+    }
+}
+
+bool parse_args(int argc, char **argv, Options *opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--dump") { opt->dump = true; continue; }
+        if (a[0] != '-') {
+            if (opt->capture) return false;
+            opt->capture = argv[i];
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char *v = argv[++i];
+        if (a == "--turnouts") opt->turnouts = v;
+        else if (a == "--panel") opt->panel = v;
+        else if (a == "--speed") opt->speed = strcmp(v, "max") == 0 ? 0 : atof(v);
+        else if (a == "--skip-alias") opt->skip_alias = (int)strtol(v, nullptr, 0);
+        else if (a == "--expect") opt->expect = v;
+        else return false;
+    }
+    return opt->capture && opt->turnouts && opt->speed >= 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, &opt)) {
+        fprintf(stderr, "usage: %s can.bin --turnouts turnouts.json [--panel panel.json]\n"
+                        "       [--speed 1|N|max] [--skip-alias ALIAS] [--dump] [--expect DIGEST]\n",
+                argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    std::vector<can_capture_record_t> frames;
+    uint32_t capture_dropped = 0;
+    if (!load_capture(opt.capture, &frames, &capture_dropped)) return 2;
+
+    turnout_manager_init();
+    block_manager_init();
+    panel_layout_t layout;
+    memset(&layout, 0, sizeof(layout));
+    if (!load_turnouts(opt.turnouts)) return 2;
+    if (opt.panel && !load_panel(opt.panel, &layout)) return 2;
+    turnout_manager_set_state_callback(on_turnout);
+    block_manager_set_state_callback(on_block);
+
+    std::vector<uint32_t> cost_ns;
+    cost_ns.reserve(frames.size());
+    uint64_t span_us = 0;
+    int64_t start = now_ns();
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        const can_capture_record_t &rec = frames[i];
+        s_counts.frames++;
+        if (i > 0) span_us += rec.time_us - frames[i - 1].time_us;     // modulo 2^32
+        if (opt.speed > 0) {
+            int64_t due = start + (int64_t)(span_us * 1000 / opt.speed);
+            struct timespec ts = { (time_t)(due / 1000000000), (long)(due % 1000000000) };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+        }
+
+        uint16_t mti, alias;
+        uint64_t event_id;
+        if (!decode(rec, &mti, &alias, &event_id)) {
+            s_counts.other++;
+            continue;
+        }
+        s_counts.messages++;
+        if (alias == opt.skip_alias) {
+            s_counts.skipped++;
+            continue;
+        }
+        if (rec.dlc != 8) continue;
+        if (mti == MTI_EVENT_REPORT) {
+            s_counts.reports++;
+        } else if (mti == MTI_PC_VALID) {
+            s_counts.pc_valid++;
+        } else {
+            // Only the valid (active) producer state carries a turnout's state
+            if (mti == MTI_PC_INVALID || mti == MTI_PC_UNKNOWN) s_counts.pc_other++;
+            continue;
+        }
+
+        int64_t t0 = now_ns();
+        bool used = lcc_route_event(event_id);
+        cost_ns.push_back((uint32_t)std::min<int64_t>(now_ns() - t0, UINT32_MAX));
+        if (used) s_counts.routed++;
+        else s_counts.unused++;
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    printf("%s: %u frames, %.1f s of traffic, %u dropped at capture\n", opt.capture,
+           s_counts.frames, span_us / 1e6, capture_dropped);
+    if (opt.speed > 0) {
+        printf("replayed at %gx in %.2f s (%.0f frames/s)\n", opt.speed, elapsed,
+               s_counts.frames / elapsed);
+    } else {
+        printf("replayed at max speed in %.3f s (%.0f frames/s)\n", elapsed,
+               s_counts.frames / elapsed);
+    }
+    printf("messages %u (other frames %u, skipped alias %u): event report %u, "
+           "PC valid %u, PC invalid/unknown %u\n", s_counts.messages, s_counts.other,
+           s_counts.skipped, s_counts.reports, s_counts.pc_valid, s_counts.pc_other);
+    printf("routed %u, unused %u; turnout changes %u, block changes %u\n",
+           s_counts.routed, s_counts.unused, s_counts.turnout_changes, s_counts.block_changes);
+    if (!cost_ns.empty()) {
+        std::sort(cost_ns.begin(), cost_ns.end());
+        uint64_t sum = 0;
+        for (uint32_t c : cost_ns) sum += c;
+        size_t n = cost_ns.size();
+        printf("route cost: mean %" PRIu64 " ns, p50 %u, p99 %u, max %u ns\n", sum / n,
+               cost_ns[n / 2], cost_ns[std::min(n - 1, n * 99 / 100)], cost_ns[n - 1]);
+    }
+    if (opt.dump) dump_states();
+
+    uint64_t digest = state_digest();
+    printf("state digest %016" PRIx64 "\n", digest);
+    panel_layout_free(&layout);
+
+    if (opt.expect && strtoull(opt.expect, nullptr, 16) != digest) {
+        fprintf(stderr, "state digest differs from expected %s\n", opt.expect);
+        return 1;
+    }
+    return 0;
+}
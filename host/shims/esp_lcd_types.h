@@ -0,0 +1,11 @@
+/**
+ * @file esp_lcd_types.h
+ * @brief Host shim: LCD handle types named by ui_common.h
+ */
+
+#ifndef HOST_ESP_LCD_TYPES_H_
+#define HOST_ESP_LCD_TYPES_H_
+
+typedef struct esp_lcd_panel_t *esp_lcd_panel_handle_t;
+
+#endif // HOST_ESP_LCD_TYPES_H_
@@ -0,0 +1,152 @@
+/**
+ * @file esp_system.c
+ * @brief Host shim: error names, logging, esp_timer and libc gaps
+ */
+
+#include "host_compat.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// Errors
+// ============================================================================
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                return "ESP_OK";
+    case ESP_FAIL:              return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+    default:                    return "UNKNOWN ERROR";
+    }
+}
+
+// ============================================================================
+// Timer
+// ============================================================================
+
+int64_t esp_timer_get_time(void)
+{
+    static int64_t s_start_us = -1;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+    int64_t expected = -1;
+    __atomic_compare_exchange_n(&s_start_us, &expected, now, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    return now - __atomic_load_n(&s_start_us, __ATOMIC_RELAXED) + 1000000;
+}
+
+// ============================================================================
+// Logging
+// ============================================================================
+
+#define LOG_TAGS    32      ///< Tags with their own level
+
+static pthread_mutex_t s_log_lock = PTHREAD_MUTEX_INITIALIZER;
+static esp_log_level_t s_default_level = ESP_LOG_INFO;
+static int s_default_set = 0;
+static struct {
+    const char *tag;        ///< Interned copy
+    esp_log_level_t level;
+} s_tags[LOG_TAGS];
+static int s_tag_count = 0;
+
+/** @brief Default level, from HOST_LOG_LEVEL on first use (lock held) */
+static esp_log_level_t default_level(void)
+{
+    if (!s_default_set) {
+        const char *env = getenv("HOST_LOG_LEVEL");
+        if (env && env[0] >= '0' && env[0] <= '5') {
+            s_default_level = (esp_log_level_t)(env[0] - '0');
+        }
+        s_default_set = 1;
+    }
+    return s_default_level;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    pthread_mutex_lock(&s_log_lock);
+    if (strcmp(tag, "*") == 0) {
+        default_level();
+        s_default_level = level;
+        // As in the IDF, "*" overrides every tag
+        for (int i = 0; i < s_tag_count; i++) free((void *)s_tags[i].tag);
+        s_tag_count = 0;
+    } else {
+        int i = 0;
+        while (i < s_tag_count && strcmp(s_tags[i].tag, tag) != 0) i++;
+        if (i == s_tag_count && s_tag_count < LOG_TAGS) {
+            s_tags[i].tag = strdup(tag);
+            s_tag_count++;
+        }
+        if (i < s_tag_count) s_tags[i].level = level;
+    }
+    pthread_mutex_unlock(&s_log_lock);
+}
+
+esp_log_level_t esp_log_level_get(const char *tag)
+{
+    pthread_mutex_lock(&s_log_lock);
+    esp_log_level_t level = default_level();
+    for (int i = 0; i < s_tag_count; i++) {
+        if (strcmp(s_tags[i].tag, tag) == 0) {
+            level = s_tags[i].level;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_log_lock);
+    return level;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    if (level > esp_log_level_get(tag)) return;
+
+    static const char letters[] = "NEWIDV";
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    fprintf(stderr, "%c (%u) %s: %s\n", letters[level], (unsigned)esp_log_timestamp(),
+            tag, line);
+}
+
+// ============================================================================
+// C library
+// ============================================================================
+
+#if HOST_NEED_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
@@ -0,0 +1,24 @@
+/**
+ * @file esp_timer.h
+ * @brief Host shim: esp_timer_get_time() on CLOCK_MONOTONIC
+ *
+ * Microseconds since the first call, offset by one second so that a time
+ * of zero never occurs (the app treats 0 as "never").
+ */
+
+#ifndef HOST_ESP_TIMER_H_
+#define HOST_ESP_TIMER_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int64_t esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_ESP_TIMER_H_
@@ -0,0 +1,357 @@
+/**
+ * @file freertos.c
+ * @brief Host shim: FreeRTOS semaphores, tasks and critical sections
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// Time
+// ============================================================================
+
+/** @brief Absolute CLOCK_MONOTONIC deadline @p ticks from now */
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ticks * (1000000000ULL / configTICK_RATE_HZ);
+    ts.tv_sec += (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec += (long)(ns % 1000000000ULL);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void cond_init_monotonic(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/**
+ * @brief Wait on @p cond until @p ready is true or the ticks run out
+ * @return true if @p ready became true (mutex held either way)
+ */
+static bool wait_until(pthread_cond_t *cond, pthread_mutex_t *mutex, TickType_t ticks,
+                       bool (*ready)(void *), void *arg)
+{
+    if (ready(arg)) return true;
+    if (ticks == 0) return false;
+
+    struct timespec deadline = deadline_after(ticks);
+    while (!ready(arg)) {
+        if (ticks == portMAX_DELAY) {
+            pthread_cond_wait(cond, mutex);
+        } else if (pthread_cond_timedwait(cond, mutex, &deadline) == ETIMEDOUT) {
+            return ready(arg);
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Critical sections
+// ============================================================================
+
+void host_port_enter_critical(portMUX_TYPE *mux)
+{
+    while (__atomic_exchange_n(&mux->owner, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&mux->owner, __ATOMIC_RELAXED)) { }
+    }
+}
+
+void host_port_exit_critical(portMUX_TYPE *mux)
+{
+    __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+}
+
+// ============================================================================
+// Tasks
+// ============================================================================
+
+struct host_task {
+    char name[configMAX_TASK_NAME_LEN];
+    TaskFunction_t fn;
+    void *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+};
+
+static __thread struct host_task *s_current = NULL;
+
+static struct host_task *task_new(const char *name)
+{
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    strncpy(t->name, name ? name : "", sizeof(t->name) - 1);
+    pthread_mutex_init(&t->lock, NULL);
+    cond_init_monotonic(&t->cond);
+    return t;
+}
+
+static void *task_entry(void *arg)
+{
+    struct host_task *t = arg;
+    s_current = t;
+    t->fn(t->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *out_handle)
+{
+    (void)stack_depth;
+    (void)priority;
+    struct host_task *t = task_new(name);
+    if (!t) return pdFAIL;
+    t->fn = fn;
+    t->arg = arg;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    int rc = pthread_create(&thread, &attr, task_entry, t);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        free(t);
+        return pdFAIL;
+    }
+    // Task handles live for the process: a notification may still be
+    // given to a task that has just deleted itself
+    if (out_handle) *out_handle = t;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *out_handle,
+                                   BaseType_t core)
+{
+    (void)core;
+    return xTaskCreate(fn, name, stack_depth, arg, priority, out_handle);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == s_current) pthread_exit(NULL);
+    abort();    // deleting another task is not supported on the host
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec deadline = deadline_after(ticks);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) { }
+}
+
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t period)
+{
+    *prev_wake += period;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(*prev_wake - now) > 0) vTaskDelay(*prev_wake - now);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / (1000000 / configTICK_RATE_HZ));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (!s_current) s_current = task_new("main");
+    return s_current;
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+    if (!task) task = xTaskGetCurrentTaskHandle();
+    return task->name;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+static bool notified(void *arg)
+{
+    return ((struct host_task *)arg)->notify != 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *t = xTaskGetCurrentTaskHandle();
+    pthread_mutex_lock(&t->lock);
+    wait_until(&t->cond, &t->lock, ticks, notified, t);
+    uint32_t value = t->notify;
+    if (value) t->notify = clear_on_exit ? 0 : value - 1;
+    pthread_mutex_unlock(&t->lock);
+    return value;
+}
+
+// ============================================================================
+// Semaphores
+// ============================================================================
+
+typedef enum {
+    SEM_MUTEX,
+    SEM_RECURSIVE,
+    SEM_COUNTING,
+} sem_kind_t;
+
+struct host_sem {
+    sem_kind_t kind;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;          ///< Available (mutexes: 1 when free)
+    UBaseType_t max;
+    TaskHandle_t holder;        ///< Mutexes only
+    UBaseType_t depth;          ///< Recursive takes by the holder
+};
+
+static SemaphoreHandle_t sem_new(sem_kind_t kind, UBaseType_t max, UBaseType_t initial)
+{
+    struct host_sem *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->kind = kind;
+    s->max = max;
+    s->count = initial;
+    pthread_mutex_init(&s->lock, NULL);
+    cond_init_monotonic(&s->cond);
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return sem_new(SEM_MUTEX, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return sem_new(SEM_RECURSIVE, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return sem_new(SEM_COUNTING, 1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return sem_new(SEM_COUNTING, max, initial);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    if (!sem) return;
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->lock);
+    free(sem);
+}
+
+static bool available(void *arg)
+{
+    return ((struct host_sem *)arg)->count != 0;
+}
+
+static BaseType_t sem_take(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    pthread_mutex_lock(&sem->lock);
+    bool ok = wait_until(&sem->cond, &sem->lock, ticks, available, sem);
+    if (ok) {
+        sem->count--;
+        if (sem->kind != SEM_COUNTING) {
+            sem->holder = xTaskGetCurrentTaskHandle();
+            sem->depth = 1;
+        }
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+static BaseType_t sem_give(SemaphoreHandle_t sem)
+{
+    BaseType_t ret = pdTRUE;
+    pthread_mutex_lock(&sem->lock);
+    if (sem->kind != SEM_COUNTING) {
+        if (sem->holder != xTaskGetCurrentTaskHandle()) {
+            ret = pdFALSE;
+        } else {
+            sem->holder = NULL;
+            sem->depth = 0;
+            sem->count = 1;
+            pthread_cond_signal(&sem->cond);
+        }
+    } else if (sem->count >= sem->max) {
+        ret = pdFALSE;
+    } else {
+        sem->count++;
+        pthread_cond_signal(&sem->cond);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    return sem_take(sem, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return sem_give(sem);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    pthread_mutex_lock(&sem->lock);
+    if (sem->holder == xTaskGetCurrentTaskHandle()) {
+        sem->depth++;
+        pthread_mutex_unlock(&sem->lock);
+        return pdTRUE;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return sem_take(sem, ticks);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    if (sem->holder != xTaskGetCurrentTaskHandle()) {
+        pthread_mutex_unlock(&sem->lock);
+        return pdFALSE;
+    }
+    if (sem->depth > 1) {
+        sem->depth--;
+        pthread_mutex_unlock(&sem->lock);
+        return pdTRUE;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return sem_give(sem);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    UBaseType_t count = sem->count;
+    pthread_mutex_unlock(&sem->lock);
+    return count;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host shim: FreeRTOS types, ticks and critical sections
+ *
+ * Only what the app layer uses.  A tick is one millisecond.  Critical
+ * sections are spinlocks, as on the dual-core ESP32-S3, but without
+ * disabling interrupts — host threads have none to mask.
+ */
+
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE                 ((BaseType_t)0)
+#define pdTRUE                  ((BaseType_t)1)
+#define pdFAIL                  pdFALSE
+#define pdPASS                  pdTRUE
+
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ      1000
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define configMAX_TASK_NAME_LEN 16
+#define tskIDLE_PRIORITY        0
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+/** @brief Spinlock standing in for portMUX_TYPE */
+typedef struct {
+    volatile int owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+
+void host_port_enter_critical(portMUX_TYPE *mux);
+void host_port_exit_critical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)         host_port_enter_critical(mux)
+#define portEXIT_CRITICAL(mux)          host_port_exit_critical(mux)
+#define portENTER_CRITICAL_ISR(mux)     host_port_enter_critical(mux)
+#define portEXIT_CRITICAL_ISR(mux)      host_port_exit_critical(mux)
+#define taskENTER_CRITICAL(mux)         host_port_enter_critical(mux)
+#define taskEXIT_CRITICAL(mux)          host_port_exit_critical(mux)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_FREERTOS_H_
@@ -0,0 +1,39 @@
+/**
+ * @file semphr.h
+ * @brief Host shim: FreeRTOS semaphores on pthreads
+ *
+ * Mutexes, recursive mutexes, binary and counting semaphores share one
+ * pthread mutex + condition variable object.  Timeouts are in ticks (ms).
+ * A plain mutex given by a task that does not hold it fails, as on target.
+ */
+
+#ifndef HOST_SEMPHR_H_
+#define HOST_SEMPHR_H_
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_sem *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem);
+
+#define xSemaphoreGiveFromISR(sem, woken)   xSemaphoreGive(sem)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SEMPHR_H_
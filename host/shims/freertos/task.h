@@ -0,0 +1,45 @@
+/**
+ * @file task.h
+ * @brief Host shim: FreeRTOS tasks on pthreads
+ *
+ * Each task is a detached thread.  Priorities, stack sizes and core
+ * affinity are accepted and ignored.  The thread that first calls into the
+ * shim without being a task (main, a test) gets a handle named "main".
+ * Direct-to-task notifications are a counting value per task.
+ */
+
+#ifndef HOST_TASK_H_
+#define HOST_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *out_handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *out_handle,
+                                   BaseType_t core);
+
+/** @brief Only NULL (the calling task) is supported */
+void vTaskDelete(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t period);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char *pcTaskGetName(TaskHandle_t task);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_TASK_H_
@@ -0,0 +1,333 @@
+/**
+ * @file heap.c
+ * @brief Host shim: heap_caps on malloc, with process-wide accounting
+ *
+ * malloc, calloc, realloc, free and the aligned allocators are replaced
+ * here and forward to glibc's implementations, counting usable sizes.
+ * Blocks requested with MALLOC_CAP_SPIRAM are remembered in a fixed
+ * open-addressing set so that whichever free() releases them (the app
+ * mixes heap_caps_free and free, as the IDF allows) credits PSRAM.
+ * The set is static (the accounting must not allocate) and uses linear
+ * probing with backward-shift deletion, so it never fills with tombstones.
+ */
+
+#include "esp_heap_caps.h"
+#include "host_heap.h"
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+extern void __libc_free(void *ptr);
+
+#define PSRAM_SET_SLOTS     (1u << 20)  ///< Live PSRAM blocks tracked at most (half full)
+#define PSRAM_SET_MASK      (PSRAM_SET_SLOTS - 1)
+
+static uintptr_t s_psram_set[PSRAM_SET_SLOTS];
+static size_t s_psram_live;
+static volatile int s_lock;
+
+static size_t s_used[2];                ///< [0] internal, [1] PSRAM
+static size_t s_peak[2];
+static uint64_t s_allocs;
+static uint64_t s_frees;
+static uint32_t s_fail_at;              ///< heap_caps calls until the first failure
+static uint32_t s_fail_count;
+
+static void lock(void)
+{
+    while (__atomic_exchange_n(&s_lock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&s_lock, __ATOMIC_RELAXED)) { }
+    }
+}
+
+static void unlock(void)
+{
+    __atomic_store_n(&s_lock, 0, __ATOMIC_RELEASE);
+}
+
+static size_t slot_of(const void *ptr)
+{
+    uint64_t h = (uintptr_t)ptr;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h & (PSRAM_SET_SLOTS - 1);
+}
+
+/** @brief Remember a PSRAM block; false when the set is full (lock held) */
+static bool psram_insert(const void *ptr)
+{
+    if (s_psram_live >= PSRAM_SET_SLOTS / 2) return false;
+    size_t s = slot_of(ptr);
+    while (s_psram_set[s] != 0) s = (s + 1) & PSRAM_SET_MASK;
+    s_psram_set[s] = (uintptr_t)ptr;
+    s_psram_live++;
+    return true;
+}
+
+/** @brief Forget a block; true if it was a PSRAM block (lock held) */
+static bool psram_remove(const void *ptr)
+{
+    if (s_psram_live == 0) return false;
+    size_t s = slot_of(ptr);
+    while (s_psram_set[s] != (uintptr_t)ptr) {
+        if (s_psram_set[s] == 0) return false;
+        s = (s + 1) & PSRAM_SET_MASK;
+    }
+
+    // Pull later entries of the probe run back over the hole
+    for (size_t next = (s + 1) & PSRAM_SET_MASK; s_psram_set[next] != 0;
+         next = (next + 1) & PSRAM_SET_MASK) {
+        size_t home = slot_of((const void *)s_psram_set[next]);
+        if (((next - home) & PSRAM_SET_MASK) >= ((next - s) & PSRAM_SET_MASK)) {
+            s_psram_set[s] = s_psram_set[next];
+            s = next;
+        }
+    }
+    s_psram_set[s] = 0;
+    s_psram_live--;
+    return true;
+}
+
+static void account_alloc(void *ptr, bool psram)
+{
+    if (!ptr) return;
+    size_t size = malloc_usable_size(ptr);
+    lock();
+    if (psram && !psram_insert(ptr)) psram = false;
+    s_used[psram] += size;
+    if (s_used[psram] > s_peak[psram]) s_peak[psram] = s_used[psram];
+    s_allocs++;
+    unlock();
+}
+
+static void account_free(void *ptr)
+{
+    if (!ptr) return;
+    size_t size = malloc_usable_size(ptr);
+    lock();
+    bool psram = psram_remove(ptr);
+    s_used[psram] -= size;
+    s_frees++;
+    unlock();
+}
+
+/** @brief Whether this heap_caps request is to fail (failure injection) */
+static bool inject_failure(void)
+{
+    bool fail = false;
+    lock();
+    if (s_fail_at && --s_fail_at == 0) {
+        fail = true;
+        if (--s_fail_count) s_fail_at = 1;
+    }
+    unlock();
+    return fail;
+}
+
+// ============================================================================
+// C library allocator
+// ============================================================================
+
+void *malloc(size_t size)
+{
+    void *p = __libc_malloc(size);
+    account_alloc(p, false);
+    return p;
+}
+
+void *calloc(size_t n, size_t size)
+{
+    void *p = __libc_calloc(n, size);
+    account_alloc(p, false);
+    return p;
+}
+
+/**
+ * @brief realloc accounting the result to PSRAM (@p psram 1), internal RAM
+ *        (0) or the region the block was in (-1)
+ */
+static void *realloc_in(void *ptr, size_t size, int region)
+{
+    if (!ptr) {
+        void *p = __libc_malloc(size);
+        account_alloc(p, region > 0);
+        return p;
+    }
+    if (size == 0) {
+        account_free(ptr);
+        __libc_free(ptr);
+        return NULL;
+    }
+
+    // Account the old block out first: once realloc succeeds it may be gone
+    size_t old_size = malloc_usable_size(ptr);
+    lock();
+    bool psram = psram_remove(ptr);
+    s_used[psram] -= old_size;
+    unlock();
+
+    void *p = __libc_realloc(ptr, size);
+    lock();
+    if (!p) {
+        // Unchanged; put it back
+        if (psram) psram_insert(ptr);
+        s_used[psram] += old_size;
+        unlock();
+        return NULL;
+    }
+    if (p != ptr) {
+        s_allocs++;
+        s_frees++;
+    }
+    if (region >= 0) psram = region > 0;
+    if (psram && !psram_insert(p)) psram = false;
+    s_used[psram] += malloc_usable_size(p);
+    if (s_used[psram] > s_peak[psram]) s_peak[psram] = s_used[psram];
+    unlock();
+    return p;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    return realloc_in(ptr, size, -1);
+}
+
+void free(void *ptr)
+{
+    account_free(ptr);
+    __libc_free(ptr);
+}
+
+void *memalign(size_t align, size_t size)
+{
+    void *p = __libc_memalign(align, size);
+    account_alloc(p, false);
+    return p;
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    return memalign(align, size);
+}
+
+int posix_memalign(void **out, size_t align, size_t size)
+{
+    void *p = memalign(align, size);
+    if (!p) return 12;  // ENOMEM
+    *out = p;
+    return 0;
+}
+
+// ============================================================================
+// heap_caps
+// ============================================================================
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    if (inject_failure()) return NULL;
+    void *p = __libc_malloc(size);
+    account_alloc(p, (caps & MALLOC_CAP_SPIRAM) != 0);
+    return p;
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    if (inject_failure()) return NULL;
+    void *p = __libc_calloc(n, size);
+    account_alloc(p, (caps & MALLOC_CAP_SPIRAM) != 0);
+    return p;
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    if (size && inject_failure()) return NULL;
+    return realloc_in(ptr, size, (caps & MALLOC_CAP_SPIRAM) != 0);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+static size_t region_size(uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? HOST_HEAP_PSRAM_SIZE : HOST_HEAP_INTERNAL_SIZE;
+}
+
+static size_t region_used(uint32_t caps, bool peak)
+{
+    bool psram = (caps & MALLOC_CAP_SPIRAM) != 0;
+    lock();
+    size_t used = peak ? s_peak[psram] : s_used[psram];
+    unlock();
+    return used;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps)
+{
+    return region_size(caps);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    size_t used = region_used(caps, false);
+    return used < region_size(caps) ? region_size(caps) - used : 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    size_t peak = region_used(caps, true);
+    return peak < region_size(caps) ? region_size(caps) - peak : 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return heap_caps_get_free_size(caps);
+}
+
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps)
+{
+    memset(info, 0, sizeof(*info));
+    info->total_free_bytes = heap_caps_get_free_size(caps);
+    info->total_allocated_bytes = region_used(caps, false);
+    info->largest_free_block = info->total_free_bytes;
+    info->minimum_free_bytes = heap_caps_get_minimum_free_size(caps);
+}
+
+// ============================================================================
+// Accounting
+// ============================================================================
+
+void host_heap_get_stats(host_heap_stats_t *out)
+{
+    lock();
+    out->internal_used = s_used[0];
+    out->internal_peak = s_peak[0];
+    out->psram_used = s_used[1];
+    out->psram_peak = s_peak[1];
+    out->allocs = s_allocs;
+    out->frees = s_frees;
+    unlock();
+}
+
+void host_heap_reset_peaks(void)
+{
+    lock();
+    s_peak[0] = s_used[0];
+    s_peak[1] = s_used[1];
+    unlock();
+}
+
+void host_heap_fail_after(uint32_t nth, uint32_t count)
+{
+    lock();
+    s_fail_at = nth;
+    s_fail_count = count ? count : 1;
+    unlock();
+}
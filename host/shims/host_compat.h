@@ -0,0 +1,28 @@
+/**
+ * @file host_compat.h
+ * @brief Host shim: newlib functions the app uses that older glibc lacks
+ *
+ * Included ahead of every app source by the host build (-include).
+ */
+
+#ifndef HOST_COMPAT_H_
+#define HOST_COMPAT_H_
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+#define HOST_NEED_STRLCPY 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+
+#endif // HOST_COMPAT_H_
@@ -0,0 +1,53 @@
+/**
+ * @file host_heap.h
+ * @brief Host heap accounting and allocation failure injection
+ *
+ * The shim library replaces malloc, calloc, realloc and free, so every
+ * allocation in the process is counted — the app's, cJSON's and the test
+ * framework's alike.  Measure a region of code by taking stats before and
+ * after it on one thread.
+ */
+
+#ifndef HOST_HEAP_H_
+#define HOST_HEAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Region sizes reported to heap_caps queries (ESP32-S3 with 8 MB PSRAM)
+#define HOST_HEAP_INTERNAL_SIZE (320 * 1024)
+#define HOST_HEAP_PSRAM_SIZE    (8 * 1024 * 1024)
+
+/** @brief Heap accounting since start (bytes are usable sizes) */
+typedef struct {
+    size_t   internal_used;
+    size_t   internal_peak;
+    size_t   psram_used;
+    size_t   psram_peak;
+    uint64_t allocs;            ///< Successful allocations (realloc counts when it moves)
+    uint64_t frees;
+} host_heap_stats_t;
+
+void host_heap_get_stats(host_heap_stats_t *out);
+
+/** @brief Restart the peaks from the current use */
+void host_heap_reset_peaks(void);
+
+/**
+ * @brief Fail a heap_caps allocation
+ *
+ * The @p nth heap_caps_malloc/calloc/realloc from now (1 = the next) returns
+ * NULL, and so do the @p count - 1 after it.  Plain malloc never fails, so
+ * the test framework is unaffected.  0 disarms.
+ */
+void host_heap_fail_after(uint32_t nth, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_HEAP_H_
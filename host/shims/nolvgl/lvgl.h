@@ -0,0 +1,37 @@
+/**
+ * @file lvgl.h
+ * @brief Host shim: the LVGL types the app layer names, without LVGL
+ *
+ * panel_geometry and ui_common.h use lv_point_t and pass LVGL objects by
+ * pointer only.  Targets built against the real LVGL leave this directory
+ * off their include path.
+ */
+
+#ifndef HOST_NOLVGL_H_
+#define HOST_NOLVGL_H_
+
+#include <stdint.h>
+
+typedef int16_t lv_coord_t;
+
+typedef struct {
+    lv_coord_t x;
+    lv_coord_t y;
+} lv_point_t;
+
+typedef struct {
+    uint32_t total_size;
+    uint32_t free_cnt;
+    uint32_t free_size;
+    uint32_t free_biggest_size;
+    uint32_t used_cnt;
+    uint32_t max_used;
+    uint8_t used_pct;
+    uint8_t frag_pct;
+} lv_mem_monitor_t;
+
+typedef struct _lv_obj_t lv_obj_t;
+typedef struct _lv_disp_t lv_disp_t;
+typedef struct _lv_indev_t lv_indev_t;
+
+#endif // HOST_NOLVGL_H_
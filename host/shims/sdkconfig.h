@@ -0,0 +1,32 @@
+/**
+ * @file sdkconfig.h
+ * @brief Host shim: the configuration the host build compiles against
+ *
+ * Diagnostics that need the device (lock profiler, trace ring, on-device
+ * benchmarks) are off; as in a generated sdkconfig.h, a disabled bool is
+ * simply not defined.  The memory budget checks are on, at the values the
+ * Kconfig help suggests, for mem_budget_check.  Other values are the
+ * Kconfig defaults.
+ */
+
+#ifndef HOST_SDKCONFIG_H_
+#define HOST_SDKCONFIG_H_
+
+#define CONFIG_IDF_TARGET_ESP32S3           1
+#define CONFIG_SPIRAM                       1
+#define CONFIG_TRACE_RING_RECORDS           0
+#define CONFIG_ROUTE_BENCH_TURNOUTS         0
+#define CONFIG_MEM_BUDGET_NAV_CYCLES        100
+#define CONFIG_MEM_BUDGET_INTERNAL_KB       32
+
+#define CONFIG_LCD_H_RES                    800
+#define CONFIG_LCD_V_RES                    480
+#define CONFIG_LCD_RGB_BOUNCE_BUFFER_HEIGHT 480
+
+#define CONFIG_LVGL_TICK_PERIOD_MS          2
+#define CONFIG_LVGL_TASK_MAX_DELAY_MS       500
+#define CONFIG_LVGL_TASK_MIN_DELAY_MS       1
+#define CONFIG_LVGL_TASK_PRIORITY           2
+#define CONFIG_LVGL_TASK_STACK_SIZE_KB      8
+
+#endif // HOST_SDKCONFIG_H_
@@ -0,0 +1,577 @@
+/**
+ * @file lcc_soak.cpp
+ * @brief LCC bus load soak test on OpenMRN's Linux port
+ *
+ * Runs the panel's LCC node (lcc_node.cpp, TurnoutEventHandler, the turnout
+ * and block managers) with its GridConnect TCP hub on loopback, and drives
+ * it from a generator thread connected as another hub client.  The
+ * generator emits event reports and ProducerIdentified for the panel's
+ * turnouts, foreign events no turnout uses, and node reboots (alias
+ * reservation, InitializationComplete, then a ProducerIdentified burst) at
+ * a rate derived from the target CAN bus load.
+ *
+ * Every event-carrying frame is stamped into a send-order ring; the
+ * receive hook on the executor matches it and bins the wire-to-handler
+ * delay.  Frames the hook never sees are lost in the stack.  After the
+ * run, every turnout's state is compared with the last state the generator
+ * sent for it; mismatches are dropped updates.  The exit status is 1 if
+ * anything was lost or dropped.
+ *
+ *   lcc_soak [--load 0.9] [--duration 60] [--turnouts 200] [--reboot 10]
+ *            [--mix REPORT,PC,FOREIGN] [--port 12021]
+ */
+
+#include "lcc_node.h"
+#include "turnout_manager.h"
+#include "block_manager.h"
+#include "fake_turnout_storage.h"
+#include "esp_log.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+#define CAN_BITRATE         125000
+#define FRAME_BITS          150     ///< 29-bit ID, 8 data bytes, typical stuffing
+#define REPORT_S            5
+#define TICK_US             1000
+#define DRAIN_MS            2000    ///< Wait for queued frames after the run
+#define REBOOT_BURST        32      ///< ProducerIdentified a rebooted node sends
+
+#define EVENT_BASE          0x0501010122600000ULL
+#define FOREIGN_BASE        0x05010101FD000000ULL
+#define SOURCE_NODE_BASE    0x0501010122E0ULL
+#define SOURCE_NODES        8
+#define SOURCE_ALIAS_BASE   0x200
+
+/// In-flight frames the send-order ring can track (power of two)
+#define RING_SLOTS          65536
+/// How far the hook looks ahead for a frame before calling it unmatched
+#define RING_LOOKAHEAD      64
+
+/// Latency histogram: 10 µs buckets up to 100 ms, then one overflow bucket
+#define LAT_BUCKET_US       10
+#define LAT_BUCKETS         10000
+
+// OpenLCB message MTIs and CAN control frames
+#define MTI_INIT_COMPLETE   0x100
+#define MTI_PC_VALID        0x544
+#define MTI_PC_INVALID      0x545
+#define MTI_EVENT_REPORT    0x5B4
+#define CAN_RID             0x0700
+#define CAN_AMD             0x0701
+#define CAN_AMR             0x0703
+
+struct Options {
+    double load = 0.9;
+    int duration_s = 60;
+    int turnouts = 200;
+    int reboot_s = 10;
+    int mix[3] = { 50, 20, 30 };    ///< report, ProducerIdentified, foreign (%)
+    int port = 12021;
+};
+
+// ============================================================================
+// Shared state
+// ============================================================================
+
+struct Slot {
+    std::atomic<uint64_t> event{0};
+    std::atomic<int64_t> time_ns{0};
+};
+
+Slot *s_ring;
+std::atomic<uint32_t> s_head{0};         ///< Next slot the generator fills
+std::atomic<uint32_t> s_tail{0};         ///< Next slot the hook expects
+std::atomic<uint32_t> s_hist[LAT_BUCKETS + 1];
+std::atomic<uint32_t> s_matched{0};
+std::atomic<uint32_t> s_lost{0};         ///< Skipped over: sent, never handled
+std::atomic<uint32_t> s_unmatched{0};    ///< Handled, not found in the ring
+std::atomic<uint32_t> s_overruns{0};     ///< Ring full: backlog beyond RING_SLOTS
+std::atomic<uint32_t> s_ui_updates{0};
+std::atomic<uint32_t> s_frames_sent{0};
+std::atomic<uint32_t> s_frames_rx{0};
+std::atomic<bool> s_exec_clock_valid{false};
+clockid_t s_exec_clock;
+
+/// Last state sent for each turnout (generator thread only)
+std::vector<turnout_state_t> s_expected;
+
+int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t normal_event(int i) { return EVENT_BASE + 2 * (uint64_t)i; }
+uint64_t reverse_event(int i) { return EVENT_BASE + 2 * (uint64_t)i + 1; }
+
+// ============================================================================
+// Receive side (LCC executor)
+// ============================================================================
+
+void rx_hook(uint64_t event_id)
+{
+    if (!s_exec_clock_valid.load(std::memory_order_relaxed)) {
+        pthread_getcpuclockid(pthread_self(), &s_exec_clock);
+        s_exec_clock_valid.store(true, std::memory_order_release);
+    }
+
+    int64_t now = now_ns();
+    uint32_t tail = s_tail.load(std::memory_order_relaxed);
+    uint32_t head = s_head.load(std::memory_order_acquire);
+    uint32_t limit = std::min<uint32_t>(head - tail, RING_LOOKAHEAD);
+    for (uint32_t k = 0; k < limit; k++) {
+        Slot &slot = s_ring[(tail + k) & (RING_SLOTS - 1)];
+        if (slot.event.load(std::memory_order_relaxed) != event_id) continue;
+
+        int64_t us = (now - slot.time_ns.load(std::memory_order_relaxed)) / 1000;
+        size_t bucket = std::min<size_t>((size_t)(us / LAT_BUCKET_US), LAT_BUCKETS);
+        s_hist[bucket].fetch_add(1, std::memory_order_relaxed);
+        s_matched.fetch_add(1, std::memory_order_relaxed);
+        if (k) s_lost.fetch_add(k, std::memory_order_relaxed);
+        s_tail.store(tail + k + 1, std::memory_order_release);
+        return;
+    }
+    s_unmatched.fetch_add(1, std::memory_order_relaxed);
+}
+
+void state_changed(int index, turnout_state_t state)
+{
+    s_ui_updates.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// Generator
+// ============================================================================
+
+/** @brief GridConnect frames for one tick, written to the hub in one call */
+class FrameBuffer {
+public:
+    void frame(uint32_t can_id, const uint8_t *data, size_t len)
+    {
+        char buf[40];
+        int n = snprintf(buf, sizeof(buf), ":X%08XN", (unsigned)can_id);
+        for (size_t i = 0; i < len; i++) {
+            n += snprintf(buf + n, sizeof(buf) - n, "%02X", data[i]);
+        }
+        buf[n++] = ';';
+        text_.append(buf, (size_t)n);
+        frames_++;
+    }
+
+    void message(uint16_t mti, uint16_t alias, uint64_t payload, size_t len)
+    {
+        uint8_t data[8];
+        for (size_t i = 0; i < len; i++) data[i] = (uint8_t)(payload >> (8 * (len - 1 - i)));
+        frame(0x19000000u | ((uint32_t)mti << 12) | alias, data, len);
+    }
+
+    void control(uint32_t content, uint16_t alias, uint64_t node_id, bool with_id)
+    {
+        uint8_t data[6];
+        for (size_t i = 0; i < 6; i++) data[i] = (uint8_t)(node_id >> (8 * (5 - i)));
+        frame(0x10000000u | (content << 12) | alias, data, with_id ? 6 : 0);
+    }
+
+    uint32_t pending() const { return frames_; }
+
+    bool flush(int fd)
+    {
+        size_t off = 0;
+        while (off < text_.size()) {
+            ssize_t n = ::write(fd, text_.data() + off, text_.size() - off);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            off += (size_t)n;
+        }
+        s_frames_sent.fetch_add(frames_, std::memory_order_relaxed);
+        text_.clear();
+        frames_ = 0;
+        return true;
+    }
+
+private:
+    std::string text_;
+    uint32_t frames_ = 0;
+};
+
+/** @brief Stamp an event-carrying frame into the send-order ring */
+bool stamp(uint64_t event_id)
+{
+    uint32_t head = s_head.load(std::memory_order_relaxed);
+    if (head - s_tail.load(std::memory_order_acquire) >= RING_SLOTS) {
+        s_overruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Slot &slot = s_ring[head & (RING_SLOTS - 1)];
+    slot.event.store(event_id, std::memory_order_relaxed);
+    slot.time_ns.store(now_ns(), std::memory_order_relaxed);
+    s_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+class Generator {
+public:
+    Generator(const Options &opt, int fd) : opt_(opt), fd_(fd), rng_(0x5eed) {}
+
+    /// Reserve every source node's alias, as nodes joining the bus do
+    void announce()
+    {
+        for (uint16_t k = 0; k < SOURCE_NODES; k++) reserve_alias(k);
+        out_.flush(fd_);
+    }
+
+    bool event(uint16_t mti, uint16_t alias, uint64_t event_id)
+    {
+        if (!stamp(event_id)) return false;
+        out_.message(mti, alias, event_id, 8);
+        return true;
+    }
+
+    /// One message of the configured mix; returns the frames it queued
+    uint32_t next()
+    {
+        uint32_t before = out_.pending();
+        uint16_t alias = SOURCE_ALIAS_BASE + (uint16_t)(rng_() % SOURCE_NODES);
+        int pick = (int)(rng_() % 100);
+        int t = (int)(rng_() % (uint32_t)opt_.turnouts);
+        bool reverse = rng_() & 1;
+        uint64_t ev = reverse ? reverse_event(t) : normal_event(t);
+
+        if (pick < opt_.mix[0]) {
+            if (event(MTI_EVENT_REPORT, alias, ev)) {
+                s_expected[t] = reverse ? TURNOUT_STATE_REVERSE : TURNOUT_STATE_NORMAL;
+            }
+        } else if (pick < opt_.mix[0] + opt_.mix[1]) {
+            // A producer answers for both events, in either order; only the
+            // active one is valid
+            uint64_t valid = reverse ? reverse_event(t) : normal_event(t);
+            uint64_t invalid = reverse ? normal_event(t) : reverse_event(t);
+            bool sent;
+            if (rng_() & 1) {
+                sent = event(MTI_PC_VALID, alias, valid);
+                event(MTI_PC_INVALID, alias, invalid);
+            } else {
+                event(MTI_PC_INVALID, alias, invalid);
+                sent = event(MTI_PC_VALID, alias, valid);
+            }
+            if (sent) s_expected[t] = reverse ? TURNOUT_STATE_REVERSE : TURNOUT_STATE_NORMAL;
+        } else {
+            event(MTI_EVENT_REPORT, alias, FOREIGN_BASE | (foreign_seq_++ & 0xFFFFFF));
+        }
+        return out_.pending() - before;
+    }
+
+    /// A source node drops off and rejoins, then reports its turnouts
+    uint32_t reboot()
+    {
+        uint32_t before = out_.pending();
+        uint16_t k = (uint16_t)(rng_() % SOURCE_NODES);
+        uint16_t alias = SOURCE_ALIAS_BASE + k;
+        out_.control(CAN_AMR, alias, SOURCE_NODE_BASE + k, true);
+        reserve_alias(k);
+        out_.message(MTI_INIT_COMPLETE, alias, SOURCE_NODE_BASE + k, 6);
+        int first = (int)(rng_() % (uint32_t)opt_.turnouts);
+        for (int n = 0; n < REBOOT_BURST && n < opt_.turnouts; n++) {
+            int t = (first + n) % opt_.turnouts;
+            if (s_expected[t] == TURNOUT_STATE_UNKNOWN) s_expected[t] = TURNOUT_STATE_NORMAL;
+            bool reverse = s_expected[t] == TURNOUT_STATE_REVERSE;
+            if (!event(MTI_PC_VALID, alias, reverse ? reverse_event(t) : normal_event(t))) {
+                s_expected[t] = TURNOUT_STATE_UNKNOWN;   // not sent: no expectation
+                continue;
+            }
+            event(MTI_PC_INVALID, alias, reverse ? normal_event(t) : reverse_event(t));
+        }
+        reboots_++;
+        return out_.pending() - before;
+    }
+
+    bool flush() { return out_.flush(fd_); }
+    uint32_t reboots() const { return reboots_; }
+
+private:
+    void reserve_alias(uint16_t k)
+    {
+        uint64_t id = SOURCE_NODE_BASE + k;
+        uint16_t alias = SOURCE_ALIAS_BASE + k;
+        for (uint32_t cid = 7; cid >= 4; cid--) {
+            uint32_t bits = (uint32_t)(id >> (12 * (cid - 4))) & 0xFFF;
+            out_.frame((cid << 24) | (bits << 12) | alias | 0x10000000u, nullptr, 0);
+        }
+        out_.control(CAN_RID, alias, 0, false);
+        out_.control(CAN_AMD, alias, id, true);
+    }
+
+    const Options &opt_;
+    int fd_;
+    std::mt19937 rng_;
+    FrameBuffer out_;
+    uint32_t foreign_seq_ = 0;
+    uint32_t reboots_ = 0;
+};
+
+/** @brief Discard what the node sends back, so the hub never blocks on us */
+void drain_socket(int fd)
+{
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+        s_frames_rx.fetch_add((uint32_t)std::count(buf, buf + n, ';'),
+                              std::memory_order_relaxed);
+    }
+}
+
+int connect_hub(int port)
+{
+    for (int attempt = 0; attempt < 50; attempt++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+        close(fd);
+        usleep(100000);
+    }
+    return -1;
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+uint32_t percentile(const std::vector<uint32_t> &hist, uint32_t total, double p)
+{
+    uint32_t want = (uint32_t)(total * p);
+    uint32_t seen = 0;
+    for (size_t i = 0; i < hist.size(); i++) {
+        seen += hist[i];
+        if (seen > want) return (uint32_t)(i * LAT_BUCKET_US);
+    }
+    return LAT_BUCKETS * LAT_BUCKET_US;
+}
+
+struct Sample {
+    std::vector<uint32_t> hist = std::vector<uint32_t>(LAT_BUCKETS + 1);
+    uint32_t matched = 0, lost = 0, sent = 0;
+    int64_t exec_cpu_ns = 0;
+    int64_t proc_cpu_ns = 0;
+
+    void take()
+    {
+        for (size_t i = 0; i <= LAT_BUCKETS; i++) hist[i] = s_hist[i].load(std::memory_order_relaxed);
+        matched = s_matched.load(std::memory_order_relaxed);
+        lost = s_lost.load(std::memory_order_relaxed);
+        sent = s_frames_sent.load(std::memory_order_relaxed);
+        exec_cpu_ns = s_exec_clock_valid.load(std::memory_order_acquire) ? clock_ns(s_exec_clock) : 0;
+        proc_cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    }
+};
+
+void report(const char *label, const Sample &a, const Sample &b, double seconds)
+{
+    std::vector<uint32_t> window(LAT_BUCKETS + 1);
+    uint32_t total = 0;
+    uint32_t max_bucket = 0;
+    for (size_t i = 0; i <= LAT_BUCKETS; i++) {
+        window[i] = b.hist[i] - a.hist[i];
+        total += window[i];
+        if (window[i]) max_bucket = (uint32_t)i;
+    }
+    uint32_t handled = b.matched - a.matched;
+    double exec_us = handled ? (b.exec_cpu_ns - a.exec_cpu_ns) / 1000.0 / handled : 0;
+    printf("%-6s %6.0f fr/s  latency p50 %5u p90 %5u p99 %5u max %6u us  "
+           "backlog %5u  lost %u  exec %.1f us/ev  cpu %.0f%%\n",
+           label, (b.sent - a.sent) / seconds,
+           percentile(window, total, 0.50), percentile(window, total, 0.90),
+           percentile(window, total, 0.99), max_bucket * LAT_BUCKET_US,
+           s_head.load() - s_tail.load(), b.lost - a.lost, exec_us,
+           100.0 * (b.proc_cpu_ns - a.proc_cpu_ns) / (seconds * 1e9));
+}
+
+bool parse_args(int argc, char **argv, Options *opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v) return false;
+        if (a == "--load") opt->load = atof(v);
+        else if (a == "--duration") opt->duration_s = atoi(v);
+        else if (a == "--turnouts") opt->turnouts = atoi(v);
+        else if (a == "--reboot") opt->reboot_s = atoi(v);
+        else if (a == "--port") opt->port = atoi(v);
+        else if (a == "--mix") {
+            if (sscanf(v, "%d,%d,%d", &opt->mix[0], &opt->mix[1], &opt->mix[2]) != 3) return false;
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return opt->load > 0 && opt->duration_s > 0 && opt->turnouts > 0 &&
+           opt->mix[0] + opt->mix[1] + opt->mix[2] == 100;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, &opt)) {
+        fprintf(stderr, "usage: %s [--load 0.9] [--duration 60] [--turnouts 200] "
+                        "[--reboot 10] [--mix 50,20,30] [--port 12021]\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    // lcc_node keeps nodeid.txt and openmrn_config in the working directory
+    char dir[] = "/tmp/lcc_soak.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("lcc_soak: work directory");
+        return 2;
+    }
+
+    std::vector<turnout_t> table((size_t)opt.turnouts);
+    for (int i = 0; i < opt.turnouts; i++) {
+        turnout_t &t = table[(size_t)i];
+        memset(&t, 0, sizeof(t));
+        t.id = (uint32_t)i + 1;
+        t.event_normal = normal_event(i);
+        t.event_reverse = reverse_event(i);
+        snprintf(t.name, sizeof(t.name), "T%d", i + 1);
+    }
+    fake_storage_set_turnouts(table.data(), table.size());
+    turnout_manager_init();
+    block_manager_init();
+    turnout_manager_set_state_callback(state_changed);
+    s_expected.assign((size_t)opt.turnouts, TURNOUT_STATE_UNKNOWN);
+    s_ring = new Slot[RING_SLOTS];
+
+    lcc_config_t cfg = LCC_CONFIG_DEFAULT();
+    cfg.hub_port = opt.port;
+    if (lcc_node_init(&cfg) != ESP_OK) {
+        fprintf(stderr, "lcc_soak: LCC node failed to start\n");
+        return 2;
+    }
+    lcc_node_set_rx_hook(rx_hook);
+
+    int fd = connect_hub(opt.port);
+    if (fd < 0) {
+        fprintf(stderr, "lcc_soak: cannot connect to the hub on port %d\n", opt.port);
+        return 2;
+    }
+    std::thread reader(drain_socket, fd);
+
+    double rate = opt.load * CAN_BITRATE / FRAME_BITS;
+    printf("lcc_soak: %d turnouts, load %.0f%% = %.0f frames/s, mix %d/%d/%d, "
+           "reboot every %d s, %d s\n", opt.turnouts, opt.load * 100, rate,
+           opt.mix[0], opt.mix[1], opt.mix[2], opt.reboot_s, opt.duration_s);
+
+    Generator gen(opt, fd);
+    gen.announce();
+    usleep(200000);     // let the node see the aliases before traffic starts
+
+    Sample start, last, cur;
+    start.take();
+    last = start;
+    int64_t t0 = now_ns();
+    int64_t next_report = t0 + (int64_t)REPORT_S * 1000000000;
+    int64_t next_reboot = opt.reboot_s > 0 ? t0 + (int64_t)opt.reboot_s * 1000000000 : INT64_MAX;
+    int64_t end = t0 + (int64_t)opt.duration_s * 1000000000;
+    double budget = 0;
+    struct timespec tick;
+    clock_gettime(CLOCK_MONOTONIC, &tick);
+
+    for (int64_t now = t0; now < end; now = now_ns()) {
+        budget += rate * TICK_US / 1e6;
+        while (budget >= 1) budget -= gen.next();
+        if (now >= next_reboot) {
+            budget -= gen.reboot();     // the burst is part of the load
+            next_reboot += (int64_t)opt.reboot_s * 1000000000;
+        }
+        if (!gen.flush()) {
+            fprintf(stderr, "lcc_soak: hub connection closed\n");
+            break;
+        }
+        if (now >= next_report) {
+            cur.take();
+            char label[16];
+            snprintf(label, sizeof(label), "%3ds", (int)((now - t0) / 1000000000));
+            report(label, last, cur, REPORT_S);
+            last = cur;
+            next_report += (int64_t)REPORT_S * 1000000000;
+        }
+        tick.tv_nsec += TICK_US * 1000;
+        if (tick.tv_nsec >= 1000000000) {
+            tick.tv_nsec -= 1000000000;
+            tick.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tick, nullptr);
+    }
+
+    // Let the stack work through its backlog
+    int64_t drain_end = now_ns() + (int64_t)DRAIN_MS * 1000000;
+    while (s_head.load() != s_tail.load() && now_ns() < drain_end) usleep(10000);
+    cur.take();
+    double elapsed = (now_ns() - t0) / 1e9;
+    report("total", start, cur, elapsed);
+
+    // Leftover frames were never handled
+    uint32_t lost = cur.lost + (s_head.load() - s_tail.load());
+    uint32_t dropped = 0;
+    for (int i = 0; i < opt.turnouts; i++) {
+        turnout_t t;
+        if (s_expected[(size_t)i] == TURNOUT_STATE_UNKNOWN) continue;
+        if (turnout_manager_get_by_index((size_t)i, &t) != ESP_OK ||
+            t.state != s_expected[(size_t)i]) {
+            dropped++;
+        }
+    }
+
+    lcc_node_stats_t stats;
+    lcc_node_get_stats(&stats);
+    printf("frames sent %u, received from node %u, node reboots %u\n",
+           cur.sent, s_frames_rx.load(), gen.reboots());
+    printf("events handled %u (stack count %u), lost %u, unmatched %u, ring overruns %u\n",
+           cur.matched, stats.events_in, lost, s_unmatched.load(), s_overruns.load());
+    printf("turnout updates to UI %u, dropped updates %u\n", s_ui_updates.load(), dropped);
+
+    shutdown(fd, SHUT_RDWR);
+    reader.join();
+    close(fd);
+    // The OpenMRN executor has no orderly stop; leave without unwinding it
+    fflush(stdout);
+    _exit(lost || dropped || s_overruns.load() ? 1 : 0);
+}
@@ -0,0 +1,23 @@
+/**
+ * @file soak_stubs.c
+ * @brief Main-task and bootloader hooks lcc_node calls, for the host soak
+ *
+ * The soak harness has no main loop to wake and no bootloader to enter;
+ * configuration changes and reboot requests are only counted.
+ */
+
+#include "scheduler.h"
+#include "bootloader_hal.h"
+#include "esp_log.h"
+
+static const char *TAG = "soak";
+
+void scheduler_kick(scheduler_job_t job)
+{
+    ESP_LOGD(TAG, "scheduler_kick(%d)", (int)job);
+}
+
+void bootloader_hal_request_reboot(void)
+{
+    ESP_LOGW(TAG, "Bootloader reboot requested (ignored on the host)");
+}
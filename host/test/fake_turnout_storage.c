@@ -0,0 +1,107 @@
+/**
+ * @file fake_turnout_storage.c
+ * @brief In-memory turnout_storage for tests and benchmarks
+ */
+
+#include "fake_turnout_storage.h"
+#include "psram_array.h"
+#include <stdlib.h>
+#include <string.h>
+
+static turnout_t *s_load = NULL;
+static size_t s_load_count = 0;
+static turnout_t *s_saved = NULL;
+static size_t s_saved_count = 0;
+static size_t s_save_calls = 0;
+static const turnout_t *s_saved_from = NULL;
+
+void fake_storage_set_turnouts(const turnout_t *turnouts, size_t count)
+{
+    free(s_load);
+    s_load = NULL;
+    s_load_count = 0;
+    if (!count) return;
+    s_load = malloc(count * sizeof(turnout_t));
+    if (!s_load) return;
+    memcpy(s_load, turnouts, count * sizeof(turnout_t));
+    s_load_count = count;
+}
+
+size_t fake_storage_save_calls(void)
+{
+    return s_save_calls;
+}
+
+const turnout_t *fake_storage_saved(size_t *out_count)
+{
+    *out_count = s_saved_count;
+    return s_saved;
+}
+
+const turnout_t *fake_storage_saved_from(void)
+{
+    return s_saved_from;
+}
+
+void fake_storage_reset(void)
+{
+    fake_storage_set_turnouts(NULL, 0);
+    free(s_saved);
+    s_saved = NULL;
+    s_saved_count = 0;
+    s_save_calls = 0;
+    s_saved_from = NULL;
+}
+
+esp_err_t turnout_storage_load(turnout_t **turnouts, size_t *capacity, size_t *out_count)
+{
+    *out_count = 0;
+    if (!s_load_count) return ESP_ERR_NOT_FOUND;
+    if (!psram_array_reserve((void **)turnouts, capacity, s_load_count, sizeof(turnout_t))) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(*turnouts, s_load, s_load_count * sizeof(turnout_t));
+    *out_count = s_load_count;
+    return ESP_OK;
+}
+
+esp_err_t turnout_storage_parse(const char *json, turnout_t **turnouts, size_t *capacity,
+                                size_t *out_count)
+{
+    (void)json;
+    (void)turnouts;
+    (void)capacity;
+    *out_count = 0;
+    return ESP_FAIL;
+}
+
+esp_err_t turnout_storage_save(const turnout_t *turnouts, size_t count,
+                               sd_io_done_cb_t cb, void *ctx)
+{
+    free(s_saved);
+    s_saved = count ? malloc(count * sizeof(turnout_t)) : NULL;
+    if (s_saved) memcpy(s_saved, turnouts, count * sizeof(turnout_t));
+    s_saved_count = s_saved ? count : 0;
+    s_saved_from = turnouts;
+    s_save_calls++;
+    if (cb) cb(ESP_OK, NULL, 0, ctx);      // as if written at once
+    return ESP_OK;
+}
+
+esp_err_t turnout_storage_import_jmri(turnout_t **turnouts, size_t *capacity, size_t *count)
+{
+    (void)turnouts;
+    (void)capacity;
+    (void)count;
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t turnout_storage_parse_jmri(const char *xml, turnout_t **turnouts, size_t *capacity,
+                                     size_t *count)
+{
+    (void)xml;
+    (void)turnouts;
+    (void)capacity;
+    (void)count;
+    return ESP_OK;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file fake_turnout_storage.h
+ * @brief In-memory turnout_storage for tests and benchmarks
+ *
+ * Linked instead of turnout_storage.c, so the turnout manager runs without
+ * an SD card or cJSON.  Loads return what fake_storage_set_turnouts() was
+ * given (nothing by default: ESP_ERR_NOT_FOUND); saves are copied out and
+ * counted, and their callbacks run at once with ESP_OK.
+ */
+
+#ifndef FAKE_TURNOUT_STORAGE_H_
+#define FAKE_TURNOUT_STORAGE_H_
+
+#include "turnout_storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Turnouts the next turnout_storage_load() returns (NULL/0 = none) */
+void fake_storage_set_turnouts(const turnout_t *turnouts, size_t count);
+
+/** @brief Number of turnout_storage_save() calls since the last reset */
+size_t fake_storage_save_calls(void);
+
+/** @brief Turnouts passed to the last save (valid until the next save) */
+const turnout_t *fake_storage_saved(size_t *out_count);
+
+/** @brief The array the last save was given (not the copy), to tell where it came from */
+const turnout_t *fake_storage_saved_from(void);
+
+/** @brief Forget the load data and the saves */
+void fake_storage_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FAKE_TURNOUT_STORAGE_H_
@@ -0,0 +1,87 @@
+/**
+ * @file layout_gen.h
+ * @brief Layout construction helpers shared by the tests and benchmarks
+ */
+
+#ifndef LAYOUT_GEN_H_
+#define LAYOUT_GEN_H_
+
+#include "panel_layout.h"
+#include <cstring>
+
+/** @brief Connection point of a turnout */
+inline panel_ref_t turnout_ref(uint32_t id, panel_point_type_t point)
+{
+    panel_ref_t ref;
+    std::memset(&ref, 0, sizeof(ref));
+    ref.type = PANEL_REF_TURNOUT;
+    ref.id = id;
+    ref.point = point;
+    return ref;
+}
+
+/** @brief An endpoint */
+inline panel_ref_t endpoint_ref(uint32_t id)
+{
+    panel_ref_t ref;
+    std::memset(&ref, 0, sizeof(ref));
+    ref.type = PANEL_REF_ENDPOINT;
+    ref.id = id;
+    ref.point = PANEL_POINT_ENTRY;
+    return ref;
+}
+
+inline panel_track_t make_track(const panel_ref_t &from, const panel_ref_t &to,
+                                uint32_t block_id = PANEL_BLOCK_NONE)
+{
+    panel_track_t t;
+    std::memset(&t, 0, sizeof(t));
+    t.from = from;
+    t.to = to;
+    t.block_id = block_id;
+    return t;
+}
+
+inline bool add_track(panel_layout_t *layout, const panel_ref_t &from, const panel_ref_t &to)
+{
+    panel_track_t t = make_track(from, to);
+    return panel_layout_add_track(layout, &t);
+}
+
+/** @brief Add an endpoint and return its ID */
+inline uint32_t add_endpoint(panel_layout_t *layout, uint16_t x, uint16_t y)
+{
+    size_t idx = 0;
+    if (!panel_layout_add_endpoint(layout, x, y, &idx)) return UINT32_MAX;
+    return layout->endpoints[idx].id;
+}
+
+/**
+ * @brief Yard ladder of @p turnouts turnouts (IDs 1..n)
+ *
+ * An entrance endpoint feeds turnout 1; each turnout's normal leg feeds the
+ * next and its reverse leg ends at a siding endpoint; the last normal leg
+ * ends at a throat endpoint.  Every siding is reachable from the entrance,
+ * so there are 2 × (n + 1) routes.
+ */
+inline void gen_ladder(panel_layout_t *layout, uint32_t turnouts)
+{
+    panel_layout_reserve(layout, turnouts, turnouts + 2, turnouts * 2 + 1);
+    uint32_t entrance = add_endpoint(layout, 0, 10);
+    for (uint32_t t = 1; t <= turnouts; t++) {
+        panel_layout_add_item(layout, t, (uint16_t)(t * 4), 10);
+    }
+    add_track(layout, endpoint_ref(entrance), turnout_ref(1, PANEL_POINT_ENTRY));
+    for (uint32_t t = 1; t <= turnouts; t++) {
+        uint32_t siding = add_endpoint(layout, (uint16_t)(t * 4 + 3), 14);
+        add_track(layout, turnout_ref(t, PANEL_POINT_REVERSE), endpoint_ref(siding));
+        if (t < turnouts) {
+            add_track(layout, turnout_ref(t, PANEL_POINT_NORMAL),
+                      turnout_ref(t + 1, PANEL_POINT_ENTRY));
+        }
+    }
+    uint32_t throat = add_endpoint(layout, (uint16_t)(turnouts * 4 + 4), 10);
+    add_track(layout, turnout_ref(turnouts, PANEL_POINT_NORMAL), endpoint_ref(throat));
+}
+
+#endif // LAYOUT_GEN_H_
@@ -0,0 +1,100 @@
+/**
+ * @file test_lcc_id.cpp
+ * @brief Event ID and node ID parsing
+ */
+
+#include "lcc_id.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(LccId, DottedEvent)
+{
+    uint64_t id = 0;
+    ASSERT_TRUE(lcc_id_parse_event("05.01.01.01.22.60.00.00", &id));
+    EXPECT_EQ(id, 0x0501010122600000ULL);
+    ASSERT_TRUE(lcc_id_parse_event("ff.FF.aB.00.01.02.03.04", &id));
+    EXPECT_EQ(id, 0xFFFFAB0001020304ULL);
+}
+
+TEST(LccId, DottedSingleDigitFields)
+{
+    uint64_t id = 0;
+    ASSERT_TRUE(lcc_id_parse_event("5.1.1.1.22.60.0.0", &id));
+    EXPECT_EQ(id, 0x0501010122600000ULL);
+}
+
+TEST(LccId, PlainEvent)
+{
+    uint64_t id = 0;
+    ASSERT_TRUE(lcc_id_parse_event("0501010122600000", &id));
+    EXPECT_EQ(id, 0x0501010122600000ULL);
+}
+
+TEST(LccId, SurroundingWhitespace)
+{
+    uint64_t id = 0;
+    ASSERT_TRUE(lcc_id_parse_event(" \t05.01.01.01.22.60.00.01\r\n", &id));
+    EXPECT_EQ(id, 0x0501010122600001ULL);
+}
+
+TEST(LccId, RejectsMalformedEvents)
+{
+    const char *bad[] = {
+        "",
+        "   ",
+        "05.01.01.01.22.60.00",             // too few fields
+        "05.01.01.01.22.60.00.00.00",       // too many fields
+        "05.01.01.01.22.60.00.000",         // overlong field
+        "05.01.01.01.22.60.00.00junk",      // trailing text
+        "-5.01.01.01.22.60.00.00",          // sign
+        "0x05.01.01.01.22.60.00.00",        // prefix
+        "05..01.01.22.60.00.00",            // empty field
+        "05.01.01.01.22.60.00.0g",          // not hex
+        "05010101226000001",                // 17 digits
+        "501010122600000",                  // 15 digits: truncated
+        "5",                                // short plain ID
+        "0501 0101",                        // embedded space
+    };
+    for (const char *s : bad) {
+        uint64_t id = 0x1234;
+        EXPECT_FALSE(lcc_id_parse_event(s, &id)) << "accepted \"" << s << "\"";
+        EXPECT_EQ(id, 0x1234u) << "written for \"" << s << "\"";
+    }
+}
+
+TEST(LccId, RejectsNull)
+{
+    uint64_t id = 0;
+    EXPECT_FALSE(lcc_id_parse_event(nullptr, &id));
+    EXPECT_FALSE(lcc_id_parse_event("05.01.01.01.22.60.00.00", nullptr));
+}
+
+TEST(LccId, NodeId)
+{
+    uint64_t id = 0;
+    ASSERT_TRUE(lcc_id_parse_node("05.01.01.01.22.60", &id));
+    EXPECT_EQ(id, 0x050101012260ULL);
+    ASSERT_TRUE(lcc_id_parse_node("050101012261\n", &id));
+    EXPECT_EQ(id, 0x050101012261ULL);
+}
+
+TEST(LccId, NodeIdRejectsZeroAndEventLength)
+{
+    uint64_t id = 0;
+    EXPECT_FALSE(lcc_id_parse_node("00.00.00.00.00.00", &id));
+    EXPECT_FALSE(lcc_id_parse_node("05.01.01.01.22.60.00.00", &id));
+    EXPECT_FALSE(lcc_id_parse_node("0501010122600000", &id));
+}
+
+TEST(LccId, NodeIdPlainNeedsTwelveDigits)
+{
+    uint64_t id = 0x1234;
+    EXPECT_FALSE(lcc_id_parse_node("50101012260", &id));
+    EXPECT_FALSE(lcc_id_parse_node("1", &id));
+    EXPECT_EQ(id, 0x1234u);
+    ASSERT_TRUE(lcc_id_parse_node("000000000001", &id));
+    EXPECT_EQ(id, 1u);
+}
+
+}  // namespace
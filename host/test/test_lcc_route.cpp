@@ -0,0 +1,84 @@
+/**
+ * @file test_lcc_route.cpp
+ * @brief Consumed event routing to turnouts and blocks
+ */
+
+#include "lcc_route.h"
+#include "turnout_manager.h"
+#include "block_manager.h"
+#include "fake_turnout_storage.h"
+#include "layout_gen.h"
+#include "esp_log.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr uint64_t kTurnoutBase = 0x0501010122600000ULL;
+constexpr uint64_t kBlockBase = 0x0501010122700000ULL;
+
+class LccRoute : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        esp_log_level_set("*", ESP_LOG_WARN);
+        fake_storage_reset();
+        ASSERT_EQ(turnout_manager_init(), ESP_OK);
+        ASSERT_EQ(block_manager_init(), ESP_OK);
+        for (int i = 0; i < 4; i++) {
+            turnout_manager_add(kTurnoutBase + 2 * i, kTurnoutBase + 2 * i + 1, "T");
+        }
+
+        std::memset(&layout_, 0, sizeof(layout_));
+        panel_block_t block = {};
+        block.id = 1;
+        block.event_occupied = kBlockBase;
+        block.event_clear = kBlockBase + 1;
+        ASSERT_TRUE(panel_layout_add_block(&layout_, &block));
+        ASSERT_EQ(block_manager_sync(&layout_), ESP_OK);
+    }
+
+    void TearDown() override
+    {
+        panel_layout_clear(&layout_);
+        block_manager_sync(&layout_);
+        panel_layout_free(&layout_);
+    }
+
+    turnout_state_t turnout_state(size_t index)
+    {
+        turnout_t t;
+        EXPECT_EQ(turnout_manager_get_by_index(index, &t), ESP_OK);
+        return t.state;
+    }
+
+    panel_layout_t layout_;
+};
+
+TEST_F(LccRoute, TurnoutEventsSetTheirState)
+{
+    EXPECT_TRUE(lcc_route_event(kTurnoutBase + 3));
+    EXPECT_EQ(turnout_state(1), TURNOUT_STATE_REVERSE);
+    EXPECT_TRUE(lcc_route_event(kTurnoutBase + 2));
+    EXPECT_EQ(turnout_state(1), TURNOUT_STATE_NORMAL);
+    EXPECT_EQ(turnout_state(0), TURNOUT_STATE_UNKNOWN);
+}
+
+TEST_F(LccRoute, OccupancyEventsSetTheBlock)
+{
+    block_t b;
+    EXPECT_TRUE(lcc_route_event(kBlockBase));
+    ASSERT_EQ(block_manager_get_by_index(0, &b), ESP_OK);
+    EXPECT_EQ(b.state, BLOCK_STATE_OCCUPIED);
+    EXPECT_TRUE(lcc_route_event(kBlockBase + 1));
+    ASSERT_EQ(block_manager_get_by_index(0, &b), ESP_OK);
+    EXPECT_EQ(b.state, BLOCK_STATE_CLEAR);
+}
+
+TEST_F(LccRoute, ForeignEventsAreNotConsumed)
+{
+    EXPECT_FALSE(lcc_route_event(0x0201570000000000ULL));
+    EXPECT_FALSE(lcc_route_event(kTurnoutBase + 8));
+    for (size_t i = 0; i < 4; i++) EXPECT_EQ(turnout_state(i), TURNOUT_STATE_UNKNOWN);
+}
+
+}  // namespace
@@ -0,0 +1,237 @@
+/**
+ * @file test_mem_budget.cpp
+ * @brief Memory budgets of the app-layer tables, measured with the host heap
+ *
+ * The budgets are ceilings for regressions, like mem_budget.c's: a few
+ * tenths above what the tables take today.  Internal RAM is the scarce
+ * one on the panel, so the tables must not touch it at all.  ctest runs
+ * each test in its own process; run together, tables left grown by earlier
+ * tests only make the growth measured here smaller.
+ *
+ * mem_budget.c's checkpoints run here too, against LVGL heap figures the
+ * test sets in place of lvgl_alloc_monitor()'s.
+ */
+
+#include "turnout_manager.h"
+#include "fake_turnout_storage.h"
+#include "panel_routes.h"
+#include "layout_gen.h"
+#include "mem_budget.h"
+#include "lvgl_alloc.h"
+#include "ui_common.h"
+#include "host_heap.h"
+#include "esp_log.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+// The UI that mem_budget.c calls, without LVGL
+static lv_mem_monitor_t s_lvgl_mon;
+
+extern "C" {
+#if CONFIG_LOCK_PROFILER
+bool ui_lock_at(const char *, int) { return true; }
+#else
+bool ui_lock(void) { return true; }
+#endif
+void ui_unlock(void) {}
+void ui_show_main(void) {}
+void ui_show_settings_at_tab(uint32_t) {}
+void lvgl_alloc_monitor(lv_mem_monitor_t *mon) { *mon = s_lvgl_mon; }
+}
+
+namespace {
+
+/// PSRAM per turnout: table entry and event index (about 109 B today)
+constexpr int64_t kTurnoutBytes = 136;
+
+/// PSRAM per turnout of a ladder: item, endpoint, tracks, index (about 109 B)
+constexpr int64_t kLadderBytes = 136;
+
+/// Route table PSRAM over the bytes its routes hold (about 2.4×)
+constexpr double kRouteOverhead = 3.0;
+
+constexpr uint64_t kEventBase = 0x0501010122600000ULL;
+
+/** @brief Heap use since construction, in bytes */
+struct HeapDelta {
+    host_heap_stats_t start;
+
+    HeapDelta() { host_heap_get_stats(&start); }
+
+    int64_t psram() const
+    {
+        host_heap_stats_t now;
+        host_heap_get_stats(&now);
+        return (int64_t)now.psram_used - (int64_t)start.psram_used;
+    }
+
+    int64_t internal() const
+    {
+        host_heap_stats_t now;
+        host_heap_get_stats(&now);
+        return (int64_t)now.internal_used - (int64_t)start.internal_used;
+    }
+};
+
+class MemBudget : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        esp_log_level_set("*", ESP_LOG_WARN);
+        fake_storage_reset();
+        ASSERT_EQ(turnout_manager_init(), ESP_OK);
+        std::memset(&layout_, 0, sizeof(layout_));
+        names_.reserve(TURNOUT_MAX_COUNT);
+        for (int i = 0; i < TURNOUT_MAX_COUNT; i++) names_.push_back("T" + std::to_string(i));
+    }
+
+    void TearDown() override
+    {
+        panel_routes_clear();
+        panel_layout_free(&layout_);
+    }
+
+    void add_turnouts(int count)
+    {
+        for (int i = 0; i < count; i++) {
+            ASSERT_GE(turnout_manager_add(kEventBase + 2 * i, kEventBase + 2 * i + 1,
+                                          names_[i].c_str()), 0);
+        }
+    }
+
+    /** @brief Bytes the route table's routes, steps and tracks hold */
+    size_t route_payload() const
+    {
+        size_t bytes = 0;
+        for (size_t i = 0; i < layout_.endpoint_count; i++) {
+            for (size_t j = 0; j < layout_.endpoint_count; j++) {
+                const panel_route_t *r = panel_routes_find(layout_.endpoints[i].id,
+                                                           layout_.endpoints[j].id);
+                if (!r) continue;
+                bytes += sizeof(*r) + r->step_count * sizeof(panel_route_step_t) +
+                         r->track_count * sizeof(uint16_t);
+            }
+        }
+        return bytes;
+    }
+
+    panel_layout_t layout_;
+    std::vector<std::string> names_;    ///< Built up front, outside the measurements
+};
+
+TEST_F(MemBudget, TurnoutTable)
+{
+    HeapDelta d;
+    add_turnouts(TURNOUT_MAX_COUNT);
+    EXPECT_LE(d.psram(), TURNOUT_MAX_COUNT * kTurnoutBytes);
+    EXPECT_EQ(d.internal(), 0);
+}
+
+TEST_F(MemBudget, SnapshotIsOneCopyOfTheTable)
+{
+    add_turnouts(500);
+    turnout_manager_snapshot_release(turnout_manager_snapshot_acquire());
+    turnout_manager_set_state_by_event(kEventBase, TURNOUT_STATE_NORMAL);
+
+    // The superseded copy is freed when the new one is published
+    HeapDelta d;
+    const turnout_snapshot_t *s = turnout_manager_snapshot_acquire();
+    ASSERT_NE(s, nullptr);
+    EXPECT_LE(d.psram(), 64);
+    EXPECT_EQ(d.internal(), 0);
+    turnout_manager_snapshot_release(s);
+}
+
+TEST_F(MemBudget, LayoutPerTurnout)
+{
+    HeapDelta d;
+    gen_ladder(&layout_, 500);
+    EXPECT_LE(d.psram(), 500 * kLadderBytes);
+    EXPECT_EQ(d.internal(), 0);
+}
+
+TEST_F(MemBudget, RouteTable)
+{
+    gen_ladder(&layout_, 200);
+    HeapDelta d;
+    ASSERT_EQ(panel_routes_build(&layout_), ESP_OK);
+    int64_t used = d.psram();
+    EXPECT_LE(used, (int64_t)(route_payload() * kRouteOverhead));
+    EXPECT_EQ(d.internal(), 0);
+
+    panel_routes_clear();
+    EXPECT_EQ(d.psram(), 0);
+}
+
+// What a navigation or a layout edit builds and drops must all come back:
+// after the first cycle (capacity reached, snapshot cached) use is flat
+TEST_F(MemBudget, NoGrowthAcrossCycles)
+{
+    HeapDelta d;
+    int64_t psram_first = 0, internal_first = 0;
+    for (int cycle = 0; cycle < 5; cycle++) {
+        ASSERT_EQ(turnout_manager_init(), ESP_OK);
+        add_turnouts(200);
+        for (int i = 0; i < 200; i += 3) {
+            turnout_manager_set_state_by_event(kEventBase + 2 * i + 1, TURNOUT_STATE_REVERSE);
+        }
+        turnout_manager_snapshot_release(turnout_manager_snapshot_acquire());
+        while (turnout_manager_get_count() > 0) ASSERT_EQ(turnout_manager_remove(0), ESP_OK);
+
+        gen_ladder(&layout_, 200);
+        ASSERT_EQ(panel_routes_build(&layout_), ESP_OK);
+        panel_routes_clear();
+        panel_layout_free(&layout_);
+        std::memset(&layout_, 0, sizeof(layout_));
+
+        if (cycle == 0) {
+            psram_first = d.psram();
+            internal_first = d.internal();
+        } else {
+            EXPECT_EQ(d.psram(), psram_first) << "cycle " << cycle;
+            EXPECT_EQ(d.internal(), internal_first) << "cycle " << cycle;
+        }
+    }
+}
+
+/** @brief Checkpoint with the LVGL heap @p used of @p size bytes; misses added */
+uint32_t checkpoint_misses(mem_checkpoint_t cp, uint32_t size, uint32_t used)
+{
+    s_lvgl_mon = {};
+    s_lvgl_mon.total_size = size;
+    s_lvgl_mon.free_size = size - used;
+    uint32_t before = mem_budget_misses();
+    mem_budget_checkpoint(cp, 100);
+    return mem_budget_misses() - before;
+}
+
+TEST(MemBudgetCheckpoint, BuilderWithinBudget)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    EXPECT_EQ(checkpoint_misses(MEM_CP_BUILDER, 128 * 1024, 64 * 1024), 0u);
+}
+
+TEST(MemBudgetCheckpoint, BuilderOverBudget)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    EXPECT_EQ(checkpoint_misses(MEM_CP_BUILDER, 128 * 1024, 120 * 1024), 1u);
+}
+
+// The pool allocator's size includes the PSRAM blocks it holds, so the
+// budget follows what the monitor reports rather than LV_MEM_SIZE
+TEST(MemBudgetCheckpoint, BudgetIsAShareOfTheReportedHeap)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    EXPECT_EQ(checkpoint_misses(MEM_CP_BUILDER, 512 * 1024, 120 * 1024), 0u);
+    EXPECT_EQ(checkpoint_misses(MEM_CP_BOOT, 512 * 1024, 120 * 1024), 1u);
+}
+
+// LVGL on the system allocator reports no heap size
+TEST(MemBudgetCheckpoint, UnsizedHeapIsNotChecked)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    EXPECT_EQ(checkpoint_misses(MEM_CP_BUILDER, 0, 0), 0u);
+}
+
+}  // namespace
@@ -0,0 +1,237 @@
+/**
+ * @file test_panel_history.cpp
+ * @brief Undo/redo journal, replayed the way the panel builder applies it
+ */
+
+#include "panel_history.h"
+#include "layout_gen.h"
+#include "esp_log.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+/** @brief Layout contents, for comparing before and after a round trip */
+struct Contents {
+    std::vector<uint32_t> items;
+    std::vector<uint32_t> endpoints;
+    std::vector<std::vector<uint32_t>> tracks;
+
+    explicit Contents(const panel_layout_t &l)
+    {
+        for (size_t i = 0; i < l.item_count; i++) items.push_back(l.items[i].turnout_id);
+        for (size_t i = 0; i < l.endpoint_count; i++) endpoints.push_back(l.endpoints[i].id);
+        for (size_t i = 0; i < l.track_count; i++) {
+            const panel_track_t &t = l.tracks[i];
+            tracks.push_back({ (uint32_t)t.from.type, t.from.id, (uint32_t)t.from.point,
+                               (uint32_t)t.to.type, t.to.id, (uint32_t)t.to.point });
+        }
+    }
+
+    bool operator==(const Contents &o) const
+    {
+        return items == o.items && endpoints == o.endpoints && tracks == o.tracks;
+    }
+};
+
+class PanelHistory : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        esp_log_level_set("*", ESP_LOG_WARN);
+        std::memset(&layout_, 0, sizeof(layout_));
+        ASSERT_EQ(panel_history_init(), ESP_OK);
+        panel_history_clear();
+    }
+
+    void TearDown() override
+    {
+        panel_layout_free(&layout_);
+    }
+
+    /** @brief Layout half of builder_apply_edit() in ui_panel_builder.c */
+    bool apply(const panel_edit_t &edit)
+    {
+        size_t idx = edit.index;
+        bool ok = true;
+        switch (edit.type) {
+        case PANEL_EDIT_ADD_ITEM:
+            ok = panel_layout_insert_item(&layout_, idx, &edit.item_new);
+            break;
+        case PANEL_EDIT_REMOVE_ITEM:
+            ok = idx < layout_.item_count;
+            if (ok) panel_layout_remove_item(&layout_, idx);
+            break;
+        case PANEL_EDIT_UPDATE_ITEM:
+            ok = idx < layout_.item_count;
+            if (ok) layout_.items[idx] = edit.item_new;
+            break;
+        case PANEL_EDIT_ADD_ENDPOINT:
+            ok = panel_layout_insert_endpoint(&layout_, idx, &edit.ep_new);
+            break;
+        case PANEL_EDIT_REMOVE_ENDPOINT:
+            ok = idx < layout_.endpoint_count;
+            if (ok) panel_layout_remove_endpoint(&layout_, idx);
+            break;
+        case PANEL_EDIT_UPDATE_ENDPOINT:
+            ok = idx < layout_.endpoint_count;
+            if (ok) layout_.endpoints[idx] = edit.ep_new;
+            break;
+        case PANEL_EDIT_ADD_TRACK:
+            ok = panel_layout_insert_track(&layout_, idx, &edit.track);
+            break;
+        case PANEL_EDIT_REMOVE_TRACK:
+            ok = idx < layout_.track_count;
+            if (ok) panel_layout_remove_track(&layout_, idx);
+            break;
+        }
+        for (uint16_t i = 0; ok && i < edit.track_count; i++) {
+            ok = panel_layout_insert_track(&layout_, edit.tracks[i].index,
+                                           &edit.tracks[i].track);
+        }
+        return ok;
+    }
+
+    /** @brief Record a removal and apply it, as the builder does */
+    void remove_item(size_t index)
+    {
+        panel_edit_t edit = {};
+        edit.type = PANEL_EDIT_REMOVE_ITEM;
+        edit.index = (uint16_t)index;
+        edit.item_old = layout_.items[index];
+        panel_history_record(&layout_, &edit);
+        ASSERT_TRUE(apply(edit));
+    }
+
+    void remove_endpoint(size_t index)
+    {
+        panel_edit_t edit = {};
+        edit.type = PANEL_EDIT_REMOVE_ENDPOINT;
+        edit.index = (uint16_t)index;
+        edit.ep_old = layout_.endpoints[index];
+        panel_history_record(&layout_, &edit);
+        ASSERT_TRUE(apply(edit));
+    }
+
+    bool undo()
+    {
+        panel_edit_t edit;
+        return panel_history_undo(&edit) && apply(edit);
+    }
+
+    bool redo()
+    {
+        panel_edit_t edit;
+        return panel_history_redo(&edit) && apply(edit);
+    }
+
+    panel_layout_t layout_;
+};
+
+TEST_F(PanelHistory, EmptyJournal)
+{
+    panel_edit_t edit;
+    EXPECT_FALSE(panel_history_can_undo());
+    EXPECT_FALSE(panel_history_can_redo());
+    EXPECT_FALSE(panel_history_undo(&edit));
+    EXPECT_FALSE(panel_history_redo(&edit));
+}
+
+TEST_F(PanelHistory, UndoRemoveItemRestoresCascadedTracksInPlace)
+{
+    gen_ladder(&layout_, 8);
+    Contents before(layout_);
+
+    remove_item(3);
+    Contents removed(layout_);
+    EXPECT_EQ(layout_.track_count, before.tracks.size() - 3);
+
+    ASSERT_TRUE(undo());
+    EXPECT_TRUE(Contents(layout_) == before);
+    ASSERT_TRUE(redo());
+    EXPECT_TRUE(Contents(layout_) == removed);
+    ASSERT_TRUE(undo());
+    EXPECT_TRUE(Contents(layout_) == before);
+}
+
+// Tracks attached to the removed turnout ahead of the first link the index
+// meets must be journaled and restored like the others
+TEST_F(PanelHistory, UndoRemoveItemWithTracksInAnyOrder)
+{
+    panel_layout_add_item(&layout_, 1, 5, 5);
+    panel_layout_add_item(&layout_, 2, 10, 5);
+    uint32_t e = add_endpoint(&layout_, 0, 0);
+    add_track(&layout_, turnout_ref(1, PANEL_POINT_NORMAL), turnout_ref(2, PANEL_POINT_ENTRY));
+    add_track(&layout_, endpoint_ref(e), turnout_ref(2, PANEL_POINT_NORMAL));
+    add_track(&layout_, endpoint_ref(e), turnout_ref(1, PANEL_POINT_ENTRY));
+    Contents before(layout_);
+
+    remove_item(0);
+    ASSERT_EQ(layout_.track_count, 1u);
+    ASSERT_TRUE(undo());
+    EXPECT_TRUE(Contents(layout_) == before);
+}
+
+TEST_F(PanelHistory, UndoRemoveEndpointRestoresCascadedTracks)
+{
+    panel_layout_add_item(&layout_, 1, 5, 5);
+    uint32_t a = add_endpoint(&layout_, 0, 0);
+    uint32_t b = add_endpoint(&layout_, 20, 0);
+    add_track(&layout_, endpoint_ref(b), turnout_ref(1, PANEL_POINT_REVERSE));
+    add_track(&layout_, endpoint_ref(a), turnout_ref(1, PANEL_POINT_ENTRY));
+    add_track(&layout_, turnout_ref(1, PANEL_POINT_NORMAL), endpoint_ref(b));
+    Contents before(layout_);
+
+    remove_endpoint(1);
+    EXPECT_EQ(layout_.track_count, 1u);
+    ASSERT_TRUE(undo());
+    EXPECT_TRUE(Contents(layout_) == before);
+    EXPECT_FALSE(panel_history_can_undo());
+    EXPECT_TRUE(panel_history_can_redo());
+}
+
+TEST_F(PanelHistory, NewEditDiscardsRedo)
+{
+    gen_ladder(&layout_, 4);
+    remove_item(0);
+    ASSERT_TRUE(undo());
+    EXPECT_TRUE(panel_history_can_redo());
+
+    panel_edit_t move = {};
+    move.type = PANEL_EDIT_UPDATE_ITEM;
+    move.index = 1;
+    move.item_old = layout_.items[1];
+    move.item_new = layout_.items[1];
+    move.item_new.grid_x += 2;
+    panel_history_record(&layout_, &move);
+    ASSERT_TRUE(apply(move));
+    EXPECT_FALSE(panel_history_can_redo());
+
+    ASSERT_TRUE(undo());
+    EXPECT_EQ(layout_.items[1].grid_x, move.item_old.grid_x);
+}
+
+TEST_F(PanelHistory, OldestEditsAreDroppedWhenFull)
+{
+    gen_ladder(&layout_, 2);
+    panel_edit_t move = {};
+    move.type = PANEL_EDIT_UPDATE_ITEM;
+    move.index = 0;
+
+    // Far more moves than the ring holds; only the newest can be undone
+    const int moves = PANEL_HISTORY_SIZE / 8;
+    for (int i = 0; i < moves; i++) {
+        move.item_old = layout_.items[0];
+        move.item_new = move.item_old;
+        move.item_new.grid_x = (uint16_t)(i + 1);
+        panel_history_record(&layout_, &move);
+        ASSERT_TRUE(apply(move));
+    }
+    int undone = 0;
+    while (undo()) undone++;
+    EXPECT_GT(undone, 0);
+    EXPECT_LT(undone, moves);
+    EXPECT_EQ(layout_.items[0].grid_x, moves - undone);
+}
+
+}  // namespace
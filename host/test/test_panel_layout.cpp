@@ -0,0 +1,267 @@
+/**
+ * @file test_panel_layout.cpp
+ * @brief Panel layout model: lookups, track graph index and cascades
+ */
+
+#include "layout_gen.h"
+#include "esp_log.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+class PanelLayout : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        esp_log_level_set("*", ESP_LOG_WARN);
+        std::memset(&layout_, 0, sizeof(layout_));
+    }
+
+    void TearDown() override
+    {
+        panel_layout_free(&layout_);
+    }
+
+    /** @brief Tracks attached to an element, by scanning the array */
+    std::vector<uint16_t> scan_tracks(panel_ref_type_t type, uint32_t id) const
+    {
+        std::vector<uint16_t> out;
+        for (size_t i = 0; i < layout_.track_count; i++) {
+            const panel_track_t &t = layout_.tracks[i];
+            bool refs = type == PANEL_REF_BLOCK
+                ? t.block_id == id
+                : (t.from.type == type && t.from.id == id) || (t.to.type == type && t.to.id == id);
+            if (refs) out.push_back((uint16_t)i);
+        }
+        return out;
+    }
+
+    std::vector<uint16_t> collect(panel_ref_type_t type, uint32_t id) const
+    {
+        size_t n = panel_layout_collect_tracks(&layout_, type, id, nullptr, 0);
+        std::vector<uint16_t> out(n);
+        if (n) panel_layout_collect_tracks(&layout_, type, id, out.data(), n);
+        return out;
+    }
+
+    /** @brief Every element's tracks through the index match a scan */
+    void expect_index_consistent() const
+    {
+        for (size_t i = 0; i < layout_.item_count; i++) {
+            uint32_t id = layout_.items[i].turnout_id;
+            EXPECT_EQ(panel_layout_find_item(&layout_, id), (int)i);
+            EXPECT_EQ(collect(PANEL_REF_TURNOUT, id), scan_tracks(PANEL_REF_TURNOUT, id))
+                << "turnout " << id;
+        }
+        for (size_t i = 0; i < layout_.endpoint_count; i++) {
+            uint32_t id = layout_.endpoints[i].id;
+            EXPECT_EQ(panel_layout_find_endpoint(&layout_, id), (int)i);
+            EXPECT_EQ(collect(PANEL_REF_ENDPOINT, id), scan_tracks(PANEL_REF_ENDPOINT, id))
+                << "endpoint " << id;
+        }
+    }
+
+    /** @brief No track names an element that is not placed */
+    void expect_no_dangling() const
+    {
+        for (size_t i = 0; i < layout_.track_count; i++) {
+            for (const panel_ref_t *r : { &layout_.tracks[i].from, &layout_.tracks[i].to }) {
+                if (r->type == PANEL_REF_TURNOUT) {
+                    EXPECT_GE(panel_layout_find_item(&layout_, r->id), 0) << "track " << i;
+                } else {
+                    EXPECT_GE(panel_layout_find_endpoint(&layout_, r->id), 0) << "track " << i;
+                }
+            }
+        }
+    }
+
+    panel_layout_t layout_;
+};
+
+TEST_F(PanelLayout, FindItemAndEndpoint)
+{
+    gen_ladder(&layout_, 50);
+    EXPECT_EQ(layout_.item_count, 50u);
+    EXPECT_EQ(layout_.endpoint_count, 52u);
+    EXPECT_EQ(layout_.track_count, 101u);
+    EXPECT_TRUE(layout_.index.valid);
+
+    for (uint32_t id = 1; id <= 50; id++) {
+        int idx = panel_layout_find_item(&layout_, id);
+        ASSERT_GE(idx, 0);
+        EXPECT_EQ(layout_.items[idx].turnout_id, id);
+    }
+    EXPECT_EQ(panel_layout_find_item(&layout_, 51), -1);
+    EXPECT_EQ(panel_layout_find_endpoint(&layout_, 1000), -1);
+    EXPECT_TRUE(panel_layout_is_turnout_placed(&layout_, 7));
+    EXPECT_FALSE(panel_layout_is_turnout_placed(&layout_, 0));
+}
+
+TEST_F(PanelLayout, CollectTracksIsSortedAndDistinct)
+{
+    panel_layout_add_item(&layout_, 1, 5, 5);
+    uint32_t e = add_endpoint(&layout_, 0, 0);
+    add_track(&layout_, turnout_ref(1, PANEL_POINT_REVERSE), endpoint_ref(e));
+    add_track(&layout_, turnout_ref(1, PANEL_POINT_NORMAL), turnout_ref(1, PANEL_POINT_ENTRY));
+    add_track(&layout_, endpoint_ref(e), turnout_ref(1, PANEL_POINT_ENTRY));
+
+    // The loop track has both ends on turnout 1 and is listed once
+    EXPECT_EQ(collect(PANEL_REF_TURNOUT, 1), (std::vector<uint16_t>{ 0, 1, 2 }));
+    EXPECT_EQ(collect(PANEL_REF_ENDPOINT, e), (std::vector<uint16_t>{ 0, 2 }));
+    expect_index_consistent();
+}
+
+TEST_F(PanelLayout, CollectTracksReportsTruncation)
+{
+    gen_ladder(&layout_, 3);
+    uint16_t one = 0xFFFF;
+    EXPECT_EQ(panel_layout_collect_tracks(&layout_, PANEL_REF_TURNOUT, 2, &one, 1), 3u);
+    EXPECT_NE(one, 0xFFFF);
+}
+
+TEST_F(PanelLayout, RemoveItemCascadesAttachedTracks)
+{
+    gen_ladder(&layout_, 10);
+    size_t before = layout_.track_count;
+    panel_layout_remove_item(&layout_, (size_t)panel_layout_find_item(&layout_, 5));
+
+    EXPECT_EQ(layout_.item_count, 9u);
+    EXPECT_EQ(layout_.track_count, before - 3);
+    EXPECT_EQ(panel_layout_find_item(&layout_, 5), -1);
+    EXPECT_TRUE(scan_tracks(PANEL_REF_TURNOUT, 5).empty());
+    expect_no_dangling();
+    expect_index_consistent();
+}
+
+// The first link met at a turnout is not always its lowest track: links are
+// pushed at the head of each point's list, and points are walked entry
+// first.  Every attached track must go, wherever it sits in the array.
+TEST_F(PanelLayout, RemoveItemCascadesTracksBeforeTheFirstLinkMet)
+{
+    panel_layout_add_item(&layout_, 1, 5, 5);
+    panel_layout_add_item(&layout_, 2, 10, 5);
+    uint32_t e = add_endpoint(&layout_, 0, 0);
+    add_track(&layout_, turnout_ref(1, PANEL_POINT_NORMAL), turnout_ref(2, PANEL_POINT_ENTRY));
+    add_track(&layout_, endpoint_ref(e), turnout_ref(2, PANEL_POINT_NORMAL));
+    add_track(&layout_, endpoint_ref(e), turnout_ref(1, PANEL_POINT_ENTRY));
+
+    panel_layout_remove_item(&layout_, 0);
+
+    ASSERT_EQ(layout_.track_count, 1u);
+    EXPECT_EQ(layout_.tracks[0].from.id, e);
+    EXPECT_EQ(layout_.tracks[0].to.id, 2u);
+    expect_no_dangling();
+    expect_index_consistent();
+}
+
+TEST_F(PanelLayout, RemoveEndpointCascadesTracksInAnyOrder)
+{
+    panel_layout_add_item(&layout_, 1, 5, 5);
+    uint32_t a = add_endpoint(&layout_, 0, 0);
+    uint32_t b = add_endpoint(&layout_, 20, 0);
+    add_track(&layout_, endpoint_ref(b), turnout_ref(1, PANEL_POINT_REVERSE));
+    add_track(&layout_, endpoint_ref(a), turnout_ref(1, PANEL_POINT_ENTRY));
+    add_track(&layout_, turnout_ref(1, PANEL_POINT_NORMAL), endpoint_ref(b));
+    add_track(&layout_, endpoint_ref(a), endpoint_ref(b));
+
+    panel_layout_remove_endpoint(&layout_, (size_t)panel_layout_find_endpoint(&layout_, b));
+
+    ASSERT_EQ(layout_.track_count, 1u);
+    EXPECT_EQ(layout_.tracks[0].from.id, a);
+    EXPECT_EQ(layout_.tracks[0].to.id, 1u);
+    expect_no_dangling();
+    expect_index_consistent();
+}
+
+TEST_F(PanelLayout, InsertAndRemoveKeepTheIndexCurrent)
+{
+    gen_ladder(&layout_, 20);
+    std::mt19937 rng(1234);
+    for (int op = 0; op < 200; op++) {
+        switch (rng() % 4) {
+        case 0:
+            if (layout_.item_count) {
+                panel_layout_remove_item(&layout_, rng() % layout_.item_count);
+            }
+            break;
+        case 1:
+            if (layout_.endpoint_count) {
+                panel_layout_remove_endpoint(&layout_, rng() % layout_.endpoint_count);
+            }
+            break;
+        case 2:
+            if (layout_.track_count) {
+                panel_layout_remove_track(&layout_, rng() % layout_.track_count);
+            }
+            break;
+        default: {
+            uint32_t id = 100 + (uint32_t)op;
+            panel_item_t item = {};
+            item.turnout_id = id;
+            panel_layout_insert_item(&layout_, rng() % (layout_.item_count + 1), &item);
+            if (layout_.endpoint_count) {
+                uint32_t e = layout_.endpoints[rng() % layout_.endpoint_count].id;
+                panel_track_t t = make_track(turnout_ref(id, PANEL_POINT_ENTRY), endpoint_ref(e));
+                panel_layout_insert_track(&layout_, rng() % (layout_.track_count + 1), &t);
+            }
+            break;
+        }
+        }
+        expect_no_dangling();
+    }
+    expect_index_consistent();
+}
+
+// After an index allocation failure, lookups and cascades scan the arrays
+TEST_F(PanelLayout, LookupsScanWithoutTheIndex)
+{
+    gen_ladder(&layout_, 10);
+    std::vector<uint16_t> expected = collect(PANEL_REF_TURNOUT, 4);
+
+    layout_.index.valid = false;
+    EXPECT_EQ(collect(PANEL_REF_TURNOUT, 4), expected);
+    EXPECT_EQ(panel_layout_find_item(&layout_, 4), 3);
+    panel_ref_t node = turnout_ref(4, PANEL_POINT_ENTRY);
+    EXPECT_EQ(panel_layout_first_link(&layout_, &node), PANEL_LINK_NONE);
+    panel_layout_remove_item(&layout_, 3);
+    EXPECT_TRUE(scan_tracks(PANEL_REF_TURNOUT, 4).empty());
+    expect_no_dangling();
+}
+
+TEST_F(PanelLayout, BlocksCoverTracks)
+{
+    gen_ladder(&layout_, 4);
+    panel_block_t block = {};
+    block.id = 7;
+    block.event_occupied = 0x0501010122600010ULL;
+    block.event_clear = 0x0501010122600011ULL;
+    ASSERT_TRUE(panel_layout_add_block(&layout_, &block));
+    EXPECT_FALSE(panel_layout_add_block(&layout_, &block));
+
+    layout_.tracks[2].block_id = 7;
+    layout_.tracks[5].block_id = 7;
+    panel_layout_reindex(&layout_);
+    EXPECT_EQ(collect(PANEL_REF_BLOCK, 7), (std::vector<uint16_t>{ 2, 5 }));
+    EXPECT_EQ(panel_layout_find_block(&layout_, 7), 0);
+}
+
+TEST_F(PanelLayout, ResolveEndpointTrack)
+{
+    uint32_t a = add_endpoint(&layout_, 1, 2);
+    uint32_t b = add_endpoint(&layout_, 3, 4);
+    panel_track_t t = make_track(endpoint_ref(a), endpoint_ref(b));
+    int16_t x1, y1, x2, y2;
+    ASSERT_TRUE(panel_layout_resolve_track(&layout_, &t, &x1, &y1, &x2, &y2));
+    EXPECT_EQ(x1, 1 * PANEL_GRID_SIZE);
+    EXPECT_EQ(y1, 2 * PANEL_GRID_SIZE);
+    EXPECT_EQ(x2, 3 * PANEL_GRID_SIZE);
+    EXPECT_EQ(y2, 4 * PANEL_GRID_SIZE);
+
+    t.to.id = 99;
+    EXPECT_FALSE(panel_layout_resolve_track(&layout_, &t, &x1, &y1, &x2, &y2));
+}
+
+}  // namespace
@@ -0,0 +1,119 @@
+/**
+ * @file test_panel_routes.cpp
+ * @brief Entrance-exit route table
+ */
+
+#include "panel_routes.h"
+#include "layout_gen.h"
+#include "esp_log.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+class PanelRoutes : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        esp_log_level_set("*", ESP_LOG_WARN);
+        std::memset(&layout_, 0, sizeof(layout_));
+        panel_routes_clear();
+    }
+
+    void TearDown() override
+    {
+        panel_routes_clear();
+        panel_layout_free(&layout_);
+    }
+
+    std::vector<std::pair<uint32_t, int>> steps(const panel_route_t *r) const
+    {
+        std::vector<std::pair<uint32_t, int>> out;
+        const panel_route_step_t *s = panel_routes_steps(r);
+        for (uint16_t i = 0; i < r->step_count; i++) {
+            out.emplace_back(layout_.items[s[i].item].turnout_id, s[i].leg);
+        }
+        return out;
+    }
+
+    panel_layout_t layout_;
+};
+
+TEST_F(PanelRoutes, SingleTurnout)
+{
+    // a — entry[1]normal — b, reverse — c
+    panel_layout_add_item(&layout_, 1, 5, 5);
+    uint32_t a = add_endpoint(&layout_, 0, 5);
+    uint32_t b = add_endpoint(&layout_, 10, 5);
+    uint32_t c = add_endpoint(&layout_, 10, 9);
+    add_track(&layout_, endpoint_ref(a), turnout_ref(1, PANEL_POINT_ENTRY));
+    add_track(&layout_, turnout_ref(1, PANEL_POINT_NORMAL), endpoint_ref(b));
+    add_track(&layout_, turnout_ref(1, PANEL_POINT_REVERSE), endpoint_ref(c));
+
+    ASSERT_EQ(panel_routes_build(&layout_), ESP_OK);
+    EXPECT_EQ(panel_routes_count(), 4u);
+
+    const panel_route_t *ab = panel_routes_find(a, b);
+    ASSERT_NE(ab, nullptr);
+    EXPECT_EQ(steps(ab), (std::vector<std::pair<uint32_t, int>>{ { 1, PANEL_POINT_NORMAL } }));
+    ASSERT_EQ(ab->track_count, 2);
+    EXPECT_EQ(panel_routes_tracks(ab)[0], 0);
+    EXPECT_EQ(panel_routes_tracks(ab)[1], 1);
+
+    const panel_route_t *ca = panel_routes_find(c, a);
+    ASSERT_NE(ca, nullptr);
+    EXPECT_EQ(steps(ca), (std::vector<std::pair<uint32_t, int>>{ { 1, PANEL_POINT_REVERSE } }));
+
+    // Normal leg to reverse leg would reverse through the turnout
+    EXPECT_EQ(panel_routes_find(b, c), nullptr);
+    EXPECT_EQ(panel_routes_find(a, a), nullptr);
+}
+
+TEST_F(PanelRoutes, LadderReachesEverySiding)
+{
+    const uint32_t n = 12;
+    gen_ladder(&layout_, n);
+    ASSERT_EQ(panel_routes_build(&layout_), ESP_OK);
+    EXPECT_EQ(panel_routes_count(), 2u * (n + 1));
+
+    // Endpoint IDs: 0 entrance, then siding k has ID k, throat n + 1
+    for (uint32_t k = 1; k <= n; k++) {
+        const panel_route_t *r = panel_routes_find(0, k);
+        ASSERT_NE(r, nullptr) << "siding " << k;
+        ASSERT_EQ(r->step_count, k);
+        std::vector<std::pair<uint32_t, int>> s = steps(r);
+        for (uint32_t i = 0; i + 1 < k; i++) {
+            EXPECT_EQ(s[i], std::make_pair(i + 1, (int)PANEL_POINT_NORMAL));
+        }
+        EXPECT_EQ(s[k - 1], std::make_pair(k, (int)PANEL_POINT_REVERSE));
+        EXPECT_EQ(r->track_count, k + 1);
+        EXPECT_NE(panel_routes_find(k, 0), nullptr);
+    }
+    const panel_route_t *throat = panel_routes_find(0, n + 1);
+    ASSERT_NE(throat, nullptr);
+    EXPECT_EQ(throat->step_count, n);
+}
+
+TEST_F(PanelRoutes, RebuildsOnlyWhenTheTopologyChanges)
+{
+    gen_ladder(&layout_, 4);
+    ASSERT_EQ(panel_routes_build(&layout_), ESP_OK);
+    const panel_route_t *r = panel_routes_find(0, 2);
+    ASSERT_EQ(panel_routes_build(&layout_), ESP_OK);
+    EXPECT_EQ(panel_routes_find(0, 2), r);
+
+    // Cutting the line between turnouts 1 and 2 leaves only siding 1
+    for (size_t i = 0; i < layout_.track_count; i++) {
+        const panel_track_t &t = layout_.tracks[i];
+        if (t.from.type == PANEL_REF_TURNOUT && t.from.id == 1 &&
+            t.from.point == PANEL_POINT_NORMAL) {
+            panel_layout_remove_track(&layout_, i);
+            break;
+        }
+    }
+    ASSERT_EQ(panel_routes_build(&layout_), ESP_OK);
+    EXPECT_NE(panel_routes_find(0, 1), nullptr);
+    EXPECT_EQ(panel_routes_find(0, 2), nullptr);
+}
+
+}  // namespace
@@ -0,0 +1,274 @@
+/**
+ * @file test_turnout_manager.cpp
+ * @brief Turnout manager: event routing hash, snapshots and persistence
+ */
+
+#include "turnout_manager.h"
+#include "fake_turnout_storage.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "host_heap.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t kEventBase = 0x0501010122600000ULL;
+
+uint64_t normal_event(int i) { return kEventBase + 2 * (uint64_t)i; }
+uint64_t reverse_event(int i) { return kEventBase + 2 * (uint64_t)i + 1; }
+
+std::vector<std::pair<int, turnout_state_t>> s_changes;
+
+void record_change(int index, turnout_state_t state)
+{
+    s_changes.emplace_back(index, state);
+}
+
+class TurnoutManager : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        esp_log_level_set("*", ESP_LOG_WARN);
+        fake_storage_reset();
+        s_changes.clear();
+        turnout_manager_set_state_callback(nullptr);
+        ASSERT_EQ(turnout_manager_init(), ESP_OK);
+    }
+
+    void TearDown() override
+    {
+        turnout_manager_set_state_callback(nullptr);
+    }
+
+    void add(int count)
+    {
+        for (int i = 0; i < count; i++) {
+            std::string name = "T" + std::to_string(i);
+            ASSERT_EQ(turnout_manager_add(normal_event(i), reverse_event(i), name.c_str()), i);
+        }
+    }
+};
+
+TEST_F(TurnoutManager, StartsEmptyWithoutAFile)
+{
+    EXPECT_EQ(turnout_manager_get_count(), 0u);
+    EXPECT_EQ(turnout_manager_find_by_event(kEventBase), -1);
+}
+
+TEST_F(TurnoutManager, LoadsFromStorage)
+{
+    turnout_t t[2] = {};
+    t[0].id = 7;
+    t[0].event_normal = normal_event(0);
+    t[0].event_reverse = reverse_event(0);
+    t[1].id = 3;
+    t[1].event_normal = normal_event(1);
+    t[1].event_reverse = reverse_event(1);
+    fake_storage_set_turnouts(t, 2);
+    ASSERT_EQ(turnout_manager_init(), ESP_OK);
+
+    EXPECT_EQ(turnout_manager_get_count(), 2u);
+    EXPECT_EQ(turnout_manager_find_by_event(reverse_event(1)), 1);
+    EXPECT_EQ(turnout_manager_find_by_id(7), 0);
+
+    // New IDs continue after the highest loaded one
+    int idx = turnout_manager_add(normal_event(5), reverse_event(5), "New");
+    turnout_t added;
+    ASSERT_EQ(turnout_manager_get_by_index((size_t)idx, &added), ESP_OK);
+    EXPECT_EQ(added.id, 8u);
+}
+
+TEST_F(TurnoutManager, EventHashFindsEveryEvent)
+{
+    add(500);
+    for (int i = 0; i < 500; i++) {
+        ASSERT_EQ(turnout_manager_find_by_event(normal_event(i)), i);
+        ASSERT_EQ(turnout_manager_find_by_event(reverse_event(i)), i);
+    }
+    EXPECT_EQ(turnout_manager_find_by_event(normal_event(500)), -1);
+    EXPECT_EQ(turnout_manager_find_by_event(0), -1);
+}
+
+TEST_F(TurnoutManager, RejectsDuplicateEvents)
+{
+    add(3);
+    EXPECT_EQ(turnout_manager_add(normal_event(1), 0x1234, "Dup"), -1);
+    EXPECT_EQ(turnout_manager_add(0x1234, reverse_event(2), "Dup"), -1);
+    EXPECT_EQ(turnout_manager_get_count(), 3u);
+}
+
+TEST_F(TurnoutManager, IndexFollowsRemoveSwapAndFlip)
+{
+    add(10);
+    ASSERT_EQ(turnout_manager_remove(3), ESP_OK);
+    EXPECT_EQ(turnout_manager_find_by_event(normal_event(3)), -1);
+    EXPECT_EQ(turnout_manager_find_by_event(normal_event(4)), 3);
+    EXPECT_EQ(turnout_manager_find_by_event(reverse_event(9)), 8);
+
+    ASSERT_EQ(turnout_manager_swap(0, 8), ESP_OK);
+    EXPECT_EQ(turnout_manager_find_by_event(normal_event(0)), 8);
+    EXPECT_EQ(turnout_manager_find_by_event(reverse_event(9)), 0);
+
+    ASSERT_EQ(turnout_manager_flip_polarity(1), ESP_OK);
+    EXPECT_EQ(turnout_manager_find_by_event(reverse_event(1)), 1);
+    turnout_manager_set_state_by_event(reverse_event(1), TURNOUT_STATE_REVERSE);
+    turnout_t t;
+    ASSERT_EQ(turnout_manager_get_by_index(1, &t), ESP_OK);
+    EXPECT_EQ(t.state, TURNOUT_STATE_NORMAL);   // the reverse event now means normal
+
+    EXPECT_EQ(turnout_manager_remove(9), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(turnout_manager_swap(0, 9), ESP_ERR_INVALID_ARG);
+}
+
+TEST_F(TurnoutManager, StateEventsUpdateAndNotify)
+{
+    add(4);
+    turnout_manager_set_state_callback(record_change);
+    turnout_manager_set_pending(2, true);
+
+    turnout_manager_set_state_by_event(reverse_event(2), TURNOUT_STATE_REVERSE);
+    turnout_manager_set_state_by_event(normal_event(0), TURNOUT_STATE_NORMAL);
+    turnout_manager_set_state_by_event(0xDEAD, TURNOUT_STATE_NORMAL);
+
+    ASSERT_EQ(s_changes.size(), 2u);
+    EXPECT_EQ(s_changes[0], std::make_pair(2, TURNOUT_STATE_REVERSE));
+    EXPECT_EQ(s_changes[1], std::make_pair(0, TURNOUT_STATE_NORMAL));
+
+    turnout_t t;
+    ASSERT_EQ(turnout_manager_get_by_index(2, &t), ESP_OK);
+    EXPECT_EQ(t.state, TURNOUT_STATE_REVERSE);
+    EXPECT_FALSE(t.command_pending);
+    EXPECT_GT(t.last_update_us, 0);
+
+    turnout_command_stats_t stats;
+    turnout_manager_get_command_stats(&stats);
+    EXPECT_EQ(stats.pending, 0u);
+}
+
+TEST_F(TurnoutManager, StaleAfterTimeout)
+{
+    add(2);
+    turnout_manager_set_state_by_event(normal_event(0), TURNOUT_STATE_NORMAL);
+    EXPECT_GT(turnout_manager_check_stale(60000), 0);
+
+    vTaskDelay(pdMS_TO_TICKS(5));
+    turnout_manager_set_state_callback(record_change);
+    EXPECT_EQ(turnout_manager_check_stale(1), -1);
+    ASSERT_EQ(s_changes.size(), 1u);
+    EXPECT_EQ(s_changes[0], std::make_pair(0, TURNOUT_STATE_STALE));
+    EXPECT_EQ(turnout_manager_check_stale(0), -1);
+}
+
+TEST_F(TurnoutManager, SnapshotIsSharedUntilTheTableChanges)
+{
+    add(5);
+    const turnout_snapshot_t *a = turnout_manager_snapshot_acquire();
+    const turnout_snapshot_t *b = turnout_manager_snapshot_acquire();
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a->count, 5u);
+    turnout_manager_snapshot_release(b);
+
+    turnout_manager_set_state_by_event(normal_event(4), TURNOUT_STATE_NORMAL);
+    const turnout_snapshot_t *c = turnout_manager_snapshot_acquire();
+    ASSERT_NE(c, nullptr);
+    EXPECT_NE(c, a);
+    EXPECT_EQ(c->turnouts[4].state, TURNOUT_STATE_NORMAL);
+
+    // The old copy is immutable and stays valid while held
+    EXPECT_EQ(a->turnouts[4].state, TURNOUT_STATE_UNKNOWN);
+    turnout_manager_snapshot_release(a);
+    turnout_manager_snapshot_release(c);
+}
+
+TEST_F(TurnoutManager, SnapshotsUnderConcurrentUpdates)
+{
+    add(64);
+    std::thread writer([] {
+        for (int n = 0; n < 2000; n++) {
+            turnout_manager_set_state_by_event(n & 1 ? reverse_event(n % 64) : normal_event(n % 64),
+                                               TURNOUT_STATE_NORMAL);
+        }
+    });
+    for (int n = 0; n < 2000; n++) {
+        const turnout_snapshot_t *s = turnout_manager_snapshot_acquire();
+        ASSERT_NE(s, nullptr);
+        ASSERT_EQ(s->count, 64u);
+        turnout_manager_snapshot_release(s);
+    }
+    writer.join();
+}
+
+TEST_F(TurnoutManager, SaveWritesTheTable)
+{
+    add(3);
+    ASSERT_EQ(turnout_manager_rename(1, "Yard lead"), ESP_OK);
+    ASSERT_EQ(turnout_manager_save(), ESP_OK);
+
+    size_t n = 0;
+    const turnout_t *saved = fake_storage_saved(&n);
+    ASSERT_EQ(n, 3u);
+    EXPECT_STREQ(saved[1].name, "Yard lead");
+    EXPECT_EQ(saved[2].event_reverse, reverse_event(2));
+    EXPECT_EQ(fake_storage_save_calls(), 1u);
+}
+
+/** @brief The manager's live array (stable while no turnout is added) */
+const turnout_t *live_table()
+{
+    const turnout_t *table = nullptr;
+    size_t count = 0;
+    turnout_manager_lock();
+    turnout_manager_get_all(&table, &count);
+    turnout_manager_unlock();
+    return table;
+}
+
+// State events landing while a save runs must not push it onto the lock:
+// the snapshot it acquired is as new as the table was when it was called
+TEST_F(TurnoutManager, SaveUsesTheSnapshotUnderConcurrentStateEvents)
+{
+    add(64);
+    const turnout_t *table = live_table();
+    std::atomic<bool> done{false};
+    std::thread writer([&done] {
+        for (int n = 0; n < 20000; n++) {
+            turnout_manager_set_state_by_event(n & 1 ? reverse_event(n % 64) : normal_event(n % 64),
+                                               TURNOUT_STATE_NORMAL);
+        }
+        done = true;
+    });
+    int saves = 0, from_table = 0;
+    while (!done.load() || saves < 200) {
+        ASSERT_EQ(turnout_manager_save(), ESP_OK);
+        if (fake_storage_saved_from() == table) from_table++;
+        saves++;
+    }
+    writer.join();
+    EXPECT_EQ(from_table, 0) << "of " << saves << " saves";
+}
+
+TEST_F(TurnoutManager, SaveFallsBackToTheTableWhenTheCopyFails)
+{
+    add(3);
+    turnout_manager_snapshot_release(turnout_manager_snapshot_acquire());
+    turnout_manager_set_state_by_event(reverse_event(2), TURNOUT_STATE_REVERSE);
+
+    // The snapshot copy is the save's first heap_caps allocation
+    host_heap_fail_after(1, 1);
+    ASSERT_EQ(turnout_manager_save(), ESP_OK);
+    host_heap_fail_after(0, 0);
+
+    size_t n = 0;
+    const turnout_t *saved = fake_storage_saved(&n);
+    EXPECT_EQ(fake_storage_saved_from(), live_table());
+    ASSERT_EQ(n, 3u);
+    EXPECT_EQ(saved[2].state, TURNOUT_STATE_REVERSE);
+}
+
+}  // namespace
@@ -0,0 +1,410 @@
+/**
+ * @file app_bench.c
+ * @brief Micro-benchmarks of the app layer's hot functions
+ *
+ * Each function is called over every element of the loaded data, repeated
+ * CONFIG_APP_BENCH_PASSES times, and the mean cost per call is logged.
+ * Lookups are timed through the public API, so turnout lookups include the
+ * manager's mutex.  Results are summed into a volatile sink so the calls
+ * are not optimised away.
+ *
+ * The parsers are also timed over generated turnouts.json and JMRI text
+ * in memory (MB/s, and cJSON allocations per turnout through counting
+ * hooks), then fed mutated copies of small seed inputs: byte flips, inserted
+ * delimiters and truncation.  A crash there is the finding; an accepted
+ * event ID must also format back to the same value.
+ */
+
+#include "app_bench.h"
+#include "turnout_manager.h"
+#include "turnout_storage.h"
+#include "panel_layout.h"
+#include "panel_storage.h"
+#include "panel_geometry.h"
+#include "psram_array.h"
+#include "lcc_id.h"
+#include "cJSON.h"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "app_bench";
+
+/// File parses per storage benchmark (each reads the SD card)
+#define BENCH_PARSE_RUNS    3
+
+/// Event IDs no turnout uses, for the lookup miss case
+#define BENCH_MISS_EVENT    0x0501010122FE0000ULL
+
+/// Turnouts in the generated parser inputs
+#define BENCH_PARSER_TURNOUTS   500
+
+/// Mutated inputs per parser per pass
+#define BENCH_MUTATIONS         10
+
+/// Seed document buffer (two turnouts fit with room to spare)
+#define BENCH_SEED_SIZE         1024
+
+static volatile uint32_t s_sink;
+static uint32_t s_cjson_allocs;
+
+static void report(const char *name, size_t calls, int64_t us)
+{
+    if (calls == 0) return;
+    ESP_LOGI(TAG, "%-28s %7d calls %8d ns/call",
+             name, (int)calls, (int)(us * 1000 / (int64_t)calls));
+}
+
+static void bench_storage(void)
+{
+    // --- turnouts.json into a scratch array ---
+    turnout_t *turnouts = NULL;
+    size_t capacity = 0, count = 0, runs = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int r = 0; r < BENCH_PARSE_RUNS; r++) {
+        if (turnout_storage_load(&turnouts, &capacity, &count) != ESP_OK) break;
+        runs++;
+    }
+    int64_t us = esp_timer_get_time() - t0;
+    psram_array_free((void **)&turnouts, &capacity);
+    if (runs) {
+        ESP_LOGI(TAG, "turnout_storage_load: %d turnouts in %d us",
+                 (int)count, (int)(us / (int64_t)runs));
+    }
+
+    // --- panel.json into a scratch layout, then its index rebuild ---
+    panel_layout_t scratch = { .index = { .valid = true } };
+    t0 = esp_timer_get_time();
+    for (int r = 0; r < BENCH_PARSE_RUNS; r++) {
+        panel_storage_load(&scratch);
+    }
+    us = esp_timer_get_time() - t0;
+    ESP_LOGI(TAG, "panel_storage_load: %d items, %d tracks in %d us",
+             (int)scratch.item_count, (int)scratch.track_count,
+             (int)(us / BENCH_PARSE_RUNS));
+
+    t0 = esp_timer_get_time();
+    for (int r = 0; r < CONFIG_APP_BENCH_PASSES; r++) {
+        panel_layout_reindex(&scratch);
+    }
+    report("panel_layout_reindex", CONFIG_APP_BENCH_PASSES, esp_timer_get_time() - t0);
+    panel_layout_free(&scratch);
+}
+
+// ============================================================================
+// Parsers
+// ============================================================================
+
+static void *counting_malloc(size_t size)
+{
+    s_cjson_allocs++;
+    return malloc(size);
+}
+
+static void format_event(uint64_t id, char *buf, size_t len)
+{
+    snprintf(buf, len, "%02X.%02X.%02X.%02X.%02X.%02X.%02X.%02X",
+             (unsigned)((id >> 56) & 0xFF), (unsigned)((id >> 48) & 0xFF),
+             (unsigned)((id >> 40) & 0xFF), (unsigned)((id >> 32) & 0xFF),
+             (unsigned)((id >> 24) & 0xFF), (unsigned)((id >> 16) & 0xFF),
+             (unsigned)((id >> 8) & 0xFF),  (unsigned)(id & 0xFF));
+}
+
+static void report_rate(const char *name, size_t bytes, size_t records, int64_t us,
+                        uint32_t allocs)
+{
+    if (us <= 0 || records == 0) return;
+    uint32_t rate = (uint32_t)((uint64_t)bytes * 100 / (uint64_t)us);   // MB/s × 100
+    ESP_LOGI(TAG, "%-28s %7d bytes %4d.%02d MB/s %6d us/1000 records %3d allocs/record",
+             name, (int)bytes, (int)(rate / 100), (int)(rate % 100),
+             (int)(us * 1000 / (int64_t)records), (int)(allocs / records));
+}
+
+/** @brief Generated turnouts.json text in the format turnout_storage_save writes */
+static size_t gen_json(char *buf, size_t len, size_t turnouts)
+{
+    char ev_n[24], ev_r[24];
+    size_t n = (size_t)snprintf(buf, len, "{\n  \"version\": 1,\n  \"turnouts\": [\n");
+    for (size_t i = 0; i < turnouts && n < len; i++) {
+        format_event(0x0501010122600000ULL + 2 * i, ev_n, sizeof(ev_n));
+        format_event(0x0501010122600001ULL + 2 * i, ev_r, sizeof(ev_r));
+        n += (size_t)snprintf(buf + n, len - n,
+                              "    {\"name\": \"Turnout %d\", \"id\": %d, "
+                              "\"event_normal\": \"%s\", \"event_reverse\": \"%s\", "
+                              "\"order\": %d}%s\n",
+                              (int)i + 1, (int)i + 1, ev_n, ev_r, (int)i,
+                              i + 1 < turnouts ? "," : "");
+    }
+    if (n < len) n += (size_t)snprintf(buf + n, len - n, "  ]\n}\n");
+    return n < len ? n : 0;
+}
+
+/** @brief Generated JMRI roster text; every other turnout has no userName */
+static size_t gen_jmri(char *buf, size_t len, size_t turnouts)
+{
+    char ev_n[24], ev_r[24];
+    size_t n = (size_t)snprintf(buf, len,
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<layout-config>\n"
+        "  <turnouts class=\"jmri.jmrix.openlcb.configurexml.OlcbTurnoutManagerXml\">\n");
+    for (size_t i = 0; i < turnouts && n < len; i++) {
+        format_event(0x0501010122700000ULL + 2 * i, ev_n, sizeof(ev_n));
+        format_event(0x0501010122700001ULL + 2 * i, ev_r, sizeof(ev_r));
+        n += (size_t)snprintf(buf + n, len - n,
+                              "    <turnout feedback=\"MONITORING\" inverted=\"%s\" automate=\"Off\">\n"
+                              "      <systemName>MT%s;%s</systemName>\n%s%s%s"
+                              "    </turnout>\n",
+                              i % 5 == 0 ? "true" : "false", ev_n, ev_r,
+                              i % 2 ? "      <userName>Yard " : "",
+                              i % 2 ? ev_n + 18 : "", i % 2 ? "</userName>\n" : "");
+    }
+    if (n < len) n += (size_t)snprintf(buf + n, len - n, "  </turnouts>\n</layout-config>\n");
+    return n < len ? n : 0;
+}
+
+/** @brief Apply one to four random edits to a NUL-terminated seed copy */
+static void mutate(char *buf, size_t size)
+{
+    static const char s_specials[] = ".;<>/\"{}[],:0Ff\\ -";
+    size_t len = strlen(buf);
+    int edits = 1 + (int)(esp_random() % 4);
+    for (int e = 0; e < edits && len > 0; e++) {
+        uint32_t r = esp_random();
+        size_t at = (r >> 8) % len;
+        switch (r % 4) {
+        case 0:     // random byte (never NUL)
+            buf[at] = (char)(1 + (r >> 24) % 255);
+            break;
+        case 1:     // delimiter or hex digit
+            buf[at] = s_specials[(r >> 24) % (sizeof(s_specials) - 1)];
+            break;
+        case 2:     // truncate
+            buf[at] = '\0';
+            len = at;
+            break;
+        default:    // duplicate a span (grows the input)
+            if (len * 2 < size) {
+                size_t span = 1 + (r >> 24) % (len - at);
+                memmove(buf + at + span, buf + at, len - at + 1);
+                len += span;
+            }
+            break;
+        }
+    }
+}
+
+static void bench_parsers(void)
+{
+    const size_t json_cap = BENCH_PARSER_TURNOUTS * 160 + 64;
+    const size_t xml_cap = BENCH_PARSER_TURNOUTS * 224 + 256;
+    char *json = heap_caps_malloc(json_cap, MALLOC_CAP_SPIRAM);
+    char *xml = heap_caps_malloc(xml_cap, MALLOC_CAP_SPIRAM);
+    char *scratch = heap_caps_malloc(BENCH_SEED_SIZE * 4, MALLOC_CAP_SPIRAM);
+    size_t json_len = json ? gen_json(json, json_cap, BENCH_PARSER_TURNOUTS) : 0;
+    size_t xml_len = xml ? gen_jmri(xml, xml_cap, BENCH_PARSER_TURNOUTS) : 0;
+    if (json_len == 0 || xml_len == 0 || !scratch) {
+        ESP_LOGE(TAG, "Out of memory for the parser inputs");
+        heap_caps_free(json);
+        heap_caps_free(xml);
+        heap_caps_free(scratch);
+        return;
+    }
+
+    // --- Event IDs ---
+    char ids[16][24];
+    size_t id_bytes = 0;
+    for (int i = 0; i < 16; i++) {
+        format_event(0x0501010122600000ULL + (uint64_t)i * 0x0101, ids[i], sizeof(ids[i]));
+        id_bytes += strlen(ids[i]);
+    }
+    uint64_t id, sum = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int pass = 0; pass < CONFIG_APP_BENCH_PASSES; pass++) {
+        for (int i = 0; i < 16; i++) {
+            if (lcc_id_parse_event(ids[i], &id)) sum += id;
+        }
+    }
+    int64_t us = esp_timer_get_time() - t0;
+    report_rate("lcc_id_parse_event", id_bytes * CONFIG_APP_BENCH_PASSES,
+                16 * CONFIG_APP_BENCH_PASSES, us, 0);
+
+    // --- turnouts.json and JMRI text, into scratch arrays ---
+    cJSON_Hooks hooks = { .malloc_fn = counting_malloc, .free_fn = free };
+    turnout_t *turnouts = NULL;
+    size_t capacity = 0, count = 0;
+    s_cjson_allocs = 0;
+    cJSON_InitHooks(&hooks);
+    t0 = esp_timer_get_time();
+    for (int r = 0; r < BENCH_PARSE_RUNS; r++) {
+        turnout_storage_parse(json, &turnouts, &capacity, &count);
+    }
+    us = esp_timer_get_time() - t0;
+    cJSON_InitHooks(NULL);
+    report_rate("turnout_storage_parse", json_len * BENCH_PARSE_RUNS,
+                count * BENCH_PARSE_RUNS, us, s_cjson_allocs);
+
+    t0 = esp_timer_get_time();
+    for (int r = 0; r < BENCH_PARSE_RUNS; r++) {
+        count = 0;
+        turnout_storage_parse_jmri(xml, &turnouts, &capacity, &count);
+    }
+    us = esp_timer_get_time() - t0;
+    report_rate("turnout_storage_parse_jmri", xml_len * BENCH_PARSE_RUNS,
+                count * BENCH_PARSE_RUNS, us, 0);
+
+    // --- Mutated inputs, seeded from small valid documents ---
+    // The loaders log every rejected input; silence them for the run
+    char *seed_json = scratch, *seed_xml = scratch + BENCH_SEED_SIZE;
+    char *input = scratch + 2 * BENCH_SEED_SIZE;    // room to double a seed
+    gen_json(seed_json, BENCH_SEED_SIZE, 2);
+    gen_jmri(seed_xml, BENCH_SEED_SIZE, 2);
+    esp_log_level_t storage_level = esp_log_level_get("turnout_storage");
+    esp_log_level_set("turnout_storage", ESP_LOG_NONE);
+    size_t runs = 0, accepted = 0, violations = 0;
+    for (int pass = 0; pass < CONFIG_APP_BENCH_PASSES * BENCH_MUTATIONS; pass++) {
+        char formatted[24];
+        strcpy(input, ids[pass % 16]);
+        mutate(input, 2 * BENCH_SEED_SIZE);
+        if (lcc_id_parse_event(input, &id)) {
+            uint64_t again = 0;
+            format_event(id, formatted, sizeof(formatted));
+            if (!lcc_id_parse_event(formatted, &again) || again != id) violations++;
+            accepted++;
+        }
+
+        strcpy(input, seed_json);
+        mutate(input, 2 * BENCH_SEED_SIZE);
+        if (turnout_storage_parse(input, &turnouts, &capacity, &count) == ESP_OK) accepted++;
+        for (size_t i = 0; i < count; i++) {
+            if (turnouts[i].name[sizeof(turnouts[i].name) - 1] != '\0') violations++;
+        }
+
+        strcpy(input, seed_xml);
+        mutate(input, 2 * BENCH_SEED_SIZE);
+        count = 0;
+        turnout_storage_parse_jmri(input, &turnouts, &capacity, &count);
+        if (count > 0) accepted++;
+        runs += 3;
+    }
+    esp_log_level_set("turnout_storage", storage_level);
+    ESP_LOGI(TAG, "Mutated parser inputs: %d run, %d accepted, %d violations",
+             (int)runs, (int)accepted, (int)violations);
+    if (violations) ESP_LOGE(TAG, "Parser produced an inconsistent result on mutated input");
+
+    s_sink = (uint32_t)sum;
+    psram_array_free((void **)&turnouts, &capacity);
+    heap_caps_free(json);
+    heap_caps_free(xml);
+    heap_caps_free(scratch);
+}
+
+static void bench_turnouts(void)
+{
+    size_t count = turnout_manager_get_count();
+    if (count == 0) return;
+
+    // Copy the keys out first so the timed loops only hit the lookups
+    uint64_t *events = NULL;
+    uint32_t *ids = NULL;
+    size_t events_cap = 0, ids_cap = 0;
+    if (!psram_array_reserve((void **)&events, &events_cap, count * 2, sizeof(uint64_t)) ||
+        !psram_array_reserve((void **)&ids, &ids_cap, count, sizeof(uint32_t))) {
+        ESP_LOGE(TAG, "Out of memory for %d turnout keys", (int)count);
+        psram_array_free((void **)&events, &events_cap);
+        psram_array_free((void **)&ids, &ids_cap);
+        return;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        turnout_t t;
+        if (turnout_manager_get_by_index(i, &t) != ESP_OK) break;
+        events[2 * n] = t.event_normal;
+        events[2 * n + 1] = t.event_reverse;
+        ids[n++] = t.id;
+    }
+
+    uint32_t sink = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int pass = 0; pass < CONFIG_APP_BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < n * 2; i++) sink += turnout_manager_find_by_event(events[i]);
+    }
+    report("find_by_event (hit)", CONFIG_APP_BENCH_PASSES * n * 2, esp_timer_get_time() - t0);
+
+    t0 = esp_timer_get_time();
+    for (int pass = 0; pass < CONFIG_APP_BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < n * 2; i++) sink += turnout_manager_find_by_event(BENCH_MISS_EVENT + i);
+    }
+    report("find_by_event (miss)", CONFIG_APP_BENCH_PASSES * n * 2, esp_timer_get_time() - t0);
+
+    t0 = esp_timer_get_time();
+    for (int pass = 0; pass < CONFIG_APP_BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < n; i++) sink += turnout_manager_find_by_id(ids[i]);
+    }
+    report("find_by_id", CONFIG_APP_BENCH_PASSES * n, esp_timer_get_time() - t0);
+
+    s_sink = sink;
+    psram_array_free((void **)&events, &events_cap);
+    psram_array_free((void **)&ids, &ids_cap);
+}
+
+static void bench_layout(const panel_layout_t *layout)
+{
+    size_t items = layout->item_count, tracks = layout->track_count;
+    uint32_t sink = 0;
+
+    int64_t t0 = esp_timer_get_time();
+    for (int pass = 0; pass < CONFIG_APP_BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < items; i++) {
+            sink += panel_layout_find_item(layout, layout->items[i].turnout_id);
+        }
+    }
+    report("panel_layout_find_item", CONFIG_APP_BENCH_PASSES * items, esp_timer_get_time() - t0);
+
+    uint16_t attached[16];
+    t0 = esp_timer_get_time();
+    for (int pass = 0; pass < CONFIG_APP_BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < items; i++) {
+            sink += panel_layout_collect_tracks(layout, PANEL_REF_TURNOUT,
+                                                layout->items[i].turnout_id, attached, 16);
+        }
+    }
+    report("panel_layout_collect_tracks", CONFIG_APP_BENCH_PASSES * items, esp_timer_get_time() - t0);
+
+    int16_t x1, y1, x2, y2;
+    t0 = esp_timer_get_time();
+    for (int pass = 0; pass < CONFIG_APP_BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < tracks; i++) {
+            sink += panel_layout_resolve_track(layout, &layout->tracks[i], &x1, &y1, &x2, &y2);
+        }
+    }
+    report("panel_layout_resolve_track", CONFIG_APP_BENCH_PASSES * tracks, esp_timer_get_time() - t0);
+
+    lv_point_t entry, normal, reverse;
+    t0 = esp_timer_get_time();
+    for (int pass = 0; pass < CONFIG_APP_BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < items; i++) {
+            panel_geometry_get_points(&layout->items[i], &entry, &normal, &reverse);
+            sink += (uint32_t)(entry.x + normal.y + reverse.x);
+        }
+    }
+    report("panel_geometry_get_points", CONFIG_APP_BENCH_PASSES * items, esp_timer_get_time() - t0);
+
+    s_sink = sink;
+}
+
+void app_bench_run(void)
+{
+    if (CONFIG_APP_BENCH_PASSES == 0) return;
+
+    ESP_LOGI(TAG, "%d turnouts, %d placed items, %d tracks, %d passes",
+             (int)turnout_manager_get_count(), (int)panel_layout_get()->item_count,
+             (int)panel_layout_get()->track_count, CONFIG_APP_BENCH_PASSES);
+    bench_storage();
+    bench_parsers();
+    bench_turnouts();
+    bench_layout(panel_layout_get());
+}
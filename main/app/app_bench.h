@@ -0,0 +1,32 @@
+/**
+ * @file app_bench.h
+ * @brief Micro-benchmarks of the app layer's hot functions
+ *
+ * Enabled by CONFIG_APP_BENCH_PASSES (menuconfig → Diagnostics).  At boot,
+ * once turnouts.json and panel.json are loaded, the storage parsers, event
+ * and ID lookups, adjacency queries, track resolution and turnout geometry
+ * are timed over the panel's own data and logged per call.  Parsing goes
+ * into scratch copies; the live turnout list and layout are only read.
+ * The ID, JSON and JMRI parsers are also timed on generated text and run
+ * over mutated inputs.
+ */
+
+#ifndef APP_BENCH_H_
+#define APP_BENCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Time each hot function over the loaded turnouts and layout
+ *
+ * Does nothing when the option is 0.
+ */
+void app_bench_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // APP_BENCH_H_
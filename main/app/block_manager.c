@@ -0,0 +1,202 @@
+/**
+ * @file block_manager.c
+ * @brief Occupancy block state tracking
+ *
+ * The block array is a growable PSRAM arena (psram_array) refilled from the
+ * layout by block_manager_sync().  Detector events are routed through an
+ * open-addressing hash of event ID → block index, the same scheme as the
+ * turnout manager's event index, and a state is only reported to the
+ * callback when it changes — repeated reports of the same state (producer
+ * re-identification, chattering detectors) cost one lookup and nothing else.
+ */
+
+#include "block_manager.h"
+#include "psram_array.h"
+#include "trace.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "block_mgr";
+
+// ============================================================================
+// Internal state
+// ============================================================================
+
+static block_t *s_blocks = NULL;        ///< Growable PSRAM array
+static size_t s_count = 0;
+static size_t s_capacity = 0;
+static SemaphoreHandle_t s_mutex = NULL;
+static block_state_callback_t s_state_callback = NULL;
+
+#define EVENT_SLOT_EMPTY    0xFFFF
+
+/// Event ID → block index hash (linear probing, kept at most 50% full).
+/// Empty when allocation failed; lookups then scan.
+static uint16_t *s_event_slots = NULL;
+static size_t s_event_slot_count = 0;
+
+// ============================================================================
+// Event index (call with the mutex held)
+// ============================================================================
+
+static size_t event_hash(uint64_t event_id)
+{
+    event_id ^= event_id >> 33;
+    event_id *= 0xff51afd7ed558ccdULL;
+    event_id ^= event_id >> 33;
+    return (size_t)event_id;
+}
+
+static bool block_has_event(size_t index, uint64_t event_id)
+{
+    return s_blocks[index].event_occupied == event_id ||
+           s_blocks[index].event_clear == event_id;
+}
+
+static void event_index_insert(uint64_t event_id, size_t index)
+{
+    size_t mask = s_event_slot_count - 1;
+    for (size_t s = event_hash(event_id) & mask;; s = (s + 1) & mask) {
+        if (s_event_slots[s] == EVENT_SLOT_EMPTY) {
+            s_event_slots[s] = (uint16_t)index;
+            return;
+        }
+        if (block_has_event(s_event_slots[s], event_id)) return;
+    }
+}
+
+static void event_index_rebuild(void)
+{
+    if (!psram_array_reserve((void **)&s_event_slots, &s_event_slot_count,
+                             s_count * 4, sizeof(s_event_slots[0]))) {
+        ESP_LOGW(TAG, "Event index allocation failed — routing by linear scan");
+        psram_array_free((void **)&s_event_slots, &s_event_slot_count);
+        return;
+    }
+    if (!s_event_slots) return;
+
+    memset(s_event_slots, 0xFF, s_event_slot_count * sizeof(s_event_slots[0]));
+    for (size_t i = 0; i < s_count; i++) {
+        event_index_insert(s_blocks[i].event_occupied, i);
+        event_index_insert(s_blocks[i].event_clear, i);
+    }
+}
+
+/** @brief Index of the first block using @p event_id, or -1 */
+static int event_index_find(uint64_t event_id)
+{
+    if (!s_event_slots) {
+        for (size_t i = 0; i < s_count; i++) {
+            if (block_has_event(i, event_id)) return (int)i;
+        }
+        return -1;
+    }
+
+    size_t mask = s_event_slot_count - 1;
+    for (size_t s = event_hash(event_id) & mask;; s = (s + 1) & mask) {
+        uint16_t idx = s_event_slots[s];
+        if (idx == EVENT_SLOT_EMPTY) return -1;
+        if (block_has_event(idx, event_id)) return (int)idx;
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t block_manager_init(void)
+{
+    if (!s_mutex) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (!s_mutex) {
+            ESP_LOGE(TAG, "Failed to create mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t block_manager_sync(const panel_layout_t *layout)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    s_count = 0;
+    if (!psram_array_reserve((void **)&s_blocks, &s_capacity,
+                             layout->block_count, sizeof(s_blocks[0]))) {
+        event_index_rebuild();
+        xSemaphoreGive(s_mutex);
+        ESP_LOGE(TAG, "Out of memory for %d blocks", (int)layout->block_count);
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < layout->block_count; i++) {
+        block_t *b = &s_blocks[i];
+        b->id = layout->blocks[i].id;
+        b->event_occupied = layout->blocks[i].event_occupied;
+        b->event_clear = layout->blocks[i].event_clear;
+        b->state = BLOCK_STATE_UNKNOWN;
+        b->last_update_us = 0;
+    }
+    s_count = layout->block_count;
+    event_index_rebuild();
+
+    xSemaphoreGive(s_mutex);
+    ESP_LOGI(TAG, "Tracking %d occupancy blocks", (int)s_count);
+    return ESP_OK;
+}
+
+void block_manager_set_state_callback(block_state_callback_t cb)
+{
+    s_state_callback = cb;
+}
+
+size_t block_manager_get_count(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    size_t count = s_count;
+    xSemaphoreGive(s_mutex);
+    return count;
+}
+
+esp_err_t block_manager_get_by_index(size_t index, block_t *out)
+{
+    if (!out) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (index >= s_count) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = s_blocks[index];
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+bool block_manager_set_state_by_event(uint64_t event_id)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    int found = event_index_find(event_id);
+    if (found < 0) {
+        xSemaphoreGive(s_mutex);
+        return false;
+    }
+
+    TRACE(TRACE_ROUTE, TRACE_KIND_BLOCK, found, event_id);
+    block_t *b = &s_blocks[found];
+    block_state_t state = event_id == b->event_occupied ? BLOCK_STATE_OCCUPIED
+                                                        : BLOCK_STATE_CLEAR;
+    bool changed = b->state != state;
+    b->state = state;
+    b->last_update_us = esp_timer_get_time();
+
+    xSemaphoreGive(s_mutex);
+    TRACE(TRACE_APPLY, TRACE_KIND_BLOCK, found, event_id);
+    if (changed && s_state_callback) {
+        s_state_callback(found, state);
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file block_manager.h
+ * @brief Occupancy block state tracking
+ *
+ * Holds the live state of the panel layout's occupancy blocks.  Detector
+ * events from the LCC executor are routed through a hashed event index, so
+ * ingest cost does not grow with the block count.  Thread-safe - can be
+ * called from the OpenMRN executor thread and the LVGL task.
+ */
+
+#ifndef BLOCK_MANAGER_H_
+#define BLOCK_MANAGER_H_
+
+#include "esp_err.h"
+#include "panel_layout.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Occupancy state of a block */
+typedef enum {
+    BLOCK_STATE_UNKNOWN = 0,    ///< No report received yet
+    BLOCK_STATE_CLEAR,          ///< Detector reports the block empty
+    BLOCK_STATE_OCCUPIED,       ///< Detector reports a train in the block
+} block_state_t;
+
+/** @brief A tracked block (copy of the layout definition plus live state) */
+typedef struct {
+    uint32_t      id;               ///< Block ID (panel_block_t.id)
+    uint64_t      event_occupied;
+    uint64_t      event_clear;
+    block_state_t state;
+    int64_t       last_update_us;   ///< Time of the last report (0 = never)
+} block_t;
+
+/**
+ * @brief Callback type for block state changes
+ *
+ * Called on the reporting thread, only when the state actually changed.
+ * Must be lightweight — typically marks the block for a UI refresh.
+ *
+ * @param index Block index in the manager array
+ * @param state New block state
+ */
+typedef void (*block_state_callback_t)(int index, block_state_t state);
+
+/**
+ * @brief Initialize the block manager (empty until block_manager_sync())
+ * @return ESP_OK on success
+ */
+esp_err_t block_manager_init(void);
+
+/**
+ * @brief Adopt the blocks of a layout
+ *
+ * Manager indices follow the layout's block array.  States start UNKNOWN.
+ * Call after the layout is loaded.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM (the manager is then empty)
+ */
+esp_err_t block_manager_sync(const panel_layout_t *layout);
+
+/**
+ * @brief Register a callback for block state changes
+ *
+ * @param cb Callback function (NULL to unregister)
+ */
+void block_manager_set_state_callback(block_state_callback_t cb);
+
+/** @brief Number of tracked blocks */
+size_t block_manager_get_count(void);
+
+/**
+ * @brief Get a copy of a block by index
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if out of range
+ */
+esp_err_t block_manager_get_by_index(size_t index, block_t *out);
+
+/**
+ * @brief Update a block from an LCC event
+ *
+ * Matches the event to a block's occupied/clear event and updates its
+ * state, invoking the state callback if it changed.
+ *
+ * @return true if the event belongs to a block
+ */
+bool block_manager_set_state_by_event(uint64_t event_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLOCK_MANAGER_H_
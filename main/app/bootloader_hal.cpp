@@ -17,6 +17,7 @@
 
 #include "bootloader_hal.h"
 #include "bootloader_display.h"
+#include "sd_io.h"
 
 #include <cstdio>
 #include <cstring>
@@ -234,7 +235,8 @@ void bootloader_hal_request_reboot(void)
     const uint32_t RTC_BOOL_TRUE = 0x92e01a42;
     bootloader_request = RTC_BOOL_TRUE;
     
-    // Give time for any pending operations
+    // Let queued saves reach the card, then give time for any pending operations
+    sd_io_flush(pdMS_TO_TICKS(2000));
     vTaskDelay(pdMS_TO_TICKS(100));
     
     // Restart into bootloader
@@ -0,0 +1,281 @@
+/**
+ * @file bus_load.c
+ * @brief Synthetic LCC traffic soak test
+ *
+ * Foreign events carry a sequence number in their low 24 bits.  The
+ * injector stamps each one into a PSRAM slot ring before handing it to the
+ * stack; a receive hook on the executor looks the slot up when the event
+ * handler sees it and bins the delay into a 100 µs histogram.  Markers that
+ * never arrive are the updates lost in the stack; a slot overwritten before
+ * its marker arrived means the backlog outgrew the ring.
+ *
+ * The injector runs at the executor's priority and paces itself in 10 ms
+ * ticks like the occupancy load test.  Injected event reports move the
+ * panel's turnout indicators (never the real turnouts — nothing is sent),
+ * so the run ends with a state query sweep to put them back.
+ */
+
+#include "bus_load.h"
+#include "lcc_node.h"
+#include "turnout_manager.h"
+#include "ui_dirty.h"
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+
+static const char *TAG = "bus_load";
+
+#define LOAD_DURATION_S     60
+#define LOAD_REPORT_S       5
+#define LOAD_TICK_MS        10
+#define LOAD_TASK_PRIORITY  5       ///< Same as the LCC executor
+#define LOAD_TASK_STACK     3072
+#define LOAD_DRAIN_MS       2000    ///< Wait for queued markers after the run
+
+/// Pretend sender of all synthetic traffic
+#define LOAD_NODE_ID        0x0501010122FDULL
+
+/// Foreign (marker) events: base | 24-bit sequence number
+#define MARKER_BASE         0x05010101FD000000ULL
+#define MARKER_SEQ_MASK     0xFFFFFFULL
+
+/// In-flight markers the slot ring can track (power of two)
+#define MARKER_SLOTS        4096
+
+/// Latency histogram: 100 µs buckets up to 50 ms, then one overflow bucket
+#define LAT_BUCKET_US       100
+#define LAT_BUCKETS         500
+
+/// Turnouts a rebooted node reports in its ProducerIdentified burst
+#define REBOOT_BURST        32
+
+typedef struct {
+    uint32_t time_us;           ///< Low 32 bits of esp_timer at injection
+    uint32_t seq;               ///< Marker sequence number owning the slot
+} marker_slot_t;
+
+static marker_slot_t *s_slots = NULL;
+static uint32_t *s_hist = NULL;         ///< [LAT_BUCKETS + 1], written by the hook
+static uint32_t *s_hist_prev = NULL;    ///< Copy at the previous report
+static uint32_t *s_window = NULL;       ///< Difference of the two
+static volatile uint32_t s_seen = 0;        ///< Markers matched by the hook
+static volatile uint32_t s_unmatched = 0;   ///< Markers whose slot was reused
+
+static void free_buffers(void)
+{
+    heap_caps_free(s_slots);
+    heap_caps_free(s_hist);
+    heap_caps_free(s_hist_prev);
+    heap_caps_free(s_window);
+    s_slots = NULL;
+    s_hist = s_hist_prev = s_window = NULL;
+}
+
+/** @brief Receive hook — runs on the LCC executor */
+static void rx_hook(uint64_t event_id)
+{
+    if ((event_id & ~MARKER_SEQ_MASK) != MARKER_BASE) return;
+
+    uint32_t seq = (uint32_t)(event_id & MARKER_SEQ_MASK);
+    const marker_slot_t *slot = &s_slots[seq & (MARKER_SLOTS - 1)];
+    if (slot->seq != seq) {
+        s_unmatched++;
+        return;
+    }
+    uint32_t lat_us = (uint32_t)esp_timer_get_time() - slot->time_us;
+    uint32_t bucket = lat_us / LAT_BUCKET_US;
+    s_hist[bucket < LAT_BUCKETS ? bucket : LAT_BUCKETS]++;
+    s_seen++;
+}
+
+/** @brief Upper edge of the bucket holding percentile @p p, in µs */
+static uint32_t hist_percentile(const uint32_t *hist, uint32_t total, uint32_t p)
+{
+    uint32_t want = (uint32_t)(((uint64_t)total * p + 99) / 100), sum = 0;
+    for (uint32_t b = 0; b <= LAT_BUCKETS; b++) {
+        sum += hist[b];
+        if (sum >= want && sum > 0) return (b + 1) * LAT_BUCKET_US;
+    }
+    return (LAT_BUCKETS + 1) * LAT_BUCKET_US;
+}
+
+/** @brief Log p50 / p90 / p99 / max of a histogram in milliseconds */
+static void log_latency(const char *prefix, const uint32_t *hist)
+{
+    uint32_t total = 0, top = 0;
+    for (uint32_t b = 0; b <= LAT_BUCKETS; b++) {
+        total += hist[b];
+        if (hist[b]) top = b;
+    }
+    if (total == 0) {
+        ESP_LOGI(TAG, "%s: no markers received", prefix);
+        return;
+    }
+    uint32_t p50 = hist_percentile(hist, total, 50);
+    uint32_t p90 = hist_percentile(hist, total, 90);
+    uint32_t p99 = hist_percentile(hist, total, 99);
+    uint32_t max = (top + 1) * LAT_BUCKET_US;
+    ESP_LOGI(TAG, "%s: latency p50 %d.%d p90 %d.%d p99 %d.%d max %s%d.%d ms (%d markers)",
+             prefix,
+             (int)(p50 / 1000), (int)(p50 % 1000 / 100),
+             (int)(p90 / 1000), (int)(p90 % 1000 / 100),
+             (int)(p99 / 1000), (int)(p99 % 1000 / 100),
+             top == LAT_BUCKETS ? ">" : "",
+             (int)(max / 1000), (int)(max % 1000 / 100), (int)total);
+}
+
+/** @brief Executor run time in µs, or 0 without run-time stats */
+static uint32_t executor_run_time(TaskHandle_t exec)
+{
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+    if (exec) {
+        TaskStatus_t ts;
+        vTaskGetInfo(exec, &ts, pdFALSE, eRunning);
+        return (uint32_t)ts.ulRunTimeCounter;
+    }
+#endif
+    return 0;
+}
+
+/** @brief A rebooted node: InitializationComplete, then its turnout states */
+static size_t inject_reboot(size_t turnouts, size_t *cursor)
+{
+    size_t sent = 0;
+    if (lcc_node_inject(LCC_INJECT_NODE_INIT, LOAD_NODE_ID, 0) == ESP_OK) sent++;
+    for (size_t i = 0; i < REBOOT_BURST && i < turnouts; i++) {
+        turnout_t t;
+        if (turnout_manager_get_by_index(*cursor % turnouts, &t) != ESP_OK) continue;
+        bool reverse = (*cursor / turnouts) % 2;
+        (*cursor)++;
+        lcc_node_inject(LCC_INJECT_PRODUCER_VALID, LOAD_NODE_ID,
+                        reverse ? t.event_reverse : t.event_normal);
+        lcc_node_inject(LCC_INJECT_PRODUCER_INVALID, LOAD_NODE_ID,
+                        reverse ? t.event_normal : t.event_reverse);
+        sent += 2;
+    }
+    return sent;
+}
+
+static void load_task(void *arg)
+{
+    size_t turnouts = turnout_manager_get_count();
+    uint32_t rate = CONFIG_BUS_LOAD_RATE;
+    ESP_LOGI(TAG, "Injecting %d msg/s for %d s (%d%% foreign, %d turnouts, reboot every %d s)",
+             (int)rate, LOAD_DURATION_S, CONFIG_BUS_LOAD_FOREIGN_PCT, (int)turnouts,
+             CONFIG_BUS_LOAD_REBOOT_S);
+
+    TaskHandle_t exec = xTaskGetHandle("lcc_exec");
+    uint32_t exec_prev = executor_run_time(exec);
+    ui_dirty_stats_t st;
+    ui_dirty_take_stats(&st);       // start from zero
+
+    uint32_t credit = 0;            ///< Messages owed, in 1/1000 units
+    uint32_t seq = 1;               ///< Next marker (slots start zeroed)
+    size_t n = 0;                   ///< Rate-paced messages so far
+    size_t cursor = 0;              ///< Turnout walk for reports and bursts
+    size_t window_sent = 0, total_sent = 0;
+    uint32_t markers = 0;
+    TickType_t wake = xTaskGetTickCount();
+
+    lcc_node_set_rx_hook(rx_hook);
+
+    for (int second = 1; second <= LOAD_DURATION_S; second++) {
+        for (int t = 0; t < 1000 / LOAD_TICK_MS; t++) {
+            credit += rate * LOAD_TICK_MS;
+            for (; credit >= 1000; credit -= 1000, n++) {
+                if (turnouts == 0 || (int)(n % 100) < CONFIG_BUS_LOAD_FOREIGN_PCT) {
+                    marker_slot_t *slot = &s_slots[seq & (MARKER_SLOTS - 1)];
+                    slot->time_us = (uint32_t)esp_timer_get_time();
+                    slot->seq = seq;
+                    lcc_node_inject(LCC_INJECT_EVENT_REPORT, LOAD_NODE_ID, MARKER_BASE | seq);
+                    seq = (seq + 1) & MARKER_SEQ_MASK;
+                    markers++;
+                } else {
+                    turnout_t tn;
+                    if (turnout_manager_get_by_index(cursor % turnouts, &tn) != ESP_OK) continue;
+                    bool reverse = (cursor / turnouts) % 2;
+                    uint64_t ev = reverse ? tn.event_reverse : tn.event_normal;
+                    cursor++;
+                    lcc_node_inject(n % 2 ? LCC_INJECT_PRODUCER_VALID : LCC_INJECT_EVENT_REPORT,
+                                    LOAD_NODE_ID, ev);
+                }
+                window_sent++;
+            }
+            vTaskDelayUntil(&wake, pdMS_TO_TICKS(LOAD_TICK_MS));
+        }
+
+        if (CONFIG_BUS_LOAD_REBOOT_S > 0 && second % CONFIG_BUS_LOAD_REBOOT_S == 0) {
+            window_sent += inject_reboot(turnouts, &cursor);
+        }
+        if (second % LOAD_REPORT_S != 0) continue;
+
+        // --- Report the window ---
+        for (uint32_t b = 0; b <= LAT_BUCKETS; b++) {
+            uint32_t now = s_hist[b];
+            s_window[b] = now - s_hist_prev[b];
+            s_hist_prev[b] = now;
+        }
+        uint32_t exec_now = executor_run_time(exec);
+        uint32_t exec_us = exec_now - exec_prev;
+        exec_prev = exec_now;
+        ui_dirty_take_stats(&st);
+
+        char prefix[16];
+        snprintf(prefix, sizeof(prefix), "%ds", second);
+        log_latency(prefix, s_window);
+        ESP_LOGI(TAG, "%ds: %d msg/s, executor %d us/msg, backlog %d markers, "
+                 "UI %d marks -> %d redraws, lag max %d ms",
+                 second, (int)(window_sent / LOAD_REPORT_S),
+                 window_sent ? (int)(exec_us / window_sent) : 0,
+                 (int)(markers - s_seen - s_unmatched),
+                 (int)st.marks, (int)st.redraws, (int)(st.max_latency_us / 1000));
+        total_sent += window_sent;
+        window_sent = 0;
+    }
+
+    // --- Drain, then the whole-run summary ---
+    for (int waited = 0; waited < LOAD_DRAIN_MS && s_seen + s_unmatched < markers; waited += 100) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    lcc_node_set_rx_hook(NULL);
+    vTaskDelay(pdMS_TO_TICKS(100));     // let a hook call in progress finish
+
+    log_latency("Run", s_hist);
+    uint32_t lost = markers - s_seen - s_unmatched;
+    if (lost || s_unmatched) {
+        ESP_LOGW(TAG, "Done: %d messages, %d markers: %d lost, %d unmeasured (backlog over %d)",
+                 (int)total_sent, (int)markers, (int)lost, (int)s_unmatched, MARKER_SLOTS);
+    } else {
+        ESP_LOGI(TAG, "Done: %d messages, all %d markers delivered", (int)total_sent, (int)markers);
+    }
+
+    free_buffers();
+
+    // Put the turnout indicators back to what the layout reports
+    if (turnouts) lcc_node_query_all_turnout_states();
+    vTaskDelete(NULL);
+}
+
+void bus_load_start(void)
+{
+    if (CONFIG_BUS_LOAD_RATE == 0) return;
+
+    if (lcc_node_get_status() != LCC_STATUS_RUNNING) {
+        ESP_LOGW(TAG, "LCC node not running — bus load test skipped");
+        return;
+    }
+    s_slots = heap_caps_calloc(MARKER_SLOTS, sizeof(marker_slot_t), MALLOC_CAP_SPIRAM);
+    s_hist = heap_caps_calloc(LAT_BUCKETS + 1, sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    s_hist_prev = heap_caps_calloc(LAT_BUCKETS + 1, sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    s_window = heap_caps_calloc(LAT_BUCKETS + 1, sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    if (!s_slots || !s_hist || !s_hist_prev || !s_window ||
+        xTaskCreate(load_task, "bus_load", LOAD_TASK_STACK, NULL,
+                    LOAD_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start bus load test");
+        free_buffers();
+    }
+}
@@ -0,0 +1,33 @@
+/**
+ * @file bus_load.h
+ * @brief Synthetic LCC traffic soak test
+ *
+ * Enabled by CONFIG_BUS_LOAD_RATE (menuconfig → Diagnostics).  After the UI
+ * is up, a task feeds that many messages per second into the LCC stack's
+ * incoming dispatcher — event reports and ProducerIdentified for the
+ * panel's turnouts, foreign events no turnout uses, and periodic node
+ * reboots (InitializationComplete followed by a ProducerIdentified burst).
+ * Nothing is transmitted.  Every few seconds it logs dispatch latency
+ * percentiles, executor CPU time per message and updates lost in the stack.
+ */
+
+#ifndef BUS_LOAD_H_
+#define BUS_LOAD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start the load task
+ *
+ * Call after the UI is shown and the initial state queries have run.
+ * Does nothing when the option is 0 or the LCC node is not running.
+ */
+void bus_load_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUS_LOAD_H_
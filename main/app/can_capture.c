@@ -0,0 +1,185 @@
+/**
+ * @file can_capture.c
+ * @brief Raw CAN frame capture to the SD card
+ *
+ * Single-producer / single-consumer ring: the executor owns the head, the
+ * writer task owns the tail, and each publishes its counter with a release
+ * store that the other side reads with acquire.  Both counters run freely;
+ * a slot is its counter masked by the ring size (rounded down to a power
+ * of two).
+ *
+ * Stopping clears s_running first, waits a tick for a frame already past
+ * the check, then drains the rest, so every counted frame is either
+ * written or reported as dropped.
+ */
+
+#include "can_capture.h"
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "can_capture";
+
+#define CAPTURE_MAGIC           "LCCC"
+#define CAPTURE_VERSION         1
+#define CAPTURE_DRAIN_MS        100     ///< Writer wake-up interval
+#define CAPTURE_FLUSH_MS        1000    ///< fflush() interval (bounds loss on power-off)
+#define CAPTURE_TASK_PRIORITY   2       ///< Below the LCC executor and LVGL
+#define CAPTURE_TASK_STACK      3072
+
+static can_capture_record_t *s_ring = NULL;
+static uint32_t s_mask = 0;             ///< Ring size - 1
+static uint32_t s_head = 0;             ///< Frames published (executor)
+static uint32_t s_tail = 0;             ///< Frames consumed (writer)
+static volatile bool s_running = false; ///< Producer accepts frames
+static volatile bool s_active = false;  ///< Writer task alive (file open)
+static volatile uint32_t s_frames = 0;
+static volatile uint32_t s_written = 0;
+static volatile uint32_t s_dropped = 0;
+static FILE *s_file = NULL;
+
+void can_capture_frame(uint32_t can_id, uint8_t dlc, const uint8_t *data)
+{
+    if (!s_running) return;
+
+    s_frames++;
+    uint32_t head = s_head;
+    if (head - __atomic_load_n(&s_tail, __ATOMIC_ACQUIRE) > s_mask) {
+        s_dropped++;
+        return;
+    }
+    can_capture_record_t *r = &s_ring[head & s_mask];
+    r->time_us = (uint32_t)esp_timer_get_time();
+    r->can_id = can_id;
+    r->dlc = dlc > 8 ? 8 : dlc;
+    memcpy(r->data, data, r->dlc);
+    __atomic_store_n(&s_head, head + 1, __ATOMIC_RELEASE);
+}
+
+static bool write_header(uint32_t records, uint32_t dropped)
+{
+    uint8_t header[16];
+    uint16_t version = CAPTURE_VERSION, rec_size = sizeof(can_capture_record_t);
+    memcpy(header, CAPTURE_MAGIC, 4);
+    memcpy(header + 4, &version, 2);
+    memcpy(header + 6, &rec_size, 2);
+    memcpy(header + 8, &records, 4);
+    memcpy(header + 12, &dropped, 4);
+    return fwrite(header, sizeof(header), 1, s_file) == 1;
+}
+
+/** @brief Write everything published so far; false on a write error */
+static bool drain(void)
+{
+    uint32_t head = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = s_tail;
+    bool ok = true;
+    while (ok && tail != head) {
+        // Contiguous run up to the head or the end of the ring
+        uint32_t first = tail & s_mask;
+        uint32_t run = head - tail;
+        if (run > s_mask + 1 - first) run = s_mask + 1 - first;
+        ok = fwrite(&s_ring[first], sizeof(can_capture_record_t), run, s_file) == run;
+        tail += run;
+        s_written += run;
+        __atomic_store_n(&s_tail, tail, __ATOMIC_RELEASE);
+    }
+    return ok;
+}
+
+static void writer_task(void *arg)
+{
+    (void)arg;
+    bool ok = true;
+    TickType_t last_flush = xTaskGetTickCount();
+
+    while (s_running && ok) {
+        vTaskDelay(pdMS_TO_TICKS(CAPTURE_DRAIN_MS));
+        ok = drain();
+        if (ok && xTaskGetTickCount() - last_flush >= pdMS_TO_TICKS(CAPTURE_FLUSH_MS)) {
+            ok = fflush(s_file) == 0;
+            last_flush = xTaskGetTickCount();
+        }
+    }
+
+    s_running = false;
+    vTaskDelay(1);      // let a frame already past the running check finish
+    if (ok) ok = drain();
+    if (ok) ok = fseek(s_file, 0, SEEK_SET) == 0 && write_header(s_written, s_dropped);
+    if (fclose(s_file) != 0) ok = false;
+    s_file = NULL;
+
+    if (ok) {
+        ESP_LOGI(TAG, "Capture closed: %d frames written, %d dropped",
+                 (int)s_written, (int)s_dropped);
+    } else {
+        ESP_LOGE(TAG, "Capture write failed after %d frames", (int)s_written);
+    }
+    s_active = false;
+    vTaskDelete(NULL);
+}
+
+esp_err_t can_capture_start(const char *path)
+{
+#if CONFIG_CAN_CAPTURE_RECORDS > 0
+    if (s_active) return ESP_ERR_INVALID_STATE;
+
+    if (!s_ring) {
+        uint32_t size = 1;
+        while (size * 2 <= CONFIG_CAN_CAPTURE_RECORDS) size *= 2;
+        s_ring = heap_caps_malloc(size * sizeof(can_capture_record_t), MALLOC_CAP_SPIRAM);
+        if (!s_ring) {
+            ESP_LOGE(TAG, "No PSRAM for %d capture records", (int)size);
+            return ESP_ERR_NO_MEM;
+        }
+        s_mask = size - 1;
+    }
+
+    s_file = fopen(path, "wb");
+    if (!s_file) {
+        ESP_LOGE(TAG, "Cannot create %s", path);
+        return ESP_FAIL;
+    }
+    if (!write_header(0, 0)) {
+        fclose(s_file);
+        s_file = NULL;
+        return ESP_FAIL;
+    }
+
+    s_head = s_tail = 0;
+    s_frames = s_written = s_dropped = 0;
+    s_running = true;
+    s_active = true;
+    if (xTaskCreate(writer_task, "can_capture", CAPTURE_TASK_STACK, NULL,
+                    CAPTURE_TASK_PRIORITY, NULL) != pdPASS) {
+        s_running = false;
+        s_active = false;
+        fclose(s_file);
+        s_file = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Capturing CAN frames to %s (%d-frame ring)", path, (int)(s_mask + 1));
+    return ESP_OK;
+#else
+    (void)path;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void can_capture_stop(void)
+{
+    s_running = false;
+}
+
+void can_capture_get_stats(can_capture_stats_t *out)
+{
+    out->running = s_active;
+    out->frames = s_frames;
+    out->written = s_written;
+    out->dropped = s_dropped;
+}
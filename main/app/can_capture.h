@@ -0,0 +1,83 @@
+/**
+ * @file can_capture.h
+ * @brief Raw CAN frame capture to the SD card
+ *
+ * Enabled by CONFIG_CAN_CAPTURE_RECORDS (menuconfig → Diagnostics).  The
+ * LCC node taps its CAN hub and hands every frame, received or sent, to
+ * can_capture_frame(), which copies it into a PSRAM ring without locking.
+ * A low-priority writer task drains the ring to a file, so SD latency
+ * never reaches the executor; if the writer falls behind by a full ring,
+ * frames are counted as dropped rather than waited for.
+ *
+ * Started and stopped from the Diagnostics tab.  tools/can_replay.py
+ * summarises a capture or replays it as GridConnect at 1×, N× or full
+ * speed (to a file or a TCP hub such as JMRI); host/replay/lcc_replay
+ * replays it through the host build of the event path.
+ */
+
+#ifndef CAN_CAPTURE_H_
+#define CAN_CAPTURE_H_
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// can_id flag: 29-bit extended frame
+#define CAN_CAPTURE_EFF     0x80000000u
+/// can_id flag: remote transmission request
+#define CAN_CAPTURE_RTR     0x40000000u
+
+/** @brief One captured frame (20 bytes, little-endian in the file) */
+typedef struct {
+    uint32_t time_us;       ///< Low 32 bits of esp_timer_get_time()
+    uint32_t can_id;        ///< Identifier | CAN_CAPTURE_EFF / CAN_CAPTURE_RTR
+    uint8_t  dlc;           ///< Data length (0-8)
+    uint8_t  reserved[3];
+    uint8_t  data[8];
+} can_capture_record_t;
+
+/** @brief Capture progress */
+typedef struct {
+    bool     running;       ///< Capture in progress (false once the file is closed)
+    uint32_t frames;        ///< Frames seen since the capture started
+    uint32_t written;       ///< Frames written to the file
+    uint32_t dropped;       ///< Frames lost to a full ring
+} can_capture_stats_t;
+
+/**
+ * @brief Start capturing to a file (truncated)
+ *
+ * The ring is allocated on first use and kept.  File layout: 16-byte
+ * header ("LCCC", u16 version, u16 record size, u32 records, u32 dropped —
+ * the counts are filled in when the capture stops) followed by the records.
+ *
+ * @param path Destination file (e.g. "/sdcard/can.bin")
+ * @return ESP_OK, ESP_ERR_NOT_SUPPORTED when disabled, ESP_ERR_INVALID_STATE
+ *         if already running, ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t can_capture_start(const char *path);
+
+/**
+ * @brief Ask the writer to finish: drain the ring, fill in the header and
+ *        close the file.  Returns at once; stats show running until done.
+ */
+void can_capture_stop(void);
+
+/** @brief Copy the capture progress (any task) */
+void can_capture_get_stats(can_capture_stats_t *out);
+
+/**
+ * @brief Record a frame.  LCC executor only (single producer); never blocks.
+ */
+void can_capture_frame(uint32_t can_id, uint8_t dlc, const uint8_t *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_CAPTURE_H_
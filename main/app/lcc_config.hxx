@@ -29,6 +29,14 @@ static constexpr uint16_t DEFAULT_STALE_TIMEOUT_SEC = 120;
 /// Default query pace in milliseconds between state queries
 static constexpr uint16_t DEFAULT_QUERY_PACE_MS = 100;
 
+/// Read-only memory space holding the performance counter block
+/// (described by its own CDI segment; see PerfCounterSpace in lcc_node.cpp)
+static constexpr uint8_t SPACE_PERF_COUNTERS = 0xA0;
+
+/// Layout version of the counter block.  Increment when fields move or
+/// change meaning; appending fields only grows the block size field.
+static constexpr uint16_t PERF_COUNTERS_VERSION = 1;
+
 /// CDI segment for panel behavior settings
 CDI_GROUP(PanelConfig);
 
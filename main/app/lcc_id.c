@@ -0,0 +1,88 @@
+/**
+ * @file lcc_id.c
+ * @brief Event ID and node ID text parsing
+ *
+ * Replaces the sscanf("%02x.%02x...") parsers the storage modules each had.
+ * "%x" also takes a sign and a "0x" prefix and stops at the first field
+ * that does not match, so "-1.00..." or "05.01.01.01.22.60.00.00junk" were
+ * accepted with the wrong value.  app_bench.c times the parser and runs
+ * mutated IDs through it.
+ */
+
+#include "lcc_id.h"
+#include <stddef.h>
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool only_space(const char *p)
+{
+    while (is_space(*p)) p++;
+    return *p == '\0';
+}
+
+/** @brief Dotted form: exactly @p bytes fields of one or two hex digits */
+static bool parse_dotted(const char *p, int bytes, uint64_t *out)
+{
+    uint64_t val = 0;
+    for (int i = 0; i < bytes; i++) {
+        if (i > 0 && *p++ != '.') return false;
+        int hi = hex_value(p[0]);
+        if (hi < 0) return false;
+        int lo = hex_value(p[1]);
+        if (lo < 0) {
+            val = (val << 8) | (uint64_t)hi;
+            p += 1;
+        } else {
+            val = (val << 8) | (uint64_t)(hi << 4 | lo);
+            p += 2;
+        }
+    }
+    if (!only_space(p)) return false;
+    *out = val;
+    return true;
+}
+
+/** @brief Plain form: exactly 2 × @p bytes hex digits, so a truncated ID is rejected */
+static bool parse_plain(const char *p, int bytes, uint64_t *out)
+{
+    uint64_t val = 0;
+    int digits = 0;
+    for (int d; (d = hex_value(*p)) >= 0; p++) {
+        if (++digits > bytes * 2) return false;
+        val = (val << 4) | (uint64_t)d;
+    }
+    if (digits != bytes * 2 || !only_space(p)) return false;
+    *out = val;
+    return true;
+}
+
+static bool parse_id(const char *str, int bytes, uint64_t *out_id)
+{
+    if (!str || !out_id) return false;
+    while (is_space(*str)) str++;
+    return parse_dotted(str, bytes, out_id) || parse_plain(str, bytes, out_id);
+}
+
+bool lcc_id_parse_event(const char *str, uint64_t *out_id)
+{
+    return parse_id(str, 8, out_id);
+}
+
+bool lcc_id_parse_node(const char *str, uint64_t *out_id)
+{
+    uint64_t id;
+    if (!parse_id(str, 6, &id) || id == 0) return false;
+    *out_id = id;
+    return true;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file lcc_id.h
+ * @brief Event ID and node ID text parsing
+ *
+ * One strict parser for the IDs read from SD card files (turnouts.json,
+ * panel.json, roster.xml, nodeid.txt) and typed on the Add Turnout tab.
+ * Accepted forms are dotted hex ("05.01.01.01.22.60.00.00", one or two
+ * digits per byte) and plain hex ("0501010122600000", two digits per
+ * byte, leading zeros included).  Leading and trailing whitespace is
+ * allowed; signs, "0x" prefixes, extra fields, overlong fields, short
+ * plain IDs and trailing text are rejected.
+ */
+
+#ifndef LCC_ID_H_
+#define LCC_ID_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Parse an 8-byte event ID
+ *
+ * @param str    NUL-terminated text (NULL is rejected)
+ * @param out_id Parsed ID, written only on success
+ * @return true on success
+ */
+bool lcc_id_parse_event(const char *str, uint64_t *out_id);
+
+/**
+ * @brief Parse a 6-byte node ID; zero is rejected
+ *
+ * @param str    NUL-terminated text (NULL is rejected)
+ * @param out_id Parsed ID, written only on success
+ * @return true on success
+ */
+bool lcc_id_parse_node(const char *str, uint64_t *out_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LCC_ID_H_
@@ -4,13 +4,21 @@
  * 
  * Implements the OpenMRN/LCC stack for the turnout control panel.
  * This node is bidirectional: it produces turnout command events and
- * consumes turnout state feedback (ProducerIdentified, EventReport).
+ * consumes turnout state feedback and block occupancy reports
+ * (ProducerIdentified, EventReport).
  */
 
 #include "lcc_node.h"
 #include "lcc_config.hxx"
 #include "bootloader_hal.h"
 #include "turnout_manager.h"
+#include "block_manager.h"
+#include "trace.h"
+#include "can_capture.h"
+#include "lcc_id.h"
+#include "lcc_route.h"
+#include "scheduler.h"
+#include "sd_io.h"
 
 #include <cstdio>
 #include <cstring>
@@ -18,20 +26,28 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
 #include <vector>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
-#include "esp_vfs.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
+#ifdef ESP_PLATFORM
+#include "esp_vfs.h"
+#include "hal/twai_ll.h"
+#endif
 
 #include "openlcb/SimpleStack.hxx"
 #include "openlcb/SimpleNodeInfoDefs.hxx"
 #include "openlcb/ConfigUpdateFlow.hxx"
 #include "openlcb/EventHandlerTemplates.hxx"
 #include "utils/ConfigUpdateListener.hxx"
+#ifdef ESP_PLATFORM
 #include "freertos_drivers/esp32/Esp32HardwareTwai.hxx"
+#endif
 #include "utils/format_utils.hxx"
 
 static const char *TAG = "lcc_node";
@@ -44,7 +60,9 @@ namespace {
 
 static lcc_status_t s_status = LCC_STATUS_UNINITIALIZED;
 static openlcb::NodeID s_node_id = 0;
+#ifdef ESP_PLATFORM
 static Esp32HardwareTwai *s_twai = nullptr;
+#endif
 static openlcb::SimpleCanStack *s_stack = nullptr;
 static openlcb::ConfigDef *s_cfg = nullptr;
 
@@ -59,54 +77,45 @@ static std::string s_config_path;
 /// Custom memory spaces
 static class SyncingFileMemorySpace* s_config_space = nullptr;
 static class SyncingFileMemorySpace* s_acdi_usr_space = nullptr;
+static class PerfCounterSpace* s_perf_space = nullptr;
 
-/// Discovery mode state
-static bool s_discovery_mode = false;
-static lcc_discovery_callback_t s_discovery_callback = nullptr;
+// Traffic counters for the diagnostics tab (running totals, wrap freely)
+static std::atomic<uint32_t> s_events_in{0};
+static std::atomic<uint32_t> s_events_out{0};
 
-// ============================================================================
-// Node ID parsing (same as original)
-// ============================================================================
+// State query sweep progress (written by the querying task)
+static std::atomic<lcc_sweep_t> s_sweep{LCC_SWEEP_IDLE};
+static std::atomic<uint32_t> s_sweep_done{0};
+static std::atomic<uint32_t> s_sweep_total{0};
+static std::atomic<uint32_t> s_turnout_sweep_ms{0};
+static std::atomic<uint32_t> s_block_sweep_ms{0};
+static std::atomic<uint32_t> s_sweeps_completed{0};
 
-static bool parse_node_id(const char *str, openlcb::NodeID *out_id)
-{
-    if (!str || !out_id) return false;
-    while (*str && (*str == ' ' || *str == '\t' || *str == '\n' || *str == '\r')) str++;
-
-    unsigned int bytes[6];
-    if (sscanf(str, "%02x.%02x.%02x.%02x.%02x.%02x",
-               &bytes[0], &bytes[1], &bytes[2], 
-               &bytes[3], &bytes[4], &bytes[5]) == 6) {
-        *out_id = ((uint64_t)bytes[0] << 40) | ((uint64_t)bytes[1] << 32) |
-                  ((uint64_t)bytes[2] << 24) | ((uint64_t)bytes[3] << 16) |
-                  ((uint64_t)bytes[4] << 8)  | ((uint64_t)bytes[5]);
-        return true;
-    }
+static std::atomic<lcc_rx_hook_t> s_rx_hook{nullptr};
 
-    char *endptr;
-    uint64_t val = strtoull(str, &endptr, 16);
-    if (endptr != str && val != 0) { *out_id = val; return true; }
-    return false;
-}
+/// Discovery mode state
+static bool s_discovery_mode = false;
+static lcc_discovery_callback_t s_discovery_callback = nullptr;
 
 static bool read_node_id_from_file(const char *path, openlcb::NodeID *out_id)
 {
-    struct stat st;
-    if (stat(path, &st) != 0) { ESP_LOGW(TAG, "Node ID file not found: %s", path); return false; }
-
-    FILE *file = fopen(path, "r");
-    if (!file) { ESP_LOGE(TAG, "Failed to open node ID file: %s", path); return false; }
-
-    char buf[64];
-    size_t read_size = fread(buf, 1, sizeof(buf) - 1, file);
-    fclose(file);
-    if (read_size == 0) { ESP_LOGE(TAG, "Empty node ID file"); return false; }
-    buf[read_size] = '\0';
-
-    if (!parse_node_id(buf, out_id)) {
-        ESP_LOGE(TAG, "Invalid node ID format in file: %s", buf);
-        return false;
-    }
+    char *buf = nullptr;
+    size_t read_size = 0;
+    esp_err_t ret = sd_io_read_sync(path, &buf, &read_size);
+    if (ret == ESP_ERR_NOT_FOUND) { ESP_LOGW(TAG, "Node ID file not found: %s", path); return false; }
+    if (ret != ESP_OK) { ESP_LOGE(TAG, "Failed to read node ID file: %s", path); return false; }
+    if (read_size == 0) { ESP_LOGE(TAG, "Empty node ID file"); free(buf); return false; }
+
+    // The ID is the first non-blank line; anything after it is ignored
+    char *line = buf + strspn(buf, " \t\r\n");
+    line[strcspn(line, "\r\n")] = '\0';
+
+    uint64_t id;
+    bool ok = lcc_id_parse_node(line, &id);
+    if (!ok) ESP_LOGE(TAG, "Invalid node ID format in file: %s", line);
+    free(buf);
+    if (!ok) return false;
+    *out_id = id;
     ESP_LOGI(TAG, "Read node ID from file: %012llx", (unsigned long long)*out_id);
     return true;
 }
@@ -114,16 +123,18 @@ static bool read_node_id_from_file(const char *path, openlcb::NodeID *out_id)
 static void create_default_nodeid_file(const char *path)
 {
     ESP_LOGI(TAG, "Creating default nodeid.txt");
-    FILE *file = fopen(path, "w");
-    if (!file) { ESP_LOGE(TAG, "Failed to create nodeid.txt"); return; }
-    fprintf(file, "%02X.%02X.%02X.%02X.%02X.%02X\n",
+    char *text = (char *)malloc(24);
+    if (!text) { ESP_LOGE(TAG, "Failed to create nodeid.txt"); return; }
+    int len = snprintf(text, 24, "%02X.%02X.%02X.%02X.%02X.%02X\n",
             (unsigned)((LCC_DEFAULT_NODE_ID >> 40) & 0xFF),
             (unsigned)((LCC_DEFAULT_NODE_ID >> 32) & 0xFF),
             (unsigned)((LCC_DEFAULT_NODE_ID >> 24) & 0xFF),
             (unsigned)((LCC_DEFAULT_NODE_ID >> 16) & 0xFF),
             (unsigned)((LCC_DEFAULT_NODE_ID >> 8) & 0xFF),
             (unsigned)(LCC_DEFAULT_NODE_ID & 0xFF));
-    fclose(file);
+    if (sd_io_write_sync(path, text, (size_t)len) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create nodeid.txt");
+    }
 }
 
 // ============================================================================
@@ -149,7 +160,9 @@ public:
         }
         ssize_t ret = ::write(fd_, data, len);
         if (ret < 0) { *error = openlcb::Defs::ERROR_PERMANENT; return 0; }
-        fsync(fd_);
+        // A config tool writes field by field; the SD task merges the
+        // fsyncs of a burst into one instead of stalling the executor
+        if (sd_io_fsync(fd_, SD_IO_PRIO_LOW, nullptr, nullptr) != ESP_OK) fsync(fd_);
         return ret;
     }
 
@@ -174,6 +187,121 @@ private:
     openlcb::MemorySpace::address_t fileSize_;
 };
 
+// ============================================================================
+// Performance counter memory space (read-only)
+// ============================================================================
+
+/**
+ * @brief Versioned counter block for remote monitoring
+ *
+ * Fields are big-endian (as CDI integers are) and laid out back to back in
+ * the order of the "Performance Counters" segment in CDI_DATA — keep the two
+ * in step.  A read starting at offset 0 takes a fresh snapshot and later
+ * offsets are served from it, so a tool reading the segment in several
+ * datagrams sees one consistent sample.
+ */
+class PerfCounterSpace : public openlcb::MemorySpace
+{
+public:
+    static constexpr size_t SIZE = 92;
+
+    bool read_only() override { return true; }
+    openlcb::MemorySpace::address_t max_address() override { return SIZE - 1; }
+
+    size_t write(openlcb::MemorySpace::address_t destination, const uint8_t *data,
+                 size_t len, errorcode_t *error, Notifiable *again) override
+    {
+        *error = openlcb::Defs::ERROR_PERMANENT;
+        return 0;
+    }
+
+    size_t read(openlcb::MemorySpace::address_t source, uint8_t *dst,
+                size_t len, errorcode_t *error, Notifiable *again) override
+    {
+        if (source >= SIZE) {
+            *error = openlcb::MemoryConfigDefs::ERROR_OUT_OF_BOUNDS; return 0;
+        }
+        if (source == 0 || !valid_) {
+            snapshot();
+            valid_ = true;
+        }
+        len = std::min(len, (size_t)(SIZE - source));
+        memcpy(dst, block_ + source, len);
+        return len;
+    }
+
+private:
+    void put(uint32_t value, size_t bytes)
+    {
+        for (size_t i = bytes; i-- > 0;) {
+            block_[pos_++] = (uint8_t)(value >> (8 * i));
+        }
+    }
+
+    void snapshot()
+    {
+        pos_ = 0;
+
+        // Header
+        put(openlcb::PERF_COUNTERS_VERSION, 2);
+        put(SIZE, 2);
+        put((uint32_t)(esp_timer_get_time() / 1000000), 4);
+
+        // LCC traffic
+        put(s_events_in.load(std::memory_order_relaxed), 4);
+        put(s_events_out.load(std::memory_order_relaxed), 4);
+
+        // Queues: elements left in the running sweep, unconfirmed commands
+        turnout_command_stats_t cmd;
+        turnout_manager_get_command_stats(&cmd);
+        uint32_t backlog = s_sweep.load(std::memory_order_relaxed) == LCC_SWEEP_IDLE ? 0 :
+                           s_sweep_total.load(std::memory_order_relaxed) -
+                           s_sweep_done.load(std::memory_order_relaxed);
+        put(std::min<uint32_t>(backlog, 0xFFFF), 2);
+        put(std::min<uint32_t>(cmd.pending, 0xFFFF), 2);
+
+        // State query sweeps
+        put(s_turnout_sweep_ms.load(std::memory_order_relaxed), 4);
+        put(s_block_sweep_ms.load(std::memory_order_relaxed), 4);
+        put(s_sweeps_completed.load(std::memory_order_relaxed), 4);
+
+        // Command latency histogram
+        for (size_t i = 0; i < TURNOUT_LATENCY_BUCKETS; i++) {
+            put(cmd.latency_hist[i], 4);
+        }
+
+        // Heap
+        put(heap_caps_get_free_size(MALLOC_CAP_INTERNAL), 4);
+        put(heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL), 4);
+        put(heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL), 4);
+        put(heap_caps_get_free_size(MALLOC_CAP_SPIRAM), 4);
+        put(heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM), 4);
+        put(heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM), 4);
+
+#ifdef ESP_PLATFORM
+        // CAN controller: bus state, error counters, frames waiting in RX FIFO
+        uint32_t status = twai_ll_get_status(&TWAI);
+        uint32_t tec = twai_ll_get_tec(&TWAI);
+        uint32_t rec = twai_ll_get_rec(&TWAI);
+        uint8_t state = (status & TWAI_LL_STATUS_BS) ? 3 :            // bus off
+                        (tec >= 128 || rec >= 128)   ? 2 :            // error passive
+                        (status & TWAI_LL_STATUS_ES) ? 1 : 0;         // warning / active
+        put(state, 1);
+        put(std::min<uint32_t>(tec, 0xFF), 1);
+        put(std::min<uint32_t>(rec, 0xFF), 1);
+        put(std::min<uint32_t>(twai_ll_get_rx_msg_count(&TWAI), 0xFF), 1);
+#else
+        put(0, 4);      // host build: no CAN controller
+#endif
+
+        HASSERT(pos_ == SIZE);
+    }
+
+    uint8_t block_[SIZE];
+    size_t pos_ = 0;
+    bool valid_ = false;
+};
+
 // ============================================================================
 // Turnout Event Handler
 // ============================================================================
@@ -223,6 +351,9 @@ public:
                             BarrierNotifiable *done) override
     {
         AutoNotify n(done);
+        s_events_in.fetch_add(1, std::memory_order_relaxed);
+        TRACE(TRACE_RX, TRACE_KIND_NONE, 0, event->event);
+        call_rx_hook(event->event);
         route_event(event->event);
     }
 
@@ -235,8 +366,11 @@ public:
                                    BarrierNotifiable *done) override
     {
         AutoNotify n(done);
+        s_events_in.fetch_add(1, std::memory_order_relaxed);
+        call_rx_hook(event->event);
         // Only act on the VALID (active) producer state.
         if (event->state != openlcb::EventState::VALID) return;
+        TRACE(TRACE_RX, TRACE_KIND_NONE, 0, event->event);
         route_event(event->event);
     }
 
@@ -270,20 +404,16 @@ public:
     }
 
 private:
+    static void call_rx_hook(uint64_t event_id)
+    {
+        lcc_rx_hook_t hook = s_rx_hook.load(std::memory_order_relaxed);
+        if (hook) hook(event_id);
+    }
+
     void route_event(uint64_t event_id)
     {
-        // Try to match to a known turnout
-        int idx = turnout_manager_find_by_event(event_id);
-        if (idx >= 0) {
-            // Determine state from which event was received
-            turnout_t t;
-            if (turnout_manager_get_by_index(idx, &t) == ESP_OK) {
-                if (event_id == t.event_normal) {
-                    turnout_manager_set_state_by_event(event_id, TURNOUT_STATE_NORMAL);
-                } else {
-                    turnout_manager_set_state_by_event(event_id, TURNOUT_STATE_REVERSE);
-                }
-            }
+        if (lcc_route_event(event_id)) {
+            // A turnout or block took it
         } else if (s_discovery_mode && s_discovery_callback) {
             // Unknown event in discovery mode - report it
             s_discovery_callback(event_id, 0);
@@ -296,6 +426,39 @@ private:
 
 static TurnoutEventHandler *s_event_handler = nullptr;
 
+// ============================================================================
+// CAN capture tap
+// ============================================================================
+
+#if CONFIG_CAN_CAPTURE_RECORDS > 0
+/**
+ * Hub port that sees every frame on the CAN hub — received from the TWAI
+ * port and sent by the stack — and copies it to the capture ring.  Runs on
+ * the executor; costs one check per frame while no capture is running.
+ */
+class CanCaptureTap : public CanHubPort
+{
+public:
+    CanCaptureTap(Service *service) : CanHubPort(service) {}
+
+    Action entry() override
+    {
+        const struct can_frame &f = *message()->data();
+        uint32_t id;
+        if (IS_CAN_FRAME_EFF(f)) {
+            id = GET_CAN_FRAME_ID_EFF(f) | CAN_CAPTURE_EFF;
+        } else {
+            id = GET_CAN_FRAME_ID(f);
+        }
+        if (IS_CAN_FRAME_RTR(f)) id |= CAN_CAPTURE_RTR;
+        can_capture_frame(id, f.can_dlc, f.data);
+        return release_and_exit();
+    }
+};
+
+static CanCaptureTap *s_capture_tap = nullptr;
+#endif
+
 // ============================================================================
 // Config listener
 // ============================================================================
@@ -315,6 +478,9 @@ public:
         if (initial_load) {
             ESP_LOGI(TAG, "Panel config: screen_timeout=%u sec, stale_timeout=%u sec, query_pace=%u ms",
                      s_screen_timeout_sec, s_stale_timeout_sec, s_query_pace_ms);
+        } else {
+            // Let the main task re-arm the screen timeout and refresh deadlines
+            scheduler_kick(SCHEDULER_CONFIG);
         }
         return UPDATED;
     }
@@ -333,7 +499,7 @@ public:
         s_stale_timeout_sec = openlcb::DEFAULT_STALE_TIMEOUT_SEC;
         s_query_pace_ms = openlcb::DEFAULT_QUERY_PACE_MS;
         
-        fsync(fd);
+        if (sd_io_fsync(fd, SD_IO_PRIO_LOW, nullptr, nullptr) != ESP_OK) fsync(fd);
     }
 };
 
@@ -345,7 +511,11 @@ static LccConfigListener *s_config_listener = nullptr;
 // OpenMRN required external symbols
 // ============================================================================
 
+#ifdef ESP_PLATFORM
 static const char LCC_CONFIG_FILE[] = "/sdcard/openmrn_config";
+#else
+static const char LCC_CONFIG_FILE[] = "openmrn_config";    // working directory
+#endif
 
 namespace openlcb {
 
@@ -400,6 +570,68 @@ const char CDI_DATA[] =
     </int>
   </group>
 </segment>
+<segment space="160" origin="0">
+  <name>Performance Counters</name>
+  <description>Read-only runtime counters. Refresh to take a new sample. Counters are totals since boot.</description>
+  <group>
+    <name>Header</name>
+    <int size="2"><name>Layout Version</name></int>
+    <int size="2"><name>Block Size (bytes)</name></int>
+    <int size="4"><name>Uptime (seconds)</name></int>
+  </group>
+  <group>
+    <name>LCC Traffic</name>
+    <int size="4"><name>Events Received</name><description>EventReport and ProducerIdentified messages.</description></int>
+    <int size="4"><name>Events Sent</name><description>Produced events and IdentifyProducer state queries.</description></int>
+  </group>
+  <group>
+    <name>Queues</name>
+    <int size="2"><name>State Query Backlog</name><description>Elements left in the running state query sweep.</description></int>
+    <int size="2"><name>Commands Pending</name><description>Turnout commands awaiting state feedback.</description></int>
+  </group>
+  <group>
+    <name>State Query Sweeps</name>
+    <int size="4"><name>Last Turnout Sweep (ms)</name></int>
+    <int size="4"><name>Last Block Sweep (ms)</name></int>
+    <int size="4"><name>Sweeps Completed</name></int>
+  </group>
+  <group>
+    <name>Command Latency</name>
+    <description>Turnout commands confirmed, by time from command to state feedback.</description>
+    <int size="4"><name>Under 50 ms</name></int>
+    <int size="4"><name>50-100 ms</name></int>
+    <int size="4"><name>100-200 ms</name></int>
+    <int size="4"><name>200-500 ms</name></int>
+    <int size="4"><name>0.5-1 s</name></int>
+    <int size="4"><name>1-2 s</name></int>
+    <int size="4"><name>2-5 s</name></int>
+    <int size="4"><name>Over 5 s</name></int>
+  </group>
+  <group>
+    <name>Heap</name>
+    <int size="4"><name>Internal Free (bytes)</name></int>
+    <int size="4"><name>Internal Lowest Free (bytes)</name></int>
+    <int size="4"><name>Internal Largest Block (bytes)</name></int>
+    <int size="4"><name>PSRAM Free (bytes)</name></int>
+    <int size="4"><name>PSRAM Lowest Free (bytes)</name></int>
+    <int size="4"><name>PSRAM Largest Block (bytes)</name></int>
+  </group>
+  <group>
+    <name>CAN Controller</name>
+    <int size="1">
+      <name>Bus State</name>
+      <map>
+        <relation><property>0</property><value>Active</value></relation>
+        <relation><property>1</property><value>Warning</value></relation>
+        <relation><property>2</property><value>Error Passive</value></relation>
+        <relation><property>3</property><value>Bus Off</value></relation>
+      </map>
+    </int>
+    <int size="1"><name>TX Error Counter</name></int>
+    <int size="1"><name>RX Error Counter</name></int>
+    <int size="1"><name>RX FIFO Frames</name></int>
+  </group>
+</segment>
 </cdi>)xmldata";
 
 const char *const CONFIG_FILENAME = LCC_CONFIG_FILE;
@@ -428,7 +660,9 @@ esp_err_t lcc_node_init(const lcc_config_t *config)
 
     ESP_LOGI(TAG, "Initializing LCC turnout panel node...");
     ESP_LOGI(TAG, "  Node ID file: %s", cfg.nodeid_path);
+#ifdef ESP_PLATFORM
     ESP_LOGI(TAG, "  TWAI RX: GPIO%d, TX: GPIO%d", cfg.twai_rx_gpio, cfg.twai_tx_gpio);
+#endif
 
     s_config_path = cfg.config_path;
 
@@ -442,10 +676,12 @@ esp_err_t lcc_node_init(const lcc_config_t *config)
 
     s_cfg = new openlcb::ConfigDef(0);
 
+#ifdef ESP_PLATFORM
     // Initialize TWAI hardware
     ESP_LOGI(TAG, "Initializing TWAI hardware...");
     s_twai = new Esp32HardwareTwai(cfg.twai_rx_gpio, cfg.twai_tx_gpio, true);
     s_twai->hw_init();
+#endif
 
     // Create OpenMRN stack
     ESP_LOGI(TAG, "Creating OpenMRN stack...");
@@ -465,7 +701,7 @@ esp_err_t lcc_node_init(const lcc_config_t *config)
         s_status = LCC_STATUS_ERROR;
         return ESP_FAIL;
     }
-    fsync(config_fd);
+    if (sd_io_fsync(config_fd, SD_IO_PRIO_LOW, nullptr, nullptr) != ESP_OK) fsync(config_fd);
 
     // Create turnout event handler
     s_event_handler = new TurnoutEventHandler(s_stack->node());
@@ -473,9 +709,20 @@ esp_err_t lcc_node_init(const lcc_config_t *config)
     // Register global event listener BEFORE starting executor to avoid races
     s_event_handler->register_global_listener();
 
+#ifdef ESP_PLATFORM
     // Add CAN port
     ESP_LOGI(TAG, "Adding CAN port...");
     s_stack->add_can_port_select("/dev/twai/twai0");
+#else
+    // Host build (OpenMRN Linux port): the bus is a GridConnect TCP hub
+    ESP_LOGI(TAG, "Starting GridConnect hub on port %d...", cfg.hub_port);
+    s_stack->start_tcp_hub_server(cfg.hub_port);
+#endif
+
+#if CONFIG_CAN_CAPTURE_RECORDS > 0
+    s_capture_tap = new CanCaptureTap(s_stack->service());
+    s_stack->can_hub()->register_port(s_capture_tap);
+#endif
 
     // Start executor
     ESP_LOGI(TAG, "Starting executor thread...");
@@ -490,6 +737,10 @@ esp_err_t lcc_node_init(const lcc_config_t *config)
     s_stack->memory_config_handler()->registry()->insert(
         s_stack->node(), openlcb::MemoryConfigDefs::SPACE_ACDI_USR, s_acdi_usr_space);
 
+    s_perf_space = new PerfCounterSpace();
+    s_stack->memory_config_handler()->registry()->insert(
+        s_stack->node(), openlcb::SPACE_PERF_COUNTERS, s_perf_space);
+
     s_status = LCC_STATUS_RUNNING;
     ESP_LOGI(TAG, "LCC turnout panel node initialized and running");
     return ESP_OK;
@@ -520,6 +771,17 @@ uint16_t lcc_node_get_query_pace_ms(void)
     return s_query_pace_ms;
 }
 
+/// Send IdentifyProducer for one event (never moves a turnout)
+static void send_identify_producer(uint64_t event_id)
+{
+    auto *b = s_stack->node()->iface()->global_message_write_flow()->alloc();
+    b->data()->reset(openlcb::Defs::MTI_PRODUCER_IDENTIFY,
+                     s_stack->node()->node_id(),
+                     openlcb::eventid_to_buffer(event_id));
+    s_stack->node()->iface()->global_message_write_flow()->send(b);
+    s_events_out.fetch_add(1, std::memory_order_relaxed);
+}
+
 esp_err_t lcc_node_send_event(uint64_t event_id)
 {
     if (s_status != LCC_STATUS_RUNNING || !s_stack) {
@@ -528,7 +790,9 @@ esp_err_t lcc_node_send_event(uint64_t event_id)
     }
 
     ESP_LOGD(TAG, "Sending event: %016llx", (unsigned long long)event_id);
+    TRACE(TRACE_TX, TRACE_KIND_NONE, 0, event_id);
     s_stack->send_event(event_id);
+    s_events_out.fetch_add(1, std::memory_order_relaxed);
     return ESP_OK;
 }
 
@@ -555,58 +819,132 @@ void lcc_node_query_all_turnout_states(void)
     if (s_status != LCC_STATUS_RUNNING || !s_stack) return;
 
     // Query states in a background task to avoid blocking
-    // We iterate turnouts and send IdentifyProducer for each event
-    size_t count = turnout_manager_get_count();
+    // We iterate turnouts and send IdentifyProducer for each event.  The
+    // sweep walks one snapshot of the table instead of locking per turnout.
+    const turnout_snapshot_t *snap = turnout_manager_snapshot_acquire();
+    size_t count = snap ? snap->count : 0;
     uint16_t pace_ms = s_query_pace_ms;
 
     ESP_LOGI(TAG, "Querying state for %d turnouts (pace=%u ms)", (int)count, pace_ms);
+    int64_t start_us = esp_timer_get_time();
+    s_sweep_done.store(0, std::memory_order_relaxed);
+    s_sweep_total.store((uint32_t)count, std::memory_order_relaxed);
+    s_sweep.store(LCC_SWEEP_TURNOUTS, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < count; i++) {
+        const turnout_t *t = &snap->turnouts[i];
+        // Send IdentifyProducer (NOT EventReport!) for each event.
+        // MTI_PRODUCER_IDENTIFY asks "who produces this event?" and
+        // producers respond with ProducerIdentified carrying state info.
+        // This does NOT trigger turnout movement.
+        send_identify_producer(t->event_normal);
+        vTaskDelay(pdMS_TO_TICKS(pace_ms / 2));
+
+        send_identify_producer(t->event_reverse);
+        vTaskDelay(pdMS_TO_TICKS(pace_ms / 2));
+        s_sweep_done.store((uint32_t)(i + 1), std::memory_order_relaxed);
+    }
+    turnout_manager_snapshot_release(snap);
+
+    s_sweep.store(LCC_SWEEP_IDLE, std::memory_order_relaxed);
+    s_turnout_sweep_ms.store((uint32_t)((esp_timer_get_time() - start_us) / 1000),
+                             std::memory_order_relaxed);
+    s_sweeps_completed.fetch_add(1, std::memory_order_relaxed);
+    ESP_LOGI(TAG, "State query complete for %d turnouts", (int)count);
+}
+
+void lcc_node_query_all_block_states(void)
+{
+    if (s_status != LCC_STATUS_RUNNING || !s_stack) return;
+
+    size_t count = block_manager_get_count();
+    uint16_t pace_ms = s_query_pace_ms;
+    if (count == 0) return;
+
+    ESP_LOGI(TAG, "Querying occupancy for %d blocks (pace=%u ms)", (int)count, pace_ms);
+    int64_t start_us = esp_timer_get_time();
+    s_sweep_done.store(0, std::memory_order_relaxed);
+    s_sweep_total.store((uint32_t)count, std::memory_order_relaxed);
+    s_sweep.store(LCC_SWEEP_BLOCKS, std::memory_order_relaxed);
 
     for (size_t i = 0; i < count; i++) {
-        turnout_t t;
-        if (turnout_manager_get_by_index(i, &t) == ESP_OK) {
-            // Send IdentifyProducer (NOT EventReport!) for each event.
-            // MTI_PRODUCER_IDENTIFY asks "who produces this event?" and
-            // producers respond with ProducerIdentified carrying state info.
-            // This does NOT trigger turnout movement.
-            auto *b1 = s_stack->node()->iface()->global_message_write_flow()->alloc();
-            b1->data()->reset(openlcb::Defs::MTI_PRODUCER_IDENTIFY,
-                              s_stack->node()->node_id(),
-                              openlcb::eventid_to_buffer(t.event_normal));
-            s_stack->node()->iface()->global_message_write_flow()->send(b1);
+        block_t b;
+        if (block_manager_get_by_index(i, &b) == ESP_OK) {
+            // Detectors answer with ProducerIdentified; only the VALID event
+            // (occupied or clear) updates the block
+            send_identify_producer(b.event_occupied);
             vTaskDelay(pdMS_TO_TICKS(pace_ms / 2));
 
-            auto *b2 = s_stack->node()->iface()->global_message_write_flow()->alloc();
-            b2->data()->reset(openlcb::Defs::MTI_PRODUCER_IDENTIFY,
-                              s_stack->node()->node_id(),
-                              openlcb::eventid_to_buffer(t.event_reverse));
-            s_stack->node()->iface()->global_message_write_flow()->send(b2);
+            send_identify_producer(b.event_clear);
             vTaskDelay(pdMS_TO_TICKS(pace_ms / 2));
         }
+        s_sweep_done.store((uint32_t)(i + 1), std::memory_order_relaxed);
     }
 
-    ESP_LOGI(TAG, "State query complete for %d turnouts", (int)count);
+    s_sweep.store(LCC_SWEEP_IDLE, std::memory_order_relaxed);
+    s_block_sweep_ms.store((uint32_t)((esp_timer_get_time() - start_us) / 1000),
+                           std::memory_order_relaxed);
+    s_sweeps_completed.fetch_add(1, std::memory_order_relaxed);
+    ESP_LOGI(TAG, "Occupancy query complete for %d blocks", (int)count);
 }
 
 void lcc_node_query_turnout_state(uint64_t event_normal, uint64_t event_reverse)
 {
     if (s_status != LCC_STATUS_RUNNING || !s_stack) return;
 
-    auto *b1 = s_stack->node()->iface()->global_message_write_flow()->alloc();
-    b1->data()->reset(openlcb::Defs::MTI_PRODUCER_IDENTIFY,
-                      s_stack->node()->node_id(),
-                      openlcb::eventid_to_buffer(event_normal));
-    s_stack->node()->iface()->global_message_write_flow()->send(b1);
-
-    auto *b2 = s_stack->node()->iface()->global_message_write_flow()->alloc();
-    b2->data()->reset(openlcb::Defs::MTI_PRODUCER_IDENTIFY,
-                      s_stack->node()->node_id(),
-                      openlcb::eventid_to_buffer(event_reverse));
-    s_stack->node()->iface()->global_message_write_flow()->send(b2);
+    send_identify_producer(event_normal);
+    send_identify_producer(event_reverse);
 
     ESP_LOGI(TAG, "Queried state for turnout events %016llx / %016llx",
              (unsigned long long)event_normal, (unsigned long long)event_reverse);
 }
 
+void lcc_node_get_stats(lcc_node_stats_t *out)
+{
+    out->events_in = s_events_in.load(std::memory_order_relaxed);
+    out->events_out = s_events_out.load(std::memory_order_relaxed);
+    out->sweep = s_sweep.load(std::memory_order_relaxed);
+    out->sweep_done = s_sweep_done.load(std::memory_order_relaxed);
+    out->sweep_total = s_sweep_total.load(std::memory_order_relaxed);
+    out->turnout_sweep_ms = s_turnout_sweep_ms.load(std::memory_order_relaxed);
+    out->block_sweep_ms = s_block_sweep_ms.load(std::memory_order_relaxed);
+    out->sweeps_completed = s_sweeps_completed.load(std::memory_order_relaxed);
+}
+
+esp_err_t lcc_node_inject(lcc_inject_t kind, uint64_t src_node_id, uint64_t event_id)
+{
+    if (s_status != LCC_STATUS_RUNNING || !s_stack) return ESP_ERR_INVALID_STATE;
+
+    openlcb::Defs::MTI mti;
+    openlcb::Payload payload = openlcb::eventid_to_buffer(event_id);
+    switch (kind) {
+    case LCC_INJECT_PRODUCER_VALID:
+        mti = openlcb::Defs::MTI_PRODUCER_IDENTIFIED_VALID;
+        break;
+    case LCC_INJECT_PRODUCER_INVALID:
+        mti = openlcb::Defs::MTI_PRODUCER_IDENTIFIED_INVALID;
+        break;
+    case LCC_INJECT_NODE_INIT:
+        mti = openlcb::Defs::MTI_INITIALIZATION_COMPLETE;
+        payload = openlcb::node_id_to_buffer(src_node_id);
+        break;
+    default:
+        mti = openlcb::Defs::MTI_EVENT_REPORT;
+        break;
+    }
+
+    auto *dispatcher = s_stack->iface()->dispatcher();
+    auto *b = dispatcher->alloc();
+    b->data()->reset(mti, src_node_id, payload);
+    dispatcher->send(b);
+    return ESP_OK;
+}
+
+void lcc_node_set_rx_hook(lcc_rx_hook_t hook)
+{
+    s_rx_hook.store(hook, std::memory_order_relaxed);
+}
+
 void lcc_node_set_discovery_mode(bool enabled)
 {
     s_discovery_mode = enabled;
@@ -41,17 +41,30 @@ typedef struct {
     const char *config_path;        /**< Path to config file (for OpenMRN EEPROM emulation) */
     int twai_rx_gpio;               /**< TWAI RX GPIO pin */
     int twai_tx_gpio;               /**< TWAI TX GPIO pin */
+#ifndef ESP_PLATFORM
+    int hub_port;                   /**< Host build: GridConnect TCP hub port */
+#endif
 } lcc_config_t;
 
 /**
  * @brief Default LCC configuration
  */
+#ifdef ESP_PLATFORM
 #define LCC_CONFIG_DEFAULT() { \
     .nodeid_path = "/sdcard/nodeid.txt", \
     .config_path = "/sdcard/lcc_config.bin", \
     .twai_rx_gpio = 16, \
     .twai_tx_gpio = 15, \
 }
+#else
+#define LCC_CONFIG_DEFAULT() { \
+    .nodeid_path = "nodeid.txt", \
+    .config_path = "lcc_config.bin", \
+    .twai_rx_gpio = -1, \
+    .twai_tx_gpio = -1, \
+    .hub_port = 12021, \
+}
+#endif
 
 /**
  * @brief Initialize the LCC node
@@ -139,6 +152,14 @@ void lcc_node_unregister_all_turnout_events(void);
  */
 void lcc_node_query_all_turnout_states(void);
 
+/**
+ * @brief Query occupancy of all blocks in the block manager
+ *
+ * Sends IdentifyProducer for each block's occupied and clear events, paced
+ * like the turnout query.  Detector answers arrive via the event handler.
+ */
+void lcc_node_query_all_block_states(void);
+
 /**
  * @brief Query state of a single turnout event pair
  * 
@@ -150,6 +171,84 @@ void lcc_node_query_all_turnout_states(void);
  */
 void lcc_node_query_turnout_state(uint64_t event_normal, uint64_t event_reverse);
 
+// ----- Diagnostics -----
+
+/**
+ * @brief State query sweep in progress
+ */
+typedef enum {
+    LCC_SWEEP_IDLE = 0,
+    LCC_SWEEP_TURNOUTS,     /**< lcc_node_query_all_turnout_states() */
+    LCC_SWEEP_BLOCKS,       /**< lcc_node_query_all_block_states() */
+} lcc_sweep_t;
+
+/**
+ * @brief Bus traffic counters and query sweep progress
+ *
+ * Counters are running totals since boot that wrap at 2^32; callers take
+ * differences between two samples to get a rate.
+ */
+typedef struct {
+    uint32_t events_in;     /**< EventReport / ProducerIdentified received */
+    uint32_t events_out;    /**< Events produced and IdentifyProducer queries sent */
+    lcc_sweep_t sweep;      /**< Sweep running now (IDLE between sweeps) */
+    uint32_t sweep_done;    /**< Elements queried by the current or last sweep */
+    uint32_t sweep_total;   /**< Elements in the current or last sweep */
+    uint32_t turnout_sweep_ms;  /**< Duration of the last completed turnout sweep */
+    uint32_t block_sweep_ms;    /**< Duration of the last completed block sweep */
+    uint32_t sweeps_completed;  /**< Sweeps of either kind finished since boot */
+} lcc_node_stats_t;
+
+/**
+ * @brief Sample the traffic counters and sweep progress (any task, lock-free)
+ *
+ * The same figures, with heap, command latency and CAN controller state,
+ * are readable over the bus from the read-only performance counter memory
+ * space (0xA0) described in the CDI.
+ */
+void lcc_node_get_stats(lcc_node_stats_t *out);
+
+// ----- Synthetic Traffic (bus load test) -----
+
+/**
+ * @brief Kind of message fed to the stack by lcc_node_inject()
+ */
+typedef enum {
+    LCC_INJECT_EVENT_REPORT = 0,    /**< EventReport */
+    LCC_INJECT_PRODUCER_VALID,      /**< ProducerIdentified, state valid */
+    LCC_INJECT_PRODUCER_INVALID,    /**< ProducerIdentified, state invalid */
+    LCC_INJECT_NODE_INIT,           /**< InitializationComplete (event_id ignored) */
+} lcc_inject_t;
+
+/**
+ * @brief Deliver a synthetic message to the node as if it came off the bus
+ *
+ * The message enters the stack's incoming dispatcher, so it is queued and
+ * handled on the executor exactly like a received frame, but nothing is
+ * transmitted.  For load testing only.
+ *
+ * @param kind        Message type
+ * @param src_node_id 48-bit node ID of the pretend sender
+ * @param event_id    Event carried by the message
+ * @return ESP_OK, or ESP_ERR_INVALID_STATE if the node is not running
+ */
+esp_err_t lcc_node_inject(lcc_inject_t kind, uint64_t src_node_id, uint64_t event_id);
+
+/**
+ * @brief Receive hook type
+ *
+ * Called on the executor for every EventReport and ProducerIdentified the
+ * event handler sees, before the event is routed.  Must be quick.
+ */
+typedef void (*lcc_rx_hook_t)(uint64_t event_id);
+
+/**
+ * @brief Set the receive hook
+ *
+ * @param hook Hook function, or NULL to remove it
+ */
+void lcc_node_set_rx_hook(lcc_rx_hook_t hook);
+
 /**
  * @brief Set discovery mode on/off
  * 
@@ -0,0 +1,31 @@
+/**
+ * @file lcc_route.c
+ * @brief Consumed event → turnout / block routing
+ */
+
+#include "lcc_route.h"
+#include "turnout_manager.h"
+#include "block_manager.h"
+#include "trace.h"
+
+bool lcc_route_event(uint64_t event_id)
+{
+    // Try to match to a known turnout
+    int idx = turnout_manager_find_by_event(event_id);
+    if (idx >= 0) {
+        TRACE(TRACE_ROUTE, TRACE_KIND_TURNOUT, idx, event_id);
+        // Determine state from which event was received
+        turnout_t t;
+        if (turnout_manager_get_by_index(idx, &t) == ESP_OK) {
+            if (event_id == t.event_normal) {
+                turnout_manager_set_state_by_event(event_id, TURNOUT_STATE_NORMAL);
+            } else {
+                turnout_manager_set_state_by_event(event_id, TURNOUT_STATE_REVERSE);
+            }
+        }
+        return true;
+    }
+
+    // Occupancy report — the block manager updates the block
+    return block_manager_set_state_by_event(event_id);
+}
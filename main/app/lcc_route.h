@@ -0,0 +1,36 @@
+/**
+ * @file lcc_route.h
+ * @brief Consumed event → turnout / block routing
+ *
+ * The body of the LCC event handler once a message has been accepted:
+ * shared by lcc_node.cpp and the host replay tool (host/replay), so a
+ * capture replayed off target goes through the same lookups and state
+ * updates as on the panel.
+ */
+
+#ifndef LCC_ROUTE_H_
+#define LCC_ROUTE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Apply an EventReport or valid ProducerIdentified
+ *
+ * A turnout event sets that turnout's state; otherwise an occupancy event
+ * sets its block's state.
+ *
+ * @param event_id The 64-bit event ID
+ * @return true if a turnout or block uses the event
+ */
+bool lcc_route_event(uint64_t event_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LCC_ROUTE_H_
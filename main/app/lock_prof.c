@@ -0,0 +1,199 @@
+/**
+ * @file lock_prof.c
+ * @brief Contention profiler for the turnout manager and LVGL mutexes
+ *
+ * A take first tries without blocking, so a take that had to wait is
+ * counted as contended even when the wait rounds to 0 µs.  Each lock's
+ * statistics (about 5.5 KB) live in PSRAM.  They are allocated at the
+ * first take, while that lock is held.
+ */
+
+#include "lock_prof.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "lock_prof";
+
+#if CONFIG_LOCK_PROFILER
+
+static const char *const s_names[LOCK_PROF_COUNT] = {
+    [LOCK_PROF_TURNOUT] = "turnout",
+    [LOCK_PROF_LVGL]    = "lvgl",
+};
+
+/// Holder state; only the task holding the lock touches it
+typedef struct {
+    uint32_t depth;             ///< Recursive take depth
+    int      site;              ///< Site index of the outermost take (-1 untracked)
+    int64_t  acquired_us;
+} lock_state_t;
+
+static lock_prof_stats_t *s_stats[LOCK_PROF_COUNT];
+static lock_state_t s_state[LOCK_PROF_COUNT];
+static volatile uint32_t s_timeouts[LOCK_PROF_COUNT];
+
+static int bucket(uint32_t us)
+{
+    if (us == 0) return 0;
+    int b = 32 - __builtin_clz(us);
+    return b < LOCK_PROF_BUCKETS ? b : LOCK_PROF_BUCKETS - 1;
+}
+
+/** @brief Find or add a site; caller holds the lock */
+static int find_site(lock_prof_stats_t *ls, const char *func, int line)
+{
+    uint32_t n = ls->site_count;
+    for (uint32_t i = 0; i < n; i++) {
+        if (ls->sites[i].func == func && ls->sites[i].line == line) return (int)i;
+    }
+    if (n >= LOCK_PROF_SITES) return -1;
+    ls->sites[n].func = func;
+    ls->sites[n].line = (uint16_t)line;
+    __atomic_store_n(&ls->site_count, n + 1, __ATOMIC_RELEASE);
+    return (int)n;
+}
+
+BaseType_t lock_prof_take(lock_prof_id_t id, SemaphoreHandle_t sem, TickType_t ticks,
+                          bool recursive, const char *func, int line)
+{
+    int64_t t0 = esp_timer_get_time();
+    bool contended = false;
+    BaseType_t ok = recursive ? xSemaphoreTakeRecursive(sem, 0) : xSemaphoreTake(sem, 0);
+    if (ok != pdTRUE && ticks > 0) {
+        contended = true;
+        ok = recursive ? xSemaphoreTakeRecursive(sem, ticks) : xSemaphoreTake(sem, ticks);
+    }
+    if (ok != pdTRUE) {
+        __atomic_add_fetch(&s_timeouts[id], 1, __ATOMIC_RELAXED);
+        return ok;
+    }
+
+    lock_state_t *st = &s_state[id];
+    if (st->depth++ > 0) return ok;     // nested take of a recursive mutex
+
+    int64_t now = esp_timer_get_time();
+    st->acquired_us = now;
+    st->site = -1;
+
+    lock_prof_stats_t *ls = s_stats[id];
+    if (!ls) {
+        ls = heap_caps_calloc(1, sizeof(*ls), MALLOC_CAP_SPIRAM);
+        if (!ls) return ok;
+        ls->name = s_names[id];
+        __atomic_store_n(&s_stats[id], ls, __ATOMIC_RELEASE);
+    }
+
+    st->site = find_site(ls, func, line);
+    if (st->site < 0) {
+        ls->overflow++;
+        return ok;
+    }
+    lock_prof_site_t *s = &ls->sites[st->site];
+    uint32_t wait = (uint32_t)(now - t0);
+    s->count++;
+    if (contended) s->contended++;
+    s->wait_total_us += wait;
+    if (wait > s->wait_max_us) s->wait_max_us = wait;
+    s->wait_hist[bucket(wait)]++;
+    return ok;
+}
+
+void lock_prof_give(lock_prof_id_t id, SemaphoreHandle_t sem, bool recursive)
+{
+    lock_state_t *st = &s_state[id];
+    if (st->depth > 0 && --st->depth == 0) {
+        uint32_t hold = (uint32_t)(esp_timer_get_time() - st->acquired_us);
+        lock_prof_stats_t *ls = s_stats[id];
+        if (ls && st->site >= 0) {
+            lock_prof_site_t *s = &ls->sites[st->site];
+            s->hold_total_us += hold;
+            if (hold > s->hold_max_us) s->hold_max_us = hold;
+            s->hold_hist[bucket(hold)]++;
+        }
+        if (ls && hold > ls->longest_us) {
+            ls->longest_us = hold;
+            ls->longest_func = st->site >= 0 ? ls->sites[st->site].func : "(untracked)";
+            ls->longest_line = st->site >= 0 ? ls->sites[st->site].line : 0;
+            strlcpy(ls->longest_task, pcTaskGetName(NULL), sizeof(ls->longest_task));
+        }
+    }
+    if (recursive) {
+        xSemaphoreGiveRecursive(sem);
+    } else {
+        xSemaphoreGive(sem);
+    }
+}
+
+const lock_prof_stats_t *lock_prof_get(lock_prof_id_t id)
+{
+    if (id >= LOCK_PROF_COUNT) return NULL;
+    return __atomic_load_n(&s_stats[id], __ATOMIC_ACQUIRE);
+}
+
+/** @brief Non-empty histogram buckets as "<4us:12 <8us:3 ..." */
+static void format_hist(char *buf, size_t len, const uint32_t *hist)
+{
+    size_t n = 0;
+    buf[0] = '\0';
+    for (int b = 0; b < LOCK_PROF_BUCKETS && n < len; b++) {
+        if (!hist[b]) continue;
+        if (b == LOCK_PROF_BUCKETS - 1) {
+            // Everything from the previous bucket's upper bound, 2^(b-1) µs
+            n += snprintf(buf + n, len - n, " >=%dms:%u", 1 << (b - 11), (unsigned)hist[b]);
+        } else if (b >= 10) {
+            n += snprintf(buf + n, len - n, " <%dms:%u", 1 << (b - 10), (unsigned)hist[b]);
+        } else {
+            n += snprintf(buf + n, len - n, " <%dus:%u", 1 << b, (unsigned)hist[b]);
+        }
+    }
+}
+
+void lock_prof_dump(void)
+{
+    char hist[192];
+    for (int id = 0; id < LOCK_PROF_COUNT; id++) {
+        const lock_prof_stats_t *ls = lock_prof_get((lock_prof_id_t)id);
+        if (!ls) {
+            ESP_LOGI(TAG, "%s: not taken yet", s_names[id]);
+            continue;
+        }
+        uint32_t sites = __atomic_load_n(&ls->site_count, __ATOMIC_ACQUIRE);
+        ESP_LOGI(TAG, "%s: %u sites, %u untracked takes, %u timeouts; longest hold %u us "
+                 "by %s in %s:%u",
+                 ls->name, (unsigned)sites, (unsigned)ls->overflow, (unsigned)s_timeouts[id],
+                 (unsigned)ls->longest_us, ls->longest_task,
+                 ls->longest_func ? ls->longest_func : "-", (unsigned)ls->longest_line);
+        for (uint32_t i = 0; i < sites; i++) {
+            const lock_prof_site_t *s = &ls->sites[i];
+            if (s->count == 0) continue;
+            ESP_LOGI(TAG, "  %s:%u  %u takes, %u contended; wait avg %u / max %u us, "
+                     "hold avg %u / max %u us",
+                     s->func, (unsigned)s->line, (unsigned)s->count, (unsigned)s->contended,
+                     (unsigned)(s->wait_total_us / s->count), (unsigned)s->wait_max_us,
+                     (unsigned)(s->hold_total_us / s->count), (unsigned)s->hold_max_us);
+            format_hist(hist, sizeof(hist), s->wait_hist);
+            ESP_LOGI(TAG, "    wait%s", hist);
+            format_hist(hist, sizeof(hist), s->hold_hist);
+            ESP_LOGI(TAG, "    hold%s", hist);
+        }
+    }
+}
+
+#else
+
+const lock_prof_stats_t *lock_prof_get(lock_prof_id_t id)
+{
+    (void)id;
+    return NULL;
+}
+
+void lock_prof_dump(void)
+{
+    ESP_LOGI(TAG, "Lock profiler disabled (CONFIG_LOCK_PROFILER)");
+}
+
+#endif
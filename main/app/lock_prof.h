@@ -0,0 +1,110 @@
+/**
+ * @file lock_prof.h
+ * @brief Contention profiler for the turnout manager and LVGL mutexes
+ *
+ * Enabled by CONFIG_LOCK_PROFILER (menuconfig → Diagnostics).  Every take
+ * of a profiled mutex goes through LOCK_PROF_TAKE*, which records, per
+ * call site (function and line): acquisitions, how many found the mutex
+ * held, and log2 histograms of the wait and of the hold time up to the
+ * matching give.  The longest single hold is kept with its site and task.
+ * With the option off the macros are the plain FreeRTOS calls.
+ *
+ * A recursive mutex is profiled at its outermost take and give only.
+ * Statistics of a lock are written while that lock is held, so they need
+ * no lock of their own; readers see counters at most one update apart.
+ *
+ * The Diagnostics tab shows the worst wait and hold per lock, and its
+ * "Dump locks" button prints every site and histogram to the console.
+ */
+
+#ifndef LOCK_PROF_H_
+#define LOCK_PROF_H_
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Profiled locks */
+typedef enum {
+    LOCK_PROF_TURNOUT = 0,      ///< turnout_manager mutex
+    LOCK_PROF_LVGL,             ///< LVGL mutex (recursive; ui_lock and lvgl_task)
+    LOCK_PROF_COUNT
+} lock_prof_id_t;
+
+/// Histogram buckets: [0] < 1 µs, [k] < 2^k µs, last ≥ 16 ms
+#define LOCK_PROF_BUCKETS   16
+
+/// Call sites tracked per lock; takes from further sites count as overflow
+#define LOCK_PROF_SITES     32
+
+/** @brief Statistics of one call site */
+typedef struct {
+    const char *func;           ///< Function that took the lock (NULL = unused)
+    uint16_t line;
+    uint32_t count;             ///< Acquisitions
+    uint32_t contended;         ///< Acquisitions that found the lock held
+    uint32_t wait_max_us;
+    uint32_t hold_max_us;
+    uint64_t wait_total_us;
+    uint64_t hold_total_us;
+    uint32_t wait_hist[LOCK_PROF_BUCKETS];
+    uint32_t hold_hist[LOCK_PROF_BUCKETS];
+} lock_prof_site_t;
+
+/** @brief Statistics of one lock */
+typedef struct {
+    const char *name;
+    uint32_t site_count;        ///< Entries used in @ref sites
+    uint32_t overflow;          ///< Acquisitions from untracked sites
+    uint32_t longest_us;        ///< Longest single hold
+    const char *longest_func;
+    uint16_t longest_line;
+    char longest_task[configMAX_TASK_NAME_LEN];
+    lock_prof_site_t sites[LOCK_PROF_SITES];
+} lock_prof_stats_t;
+
+#if CONFIG_LOCK_PROFILER
+
+#define LOCK_PROF_TAKE(id, sem, ticks) \
+    lock_prof_take((id), (sem), (ticks), false, __func__, __LINE__)
+#define LOCK_PROF_GIVE(id, sem)         lock_prof_give((id), (sem), false)
+#define LOCK_PROF_TAKE_RECURSIVE(id, sem, ticks) \
+    lock_prof_take((id), (sem), (ticks), true, __func__, __LINE__)
+#define LOCK_PROF_GIVE_RECURSIVE(id, sem) lock_prof_give((id), (sem), true)
+
+/** @brief Take @p sem and record the wait; use the LOCK_PROF_TAKE macros */
+BaseType_t lock_prof_take(lock_prof_id_t id, SemaphoreHandle_t sem, TickType_t ticks,
+                          bool recursive, const char *func, int line);
+
+/** @brief Record the hold and give @p sem; use the LOCK_PROF_GIVE macros */
+void lock_prof_give(lock_prof_id_t id, SemaphoreHandle_t sem, bool recursive);
+
+#else
+
+#define LOCK_PROF_TAKE(id, sem, ticks)              xSemaphoreTake((sem), (ticks))
+#define LOCK_PROF_GIVE(id, sem)                     xSemaphoreGive((sem))
+#define LOCK_PROF_TAKE_RECURSIVE(id, sem, ticks)    xSemaphoreTakeRecursive((sem), (ticks))
+#define LOCK_PROF_GIVE_RECURSIVE(id, sem)           xSemaphoreGiveRecursive((sem))
+
+#endif
+
+/**
+ * @brief Statistics of a lock (live; read without locking)
+ * @return NULL when the profiler is disabled
+ */
+const lock_prof_stats_t *lock_prof_get(lock_prof_id_t id);
+
+/** @brief Print every site with its histograms to the console */
+void lock_prof_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOCK_PROF_H_
@@ -0,0 +1,105 @@
+/**
+ * @file occupancy_load.c
+ * @brief Occupancy ingest load test
+ *
+ * Transitions walk the blocks round-robin; each pass over the blocks flips
+ * every block, alternating occupied and clear passes.  The injector runs at
+ * the LCC executor's priority and paces itself in 10 ms ticks, carrying the
+ * fractional remainder so any rate is met on average.  When the run ends
+ * every block is reported clear so the overlay is left as it was found.
+ */
+
+#include "occupancy_load.h"
+#include "block_manager.h"
+#include "ui_dirty.h"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "occ_load";
+
+#define LOAD_DURATION_S     30
+#define LOAD_TICK_MS        10
+#define LOAD_TASK_PRIORITY  5       ///< Same as the LCC executor
+#define LOAD_TASK_STACK     3072
+
+/// Longest acceptable report → redraw delay (about three frames)
+#define LOAD_LAG_BUDGET_MS  50
+
+static void load_task(void *arg)
+{
+    size_t blocks = (size_t)(uintptr_t)arg;
+    uint32_t rate = CONFIG_OCCUPANCY_LOAD_RATE;
+    ESP_LOGI(TAG, "Toggling %d blocks at %d transitions/s for %d s",
+             (int)blocks, (int)rate, LOAD_DURATION_S);
+
+    uint32_t credit = 0;            ///< Transitions owed, in 1/1000 units
+    size_t sent = 0;
+    size_t sent_second = 0;
+    int64_t ingest_us = 0;
+    uint32_t worst_lag_us = 0;
+    TickType_t wake = xTaskGetTickCount();
+    ui_dirty_stats_t st;
+    ui_dirty_take_stats(&st);       // start from zero
+
+    for (int second = 1; second <= LOAD_DURATION_S; second++) {
+        for (int t = 0; t < 1000 / LOAD_TICK_MS; t++) {
+            credit += rate * LOAD_TICK_MS;
+            for (; credit >= 1000; credit -= 1000) {
+                block_t b;
+                if (block_manager_get_by_index(sent % blocks, &b) != ESP_OK) continue;
+                bool occupy = (sent / blocks) % 2 == 0;
+
+                int64_t t0 = esp_timer_get_time();
+                block_manager_set_state_by_event(occupy ? b.event_occupied : b.event_clear);
+                ingest_us += esp_timer_get_time() - t0;
+                sent++;
+                sent_second++;
+            }
+            vTaskDelayUntil(&wake, pdMS_TO_TICKS(LOAD_TICK_MS));
+        }
+
+        ui_dirty_take_stats(&st);
+        if (st.max_latency_us > worst_lag_us) worst_lag_us = st.max_latency_us;
+        ESP_LOGI(TAG, "%ds: %d transitions, ingest %d us/event, %d flushes, %d redraws, "
+                 "lag max %d ms, flush max %d ms",
+                 second, (int)sent_second,
+                 sent ? (int)(ingest_us / (int64_t)sent) : 0,
+                 (int)st.flushes, (int)st.redraws,
+                 (int)(st.max_latency_us / 1000), (int)(st.max_flush_us / 1000));
+        sent_second = 0;
+    }
+
+    for (size_t i = 0; i < blocks; i++) {
+        block_t b;
+        if (block_manager_get_by_index(i, &b) == ESP_OK) {
+            block_manager_set_state_by_event(b.event_clear);
+        }
+    }
+
+    if (worst_lag_us / 1000 > LOAD_LAG_BUDGET_MS) {
+        ESP_LOGW(TAG, "Done: %d transitions, worst UI lag %d ms (budget %d ms)",
+                 (int)sent, (int)(worst_lag_us / 1000), LOAD_LAG_BUDGET_MS);
+    } else {
+        ESP_LOGI(TAG, "Done: %d transitions, worst UI lag %d ms (within %d ms)",
+                 (int)sent, (int)(worst_lag_us / 1000), LOAD_LAG_BUDGET_MS);
+    }
+    vTaskDelete(NULL);
+}
+
+void occupancy_load_start(void)
+{
+    if (CONFIG_OCCUPANCY_LOAD_RATE == 0) return;
+
+    size_t blocks = block_manager_get_count();
+    if (blocks == 0) {
+        ESP_LOGW(TAG, "Layout has no occupancy blocks — load test skipped");
+        return;
+    }
+    if (xTaskCreate(load_task, "occ_load", LOAD_TASK_STACK, (void *)(uintptr_t)blocks,
+                    LOAD_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start load task");
+    }
+}
@@ -0,0 +1,32 @@
+/**
+ * @file occupancy_load.h
+ * @brief Occupancy ingest load test
+ *
+ * Enabled by CONFIG_OCCUPANCY_LOAD_RATE (menuconfig → Diagnostics).  After
+ * the UI is up, a task toggles the layout's blocks between occupied and
+ * clear at that many transitions per second, feeding their events through
+ * block_manager_set_state_by_event() exactly as the LCC executor would.
+ * Each second it logs the ingest cost and the UI flush statistics, so the
+ * delay from a report to its redraw can be checked under load.
+ */
+
+#ifndef OCCUPANCY_LOAD_H_
+#define OCCUPANCY_LOAD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start the load task
+ *
+ * Call after the UI is shown and the block state callback is registered.
+ * Does nothing when the option is 0 or the layout has no blocks.
+ */
+void occupancy_load_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OCCUPANCY_LOAD_H_
@@ -0,0 +1,397 @@
+/**
+ * @file panel_history.c
+ * @brief Undo/redo journal for panel layout edits
+ *
+ * Edits are serialized into variable-length records in a byte ring:
+ *
+ *   [type u8][track_count u8][index u16][length u16][body ...][tracks ...][length u16]
+ *
+ * The length in the header lets redo and the oldest-record drop walk
+ * forwards; the trailing copy lets undo walk backwards from the cursor.
+ * Offsets are free-running counters (head <= cursor <= top), reduced modulo
+ * the ring size only on access, so records may wrap around the buffer end.
+ *
+ * Record sizes: move/rotate 24 bytes, add 18-22 bytes, removal 18-20 bytes
+ * plus 14 bytes per cascaded track — the journal costs O(edit), never O(layout).
+ * A removal cascading more than REC_CASCADE_MAX tracks is not journaled; the
+ * history is cleared instead.
+ */
+
+#include "panel_history.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "panel_history";
+
+#define REC_HEADER_SIZE     6
+#define REC_TRAILER_SIZE    2
+#define REC_BODY_MAX        16      ///< UPDATE_ITEM: id + old pose + new pose
+#define REC_CASCADE_SIZE    18      ///< index + two refs (type, point, id) + block
+#define REC_CASCADE_MAX     64      ///< Tracks one removal may carry (fits the u8 count)
+
+/** Largest record: an element removal with a full cascade */
+#define REC_MAX_SIZE        (REC_HEADER_SIZE + REC_BODY_MAX + \
+                             REC_CASCADE_MAX * REC_CASCADE_SIZE + REC_TRAILER_SIZE)
+
+// ============================================================================
+// State
+// ============================================================================
+
+static uint8_t *s_ring = NULL;
+static uint32_t s_head = 0;     ///< Oldest record
+static uint32_t s_cursor = 0;   ///< End of the last applied record
+static uint32_t s_top = 0;      ///< End of the newest (redo-able) record
+
+/// Scratch, allocated in PSRAM together with the ring
+static uint8_t *s_rec = NULL;                   ///< Encode/decode buffer (REC_MAX_SIZE)
+static panel_edit_track_t *s_tracks = NULL;     ///< Decoded cascade (REC_CASCADE_MAX)
+
+// ============================================================================
+// Ring Access
+// ============================================================================
+
+static void ring_write(uint32_t off, const uint8_t *src, size_t len)
+{
+    size_t pos = off % PANEL_HISTORY_SIZE;
+    size_t first = PANEL_HISTORY_SIZE - pos;
+    if (first > len) first = len;
+    memcpy(&s_ring[pos], src, first);
+    memcpy(s_ring, src + first, len - first);
+}
+
+static void ring_read(uint32_t off, uint8_t *dst, size_t len)
+{
+    size_t pos = off % PANEL_HISTORY_SIZE;
+    size_t first = PANEL_HISTORY_SIZE - pos;
+    if (first > len) first = len;
+    memcpy(dst, &s_ring[pos], first);
+    memcpy(dst + first, s_ring, len - first);
+}
+
+static uint16_t ring_read_u16(uint32_t off)
+{
+    uint8_t b[2];
+    ring_read(off, b, 2);
+    return (uint16_t)(b[0] | (b[1] << 8));
+}
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+static uint8_t *put_u8(uint8_t *p, uint8_t v)   { *p++ = v; return p; }
+static uint8_t *put_u16(uint8_t *p, uint16_t v) { *p++ = (uint8_t)v; *p++ = (uint8_t)(v >> 8); return p; }
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p = put_u16(p, (uint16_t)v);
+    return put_u16(p, (uint16_t)(v >> 16));
+}
+
+static const uint8_t *get_u8(const uint8_t *p, uint8_t *v)   { *v = *p; return p + 1; }
+static const uint8_t *get_u16(const uint8_t *p, uint16_t *v) { *v = (uint16_t)(p[0] | (p[1] << 8)); return p + 2; }
+static const uint8_t *get_u32(const uint8_t *p, uint32_t *v)
+{
+    uint16_t lo, hi;
+    p = get_u16(p, &lo);
+    p = get_u16(p, &hi);
+    *v = lo | ((uint32_t)hi << 16);
+    return p;
+}
+
+static uint8_t *put_item_pose(uint8_t *p, const panel_item_t *item)
+{
+    p = put_u16(p, item->grid_x);
+    p = put_u16(p, item->grid_y);
+    p = put_u8(p, item->rotation);
+    return put_u8(p, item->mirrored ? 1 : 0);
+}
+
+static const uint8_t *get_item_pose(const uint8_t *p, panel_item_t *item)
+{
+    uint8_t mirrored;
+    p = get_u16(p, &item->grid_x);
+    p = get_u16(p, &item->grid_y);
+    p = get_u8(p, &item->rotation);
+    p = get_u8(p, &mirrored);
+    item->mirrored = mirrored != 0;
+    return p;
+}
+
+static uint8_t *put_ref(uint8_t *p, const panel_ref_t *ref)
+{
+    p = put_u8(p, (uint8_t)ref->type);
+    p = put_u8(p, (uint8_t)ref->point);
+    return put_u32(p, ref->id);
+}
+
+static const uint8_t *get_ref(const uint8_t *p, panel_ref_t *ref)
+{
+    uint8_t type, point;
+    p = get_u8(p, &type);
+    p = get_u8(p, &point);
+    p = get_u32(p, &ref->id);
+    ref->type = (panel_ref_type_t)type;
+    ref->point = (panel_point_type_t)point;
+    return p;
+}
+
+static uint8_t *put_track(uint8_t *p, const panel_track_t *track)
+{
+    p = put_ref(p, &track->from);
+    p = put_ref(p, &track->to);
+    return put_u32(p, track->block_id);
+}
+
+static const uint8_t *get_track(const uint8_t *p, panel_track_t *track)
+{
+    p = get_ref(p, &track->from);
+    p = get_ref(p, &track->to);
+    return get_u32(p, &track->block_id);
+}
+
+/**
+ * @brief Serialize an edit into s_rec
+ * @return Record length including header and trailer, or 0 if the cascade
+ *         is too large to journal
+ */
+static size_t encode_edit(const panel_layout_t *layout, const panel_edit_t *edit)
+{
+    uint8_t *p = s_rec + REC_HEADER_SIZE;
+    uint8_t cascade = 0;
+
+    switch (edit->type) {
+    case PANEL_EDIT_ADD_ITEM:
+    case PANEL_EDIT_REMOVE_ITEM: {
+        const panel_item_t *item = edit->type == PANEL_EDIT_ADD_ITEM ? &edit->item_new : &edit->item_old;
+        p = put_u32(p, item->turnout_id);
+        p = put_item_pose(p, item);
+        break;
+    }
+    case PANEL_EDIT_UPDATE_ITEM:
+        p = put_u32(p, edit->item_old.turnout_id);
+        p = put_item_pose(p, &edit->item_old);
+        p = put_item_pose(p, &edit->item_new);
+        break;
+    case PANEL_EDIT_ADD_ENDPOINT:
+    case PANEL_EDIT_REMOVE_ENDPOINT: {
+        const panel_endpoint_t *ep = edit->type == PANEL_EDIT_ADD_ENDPOINT ? &edit->ep_new : &edit->ep_old;
+        p = put_u32(p, ep->id);
+        p = put_u16(p, ep->grid_x);
+        p = put_u16(p, ep->grid_y);
+        break;
+    }
+    case PANEL_EDIT_UPDATE_ENDPOINT:
+        p = put_u32(p, edit->ep_old.id);
+        p = put_u16(p, edit->ep_old.grid_x);
+        p = put_u16(p, edit->ep_old.grid_y);
+        p = put_u16(p, edit->ep_new.grid_x);
+        p = put_u16(p, edit->ep_new.grid_y);
+        break;
+    case PANEL_EDIT_ADD_TRACK:
+    case PANEL_EDIT_REMOVE_TRACK:
+        p = put_track(p, &edit->track);
+        break;
+    }
+
+    // Removals snapshot the tracks the layout is about to cascade-delete
+    if (edit->type == PANEL_EDIT_REMOVE_ITEM || edit->type == PANEL_EDIT_REMOVE_ENDPOINT) {
+        panel_ref_type_t type = edit->type == PANEL_EDIT_REMOVE_ITEM ? PANEL_REF_TURNOUT : PANEL_REF_ENDPOINT;
+        uint32_t id = edit->type == PANEL_EDIT_REMOVE_ITEM ? edit->item_old.turnout_id : edit->ep_old.id;
+        uint16_t attached[REC_CASCADE_MAX];
+        size_t n = panel_layout_collect_tracks(layout, type, id, attached, REC_CASCADE_MAX);
+        if (n > REC_CASCADE_MAX) return 0;
+        for (size_t k = 0; k < n; k++) {
+            p = put_u16(p, attached[k]);
+            p = put_track(p, &layout->tracks[attached[k]]);
+        }
+        cascade = (uint8_t)n;
+    }
+
+    size_t len = (size_t)(p - s_rec) + REC_TRAILER_SIZE;
+    uint8_t *h = put_u8(s_rec, (uint8_t)edit->type);
+    h = put_u8(h, cascade);
+    h = put_u16(h, edit->index);
+    put_u16(h, (uint16_t)len);
+    put_u16(p, (uint16_t)len);
+    return len;
+}
+
+/**
+ * @brief Deserialize the record in s_rec (as recorded, not inverted)
+ */
+static void decode_edit(panel_edit_t *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    uint8_t type, cascade;
+    const uint8_t *p = get_u8(s_rec, &type);
+    p = get_u8(p, &cascade);
+    p = get_u16(p, &out->index);
+    p += 2;     // length
+    out->type = (panel_edit_type_t)type;
+
+    switch (out->type) {
+    case PANEL_EDIT_ADD_ITEM:
+    case PANEL_EDIT_REMOVE_ITEM: {
+        panel_item_t *item = out->type == PANEL_EDIT_ADD_ITEM ? &out->item_new : &out->item_old;
+        p = get_u32(p, &item->turnout_id);
+        p = get_item_pose(p, item);
+        break;
+    }
+    case PANEL_EDIT_UPDATE_ITEM:
+        p = get_u32(p, &out->item_old.turnout_id);
+        out->item_new.turnout_id = out->item_old.turnout_id;
+        p = get_item_pose(p, &out->item_old);
+        p = get_item_pose(p, &out->item_new);
+        break;
+    case PANEL_EDIT_ADD_ENDPOINT:
+    case PANEL_EDIT_REMOVE_ENDPOINT: {
+        panel_endpoint_t *ep = out->type == PANEL_EDIT_ADD_ENDPOINT ? &out->ep_new : &out->ep_old;
+        p = get_u32(p, &ep->id);
+        p = get_u16(p, &ep->grid_x);
+        p = get_u16(p, &ep->grid_y);
+        break;
+    }
+    case PANEL_EDIT_UPDATE_ENDPOINT:
+        p = get_u32(p, &out->ep_old.id);
+        out->ep_new.id = out->ep_old.id;
+        p = get_u16(p, &out->ep_old.grid_x);
+        p = get_u16(p, &out->ep_old.grid_y);
+        p = get_u16(p, &out->ep_new.grid_x);
+        p = get_u16(p, &out->ep_new.grid_y);
+        break;
+    case PANEL_EDIT_ADD_TRACK:
+    case PANEL_EDIT_REMOVE_TRACK:
+        p = get_track(p, &out->track);
+        break;
+    }
+
+    for (uint8_t i = 0; i < cascade; i++) {
+        p = get_u16(p, &s_tracks[i].index);
+        p = get_track(p, &s_tracks[i].track);
+    }
+    out->track_count = cascade;
+    out->tracks = cascade ? s_tracks : NULL;
+}
+
+/**
+ * @brief Turn a decoded edit into the edit that reverts it
+ */
+static void invert_edit(panel_edit_t *edit)
+{
+    panel_item_t item = edit->item_old;
+    edit->item_old = edit->item_new;
+    edit->item_new = item;
+
+    panel_endpoint_t ep = edit->ep_old;
+    edit->ep_old = edit->ep_new;
+    edit->ep_new = ep;
+
+    switch (edit->type) {
+    case PANEL_EDIT_ADD_ITEM:       edit->type = PANEL_EDIT_REMOVE_ITEM; break;
+    case PANEL_EDIT_REMOVE_ITEM:    edit->type = PANEL_EDIT_ADD_ITEM; break;
+    case PANEL_EDIT_ADD_ENDPOINT:   edit->type = PANEL_EDIT_REMOVE_ENDPOINT; break;
+    case PANEL_EDIT_REMOVE_ENDPOINT: edit->type = PANEL_EDIT_ADD_ENDPOINT; break;
+    case PANEL_EDIT_ADD_TRACK:      edit->type = PANEL_EDIT_REMOVE_TRACK; break;
+    case PANEL_EDIT_REMOVE_TRACK:   edit->type = PANEL_EDIT_ADD_TRACK; break;
+    default: break;
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t panel_history_init(void)
+{
+    if (s_ring) return ESP_OK;
+
+    // Ring, record scratch and decoded cascade in one block
+    size_t size = PANEL_HISTORY_SIZE + REC_MAX_SIZE +
+                  REC_CASCADE_MAX * sizeof(panel_edit_track_t);
+    uint8_t *block = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!block) {
+        ESP_LOGW(TAG, "PSRAM alloc failed, falling back to internal RAM");
+        block = malloc(size);
+    }
+    if (!block) {
+        ESP_LOGE(TAG, "Failed to allocate undo journal — undo disabled");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Cascade entries first so they stay aligned; the byte buffers follow
+    s_tracks = (panel_edit_track_t *)block;
+    s_rec = block + REC_CASCADE_MAX * sizeof(panel_edit_track_t);
+    s_ring = s_rec + REC_MAX_SIZE;
+
+    panel_history_clear();
+    ESP_LOGI(TAG, "Undo journal: %d bytes", PANEL_HISTORY_SIZE);
+    return ESP_OK;
+}
+
+void panel_history_clear(void)
+{
+    s_head = s_cursor = s_top = 0;
+}
+
+void panel_history_record(const panel_layout_t *layout, const panel_edit_t *edit)
+{
+    if (!s_ring) return;
+
+    size_t len = encode_edit(layout, edit);
+    if (len == 0) {
+        ESP_LOGW(TAG, "Removal cascades over %d tracks — history cleared", REC_CASCADE_MAX);
+        panel_history_clear();
+        return;
+    }
+
+    // A new edit forks history: the redo entries are gone
+    s_top = s_cursor;
+
+    // Drop the oldest records until the new one fits
+    while (s_top - s_head + len > PANEL_HISTORY_SIZE && s_head != s_top) {
+        s_head += ring_read_u16(s_head + REC_HEADER_SIZE - 2);
+    }
+
+    ring_write(s_top, s_rec, len);
+    s_top += (uint32_t)len;
+    s_cursor = s_top;
+}
+
+bool panel_history_undo(panel_edit_t *out)
+{
+    if (!panel_history_can_undo()) return false;
+
+    uint16_t len = ring_read_u16(s_cursor - REC_TRAILER_SIZE);
+    s_cursor -= len;
+    ring_read(s_cursor, s_rec, len);
+    decode_edit(out);
+    invert_edit(out);
+    return true;
+}
+
+bool panel_history_redo(panel_edit_t *out)
+{
+    if (!panel_history_can_redo()) return false;
+
+    uint16_t len = ring_read_u16(s_cursor + REC_HEADER_SIZE - 2);
+    ring_read(s_cursor, s_rec, len);
+    s_cursor += len;
+    decode_edit(out);
+    // Re-applying a removal cascades the tracks again; only undo restores them
+    out->track_count = 0;
+    out->tracks = NULL;
+    return true;
+}
+
+bool panel_history_can_undo(void)
+{
+    return s_ring && s_cursor != s_head;
+}
+
+bool panel_history_can_redo(void)
+{
+    return s_ring && s_cursor != s_top;
+}
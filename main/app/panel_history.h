@@ -0,0 +1,115 @@
+/**
+ * @file panel_history.h
+ * @brief Undo/redo journal for panel layout edits
+ *
+ * Records each builder edit as a compact delta (what changed, not a copy of
+ * the layout) in a bounded ring buffer in PSRAM.  Removals carry the tracks
+ * they cascade-deleted so an undo restores them at their original indices.
+ * When the ring is full the oldest edits are dropped.
+ *
+ * The journal only stores and replays edits; the caller applies the returned
+ * panel_edit_t to the layout (and its own view of it).  Not thread-safe —
+ * used from the LVGL task only.
+ */
+
+#ifndef PANEL_HISTORY_H_
+#define PANEL_HISTORY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "panel_layout.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Journal ring size in bytes (a move costs ~20 bytes) */
+#define PANEL_HISTORY_SIZE  (16 * 1024)
+
+/** @brief Kind of layout edit */
+typedef enum {
+    PANEL_EDIT_ADD_ITEM = 0,        ///< item_new inserted at index
+    PANEL_EDIT_REMOVE_ITEM,         ///< item_old removed from index (+ cascaded tracks)
+    PANEL_EDIT_UPDATE_ITEM,         ///< item at index changed item_old -> item_new
+    PANEL_EDIT_ADD_ENDPOINT,        ///< ep_new inserted at index
+    PANEL_EDIT_REMOVE_ENDPOINT,     ///< ep_old removed from index (+ cascaded tracks)
+    PANEL_EDIT_UPDATE_ENDPOINT,     ///< endpoint at index changed ep_old -> ep_new
+    PANEL_EDIT_ADD_TRACK,           ///< track inserted at index
+    PANEL_EDIT_REMOVE_TRACK,        ///< track removed from index
+} panel_edit_type_t;
+
+/** @brief A track together with its array index */
+typedef struct {
+    uint16_t      index;
+    panel_track_t track;
+} panel_edit_track_t;
+
+/**
+ * @brief One layout edit
+ *
+ * Only the fields named by the type are meaningful.  For ADD_ITEM and
+ * ADD_ENDPOINT, @c tracks lists tracks to insert (ascending index) after
+ * the element; for removals the layout cascade deletes them implicitly.
+ */
+typedef struct {
+    panel_edit_type_t         type;
+    uint16_t                  index;        ///< Array index of the element
+    panel_item_t              item_old;
+    panel_item_t              item_new;
+    panel_endpoint_t          ep_old;
+    panel_endpoint_t          ep_new;
+    panel_track_t             track;
+    uint16_t                  track_count;  ///< Entries in @c tracks
+    const panel_edit_track_t *tracks;
+} panel_edit_t;
+
+/**
+ * @brief Allocate the journal ring (PSRAM, internal RAM fallback)
+ * @return ESP_OK, or ESP_ERR_NO_MEM (history is then disabled)
+ */
+esp_err_t panel_history_init(void);
+
+/**
+ * @brief Discard all undo and redo entries
+ *
+ * Call whenever the layout changes outside the journal (load, external
+ * delete), since recorded indices no longer apply.
+ */
+void panel_history_clear(void);
+
+/**
+ * @brief Record an edit and discard the redo entries
+ *
+ * Removals snapshot the tracks the layout will cascade-delete, so record
+ * REMOVE_ITEM / REMOVE_ENDPOINT before applying them.
+ */
+void panel_history_record(const panel_layout_t *layout, const panel_edit_t *edit);
+
+/**
+ * @brief Step back one edit
+ * @param out  Filled with the inverse edit to apply.  @c out->tracks points
+ *             into journal scratch memory, valid until the next call.
+ * @return false if there is nothing to undo
+ */
+bool panel_history_undo(panel_edit_t *out);
+
+/**
+ * @brief Step forward one undone edit
+ * @param out  Filled with the edit to re-apply (same lifetime as undo)
+ * @return false if there is nothing to redo
+ */
+bool panel_history_redo(panel_edit_t *out);
+
+/** @brief Check whether an undo step is available */
+bool panel_history_can_undo(void);
+
+/** @brief Check whether a redo step is available */
+bool panel_history_can_redo(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PANEL_HISTORY_H_
@@ -7,8 +7,9 @@
  * the live panel screen and the panel builder editor.
  *
  * Key responsibilities:
- *   - Singleton ownership of panel_layout_t
- *   - Add / remove items, endpoints, tracks (with cascade delete)
+ *   - Singleton ownership of panel_layout_t and its PSRAM arrays
+ *   - Add / remove items, endpoints, tracks (with cascade delete), add blocks
+ *   - Track graph index: ID lookups, tracks per connection point and block
  *   - Resolve track segments to pixel coordinates
  *   - Compute layout bounding box for auto-fit
  *   - Turnout-placed queries
@@ -16,6 +17,7 @@
 
 #include "panel_layout.h"
 #include "panel_geometry.h"   /* turnout connection point resolution (uses lv_point_t) */
+#include "psram_array.h"
 #include "esp_log.h"
 #include <string.h>
 
@@ -25,7 +27,7 @@ static const char *TAG = "panel_layout";
 // Singleton
 // ============================================================================
 
-static panel_layout_t s_layout;
+static panel_layout_t s_layout = { .index = { .valid = true } };
 
 panel_layout_t* panel_layout_get(void)
 {
@@ -44,18 +46,172 @@ bool panel_layout_is_empty(const panel_layout_t *layout)
 bool panel_layout_is_turnout_placed(const panel_layout_t *layout,
                                      uint32_t turnout_id)
 {
-    for (size_t i = 0; i < layout->item_count; i++) {
-        if (layout->items[i].turnout_id == turnout_id) return true;
-    }
-    return false;
+    return panel_layout_find_item(layout, turnout_id) >= 0;
 }
 
+static size_t id_hash(uint32_t id)
+{
+    id ^= id >> 16;
+    id *= 0x85ebca6bU;
+    id ^= id >> 13;
+    return (size_t)id;
+}
+
+/*
+ * The ID hashes use linear probing and are kept at most 50% full.  Slot
+ * counts come from psram_array (doubling from a power of two), so masking
+ * works.  On duplicate IDs the lowest index keeps the slot, matching the
+ * first-match result of a linear scan.
+ */
+
 int panel_layout_find_item(const panel_layout_t *layout, uint32_t turnout_id)
 {
-    for (size_t i = 0; i < layout->item_count; i++) {
-        if (layout->items[i].turnout_id == turnout_id) return (int)i;
+    const panel_layout_index_t *ix = &layout->index;
+    if (!ix->valid || !ix->item_slots) {
+        for (size_t i = 0; i < layout->item_count; i++) {
+            if (layout->items[i].turnout_id == turnout_id) return (int)i;
+        }
+        return -1;
+    }
+
+    size_t mask = ix->item_slot_count - 1;
+    for (size_t s = id_hash(turnout_id) & mask;; s = (s + 1) & mask) {
+        uint16_t idx = ix->item_slots[s];
+        if (idx == PANEL_LINK_NONE) return -1;
+        if (layout->items[idx].turnout_id == turnout_id) return (int)idx;
+    }
+}
+
+int panel_layout_find_endpoint(const panel_layout_t *layout, uint32_t id)
+{
+    const panel_layout_index_t *ix = &layout->index;
+    if (!ix->valid || !ix->endpoint_slots) {
+        for (size_t i = 0; i < layout->endpoint_count; i++) {
+            if (layout->endpoints[i].id == id) return (int)i;
+        }
+        return -1;
+    }
+
+    size_t mask = ix->endpoint_slot_count - 1;
+    for (size_t s = id_hash(id) & mask;; s = (s + 1) & mask) {
+        uint16_t idx = ix->endpoint_slots[s];
+        if (idx == PANEL_LINK_NONE) return -1;
+        if (layout->endpoints[idx].id == id) return (int)idx;
+    }
+}
+
+int panel_layout_find_block(const panel_layout_t *layout, uint32_t id)
+{
+    const panel_layout_index_t *ix = &layout->index;
+    if (!ix->valid || !ix->block_slots) {
+        for (size_t i = 0; i < layout->block_count; i++) {
+            if (layout->blocks[i].id == id) return (int)i;
+        }
+        return -1;
+    }
+
+    size_t mask = ix->block_slot_count - 1;
+    for (size_t s = id_hash(id) & mask;; s = (s + 1) & mask) {
+        uint16_t idx = ix->block_slots[s];
+        if (idx == PANEL_LINK_NONE) return -1;
+        if (layout->blocks[idx].id == id) return (int)idx;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Adjacency (track graph)
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Head of the link list for a connection point, or NULL if the
+ *        element is not placed (a dangling track end)
+ */
+static uint16_t *node_head(const panel_layout_t *layout, const panel_ref_t *ref)
+{
+    if (ref->type == PANEL_REF_ENDPOINT) {
+        int idx = panel_layout_find_endpoint(layout, ref->id);
+        return idx < 0 ? NULL : &layout->index.endpoint_heads[idx];
+    }
+    if (ref->type != PANEL_REF_TURNOUT) return NULL;
+    if ((unsigned)ref->point >= PANEL_POINT_COUNT) return NULL;
+    int idx = panel_layout_find_item(layout, ref->id);
+    return idx < 0 ? NULL : &layout->index.item_heads[idx * PANEL_POINT_COUNT + ref->point];
+}
+
+uint16_t panel_layout_first_link(const panel_layout_t *layout, const panel_ref_t *node)
+{
+    if (!layout->index.valid) return PANEL_LINK_NONE;
+    const uint16_t *head = node_head(layout, node);
+    return head ? *head : PANEL_LINK_NONE;
+}
+
+uint16_t panel_layout_next_link(const panel_layout_t *layout, uint16_t link)
+{
+    return layout->index.links[link];
+}
+
+/** @brief Insert @p t into the first @p n entries of @p out, keeping them ascending */
+static void sorted_insert(uint16_t *out, size_t n, size_t t)
+{
+    /* Insertion sort: degrees are small */
+    size_t k = n;
+    while (k > 0 && out[k - 1] > t) {
+        out[k] = out[k - 1];
+        k--;
+    }
+    out[k] = (uint16_t)t;
+}
+
+static bool track_refs(const panel_track_t *t, panel_ref_type_t type, uint32_t id)
+{
+    if (type == PANEL_REF_BLOCK) return t->block_id == id;
+    return (t->from.type == type && t->from.id == id) ||
+           (t->to.type == type && t->to.id == id);
+}
+
+size_t panel_layout_collect_tracks(const panel_layout_t *layout, panel_ref_type_t type,
+                                   uint32_t id, uint16_t *out, size_t max)
+{
+    size_t n = 0;
+
+    if (!layout->index.valid) {
+        for (size_t i = 0; i < layout->track_count; i++) {
+            if (track_refs(&layout->tracks[i], type, id)) {
+                if (n < max) out[n] = (uint16_t)i;
+                n++;
+            }
+        }
+        return n;
+    }
+
+    if (type == PANEL_REF_BLOCK) {
+        int b = panel_layout_find_block(layout, id);
+        if (b < 0 || id == PANEL_BLOCK_NONE) return 0;
+        for (uint16_t t = layout->index.block_heads[b]; t != PANEL_LINK_NONE;
+             t = layout->index.block_links[t]) {
+            if (n < max) sorted_insert(out, n, t);
+            n++;
+        }
+        return n;
     }
-    return -1;
+
+    panel_ref_t node = { .type = type, .id = id, .point = PANEL_POINT_ENTRY };
+    int points = type == PANEL_REF_TURNOUT ? PANEL_POINT_COUNT : 1;
+    for (int p = 0; p < points; p++) {
+        node.point = (panel_point_type_t)p;
+        for (uint16_t l = panel_layout_first_link(layout, &node); l != PANEL_LINK_NONE;
+             l = panel_layout_next_link(layout, l)) {
+            size_t t = PANEL_LINK_TRACK(l);
+            /* A track with both ends on this element is listed once */
+            if (PANEL_LINK_END(l) == 1 && layout->tracks[t].from.type == type &&
+                layout->tracks[t].from.id == id) {
+                continue;
+            }
+            if (n < max) sorted_insert(out, n, t);
+            n++;
+        }
+    }
+    return n;
 }
 
 // ---------------------------------------------------------------------------
@@ -71,32 +227,17 @@ static bool resolve_track_end(const panel_layout_t *layout,
                                int16_t *px, int16_t *py)
 {
     if (ref->type == PANEL_REF_ENDPOINT) {
-        for (size_t j = 0; j < layout->endpoint_count; j++) {
-            if (layout->endpoints[j].id == ref->id) {
-                *px = (int16_t)(layout->endpoints[j].grid_x * PANEL_GRID_SIZE);
-                *py = (int16_t)(layout->endpoints[j].grid_y * PANEL_GRID_SIZE);
-                return true;
-            }
-        }
-        return false;
-    }
-
-    /* Turnout connection point — check last-hit hint first (#6: avoid full scan) */
-    static size_t s_last_hit = 0;
-    if (s_last_hit < layout->item_count &&
-        layout->items[s_last_hit].turnout_id == ref->id) {
-        panel_geometry_get_connection_point(&layout->items[s_last_hit], ref->point, px, py);
+        int j = panel_layout_find_endpoint(layout, ref->id);
+        if (j < 0) return false;
+        *px = (int16_t)(layout->endpoints[j].grid_x * PANEL_GRID_SIZE);
+        *py = (int16_t)(layout->endpoints[j].grid_y * PANEL_GRID_SIZE);
         return true;
     }
 
-    for (size_t j = 0; j < layout->item_count; j++) {
-        if (layout->items[j].turnout_id == ref->id) {
-            s_last_hit = j;
-            panel_geometry_get_connection_point(&layout->items[j], ref->point, px, py);
-            return true;
-        }
-    }
-    return false;
+    int j = panel_layout_find_item(layout, ref->id);
+    if (j < 0) return false;
+    panel_geometry_get_connection_point(&layout->items[j], ref->point, px, py);
+    return true;
 }
 
 bool panel_layout_resolve_track(const panel_layout_t *layout,
@@ -155,16 +296,274 @@ bool panel_layout_get_bounds(const panel_layout_t *layout,
 }
 
 // ============================================================================
-// Mutation Operations
+// Track graph index maintenance
 // ============================================================================
 
-int panel_layout_add_item(panel_layout_t *layout, uint32_t turnout_id,
-                           uint16_t grid_x, uint16_t grid_y)
+static void index_insert_item(panel_layout_t *layout, size_t index)
+{
+    panel_layout_index_t *ix = &layout->index;
+    size_t mask = ix->item_slot_count - 1;
+    uint32_t id = layout->items[index].turnout_id;
+    for (size_t s = id_hash(id) & mask;; s = (s + 1) & mask) {
+        if (ix->item_slots[s] == PANEL_LINK_NONE) {
+            ix->item_slots[s] = (uint16_t)index;
+            return;
+        }
+        if (layout->items[ix->item_slots[s]].turnout_id == id) return;
+    }
+}
+
+static void index_insert_endpoint(panel_layout_t *layout, size_t index)
+{
+    panel_layout_index_t *ix = &layout->index;
+    size_t mask = ix->endpoint_slot_count - 1;
+    uint32_t id = layout->endpoints[index].id;
+    for (size_t s = id_hash(id) & mask;; s = (s + 1) & mask) {
+        if (ix->endpoint_slots[s] == PANEL_LINK_NONE) {
+            ix->endpoint_slots[s] = (uint16_t)index;
+            return;
+        }
+        if (layout->endpoints[ix->endpoint_slots[s]].id == id) return;
+    }
+}
+
+static void index_insert_block(panel_layout_t *layout, size_t index)
+{
+    panel_layout_index_t *ix = &layout->index;
+    size_t mask = ix->block_slot_count - 1;
+    uint32_t id = layout->blocks[index].id;
+    for (size_t s = id_hash(id) & mask;; s = (s + 1) & mask) {
+        if (ix->block_slots[s] == PANEL_LINK_NONE) {
+            ix->block_slots[s] = (uint16_t)index;
+            return;
+        }
+        if (layout->blocks[ix->block_slots[s]].id == id) return;
+    }
+}
+
+/**
+ * @brief Thread both ends of a track into their node lists, and the track
+ *        into its block's list (a missing block is not a dangling end)
+ */
+static void index_link_track(panel_layout_t *layout, size_t track)
+{
+    panel_layout_index_t *ix = &layout->index;
+    uint32_t block_id = layout->tracks[track].block_id;
+    int block = block_id == PANEL_BLOCK_NONE ? -1 : panel_layout_find_block(layout, block_id);
+    if (block < 0) {
+        ix->block_links[track] = PANEL_LINK_NONE;
+    } else {
+        ix->block_links[track] = ix->block_heads[block];
+        ix->block_heads[block] = (uint16_t)track;
+    }
+
+    for (unsigned end = 0; end < 2; end++) {
+        const panel_track_t *t = &layout->tracks[track];
+        uint16_t link = (uint16_t)(track * 2 + end);
+        uint16_t *head = node_head(layout, end ? &t->to : &t->from);
+        if (!head) {
+            ix->links[link] = PANEL_LINK_NONE;
+            ix->dangling++;
+            continue;
+        }
+        ix->links[link] = *head;
+        *head = link;
+    }
+}
+
+/**
+ * @brief Grow the index arrays to the layout array capacities
+ *
+ * Called after every layout array reservation, so an element can only be
+ * added once its index slots exist.  Sets @p rehash when a hash table was
+ * reallocated (its contents are then stale).
+ */
+static bool index_reserve(panel_layout_t *layout, bool *rehash)
+{
+    panel_layout_index_t *ix = &layout->index;
+    size_t item_slots = ix->item_slot_count;
+    size_t endpoint_slots = ix->endpoint_slot_count;
+    size_t block_slots = ix->block_slot_count;
+
+    bool ok = psram_array_reserve((void **)&ix->item_slots, &ix->item_slot_count,
+                                  layout->item_capacity * 2, sizeof(ix->item_slots[0]));
+    ok &= psram_array_reserve((void **)&ix->endpoint_slots, &ix->endpoint_slot_count,
+                              layout->endpoint_capacity * 2, sizeof(ix->endpoint_slots[0]));
+    ok &= psram_array_reserve((void **)&ix->item_heads, &ix->item_head_capacity,
+                              layout->item_capacity * PANEL_POINT_COUNT,
+                              sizeof(ix->item_heads[0]));
+    ok &= psram_array_reserve((void **)&ix->endpoint_heads, &ix->endpoint_head_capacity,
+                              layout->endpoint_capacity, sizeof(ix->endpoint_heads[0]));
+    ok &= psram_array_reserve((void **)&ix->links, &ix->link_capacity,
+                              layout->track_capacity * 2, sizeof(ix->links[0]));
+    ok &= psram_array_reserve((void **)&ix->block_slots, &ix->block_slot_count,
+                              layout->block_capacity * 2, sizeof(ix->block_slots[0]));
+    ok &= psram_array_reserve((void **)&ix->block_heads, &ix->block_head_capacity,
+                              layout->block_capacity, sizeof(ix->block_heads[0]));
+    ok &= psram_array_reserve((void **)&ix->block_links, &ix->block_link_capacity,
+                              layout->track_capacity, sizeof(ix->block_links[0]));
+
+    if (rehash) {
+        *rehash = ix->item_slot_count != item_slots ||
+                  ix->endpoint_slot_count != endpoint_slots ||
+                  ix->block_slot_count != block_slots;
+    }
+    if (!ok) ESP_LOGE(TAG, "Track graph index allocation failed");
+    return ok;
+}
+
+void panel_layout_reindex(panel_layout_t *layout)
+{
+    panel_layout_index_t *ix = &layout->index;
+    layout->revision++;
+
+    /* Loaders reserve before writing, so this only fails if they did not */
+    ix->valid = index_reserve(layout, NULL);
+    if (!ix->valid) {
+        ESP_LOGW(TAG, "Track graph index unavailable — lookups fall back to scans");
+        return;
+    }
+
+    /* Arrays are still NULL until the first element of their kind */
+    if (ix->item_slots) {
+        memset(ix->item_slots, 0xFF, ix->item_slot_count * sizeof(ix->item_slots[0]));
+        memset(ix->item_heads, 0xFF, ix->item_head_capacity * sizeof(ix->item_heads[0]));
+    }
+    if (ix->endpoint_slots) {
+        memset(ix->endpoint_slots, 0xFF,
+               ix->endpoint_slot_count * sizeof(ix->endpoint_slots[0]));
+        memset(ix->endpoint_heads, 0xFF,
+               ix->endpoint_head_capacity * sizeof(ix->endpoint_heads[0]));
+    }
+    if (ix->block_slots) {
+        memset(ix->block_slots, 0xFF, ix->block_slot_count * sizeof(ix->block_slots[0]));
+        memset(ix->block_heads, 0xFF, ix->block_head_capacity * sizeof(ix->block_heads[0]));
+    }
+    for (size_t i = 0; i < layout->item_count; i++) index_insert_item(layout, i);
+    for (size_t i = 0; i < layout->endpoint_count; i++) index_insert_endpoint(layout, i);
+    for (size_t i = 0; i < layout->block_count; i++) index_insert_block(layout, i);
+
+    ix->dangling = 0;
+    for (size_t t = layout->track_count; t-- > 0;) index_link_track(layout, t);
+}
+
+void panel_layout_free(panel_layout_t *layout)
+{
+    panel_layout_index_t *ix = &layout->index;
+    psram_array_free((void **)&ix->item_slots, &ix->item_slot_count);
+    psram_array_free((void **)&ix->endpoint_slots, &ix->endpoint_slot_count);
+    psram_array_free((void **)&ix->item_heads, &ix->item_head_capacity);
+    psram_array_free((void **)&ix->endpoint_heads, &ix->endpoint_head_capacity);
+    psram_array_free((void **)&ix->links, &ix->link_capacity);
+    psram_array_free((void **)&ix->block_slots, &ix->block_slot_count);
+    psram_array_free((void **)&ix->block_heads, &ix->block_head_capacity);
+    psram_array_free((void **)&ix->block_links, &ix->block_link_capacity);
+    psram_array_free((void **)&layout->items, &layout->item_capacity);
+    psram_array_free((void **)&layout->endpoints, &layout->endpoint_capacity);
+    psram_array_free((void **)&layout->tracks, &layout->track_capacity);
+    psram_array_free((void **)&layout->blocks, &layout->block_capacity);
+    layout->item_count = 0;
+    layout->endpoint_count = 0;
+    layout->track_count = 0;
+    layout->block_count = 0;
+    ix->dangling = 0;
+    layout->revision++;
+}
+
+// ============================================================================
+// Capacity
+// ============================================================================
+
+/*
+ * Each helper makes room for one more element, growing the array and the
+ * track graph index if needed.  Failure (limit reached or out of memory) is
+ * logged here so callers only have to bail out.
+ */
+
+static bool reserve_item(panel_layout_t *layout, bool *rehash)
 {
     if (layout->item_count >= PANEL_MAX_ITEMS) {
         ESP_LOGW(TAG, "Layout full — cannot add more items (max %d)", PANEL_MAX_ITEMS);
-        return -1;
+        return false;
     }
+    return psram_array_reserve((void **)&layout->items, &layout->item_capacity,
+                               layout->item_count + 1, sizeof(layout->items[0])) &&
+           index_reserve(layout, rehash);
+}
+
+static bool reserve_endpoint(panel_layout_t *layout, bool *rehash)
+{
+    if (layout->endpoint_count >= PANEL_MAX_ENDPOINTS) {
+        ESP_LOGW(TAG, "Layout full — cannot add more endpoints (max %d)",
+                 PANEL_MAX_ENDPOINTS);
+        return false;
+    }
+    return psram_array_reserve((void **)&layout->endpoints, &layout->endpoint_capacity,
+                               layout->endpoint_count + 1, sizeof(layout->endpoints[0])) &&
+           index_reserve(layout, rehash);
+}
+
+static bool reserve_track(panel_layout_t *layout)
+{
+    if (layout->track_count >= PANEL_MAX_TRACKS) {
+        ESP_LOGW(TAG, "Layout full — cannot add more tracks (max %d)", PANEL_MAX_TRACKS);
+        return false;
+    }
+    return psram_array_reserve((void **)&layout->tracks, &layout->track_capacity,
+                               layout->track_count + 1, sizeof(layout->tracks[0])) &&
+           index_reserve(layout, NULL);
+}
+
+static bool reserve_block(panel_layout_t *layout, bool *rehash)
+{
+    if (layout->block_count >= PANEL_MAX_BLOCKS) {
+        ESP_LOGW(TAG, "Layout full — cannot add more blocks (max %d)", PANEL_MAX_BLOCKS);
+        return false;
+    }
+    return psram_array_reserve((void **)&layout->blocks, &layout->block_capacity,
+                               layout->block_count + 1, sizeof(layout->blocks[0])) &&
+           index_reserve(layout, rehash);
+}
+
+void panel_layout_clear(panel_layout_t *layout)
+{
+    layout->item_count = 0;
+    layout->endpoint_count = 0;
+    layout->track_count = 0;
+    layout->block_count = 0;
+    layout->next_endpoint_id = 0;
+    panel_layout_reindex(layout);
+}
+
+bool panel_layout_reserve(panel_layout_t *layout, size_t items,
+                           size_t endpoints, size_t tracks)
+{
+    if (items > PANEL_MAX_ITEMS) items = PANEL_MAX_ITEMS;
+    if (endpoints > PANEL_MAX_ENDPOINTS) endpoints = PANEL_MAX_ENDPOINTS;
+    if (tracks > PANEL_MAX_TRACKS) tracks = PANEL_MAX_TRACKS;
+
+    bool ok = psram_array_reserve((void **)&layout->items, &layout->item_capacity,
+                                  items, sizeof(layout->items[0]));
+    ok &= psram_array_reserve((void **)&layout->endpoints, &layout->endpoint_capacity,
+                              endpoints, sizeof(layout->endpoints[0]));
+    ok &= psram_array_reserve((void **)&layout->tracks, &layout->track_capacity,
+                              tracks, sizeof(layout->tracks[0]));
+    if (!ok) return false;
+
+    /* Hash tables may have been reallocated empty — refill them */
+    panel_layout_reindex(layout);
+    return layout->index.valid;
+}
+
+// ============================================================================
+// Mutation Operations
+// ============================================================================
+
+int panel_layout_add_item(panel_layout_t *layout, uint32_t turnout_id,
+                           uint16_t grid_x, uint16_t grid_y)
+{
+    bool rehash;
+    if (!reserve_item(layout, &rehash)) return -1;
 
     size_t idx = layout->item_count;
     panel_item_t *pi = &layout->items[idx];
@@ -175,6 +574,16 @@ int panel_layout_add_item(panel_layout_t *layout, uint32_t turnout_id,
     pi->mirrored = false;
     layout->item_count++;
 
+    /* Dangling track ends may name this turnout — relink them */
+    if (rehash || layout->index.dangling > 0 || !layout->index.valid) {
+        panel_layout_reindex(layout);
+    } else {
+        index_insert_item(layout, idx);
+        memset(&layout->index.item_heads[idx * PANEL_POINT_COUNT], 0xFF,
+               PANEL_POINT_COUNT * sizeof(layout->index.item_heads[0]));
+        layout->revision++;
+    }
+
     ESP_LOGI(TAG, "Added item at grid (%d, %d), %d items total",
              grid_x, grid_y, (int)layout->item_count);
     return (int)idx;
@@ -184,11 +593,8 @@ bool panel_layout_add_endpoint(panel_layout_t *layout,
                                 uint16_t grid_x, uint16_t grid_y,
                                 size_t *out_index)
 {
-    if (layout->endpoint_count >= PANEL_MAX_ENDPOINTS) {
-        ESP_LOGW(TAG, "Layout full — cannot add more endpoints (max %d)",
-                 PANEL_MAX_ENDPOINTS);
-        return false;
-    }
+    bool rehash;
+    if (!reserve_endpoint(layout, &rehash)) return false;
 
     size_t idx = layout->endpoint_count;
     panel_endpoint_t *ep = &layout->endpoints[idx];
@@ -197,6 +603,14 @@ bool panel_layout_add_endpoint(panel_layout_t *layout,
     ep->grid_y = grid_y;
     layout->endpoint_count++;
 
+    if (rehash || layout->index.dangling > 0 || !layout->index.valid) {
+        panel_layout_reindex(layout);
+    } else {
+        index_insert_endpoint(layout, idx);
+        layout->index.endpoint_heads[idx] = PANEL_LINK_NONE;
+        layout->revision++;
+    }
+
     if (out_index) *out_index = idx;
 
     ESP_LOGI(TAG, "Added endpoint %u at grid (%d, %d), %d endpoints total",
@@ -206,18 +620,95 @@ bool panel_layout_add_endpoint(panel_layout_t *layout,
 
 bool panel_layout_add_track(panel_layout_t *layout, const panel_track_t *track)
 {
-    if (layout->track_count >= PANEL_MAX_TRACKS) {
-        ESP_LOGW(TAG, "Layout full — cannot add more tracks (max %d)", PANEL_MAX_TRACKS);
-        return false;
-    }
+    if (!reserve_track(layout)) return false;
 
     layout->tracks[layout->track_count] = *track;
     layout->track_count++;
+    if (layout->index.valid) {
+        index_link_track(layout, layout->track_count - 1);
+        layout->revision++;
+    } else {
+        panel_layout_reindex(layout);
+    }
 
     ESP_LOGI(TAG, "Added track segment, %d tracks total", (int)layout->track_count);
     return true;
 }
 
+bool panel_layout_add_block(panel_layout_t *layout, const panel_block_t *block)
+{
+    if (block->id == PANEL_BLOCK_NONE || panel_layout_find_block(layout, block->id) >= 0) {
+        ESP_LOGW(TAG, "Invalid or duplicate block ID %u", (unsigned)block->id);
+        return false;
+    }
+
+    bool rehash;
+    if (!reserve_block(layout, &rehash)) return false;
+
+    size_t idx = layout->block_count;
+    layout->blocks[idx] = *block;
+    layout->block_count++;
+
+    /* Tracks may already name this block — relink them */
+    if (rehash || layout->track_count > 0 || !layout->index.valid) {
+        panel_layout_reindex(layout);
+    } else {
+        index_insert_block(layout, idx);
+        layout->index.block_heads[idx] = PANEL_LINK_NONE;
+    }
+    return true;
+}
+
+bool panel_layout_insert_item(panel_layout_t *layout, size_t index,
+                               const panel_item_t *item)
+{
+    if (index > layout->item_count || !reserve_item(layout, NULL)) {
+        return false;
+    }
+
+    memmove(&layout->items[index + 1], &layout->items[index],
+            (layout->item_count - index) * sizeof(layout->items[0]));
+    layout->items[index] = *item;
+    layout->item_count++;
+    panel_layout_reindex(layout);
+    return true;
+}
+
+bool panel_layout_insert_endpoint(panel_layout_t *layout, size_t index,
+                                   const panel_endpoint_t *endpoint)
+{
+    if (index > layout->endpoint_count || !reserve_endpoint(layout, NULL)) {
+        return false;
+    }
+
+    memmove(&layout->endpoints[index + 1], &layout->endpoints[index],
+            (layout->endpoint_count - index) * sizeof(layout->endpoints[0]));
+    layout->endpoints[index] = *endpoint;
+    layout->endpoint_count++;
+
+    /* Never hand out a restored endpoint's ID again */
+    if (layout->next_endpoint_id <= endpoint->id) {
+        layout->next_endpoint_id = endpoint->id + 1;
+    }
+    panel_layout_reindex(layout);
+    return true;
+}
+
+bool panel_layout_insert_track(panel_layout_t *layout, size_t index,
+                                const panel_track_t *track)
+{
+    if (index > layout->track_count || !reserve_track(layout)) {
+        return false;
+    }
+
+    memmove(&layout->tracks[index + 1], &layout->tracks[index],
+            (layout->track_count - index) * sizeof(layout->tracks[0]));
+    layout->tracks[index] = *track;
+    layout->track_count++;
+    panel_layout_reindex(layout);
+    return true;
+}
+
 void panel_layout_remove_item(panel_layout_t *layout, size_t index)
 {
     if (index >= layout->item_count) return;
@@ -244,6 +735,7 @@ void panel_layout_remove_item(panel_layout_t *layout, size_t index)
     }
     size_t removed_tracks = layout->track_count - write;
     layout->track_count = write;
+    panel_layout_reindex(layout);
 
     ESP_LOGI(TAG, "Removed item, cascade deleted %d tracks, %d items remain",
              (int)removed_tracks, (int)layout->item_count);
@@ -275,6 +767,7 @@ void panel_layout_remove_endpoint(panel_layout_t *layout, size_t index)
     }
     size_t removed_tracks = layout->track_count - write;
     layout->track_count = write;
+    panel_layout_reindex(layout);
 
     ESP_LOGI(TAG, "Removed endpoint %u, cascade deleted %d tracks, %d endpoints remain",
              (unsigned)removed_id, (int)removed_tracks, (int)layout->endpoint_count);
@@ -288,6 +781,7 @@ void panel_layout_remove_track(panel_layout_t *layout, size_t index)
         layout->tracks[i] = layout->tracks[i + 1];
     }
     layout->track_count--;
+    panel_layout_reindex(layout);
 
     ESP_LOGI(TAG, "Removed track segment, %d tracks remain", (int)layout->track_count);
 }
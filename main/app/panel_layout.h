@@ -32,21 +32,35 @@ extern "C" {
 /**
  * @brief Maximum placed turnouts on the panel
  *
- * Keep these limits modest — every extra slot adds to the static BSS in
- * internal SRAM.  On the ESP32-S3 the RGB LCD driver needs DMA-capable
- * internal RAM for bounce buffers; oversized statics starve that allocation.
+ * The layout arrays grow on demand in PSRAM (see panel_layout_reserve()),
+ * so these limits cost no memory up front.  They bound the 16-bit element
+ * indices used by the undo journal and the builder hit index.
  */
-#define PANEL_MAX_ITEMS     50
+#define PANEL_MAX_ITEMS     2000
 
 /** @brief Maximum track endpoints (dead-end terminators) */
-#define PANEL_MAX_ENDPOINTS 20
+#define PANEL_MAX_ENDPOINTS 1000
 
 /** @brief Maximum track segments connecting points */
-#define PANEL_MAX_TRACKS    100
+#define PANEL_MAX_TRACKS    4000
+
+/** @brief Maximum occupancy blocks */
+#define PANEL_MAX_BLOCKS    1000
+
+/** @brief panel_track_t.block_id of a track outside every block */
+#define PANEL_BLOCK_NONE    0
 
 /** @brief Grid cell size in pixels for panel layout positioning */
 #define PANEL_GRID_SIZE     20
 
+/**
+ * @brief Grid cells along each axis of the layout world (positions 0..PANEL_GRID_MAX)
+ *
+ * The builder places and drags within it and sizes its world layers to hold
+ * all of it at its largest zoom, which LVGL's 8191 px coordinates bound.
+ */
+#define PANEL_GRID_MAX      128
+
 // ============================================================================
 // Data Types
 // ============================================================================
@@ -58,6 +72,9 @@ typedef enum {
     PANEL_POINT_REVERSE,        ///< Reverse (thrown/diverging) exit
 } panel_point_type_t;
 
+/** @brief Connection points per turnout */
+#define PANEL_POINT_COUNT   3
+
 /**
  * @brief A turnout placed on the panel layout
  *
@@ -87,6 +104,19 @@ typedef struct {
     uint16_t grid_y;            ///< Y position in grid cells
 } panel_endpoint_t;
 
+/**
+ * @brief An occupancy block (detection section) on the panel layout
+ *
+ * Bound to an LCC event pair reported by the block's detector.  A block has
+ * no position of its own: it covers the tracks whose block_id names it, and
+ * the control panel colours those tracks while the block is occupied.
+ */
+typedef struct {
+    uint32_t id;                ///< Unique block identifier (never PANEL_BLOCK_NONE)
+    uint64_t event_occupied;    ///< Event reported when the block becomes occupied
+    uint64_t event_clear;       ///< Event reported when the block becomes clear
+} panel_block_t;
+
 /**
  * @brief Type of panel element referenced by a track endpoint
  *
@@ -95,6 +125,8 @@ typedef struct {
 typedef enum {
     PANEL_REF_TURNOUT = 0,      ///< References a turnout (by turnout_t.id)
     PANEL_REF_ENDPOINT,         ///< References a panel endpoint (by endpoint.id)
+    PANEL_REF_BLOCK,            ///< References an occupancy block (by block.id);
+                                ///< covers tracks, never a track end
 } panel_ref_type_t;
 
 /**
@@ -118,25 +150,82 @@ typedef struct {
 typedef struct {
     panel_ref_t from;               ///< Source connection
     panel_ref_t to;                 ///< Destination connection
+    uint32_t    block_id;           ///< Occupancy block covering it, or PANEL_BLOCK_NONE
 } panel_track_t;
 
+/**
+ * @brief Track graph index over the layout arrays
+ *
+ * Nodes are connection points (a panel_ref_t: element + point; endpoints
+ * have the single point PANEL_POINT_ENTRY), edges are tracks.  Each track
+ * end is a "link" (track * 2 + end) threaded into its node's list, so the
+ * tracks at a node are found in O(degree).  Tracks in a block are
+ * threaded the same way, one list per block.  ID→index hashes resolve
+ * turnout, endpoint and block IDs in O(1).  Maintained by the mutation operations
+ * below: appends update it in place, operations that shift indices rebuild
+ * it.  Internal to panel_layout.c — use the adjacency queries.
+ */
+typedef struct {
+    uint16_t *item_slots;           ///< turnout_id → item index (open addressing)
+    size_t    item_slot_count;
+    uint16_t *endpoint_slots;       ///< endpoint id → endpoint index
+    size_t    endpoint_slot_count;
+    uint16_t *item_heads;           ///< First link per item point (PANEL_POINT_COUNT per item)
+    size_t    item_head_capacity;
+    uint16_t *endpoint_heads;       ///< First link per endpoint
+    size_t    endpoint_head_capacity;
+    uint16_t *links;                ///< Next link in the same node list, indexed by link
+    size_t    link_capacity;
+    uint16_t *block_slots;          ///< block id → block index
+    size_t    block_slot_count;
+    uint16_t *block_heads;          ///< First track per block
+    size_t    block_head_capacity;
+    uint16_t *block_links;          ///< Next track in the same block, indexed by track
+    size_t    block_link_capacity;
+    size_t    dangling;             ///< Track ends whose element is not placed
+    bool      valid;                ///< false after an allocation failure (lookups scan)
+} panel_layout_index_t;
+
 /**
  * @brief Complete panel layout definition
  *
- * Holds all placed turnouts, endpoints, and track connections for the
- * control panel.  A single instance is owned by panel_layout.c and
+ * Holds all placed turnouts, endpoints, track connections and occupancy
+ * blocks for the control panel.  A single instance is owned by panel_layout.c and
  * accessed via panel_layout_get().
+ *
+ * The arrays are growable PSRAM arenas: only the mutation operations below
+ * (and panel_layout_reserve()) may add elements, and growth can move an
+ * array, so never keep element pointers across a mutation.  Elements are
+ * identified by their stable IDs (turnout_id, endpoint id), which is what
+ * tracks reference — array indices shift on insert/remove.
  */
 typedef struct {
-    panel_item_t     items[PANEL_MAX_ITEMS];            ///< Placed turnout items
-    size_t           item_count;                         ///< Number of placed items
-    panel_endpoint_t endpoints[PANEL_MAX_ENDPOINTS];     ///< Placed endpoints
-    size_t           endpoint_count;                     ///< Number of placed endpoints
-    uint32_t         next_endpoint_id;                   ///< Auto-increment ID for new endpoints
-    panel_track_t    tracks[PANEL_MAX_TRACKS];           ///< Track segments
-    size_t           track_count;                        ///< Number of track segments
+    panel_item_t     *items;                ///< Placed turnout items
+    size_t           item_count;            ///< Number of placed items
+    size_t           item_capacity;         ///< Allocated item slots
+    panel_endpoint_t *endpoints;            ///< Placed endpoints
+    size_t           endpoint_count;        ///< Number of placed endpoints
+    size_t           endpoint_capacity;     ///< Allocated endpoint slots
+    uint32_t         next_endpoint_id;      ///< Auto-increment ID for new endpoints
+    panel_track_t    *tracks;               ///< Track segments
+    size_t           track_count;           ///< Number of track segments
+    size_t           track_capacity;        ///< Allocated track slots
+    panel_block_t    *blocks;               ///< Occupancy blocks
+    size_t           block_count;           ///< Number of blocks
+    size_t           block_capacity;        ///< Allocated block slots
+    panel_layout_index_t index;             ///< Track graph and ID lookups
+    uint32_t         revision;              ///< Bumped on every topology change
 } panel_layout_t;
 
+/** @brief End of a link list */
+#define PANEL_LINK_NONE         0xFFFF
+
+/** @brief Track index of a link */
+#define PANEL_LINK_TRACK(link)  ((size_t)((link) >> 1))
+
+/** @brief Track end of a link: 0 = from, 1 = to */
+#define PANEL_LINK_END(link)    ((unsigned)((link) & 1))
+
 // ============================================================================
 // Singleton Access
 // ============================================================================
@@ -163,6 +252,45 @@ bool panel_layout_is_turnout_placed(const panel_layout_t *layout,
 /** @brief Find a placed item index by turnout ID.  Returns -1 if not found. */
 int panel_layout_find_item(const panel_layout_t *layout, uint32_t turnout_id);
 
+/** @brief Find an endpoint index by endpoint ID.  Returns -1 if not found. */
+int panel_layout_find_endpoint(const panel_layout_t *layout, uint32_t id);
+
+/** @brief Find a block index by block ID.  Returns -1 if not found. */
+int panel_layout_find_block(const panel_layout_t *layout, uint32_t id);
+
+// ---------------------------------------------------------------------------
+// Adjacency (track graph)
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief First link at a node, or PANEL_LINK_NONE
+ *
+ * Iterate the tracks at one connection point with:
+ * @code
+ * for (uint16_t l = panel_layout_first_link(layout, &node); l != PANEL_LINK_NONE;
+ *      l = panel_layout_next_link(layout, l)) { ... PANEL_LINK_TRACK(l) ... }
+ * @endcode
+ * Links are only valid until the next mutation.
+ */
+uint16_t panel_layout_first_link(const panel_layout_t *layout, const panel_ref_t *node);
+
+/** @brief Next link at the same node, or PANEL_LINK_NONE */
+uint16_t panel_layout_next_link(const panel_layout_t *layout, uint16_t link);
+
+/**
+ * @brief Collect the tracks attached to an element at any connection point
+ *
+ * For PANEL_REF_BLOCK, collects the tracks the block covers.
+ *
+ * @param out  Output: ascending, distinct track indices (may be NULL if max is 0)
+ * @param max  Capacity of @p out
+ * @return Number of attached tracks; if greater than @p max, only the
+ *         first @p max met were written (not necessarily the lowest
+ *         indices) and the call should be repeated with a larger buffer
+ */
+size_t panel_layout_collect_tracks(const panel_layout_t *layout, panel_ref_type_t type,
+                                   uint32_t id, uint16_t *out, size_t max);
+
 /**
  * @brief Resolve a track segment to pixel coordinates
  *
@@ -198,9 +326,40 @@ bool panel_layout_get_bounds(const panel_layout_t *layout,
 // Mutation Operations
 // ============================================================================
 
+/**
+ * @brief Remove every element, keeping the allocated arrays for reuse
+ */
+void panel_layout_clear(panel_layout_t *layout);
+
+/**
+ * @brief Grow the arrays to hold at least the given element counts
+ *
+ * Used by bulk loaders to size the arrays once.  Counts above the
+ * PANEL_MAX_* limits are clamped.
+ * @return false if an allocation failed (capacities may be partly grown)
+ */
+bool panel_layout_reserve(panel_layout_t *layout, size_t items,
+                           size_t endpoints, size_t tracks);
+
+/**
+ * @brief Rebuild the track graph index after writing the arrays directly
+ *
+ * Bulk loaders fill the arrays (after panel_layout_reserve()) and call this
+ * once; the mutation operations keep the index current on their own.
+ */
+void panel_layout_reindex(panel_layout_t *layout);
+
+/**
+ * @brief Release a layout's arrays
+ *
+ * For scratch layouts built outside the singleton (e.g. diagnostics); the
+ * singleton keeps its arrays for the life of the app.
+ */
+void panel_layout_free(panel_layout_t *layout);
+
 /**
  * @brief Add a turnout item to the layout
- * @return Index of the new item, or -1 if layout is full
+ * @return Index of the new item, or -1 if the layout is full or out of memory
  */
 int panel_layout_add_item(panel_layout_t *layout, uint32_t turnout_id,
                            uint16_t grid_x, uint16_t grid_y);
@@ -208,7 +367,7 @@ int panel_layout_add_item(panel_layout_t *layout, uint32_t turnout_id,
 /**
  * @brief Add an endpoint to the layout (auto-assigns a unique ID)
  * @param out_index  Output: array index of the new endpoint (may be NULL)
- * @return true on success, false if layout is full
+ * @return true on success, false if the layout is full or out of memory
  */
 bool panel_layout_add_endpoint(panel_layout_t *layout,
                                 uint16_t grid_x, uint16_t grid_y,
@@ -216,10 +375,40 @@ bool panel_layout_add_endpoint(panel_layout_t *layout,
 
 /**
  * @brief Add a track segment to the layout
- * @return true on success, false if layout is full
+ * @return true on success, false if the layout is full or out of memory
  */
 bool panel_layout_add_track(panel_layout_t *layout, const panel_track_t *track);
 
+/**
+ * @brief Add an occupancy block to the layout (keeping its ID)
+ * @return true on success, false if the layout is full, out of memory,
+ *         or the ID is PANEL_BLOCK_NONE or already used
+ */
+bool panel_layout_add_block(panel_layout_t *layout, const panel_block_t *block);
+
+/**
+ * @brief Insert a turnout item at an array index, shifting later items up
+ *
+ * Used to restore a removed item exactly where it was (undo/redo).
+ * @return true on success, false if the layout is full or index is invalid
+ */
+bool panel_layout_insert_item(panel_layout_t *layout, size_t index,
+                               const panel_item_t *item);
+
+/**
+ * @brief Insert an endpoint (keeping its ID) at an array index
+ * @return true on success, false if the layout is full or index is invalid
+ */
+bool panel_layout_insert_endpoint(panel_layout_t *layout, size_t index,
+                                   const panel_endpoint_t *endpoint);
+
+/**
+ * @brief Insert a track segment at an array index
+ * @return true on success, false if the layout is full or index is invalid
+ */
+bool panel_layout_insert_track(panel_layout_t *layout, size_t index,
+                                const panel_track_t *track);
+
 /**
  * @brief Remove a turnout item by index, cascading to connected tracks
  */
@@ -0,0 +1,410 @@
+/**
+ * @file panel_routes.c
+ * @brief Entrance-exit route table over the panel track graph
+ *
+ * The search walks connection points through the layout's adjacency index.
+ * Arriving at a turnout's entry it may leave by either leg; arriving on a
+ * leg it must leave by the entry, and that leg is the setting the route
+ * needs.  The walk is an explicit stack in PSRAM (layouts can chain
+ * thousands of turnouts, too deep for recursion on the LVGL task).
+ *
+ * Per entrance, the shortest candidate for each exit is kept in a scratch
+ * pool; when the entrance is done the winners are appended to the table.
+ * The (from, to) hash is built once all routes are known.
+ */
+
+#include "panel_routes.h"
+#include "psram_array.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "panel_routes";
+
+#define ROUTE_SLOT_EMPTY    0xFFFF
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+/// The route table and the layout revision it was built for
+static struct {
+    const panel_layout_t *layout;
+    uint32_t              revision;
+    panel_route_t        *routes;
+    size_t                route_count;
+    size_t                route_capacity;
+    panel_route_step_t   *steps;
+    size_t                step_count;
+    size_t                step_capacity;
+    uint16_t             *tracks;
+    size_t                track_count;
+    size_t                track_capacity;
+    uint16_t             *slots;        ///< (from, to) → route index, linear probing
+    size_t                slot_count;
+} s_table;
+
+/// One turnout on the search stack
+typedef struct {
+    uint16_t item;              ///< Layout item index
+    uint16_t in_track;          ///< Track the search arrived on
+    uint16_t link;              ///< Next link to try at the current exit
+    uint8_t  arrive;            ///< Connection point the search arrived at
+    uint8_t  exit_pos;          ///< Exit being followed (index into exits)
+    uint8_t  exit_count;
+    uint8_t  exits[2];          ///< Connection points to leave by
+} frame_t;
+
+/// Shortest candidate to one exit, in the scratch pool
+typedef struct {
+    uint32_t first_step;
+    uint32_t first_track;
+    uint16_t step_count;
+    uint16_t track_count;       ///< 0 = no candidate yet
+} candidate_t;
+
+/// Search scratch, kept between builds
+static struct {
+    frame_t            *frames;
+    size_t              frame_capacity;
+    uint8_t            *visited;        ///< Per item: on the current path
+    size_t              visited_capacity;
+    candidate_t        *cands;          ///< Per endpoint index
+    size_t              cand_capacity;
+    uint16_t           *touched;        ///< Endpoint indices with a candidate
+    size_t              touched_capacity;
+    size_t              touched_count;
+    panel_route_step_t *pool_steps;
+    size_t              pool_step_count;
+    size_t              pool_step_capacity;
+    uint16_t           *pool_tracks;
+    size_t              pool_track_count;
+    size_t              pool_track_capacity;
+    size_t              budget;         ///< Turnout entries left for this entrance
+    bool                truncated;      ///< Budget or memory ran out
+} s_search;
+
+// ============================================================================
+// Lookup
+// ============================================================================
+
+static size_t pair_hash(uint32_t from_id, uint32_t to_id)
+{
+    uint64_t key = ((uint64_t)from_id << 32) | to_id;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (size_t)key;
+}
+
+static bool build_slots(void)
+{
+    size_t needed = s_table.route_count * 2;
+    if (!psram_array_reserve((void **)&s_table.slots, &s_table.slot_count,
+                             needed, sizeof(s_table.slots[0]))) {
+        return false;
+    }
+    if (!s_table.slots) return true;
+
+    memset(s_table.slots, 0xFF, s_table.slot_count * sizeof(s_table.slots[0]));
+    size_t mask = s_table.slot_count - 1;
+    for (size_t r = 0; r < s_table.route_count; r++) {
+        const panel_route_t *route = &s_table.routes[r];
+        size_t s = pair_hash(route->from_id, route->to_id) & mask;
+        while (s_table.slots[s] != ROUTE_SLOT_EMPTY) s = (s + 1) & mask;
+        s_table.slots[s] = (uint16_t)r;
+    }
+    return true;
+}
+
+const panel_route_t *panel_routes_find(uint32_t from_id, uint32_t to_id)
+{
+    if (s_table.route_count == 0 || !s_table.slots) return NULL;
+
+    size_t mask = s_table.slot_count - 1;
+    for (size_t s = pair_hash(from_id, to_id) & mask;; s = (s + 1) & mask) {
+        uint16_t r = s_table.slots[s];
+        if (r == ROUTE_SLOT_EMPTY) return NULL;
+        if (s_table.routes[r].from_id == from_id && s_table.routes[r].to_id == to_id) {
+            return &s_table.routes[r];
+        }
+    }
+}
+
+const panel_route_step_t *panel_routes_steps(const panel_route_t *route)
+{
+    return &s_table.steps[route->first_step];
+}
+
+const uint16_t *panel_routes_tracks(const panel_route_t *route)
+{
+    return &s_table.tracks[route->first_track];
+}
+
+size_t panel_routes_count(void)
+{
+    return s_table.route_count;
+}
+
+// ============================================================================
+// Search
+// ============================================================================
+
+static uint8_t frame_leg(const frame_t *f)
+{
+    return f->arrive == PANEL_POINT_ENTRY ? f->exits[f->exit_pos] : f->arrive;
+}
+
+static uint16_t frame_first_link(const panel_layout_t *layout, const frame_t *f)
+{
+    panel_ref_t node = {
+        .type = PANEL_REF_TURNOUT,
+        .id = layout->items[f->item].turnout_id,
+        .point = (panel_point_type_t)f->exits[f->exit_pos],
+    };
+    return panel_layout_first_link(layout, &node);
+}
+
+/**
+ * @brief Keep the path on the stack as the candidate for @p exit if it is
+ *        the shortest so far
+ */
+static void record(size_t exit, size_t depth, uint16_t last_track)
+{
+    candidate_t *c = &s_search.cands[exit];
+    size_t track_count = depth + 1;
+    if (c->track_count && c->track_count <= track_count) return;
+
+    if (!psram_array_reserve((void **)&s_search.pool_steps, &s_search.pool_step_capacity,
+                             s_search.pool_step_count + depth,
+                             sizeof(s_search.pool_steps[0])) ||
+        !psram_array_reserve((void **)&s_search.pool_tracks, &s_search.pool_track_capacity,
+                             s_search.pool_track_count + track_count,
+                             sizeof(s_search.pool_tracks[0]))) {
+        s_search.truncated = true;
+        return;
+    }
+
+    if (!c->track_count) s_search.touched[s_search.touched_count++] = (uint16_t)exit;
+    c->first_step = (uint32_t)s_search.pool_step_count;
+    c->first_track = (uint32_t)s_search.pool_track_count;
+    c->step_count = (uint16_t)depth;
+    c->track_count = (uint16_t)track_count;
+
+    for (size_t k = 0; k < depth; k++) {
+        const frame_t *f = &s_search.frames[k];
+        s_search.pool_steps[s_search.pool_step_count++] =
+            (panel_route_step_t){ .item = f->item, .leg = frame_leg(f) };
+        s_search.pool_tracks[s_search.pool_track_count++] = f->in_track;
+    }
+    s_search.pool_tracks[s_search.pool_track_count++] = last_track;
+}
+
+/**
+ * @brief Follow @p link to the far end of its track: record an exit or
+ *        push the turnout found there
+ */
+static void arrive(const panel_layout_t *layout, size_t entrance, uint16_t link,
+                   size_t *depth)
+{
+    size_t t = PANEL_LINK_TRACK(link);
+    const panel_track_t *track = &layout->tracks[t];
+    const panel_ref_t *far = PANEL_LINK_END(link) ? &track->from : &track->to;
+
+    if (far->type == PANEL_REF_ENDPOINT) {
+        int exit = panel_layout_find_endpoint(layout, far->id);
+        if (exit >= 0 && (size_t)exit != entrance) record((size_t)exit, *depth, (uint16_t)t);
+        return;
+    }
+
+    int item = panel_layout_find_item(layout, far->id);
+    if (item < 0 || s_search.visited[item] || (unsigned)far->point >= PANEL_POINT_COUNT) {
+        return;
+    }
+    if (s_search.budget == 0 ||
+        !psram_array_reserve((void **)&s_search.frames, &s_search.frame_capacity,
+                             *depth + 1, sizeof(s_search.frames[0]))) {
+        s_search.truncated = true;
+        return;
+    }
+    s_search.budget--;
+
+    frame_t *f = &s_search.frames[(*depth)++];
+    f->item = (uint16_t)item;
+    f->in_track = (uint16_t)t;
+    f->arrive = (uint8_t)far->point;
+    f->exit_pos = 0;
+    if (far->point == PANEL_POINT_ENTRY) {
+        f->exits[0] = PANEL_POINT_NORMAL;
+        f->exits[1] = PANEL_POINT_REVERSE;
+        f->exit_count = 2;
+    } else {
+        f->exits[0] = PANEL_POINT_ENTRY;
+        f->exit_count = 1;
+    }
+    f->link = frame_first_link(layout, f);
+    s_search.visited[item] = 1;
+}
+
+/**
+ * @brief Find the shortest simple route from @p entrance to every reachable
+ *        endpoint; candidates are left in the scratch pool
+ */
+static void search_from(const panel_layout_t *layout, size_t entrance)
+{
+    panel_ref_t node = {
+        .type = PANEL_REF_ENDPOINT,
+        .id = layout->endpoints[entrance].id,
+        .point = PANEL_POINT_ENTRY,
+    };
+    s_search.budget = PANEL_ROUTE_SEARCH_BUDGET;
+
+    for (uint16_t first = panel_layout_first_link(layout, &node); first != PANEL_LINK_NONE;
+         first = panel_layout_next_link(layout, first)) {
+        size_t depth = 0;
+        arrive(layout, entrance, first, &depth);
+
+        while (depth > 0) {
+            frame_t *f = &s_search.frames[depth - 1];
+            if (f->link == PANEL_LINK_NONE) {
+                if (++f->exit_pos < f->exit_count) {
+                    f->link = frame_first_link(layout, f);
+                } else {
+                    s_search.visited[f->item] = 0;
+                    depth--;
+                }
+                continue;
+            }
+
+            uint16_t link = f->link;
+            f->link = panel_layout_next_link(layout, link);
+            if (PANEL_LINK_TRACK(link) == f->in_track) continue;
+            arrive(layout, entrance, link, &depth);     // may move s_search.frames
+        }
+    }
+}
+
+/**
+ * @brief Append the entrance's winning candidates to the table and reset
+ *        the scratch pool
+ */
+static bool flush_candidates(const panel_layout_t *layout, size_t entrance)
+{
+    bool ok = true;
+    for (size_t k = 0; k < s_search.touched_count; k++) {
+        size_t exit = s_search.touched[k];
+        candidate_t *c = &s_search.cands[exit];
+
+        if (ok && s_table.route_count >= PANEL_ROUTE_MAX) {
+            ESP_LOGW(TAG, "Route table full (%d routes)", PANEL_ROUTE_MAX);
+            s_search.truncated = true;
+            ok = false;
+        }
+        if (ok) {
+            ok = psram_array_reserve((void **)&s_table.routes, &s_table.route_capacity,
+                                     s_table.route_count + 1, sizeof(s_table.routes[0])) &&
+                 psram_array_reserve((void **)&s_table.steps, &s_table.step_capacity,
+                                     s_table.step_count + c->step_count,
+                                     sizeof(s_table.steps[0])) &&
+                 psram_array_reserve((void **)&s_table.tracks, &s_table.track_capacity,
+                                     s_table.track_count + c->track_count,
+                                     sizeof(s_table.tracks[0]));
+        }
+        if (ok) {
+            s_table.routes[s_table.route_count++] = (panel_route_t){
+                .from_id = layout->endpoints[entrance].id,
+                .to_id = layout->endpoints[exit].id,
+                .first_step = (uint32_t)s_table.step_count,
+                .first_track = (uint32_t)s_table.track_count,
+                .step_count = c->step_count,
+                .track_count = c->track_count,
+            };
+            if (c->step_count) {
+                memcpy(&s_table.steps[s_table.step_count], &s_search.pool_steps[c->first_step],
+                       c->step_count * sizeof(s_table.steps[0]));
+            }
+            memcpy(&s_table.tracks[s_table.track_count], &s_search.pool_tracks[c->first_track],
+                   c->track_count * sizeof(s_table.tracks[0]));
+            s_table.step_count += c->step_count;
+            s_table.track_count += c->track_count;
+        }
+        c->track_count = 0;
+    }
+    s_search.touched_count = 0;
+    s_search.pool_step_count = 0;
+    s_search.pool_track_count = 0;
+    return ok;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t panel_routes_build(const panel_layout_t *layout)
+{
+    if (s_table.layout == layout && s_table.revision == layout->revision) return ESP_OK;
+
+    int64_t t0 = esp_timer_get_time();
+    s_table.layout = NULL;
+    s_table.route_count = 0;
+    s_table.step_count = 0;
+    s_table.track_count = 0;
+
+    size_t items = layout->item_count;
+    size_t endpoints = layout->endpoint_count;
+    if (!psram_array_reserve((void **)&s_search.visited, &s_search.visited_capacity,
+                             items, sizeof(s_search.visited[0])) ||
+        !psram_array_reserve((void **)&s_search.cands, &s_search.cand_capacity,
+                             endpoints, sizeof(s_search.cands[0])) ||
+        !psram_array_reserve((void **)&s_search.touched, &s_search.touched_capacity,
+                             endpoints, sizeof(s_search.touched[0]))) {
+        ESP_LOGE(TAG, "Out of memory for the route search");
+        return ESP_ERR_NO_MEM;
+    }
+    if (items) memset(s_search.visited, 0, items * sizeof(s_search.visited[0]));
+    if (endpoints) memset(s_search.cands, 0, endpoints * sizeof(s_search.cands[0]));
+    s_search.touched_count = 0;
+    s_search.pool_step_count = 0;
+    s_search.pool_track_count = 0;
+    s_search.truncated = false;
+
+    bool ok = true;
+    for (size_t e = 0; e < endpoints && ok; e++) {
+        search_from(layout, e);
+        ok = flush_candidates(layout, e);
+    }
+    if (!build_slots()) {
+        ESP_LOGE(TAG, "Out of memory for the route index");
+        s_table.route_count = 0;
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_table.layout = layout;
+    s_table.revision = layout->revision;
+    ESP_LOGI(TAG, "Route table: %d routes between %d endpoints (%d turnout settings) in %d ms",
+             (int)s_table.route_count, (int)endpoints, (int)s_table.step_count,
+             (int)((esp_timer_get_time() - t0) / 1000));
+    if (s_search.truncated) {
+        ESP_LOGW(TAG, "Route search was cut short — some longer routes are missing");
+    }
+    return ESP_OK;
+}
+
+void panel_routes_clear(void)
+{
+    psram_array_free((void **)&s_table.routes, &s_table.route_capacity);
+    psram_array_free((void **)&s_table.steps, &s_table.step_capacity);
+    psram_array_free((void **)&s_table.tracks, &s_table.track_capacity);
+    psram_array_free((void **)&s_table.slots, &s_table.slot_count);
+    s_table.layout = NULL;
+    s_table.route_count = 0;
+    s_table.step_count = 0;
+    s_table.track_count = 0;
+
+    psram_array_free((void **)&s_search.frames, &s_search.frame_capacity);
+    psram_array_free((void **)&s_search.visited, &s_search.visited_capacity);
+    psram_array_free((void **)&s_search.cands, &s_search.cand_capacity);
+    psram_array_free((void **)&s_search.touched, &s_search.touched_capacity);
+    psram_array_free((void **)&s_search.pool_steps, &s_search.pool_step_capacity);
+    psram_array_free((void **)&s_search.pool_tracks, &s_search.pool_track_capacity);
+}
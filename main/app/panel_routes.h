@@ -0,0 +1,87 @@
+/**
+ * @file panel_routes.h
+ * @brief Entrance-exit route table over the panel track graph
+ *
+ * A route joins two endpoints through a chain of turnouts.  The table is
+ * precomputed from the layout's track graph whenever its topology changes:
+ * every simple route (no turnout passed twice) is searched from each
+ * endpoint, and the one with the fewest track segments is kept for each
+ * ordered (entrance, exit) pair.  Lookups by endpoint ID are O(1).
+ *
+ * Each route stores the turnout legs that line it and the track segments it
+ * covers.  No LVGL dependency — the control panel screen drives selection,
+ * highlighting and the paced command batch.
+ */
+
+#ifndef PANEL_ROUTES_H_
+#define PANEL_ROUTES_H_
+
+#include "panel_layout.h"
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Maximum routes in the table (bounds the 16-bit lookup slots) */
+#define PANEL_ROUTE_MAX             16384
+
+/**
+ * @brief Turnouts the search may enter per entrance
+ *
+ * Simple routes can grow exponentially with crossovers; past this budget
+ * the search stops and longer alternatives from that entrance are omitted.
+ */
+#define PANEL_ROUTE_SEARCH_BUDGET   50000
+
+/** @brief One turnout setting along a route */
+typedef struct {
+    uint16_t item;              ///< Layout item index
+    uint8_t  leg;               ///< PANEL_POINT_NORMAL or PANEL_POINT_REVERSE
+} panel_route_step_t;
+
+/** @brief A route between two endpoints */
+typedef struct {
+    uint32_t from_id;           ///< Entrance endpoint ID
+    uint32_t to_id;             ///< Exit endpoint ID
+    uint32_t first_step;        ///< Offset of the first step (panel_routes_steps())
+    uint32_t first_track;       ///< Offset of the first track (panel_routes_tracks())
+    uint16_t step_count;        ///< Turnouts to set, entrance to exit
+    uint16_t track_count;       ///< Track segments covered, entrance to exit
+} panel_route_t;
+
+/**
+ * @brief Rebuild the route table if the layout's topology changed
+ *
+ * Cheap when nothing changed (compares the layout revision).  Routes and
+ * the pointers returned below stay valid until the next rebuild.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM (the table is then empty)
+ */
+esp_err_t panel_routes_build(const panel_layout_t *layout);
+
+/** @brief Release the table (the next build starts from scratch) */
+void panel_routes_clear(void);
+
+/** @brief Number of routes in the table */
+size_t panel_routes_count(void);
+
+/**
+ * @brief Find the route from one endpoint to another
+ * @return Route, or NULL if the endpoints are not connected
+ */
+const panel_route_t *panel_routes_find(uint32_t from_id, uint32_t to_id);
+
+/** @brief Turnout settings of a route (route->step_count entries) */
+const panel_route_step_t *panel_routes_steps(const panel_route_t *route);
+
+/** @brief Track segment indices of a route (route->track_count entries) */
+const uint16_t *panel_routes_tracks(const panel_route_t *route);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PANEL_ROUTES_H_
@@ -4,7 +4,9 @@
  *
  * Stores the control panel layout as JSON on SD card. Turnout items are
  * referenced by their stable turnout_id (integer). Track endpoints use
- * "turnout:N" or "endpoint:N" string format.
+ * "turnout:N" or "endpoint:N" string format.  Occupancy blocks carry their
+ * event pair as dotted hex (as in turnouts.json); a track in a block names
+ * it by "block" ID.  Both are optional, so older files load unchanged.
  *
  * JSON format:
  * {
@@ -26,30 +28,32 @@
  *     }
  *   ],
  *   "next_endpoint_id": 2,
+ *   "blocks": [
+ *     {
+ *       "id": 1,
+ *       "event_occupied": "05.01.01.01.22.70.00.00",
+ *       "event_clear": "05.01.01.01.22.70.00.01"
+ *     }
+ *   ],
  *   "tracks": [
  *     {
  *       "from": "turnout:1",
  *       "from_point": "entry",
  *       "to": "endpoint:1",
- *       "to_point": "entry"
+ *       "to_point": "entry",
+ *       "block": 1
  *     }
  *   ]
  * }
  */
 
 #include "panel_storage.h"
+#include "lcc_id.h"
 #include "cJSON.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
-
-/** @brief Max attempts for SD card file open (card may need wake-up) */
-#define SD_OPEN_MAX_RETRIES  3
-#define SD_OPEN_RETRY_MS     100
 
 static const char *TAG = "panel_storage";
 
@@ -75,7 +79,28 @@ static panel_point_type_t str_to_point_type(const char *str)
     return PANEL_POINT_ENTRY;
 }
 
+// ============================================================================
+// Event ID string conversion (same format as turnouts.json)
+// ============================================================================
 
+static void format_event_id(uint64_t event_id, char *buf, size_t len)
+{
+    snprintf(buf, len, "%02X.%02X.%02X.%02X.%02X.%02X.%02X.%02X",
+             (unsigned)((event_id >> 56) & 0xFF), (unsigned)((event_id >> 48) & 0xFF),
+             (unsigned)((event_id >> 40) & 0xFF), (unsigned)((event_id >> 32) & 0xFF),
+             (unsigned)((event_id >> 24) & 0xFF), (unsigned)((event_id >> 16) & 0xFF),
+             (unsigned)((event_id >> 8) & 0xFF),  (unsigned)(event_id & 0xFF));
+}
+
+/** @brief Completion of a save queued without a callback (SD task) */
+static void save_done_cb(esp_err_t result, char *data, size_t len, void *ctx)
+{
+    if (result == ESP_OK) {
+        ESP_LOGI(TAG, "Panel layout saved successfully");
+    } else {
+        ESP_LOGE(TAG, "Failed to write panel JSON: %s", esp_err_to_name(result));
+    }
+}
 
 // ============================================================================
 // Public API
@@ -85,40 +110,34 @@ esp_err_t panel_storage_load(panel_layout_t *layout)
 {
     if (!layout) return ESP_ERR_INVALID_ARG;
 
-    // Initialize to empty
-    memset(layout, 0, sizeof(panel_layout_t));
+    // Initialize to empty (the layout keeps its arrays for reuse)
+    panel_layout_clear(layout);
 
-    struct stat st;
-    if (stat(PANEL_STORAGE_PATH, &st) != 0) {
+    char *buf = NULL;
+    esp_err_t ret = sd_io_read_sync(PANEL_STORAGE_PATH, &buf, NULL);
+    if (ret == ESP_ERR_NOT_FOUND) {
         ESP_LOGI(TAG, "No panel layout file found at %s - starting empty", PANEL_STORAGE_PATH);
         return ESP_OK;
     }
-
-    FILE *f = fopen(PANEL_STORAGE_PATH, "r");
-    if (!f) {
-        ESP_LOGW(TAG, "Failed to open %s", PANEL_STORAGE_PATH);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to read %s: %s", PANEL_STORAGE_PATH, esp_err_to_name(ret));
         return ESP_OK;  // Not an error — just empty layout
     }
 
-    // Read entire file
-    char *buf = malloc(st.st_size + 1);
-    if (!buf) {
-        fclose(f);
-        ESP_LOGE(TAG, "Failed to allocate %ld bytes for panel file", (long)st.st_size);
-        return ESP_OK;
-    }
-
-    size_t read_len = fread(buf, 1, st.st_size, f);
-    fclose(f);
-    buf[read_len] = '\0';
-
-    // Parse JSON
-    cJSON *root = cJSON_Parse(buf);
+    panel_storage_parse(buf, layout);   // a corrupt file leaves the layout empty
     free(buf);
+    return ESP_OK;
+}
 
+esp_err_t panel_storage_parse(const char *json, panel_layout_t *layout)
+{
+    if (!json || !layout) return ESP_ERR_INVALID_ARG;
+    panel_layout_clear(layout);
+
+    cJSON *root = cJSON_Parse(json);
     if (!root) {
         ESP_LOGW(TAG, "Failed to parse panel JSON");
-        return ESP_OK;
+        return ESP_FAIL;
     }
 
     // Check version
@@ -127,7 +146,7 @@ esp_err_t panel_storage_load(panel_layout_t *layout)
     if (ver != 1 && ver != 2) {
         ESP_LOGW(TAG, "Unknown panel version: %d", ver);
         cJSON_Delete(root);
-        return ESP_OK;
+        return ESP_FAIL;
     }
 
     // Parse items
@@ -138,6 +157,10 @@ esp_err_t panel_storage_load(panel_layout_t *layout)
             ESP_LOGW(TAG, "Panel has %d items, truncating to %d", count, PANEL_MAX_ITEMS);
             count = PANEL_MAX_ITEMS;
         }
+        if (!panel_layout_reserve(layout, count, 0, 0)) {
+            ESP_LOGW(TAG, "Out of memory, loading %d of %d items", (int)layout->item_capacity, count);
+            count = (int)layout->item_capacity;
+        }
 
         for (int i = 0; i < count; i++) {
             cJSON *item = cJSON_GetArrayItem(items, i);
@@ -171,6 +194,10 @@ esp_err_t panel_storage_load(panel_layout_t *layout)
             ESP_LOGW(TAG, "Panel has %d endpoints, truncating to %d", count, PANEL_MAX_ENDPOINTS);
             count = PANEL_MAX_ENDPOINTS;
         }
+        if (!panel_layout_reserve(layout, 0, count, 0)) {
+            ESP_LOGW(TAG, "Out of memory, loading %d of %d endpoints", (int)layout->endpoint_capacity, count);
+            count = (int)layout->endpoint_capacity;
+        }
 
         for (int i = 0; i < count; i++) {
             cJSON *ep = cJSON_GetArrayItem(endpoints, i);
@@ -195,6 +222,30 @@ esp_err_t panel_storage_load(panel_layout_t *layout)
     cJSON *next_id = cJSON_GetObjectItem(root, "next_endpoint_id");
     layout->next_endpoint_id = cJSON_IsNumber(next_id) ? (uint32_t)next_id->valueint : 1;
 
+    // Parse blocks (before tracks, which reference them)
+    cJSON *blocks = cJSON_GetObjectItem(root, "blocks");
+    if (cJSON_IsArray(blocks)) {
+        cJSON *blk;
+        cJSON_ArrayForEach(blk, blocks) {
+            cJSON *j_id = cJSON_GetObjectItem(blk, "id");
+            cJSON *ev_occ = cJSON_GetObjectItem(blk, "event_occupied");
+            cJSON *ev_clr = cJSON_GetObjectItem(blk, "event_clear");
+
+            panel_block_t pb = { 0 };
+            if (!cJSON_IsNumber(j_id) || !cJSON_IsString(ev_occ) || !cJSON_IsString(ev_clr) ||
+                !lcc_id_parse_event(ev_occ->valuestring, &pb.event_occupied) ||
+                !lcc_id_parse_event(ev_clr->valuestring, &pb.event_clear)) {
+                ESP_LOGW(TAG, "Skipping block with missing id or invalid events");
+                continue;
+            }
+            pb.id = (uint32_t)j_id->valueint;
+            if (!panel_layout_add_block(layout, &pb) &&
+                layout->block_count >= PANEL_MAX_BLOCKS) {
+                break;
+            }
+        }
+    }
+
     // Parse tracks
     cJSON *tracks = cJSON_GetObjectItem(root, "tracks");
     if (cJSON_IsArray(tracks)) {
@@ -203,6 +254,10 @@ esp_err_t panel_storage_load(panel_layout_t *layout)
             ESP_LOGW(TAG, "Panel has %d tracks, truncating to %d", count, PANEL_MAX_TRACKS);
             count = PANEL_MAX_TRACKS;
         }
+        if (!panel_layout_reserve(layout, 0, 0, count)) {
+            ESP_LOGW(TAG, "Out of memory, loading %d of %d tracks", (int)layout->track_capacity, count);
+            count = (int)layout->track_capacity;
+        }
 
         for (int i = 0; i < count; i++) {
             cJSON *track = cJSON_GetArrayItem(tracks, i);
@@ -212,6 +267,7 @@ esp_err_t panel_storage_load(panel_layout_t *layout)
             cJSON *from_pt = cJSON_GetObjectItem(track, "from_point");
             cJSON *to_ev = cJSON_GetObjectItem(track, "to");
             cJSON *to_pt = cJSON_GetObjectItem(track, "to_point");
+            cJSON *blk = cJSON_GetObjectItem(track, "block");
 
             if (!cJSON_IsString(from_ev) || !cJSON_IsString(to_ev)) continue;
 
@@ -246,20 +302,23 @@ esp_err_t panel_storage_load(panel_layout_t *layout)
 
             pt->from.point = cJSON_IsString(from_pt) ? str_to_point_type(from_pt->valuestring) : PANEL_POINT_ENTRY;
             pt->to.point = cJSON_IsString(to_pt) ? str_to_point_type(to_pt->valuestring) : PANEL_POINT_ENTRY;
+            pt->block_id = cJSON_IsNumber(blk) ? (uint32_t)blk->valueint : PANEL_BLOCK_NONE;
 
             layout->track_count++;
         }
     }
 
     cJSON_Delete(root);
+    panel_layout_reindex(layout);
 
-    ESP_LOGI(TAG, "Panel layout loaded: %d items, %d endpoints, %d tracks",
-             (int)layout->item_count, (int)layout->endpoint_count, (int)layout->track_count);
+    ESP_LOGI(TAG, "Panel layout loaded: %d items, %d endpoints, %d tracks, %d blocks",
+             (int)layout->item_count, (int)layout->endpoint_count, (int)layout->track_count,
+             (int)layout->block_count);
 
     return ESP_OK;
 }
 
-esp_err_t panel_storage_save(const panel_layout_t *layout)
+esp_err_t panel_storage_save(const panel_layout_t *layout, sd_io_done_cb_t cb, void *ctx)
 {
     if (!layout) return ESP_ERR_INVALID_ARG;
 
@@ -310,6 +369,23 @@ esp_err_t panel_storage_save(const panel_layout_t *layout)
     }
     cJSON_AddNumberToObject(root, "next_endpoint_id", layout->next_endpoint_id);
 
+    // Serialize blocks (omitted when there are none)
+    if (layout->block_count > 0) {
+        cJSON *blk_array = cJSON_AddArrayToObject(root, "blocks");
+        char ev_buf[24];
+        for (size_t i = 0; blk_array && i < layout->block_count; i++) {
+            const panel_block_t *pb = &layout->blocks[i];
+            cJSON *blk = cJSON_CreateObject();
+            if (!blk) continue;
+            cJSON_AddNumberToObject(blk, "id", pb->id);
+            format_event_id(pb->event_occupied, ev_buf, sizeof(ev_buf));
+            cJSON_AddStringToObject(blk, "event_occupied", ev_buf);
+            format_event_id(pb->event_clear, ev_buf, sizeof(ev_buf));
+            cJSON_AddStringToObject(blk, "event_clear", ev_buf);
+            cJSON_AddItemToArray(blk_array, blk);
+        }
+    }
+
     // Serialize tracks
     cJSON *tracks = cJSON_AddArrayToObject(root, "tracks");
     if (!tracks) {
@@ -338,11 +414,13 @@ esp_err_t panel_storage_save(const panel_layout_t *layout)
         }
         cJSON_AddStringToObject(track, "to", ref_buf);
         cJSON_AddStringToObject(track, "to_point", point_type_to_str(pt->to.point));
+        if (pt->block_id != PANEL_BLOCK_NONE) {
+            cJSON_AddNumberToObject(track, "block", pt->block_id);
+        }
 
         cJSON_AddItemToArray(tracks, track);
     }
 
-    // Write to file atomically (write to .tmp, then rename)
     char *json_str = cJSON_Print(root);
     cJSON_Delete(root);
 
@@ -351,40 +429,11 @@ esp_err_t panel_storage_save(const panel_layout_t *layout)
         return ESP_ERR_NO_MEM;
     }
 
-    const char *tmp_path = PANEL_STORAGE_PATH ".tmp";
-    FILE *f = NULL;
-    for (int attempt = 0; attempt < SD_OPEN_MAX_RETRIES; attempt++) {
-        f = fopen(tmp_path, "w");
-        if (f) break;
-        ESP_LOGW(TAG, "SD card open failed (attempt %d/%d), retrying...",
-                 attempt + 1, SD_OPEN_MAX_RETRIES);
-        vTaskDelay(pdMS_TO_TICKS(SD_OPEN_RETRY_MS));
-    }
-    if (!f) {
-        ESP_LOGE(TAG, "Failed to open %s for writing after %d attempts",
-                 tmp_path, SD_OPEN_MAX_RETRIES);
-        cJSON_free(json_str);
-        return ESP_FAIL;
-    }
-
-    size_t len = strlen(json_str);
-    size_t written = fwrite(json_str, 1, len, f);
-    fclose(f);
-    cJSON_free(json_str);
-
-    if (written != len) {
-        ESP_LOGE(TAG, "Failed to write panel JSON (wrote %d of %d)", (int)written, (int)len);
-        remove(tmp_path);
-        return ESP_FAIL;
-    }
-
-    // Atomic rename
-    remove(PANEL_STORAGE_PATH);
-    if (rename(tmp_path, PANEL_STORAGE_PATH) != 0) {
-        ESP_LOGE(TAG, "Failed to rename temp file to %s", PANEL_STORAGE_PATH);
-        return ESP_FAIL;
+    // The SD task writes it atomically (.tmp, then rename) and frees json_str
+    esp_err_t ret = sd_io_write(PANEL_STORAGE_PATH, json_str, strlen(json_str),
+                                SD_IO_PRIO_HIGH, cb ? cb : save_done_cb, ctx);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to queue panel JSON: %s", esp_err_to_name(ret));
     }
-
-    ESP_LOGI(TAG, "Panel layout saved successfully");
-    return ESP_OK;
+    return ret;
 }
@@ -11,6 +11,7 @@
 
 #include "esp_err.h"
 #include "panel_layout.h"
+#include "sd_io.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,15 +31,30 @@ extern "C" {
  */
 esp_err_t panel_storage_load(panel_layout_t *layout);
 
+/**
+ * @brief Parse panel.json text (the body of panel_storage_load)
+ *
+ * @param json   NUL-terminated file contents
+ * @param layout Output layout, cleared first
+ * @return ESP_OK, or ESP_FAIL if the text is not a panel layout (the layout
+ *         is left empty)
+ */
+esp_err_t panel_storage_parse(const char *json, panel_layout_t *layout);
+
 /**
  * @brief Save panel layout to SD card
  *
- * Writes the layout to /sdcard/panel.json atomically.
+ * Serializes the layout on the calling task and queues an atomic write of
+ * /sdcard/panel.json with the SD I/O service; the caller does not wait for
+ * the card.  A save queued while an earlier one still waits replaces it.
  *
  * @param layout Layout to save
- * @return ESP_OK on success
+ * @param cb     Completion callback (runs on the SD task), or NULL to log
+ *               the result
+ * @param ctx    Passed to @p cb
+ * @return ESP_OK if queued
  */
-esp_err_t panel_storage_save(const panel_layout_t *layout);
+esp_err_t panel_storage_save(const panel_layout_t *layout, sd_io_done_cb_t cb, void *ctx);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,44 @@
+/**
+ * @file psram_array.c
+ * @brief Growable arrays backed by PSRAM
+ */
+
+#include "psram_array.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "psram_array";
+
+bool psram_array_reserve(void **array, size_t *capacity, size_t needed, size_t elem_size)
+{
+    if (needed <= *capacity) return true;
+
+    size_t cap = *capacity ? *capacity : PSRAM_ARRAY_MIN_CAPACITY;
+    while (cap < needed) cap *= 2;
+
+    void *p = heap_caps_realloc(*array, cap * elem_size, MALLOC_CAP_SPIRAM);
+    if (!p) {
+        ESP_LOGW(TAG, "PSRAM realloc failed, falling back to internal RAM");
+        p = realloc(*array, cap * elem_size);
+    }
+    if (!p) {
+        ESP_LOGE(TAG, "Failed to grow array to %u x %u bytes",
+                 (unsigned)cap, (unsigned)elem_size);
+        return false;
+    }
+
+    memset((uint8_t *)p + *capacity * elem_size, 0, (cap - *capacity) * elem_size);
+    *array = p;
+    *capacity = cap;
+    return true;
+}
+
+void psram_array_free(void **array, size_t *capacity)
+{
+    free(*array);
+    *array = NULL;
+    *capacity = 0;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file psram_array.h
+ * @brief Growable arrays backed by PSRAM
+ *
+ * Backing store for the panel layout model and the UI records that mirror
+ * it.  Capacity doubles on demand, so memory follows the size of the layout
+ * instead of a compile-time worst case held in internal BSS (which the RGB
+ * LCD driver needs for its DMA bounce buffers).
+ *
+ * Growth may move the array.  Indices stay valid; raw pointers into the
+ * array (e.g. LVGL line point arrays) must be re-established after a
+ * reserve that moved it — compare the array pointer before and after.
+ */
+
+#ifndef PSRAM_ARRAY_H_
+#define PSRAM_ARRAY_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief First allocation size in elements */
+#define PSRAM_ARRAY_MIN_CAPACITY    16
+
+/**
+ * @brief Ensure an array can hold at least @p needed elements
+ *
+ * Grows geometrically in PSRAM (internal RAM fallback); new slots are
+ * zeroed.  On failure the array and capacity are left unchanged.
+ *
+ * @param array     In/out: array pointer (NULL for an empty array)
+ * @param capacity  In/out: current capacity in elements
+ * @param needed    Required capacity in elements
+ * @param elem_size Element size in bytes
+ * @return true if the array now holds @p needed elements
+ */
+bool psram_array_reserve(void **array, size_t *capacity, size_t needed, size_t elem_size);
+
+/** @brief Free an array and reset its capacity */
+void psram_array_free(void **array, size_t *capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PSRAM_ARRAY_H_
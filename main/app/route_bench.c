@@ -0,0 +1,121 @@
+/**
+ * @file route_bench.c
+ * @brief Route table benchmark on a synthetic layout
+ *
+ * The layout is built in columns.  Column k has turnout A_k on line A
+ * (entry facing west) and B_k on line B (entry facing east).  Even columns
+ * join the reverse legs as a crossover; odd columns run both reverse legs
+ * to stub sidings.  Both lines end in endpoints at each side.
+ */
+
+#include "route_bench.h"
+#include "panel_layout.h"
+#include "panel_routes.h"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "route_bench";
+
+/// Lookup passes over every endpoint pair, to average out cache effects
+#define BENCH_LOOKUP_PASSES 4
+
+static panel_ref_t turnout_ref(uint32_t id, panel_point_type_t point)
+{
+    return (panel_ref_t){ .type = PANEL_REF_TURNOUT, .id = id, .point = point };
+}
+
+static panel_ref_t endpoint_ref(panel_layout_t *layout, uint16_t grid_x, uint16_t grid_y)
+{
+    panel_endpoint_t *ep = &layout->endpoints[layout->endpoint_count++];
+    ep->id = layout->next_endpoint_id++;
+    ep->grid_x = grid_x;
+    ep->grid_y = grid_y;
+    return (panel_ref_t){ .type = PANEL_REF_ENDPOINT, .id = ep->id, .point = PANEL_POINT_ENTRY };
+}
+
+static void connect(panel_layout_t *layout, panel_ref_t from, panel_ref_t to)
+{
+    layout->tracks[layout->track_count++] = (panel_track_t){ .from = from, .to = to };
+}
+
+bool route_bench_build_layout(panel_layout_t *layout, size_t turnouts, uint32_t id_base)
+{
+    size_t columns = turnouts / 2;
+    if (columns == 0) return false;
+
+    // Bulk-load: A_k = id_base + 2k + 1, B_k = id_base + 2k + 2
+    if (!panel_layout_reserve(layout, columns * 2, columns * 2 + 4, columns * 4 + 2)) {
+        return false;
+    }
+    for (size_t k = 0; k < columns; k++) {
+        uint16_t x = (uint16_t)(4 + k * 4);
+        layout->items[layout->item_count++] = (panel_item_t){ .turnout_id = id_base + 2 * k + 1, .grid_x = x, .grid_y = 4 };
+        layout->items[layout->item_count++] = (panel_item_t){ .turnout_id = id_base + 2 * k + 2, .grid_x = x, .grid_y = 10, .rotation = 4 };
+    }
+
+    connect(layout, endpoint_ref(layout, 0, 4), turnout_ref(id_base + 1, PANEL_POINT_ENTRY));
+    connect(layout, endpoint_ref(layout, 0, 10), turnout_ref(id_base + 2, PANEL_POINT_NORMAL));
+    for (size_t k = 0; k < columns; k++) {
+        uint32_t a = id_base + 2 * k + 1, b = id_base + 2 * k + 2;
+        uint16_t x = (uint16_t)(4 + k * 4);
+        if (k + 1 < columns) {
+            connect(layout, turnout_ref(a, PANEL_POINT_NORMAL), turnout_ref(a + 2, PANEL_POINT_ENTRY));
+            connect(layout, turnout_ref(b, PANEL_POINT_ENTRY), turnout_ref(b + 2, PANEL_POINT_NORMAL));
+        }
+        if (k % 2 == 0) {
+            connect(layout, turnout_ref(a, PANEL_POINT_REVERSE), turnout_ref(b, PANEL_POINT_REVERSE));
+        } else {
+            connect(layout, turnout_ref(a, PANEL_POINT_REVERSE), endpoint_ref(layout, x + 2, 6));
+            connect(layout, turnout_ref(b, PANEL_POINT_REVERSE), endpoint_ref(layout, x - 2, 8));
+        }
+    }
+    uint16_t east = (uint16_t)(4 + columns * 4);
+    connect(layout, turnout_ref(id_base + 2 * columns - 1, PANEL_POINT_NORMAL), endpoint_ref(layout, east, 4));
+    connect(layout, turnout_ref(id_base + 2 * columns, PANEL_POINT_ENTRY), endpoint_ref(layout, east, 10));
+    panel_layout_reindex(layout);
+    return true;
+}
+
+void route_bench_run(void)
+{
+    if (CONFIG_ROUTE_BENCH_TURNOUTS / 2 == 0) return;
+
+    panel_layout_t layout = { .index = { .valid = true } };
+    if (!route_bench_build_layout(&layout, CONFIG_ROUTE_BENCH_TURNOUTS, 0)) {
+        ESP_LOGE(TAG, "Out of memory for a %d-turnout layout", CONFIG_ROUTE_BENCH_TURNOUTS);
+        panel_layout_free(&layout);
+        return;
+    }
+
+    // --- Precompute ---
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = panel_routes_build(&layout);
+    int64_t build_us = esp_timer_get_time() - t0;
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "%d turnouts, %d endpoints, %d tracks: %d routes precomputed in %d us",
+                 (int)layout.item_count, (int)layout.endpoint_count, (int)layout.track_count,
+                 (int)panel_routes_count(), (int)build_us);
+
+        // --- Look up every ordered endpoint pair ---
+        size_t lookups = 0, found = 0;
+        t0 = esp_timer_get_time();
+        for (int pass = 0; pass < BENCH_LOOKUP_PASSES; pass++) {
+            for (size_t i = 0; i < layout.endpoint_count; i++) {
+                for (size_t j = 0; j < layout.endpoint_count; j++) {
+                    if (panel_routes_find(layout.endpoints[i].id, layout.endpoints[j].id)) found++;
+                    lookups++;
+                }
+            }
+        }
+        int64_t find_us = esp_timer_get_time() - t0;
+        if (lookups) {
+            ESP_LOGI(TAG, "Route lookup: %d ns/pair (%d of %d pairs connected)",
+                     (int)(find_us * 1000 / (int64_t)lookups),
+                     (int)(found / BENCH_LOOKUP_PASSES), (int)(lookups / BENCH_LOOKUP_PASSES));
+        }
+    }
+
+    panel_routes_clear();
+    panel_layout_free(&layout);
+}
@@ -0,0 +1,49 @@
+/**
+ * @file route_bench.h
+ * @brief Route table benchmark on a synthetic layout
+ *
+ * Enabled by CONFIG_ROUTE_BENCH_TURNOUTS (menuconfig → Diagnostics).  At
+ * boot a scratch layout of that many turnouts is generated — two parallel
+ * lines joined by crossovers, with stub sidings between them — and route
+ * precomputation and lookup are timed and logged.  The panel's own layout
+ * is not touched.
+ */
+
+#ifndef ROUTE_BENCH_H_
+#define ROUTE_BENCH_H_
+
+#include "panel_layout.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Fill an empty layout with the synthetic two-line layout
+ *
+ * Also used by the render benchmark.  Turnout IDs run from
+ * @p id_base + 1; endpoints are numbered from the layout's next ID.
+ *
+ * @param layout   Empty layout (e.g. `{ .index = { .valid = true } }`)
+ * @param turnouts Turnouts to place (rounded down to even, at least 2)
+ * @param id_base  Offset for the turnout IDs
+ * @return false if out of memory (free the layout anyway) or too small
+ */
+bool route_bench_build_layout(panel_layout_t *layout, size_t turnouts, uint32_t id_base);
+
+/**
+ * @brief Build the synthetic layout, time panel_routes_build() and route
+ *        lookups, then release everything
+ *
+ * Does nothing when the option is 0.
+ */
+void route_bench_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ROUTE_BENCH_H_
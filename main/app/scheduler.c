@@ -0,0 +1,101 @@
+/**
+ * @file scheduler.c
+ * @brief Deadline and event scheduler for the main task
+ *
+ * One esp_timer per job.  The timer callbacks run on the esp_timer task and
+ * only set a notification bit, so a deadline costs the main task one wakeup
+ * and nothing while it is pending.
+ */
+
+#include "scheduler.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "scheduler";
+
+static const char *const s_job_names[SCHEDULER_JOB_COUNT] = {
+    [SCHEDULER_SCREEN]     = "sched_screen",
+    [SCHEDULER_STALE]      = "sched_stale",
+    [SCHEDULER_REFRESH]    = "sched_refresh",
+    [SCHEDULER_SWEEP_DONE] = "sched_sweep",
+    [SCHEDULER_TELEMETRY]  = "sched_status",
+    [SCHEDULER_CONFIG]     = "sched_config",
+};
+
+static TaskHandle_t s_task = NULL;
+static esp_timer_handle_t s_timers[SCHEDULER_JOB_COUNT];
+static uint32_t s_wakeups = 0;
+
+static void timer_cb(void *arg)
+{
+    scheduler_kick((scheduler_job_t)(uintptr_t)arg);
+}
+
+esp_err_t scheduler_init(void)
+{
+    if (s_task) return ESP_OK;
+
+    for (int job = 0; job < SCHEDULER_JOB_COUNT; job++) {
+        const esp_timer_create_args_t args = {
+            .callback = timer_cb,
+            .arg = (void *)(uintptr_t)job,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = s_job_names[job],
+        };
+        esp_err_t ret = esp_timer_create(&args, &s_timers[job]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Timer create failed: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    s_task = xTaskGetCurrentTaskHandle();
+    return ESP_OK;
+}
+
+void scheduler_at(scheduler_job_t job, int64_t deadline_us)
+{
+    if (job >= SCHEDULER_JOB_COUNT || !s_timers[job]) return;
+
+    esp_timer_stop(s_timers[job]);   // ESP_ERR_INVALID_STATE when not armed
+    int64_t delay_us = deadline_us - esp_timer_get_time();
+    if (delay_us <= 0) {
+        scheduler_kick(job);
+        return;
+    }
+    esp_timer_start_once(s_timers[job], (uint64_t)delay_us);
+}
+
+void scheduler_after_ms(scheduler_job_t job, uint32_t delay_ms)
+{
+    scheduler_at(job, esp_timer_get_time() + (int64_t)delay_ms * 1000);
+}
+
+void scheduler_cancel(scheduler_job_t job)
+{
+    if (job >= SCHEDULER_JOB_COUNT || !s_timers[job]) return;
+    esp_timer_stop(s_timers[job]);
+}
+
+void scheduler_kick(scheduler_job_t job)
+{
+    TaskHandle_t task = s_task;
+    if (!task || job >= SCHEDULER_JOB_COUNT) return;
+    xTaskNotify(task, SCHEDULER_BIT(job), eSetBits);
+}
+
+uint32_t scheduler_wait(void)
+{
+    uint32_t bits = 0;
+    while (bits == 0) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+    }
+    s_wakeups++;
+    return bits;
+}
+
+uint32_t scheduler_get_wakeups(void)
+{
+    return s_wakeups;
+}
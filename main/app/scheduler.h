@@ -0,0 +1,85 @@
+/**
+ * @file scheduler.h
+ * @brief Deadline and event scheduler for the main task
+ *
+ * The main task sleeps in scheduler_wait() until a job is due.  Every job
+ * has an esp_timer one-shot deadline; when it expires, or when another task
+ * kicks the job, the job's bit is set in the main task's notification value
+ * and scheduler_wait() returns it.  Running a job is the caller's business,
+ * and so is arming the job's next deadline.
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Main task jobs */
+typedef enum {
+    SCHEDULER_SCREEN = 0,       ///< Screen timeout and wake
+    SCHEDULER_STALE,            ///< Turnout stale expiry
+    SCHEDULER_REFRESH,          ///< Periodic state query sweep
+    SCHEDULER_SWEEP_DONE,       ///< A query sweep finished
+    SCHEDULER_TELEMETRY,        ///< Heartbeat status log
+    SCHEDULER_CONFIG,           ///< Panel configuration changed over LCC
+    SCHEDULER_JOB_COUNT
+} scheduler_job_t;
+
+/** @brief Bit of @p job in the scheduler_wait() result */
+#define SCHEDULER_BIT(job)  (1UL << (job))
+
+/**
+ * @brief Create the job timers and bind the scheduler to the calling task
+ *
+ * Call from the task that will call scheduler_wait().
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t scheduler_init(void);
+
+/**
+ * @brief Arm @p job for an absolute deadline, replacing any earlier one
+ *
+ * @param job         Job to arm
+ * @param deadline_us esp_timer_get_time() time; a deadline already past
+ *                    makes the job due at once
+ */
+void scheduler_at(scheduler_job_t job, int64_t deadline_us);
+
+/**
+ * @brief Arm @p job to be due @p delay_ms from now
+ */
+void scheduler_after_ms(scheduler_job_t job, uint32_t delay_ms);
+
+/**
+ * @brief Disarm @p job's deadline (a kick already delivered still runs)
+ */
+void scheduler_cancel(scheduler_job_t job);
+
+/**
+ * @brief Make @p job due now (any task; ignored before scheduler_init())
+ */
+void scheduler_kick(scheduler_job_t job);
+
+/**
+ * @brief Sleep until at least one job is due
+ *
+ * @return SCHEDULER_BIT() mask of the due jobs
+ */
+uint32_t scheduler_wait(void);
+
+/**
+ * @brief Number of times scheduler_wait() has returned
+ */
+uint32_t scheduler_get_wakeups(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCHEDULER_H_
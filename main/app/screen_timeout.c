@@ -5,6 +5,12 @@
  * Implements automatic screen timeout with touch-to-wake functionality
  * for power saving when the device is idle. Features a smooth 1-second
  * fade-to-black transition before turning off the backlight.
+ *
+ * The main task runs screen_timeout_tick() at the deadline from
+ * screen_timeout_next_deadline_us().  Touch activity only moves that
+ * deadline later, so it is not signalled; changes that need the main task
+ * sooner (a wake, a manual sleep, a new duration, the end of a fade-in)
+ * kick SCHEDULER_SCREEN.
  */
 
 #include "screen_timeout.h"
@@ -14,6 +20,7 @@
 #include "freertos/semphr.h"
 #include "lvgl.h"
 #include "ui/ui_common.h"
+#include "scheduler.h"
 
 static const char *TAG = "screen_timeout";
 
@@ -25,6 +32,9 @@ static const char *TAG = "screen_timeout";
 /// At 60fps, 1000ms = 60 frames. 20 steps = opacity change every 3 frames
 #define FADE_OPACITY_STEPS  20
 
+/// Retry delay when the deadline cannot be read because the state is locked
+#define DEADLINE_RETRY_MS   50
+
 /// Screen state machine
 typedef enum {
     SCREEN_STATE_ACTIVE,        ///< Screen is on and active
@@ -142,6 +152,7 @@ static void fade_in_complete_cb(lv_anim_t *anim)
 {
     ESP_LOGI(TAG, "Fade-in complete");
     s_state.state = SCREEN_STATE_ACTIVE;
+    scheduler_kick(SCHEDULER_SCREEN);   // arm the next timeout
     
     // Hide the fully transparent overlay
     if (s_state.fade_overlay != NULL) {
@@ -296,6 +307,7 @@ void screen_timeout_notify_activity(void)
     
     if (xSemaphoreTake(s_state.mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
         s_state.last_activity_us = esp_timer_get_time();
+        bool was_pending = s_state.pending_wake;
         
         switch (s_state.state) {
             case SCREEN_STATE_OFF:
@@ -316,7 +328,9 @@ void screen_timeout_notify_activity(void)
                 break;
         }
         
+        bool kick = s_state.pending_wake && !was_pending;
         xSemaphoreGive(s_state.mutex);
+        if (kick) scheduler_kick(SCHEDULER_SCREEN);
     }
 }
 
@@ -345,6 +359,7 @@ void screen_timeout_set_duration(uint16_t timeout_sec)
         s_state.last_activity_us = esp_timer_get_time();
         
         xSemaphoreGive(s_state.mutex);
+        scheduler_kick(SCHEDULER_SCREEN);
     }
 }
 
@@ -405,6 +420,7 @@ void screen_timeout_wake(void)
         }
         
         xSemaphoreGive(s_state.mutex);
+        scheduler_kick(SCHEDULER_SCREEN);
     }
 }
 
@@ -422,6 +438,7 @@ void screen_timeout_sleep(void)
         }
         
         xSemaphoreGive(s_state.mutex);
+        scheduler_kick(SCHEDULER_SCREEN);
     }
 }
 
@@ -478,3 +495,24 @@ void screen_timeout_tick(void)
         xSemaphoreGive(s_state.mutex);
     }
 }
+
+int64_t screen_timeout_next_deadline_us(void)
+{
+    int64_t deadline = -1;
+
+    if (!s_state.initialized) return deadline;
+
+    // Not knowing is not "nothing pending": -1 would cancel the timer and
+    // the timeout would never fire, so ask to be called again shortly
+    if (xSemaphoreTake(s_state.mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return esp_timer_get_time() + DEADLINE_RETRY_MS * 1000LL;
+    }
+    if (s_state.pending_wake && s_state.state == SCREEN_STATE_OFF) {
+        deadline = 0;   // due now
+    } else if (s_state.timeout_sec != 0 && s_state.state == SCREEN_STATE_ACTIVE) {
+        deadline = s_state.last_activity_us + (int64_t)s_state.timeout_sec * 1000000LL;
+    }
+    xSemaphoreGive(s_state.mutex);
+
+    return deadline;
+}
@@ -118,13 +118,23 @@ void screen_timeout_wake(void);
 void screen_timeout_sleep(void);
 
 /**
- * @brief Process timeout (called periodically from main loop or timer)
+ * @brief Process timeout and pending wake
  * 
- * Call this function periodically (every 100-1000ms) to check for timeout.
- * Alternatively, the module can create its own timer task.
+ * Called by the main task at screen_timeout_next_deadline_us() and
+ * whenever SCHEDULER_SCREEN is kicked.
  */
 void screen_timeout_tick(void);
 
+/**
+ * @brief When screen_timeout_tick() next has work to do
+ *
+ * @return esp_timer_get_time() deadline (0 = now), or -1 while nothing is
+ *         pending (timeout disabled, screen off, or a fade in progress).
+ *         If the state stays locked for 10 ms, a deadline 50 ms from now,
+ *         so the caller asks again instead of dropping the timeout.
+ */
+int64_t screen_timeout_next_deadline_us(void);
+
 #ifdef __cplusplus
 }
 #endif
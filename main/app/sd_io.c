@@ -0,0 +1,497 @@
+/**
+ * @file sd_io.c
+ * @brief SD card I/O service
+ *
+ * Requests live in a small fixed pool.  The task takes the oldest waiting
+ * request of the highest priority, so a scan of SD_IO_SLOTS entries replaces
+ * a queue per priority and makes merging a lookup in the same pool.  A slot
+ * whose request was merged stays allocated, pointing at the survivor, until
+ * the survivor completes and its callback has been run.
+ *
+ * Whole files are read unbuffered in SD_IO_CHUNK pieces straight into one
+ * PSRAM buffer sized from stat(), so FATFS transfers whole runs of sectors
+ * instead of going through the 128-byte stdio buffer.  Opening a file is
+ * retried a few times, since the card may need waking after idle.
+ */
+
+#include "sd_io.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char *TAG = "sd_io";
+
+#define SD_IO_SLOTS          16
+#define SD_IO_PATH_MAX       64
+#define SD_IO_CHUNK          (16 * 1024)
+#define SD_IO_TASK_STACK     4096
+#define SD_IO_TASK_PRIORITY  2          ///< Below the LCC executor; transfers wait on SPI DMA
+
+/** @brief Max attempts for SD card file open (card may need wake-up) */
+#define SD_OPEN_MAX_RETRIES  3
+#define SD_OPEN_RETRY_MS     100
+
+typedef enum {
+    SLOT_FREE = 0,
+    SLOT_QUEUED,
+    SLOT_ACTIVE,
+    SLOT_MERGED,                ///< Completes with the slot in merged_into
+} slot_state_t;
+
+typedef enum {
+    REQ_READ,
+    REQ_WRITE,
+    REQ_FSYNC,
+} req_type_t;
+
+typedef struct {
+    slot_state_t state;
+    req_type_t type;
+    sd_io_prio_t prio;
+    int merged_into;
+    int fd;
+    uint32_t seq;
+    char path[SD_IO_PATH_MAX];
+    char *data;
+    size_t len;
+    sd_io_done_cb_t cb;
+    void *ctx;
+    int64_t queued_us;
+} request_t;
+
+static request_t s_slots[SD_IO_SLOTS];
+static SemaphoreHandle_t s_lock = NULL;     ///< Guards s_slots and s_stats
+static TaskHandle_t s_task = NULL;
+static uint32_t s_seq = 0;
+static sd_io_stats_t s_stats;
+
+// ============================================================================
+// File operations (SD task)
+// ============================================================================
+
+static FILE *open_retry(const char *path, const char *mode)
+{
+    for (int attempt = 0; attempt < SD_OPEN_MAX_RETRIES; attempt++) {
+        FILE *f = fopen(path, mode);
+        if (f) return f;
+        ESP_LOGW(TAG, "SD card open of %s failed (attempt %d/%d), retrying...",
+                 path, attempt + 1, SD_OPEN_MAX_RETRIES);
+        vTaskDelay(pdMS_TO_TICKS(SD_OPEN_RETRY_MS));
+    }
+    ESP_LOGE(TAG, "Failed to open %s after %d attempts", path, SD_OPEN_MAX_RETRIES);
+    return NULL;
+}
+
+static esp_err_t do_read(const char *path, char **out, size_t *out_len)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return ESP_ERR_NOT_FOUND;
+
+    FILE *f = open_retry(path, "rb");
+    if (!f) return ESP_FAIL;
+    setvbuf(f, NULL, _IONBF, 0);
+
+    size_t size = (size_t)st.st_size;
+    char *buf = heap_caps_malloc(size + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) buf = malloc(size + 1);
+    if (!buf) {
+        fclose(f);
+        ESP_LOGE(TAG, "No memory for %s (%d bytes)", path, (int)size);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t n = 0;
+    while (n < size) {
+        size_t chunk = size - n < SD_IO_CHUNK ? size - n : SD_IO_CHUNK;
+        size_t got = fread(buf + n, 1, chunk, f);
+        if (got == 0) break;
+        n += got;
+    }
+    fclose(f);
+    buf[n] = '\0';
+
+    *out = buf;
+    *out_len = n;
+    return ESP_OK;
+}
+
+static esp_err_t do_write(const char *path, const char *data, size_t len)
+{
+    char tmp_path[SD_IO_PATH_MAX + 4];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *f = open_retry(tmp_path, "wb");
+    if (!f) return ESP_FAIL;
+    setvbuf(f, NULL, _IONBF, 0);
+
+    size_t n = 0;
+    while (n < len) {
+        size_t chunk = len - n < SD_IO_CHUNK ? len - n : SD_IO_CHUNK;
+        size_t put = fwrite(data + n, 1, chunk, f);
+        if (put == 0) break;
+        n += put;
+    }
+    if (fclose(f) != 0 || n != len) {
+        ESP_LOGE(TAG, "Failed to write %s (wrote %d of %d)", tmp_path, (int)n, (int)len);
+        remove(tmp_path);
+        return ESP_FAIL;
+    }
+
+    // Atomic replace
+    remove(path);
+    if (rename(tmp_path, path) != 0) {
+        ESP_LOGE(TAG, "Failed to rename %s to %s", tmp_path, path);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Request pool
+// ============================================================================
+
+/** @brief Free slot, or -1 (lock held) */
+static int slot_alloc(void)
+{
+    for (int i = 0; i < SD_IO_SLOTS; i++) {
+        if (s_slots[i].state == SLOT_FREE) return i;
+    }
+    s_stats.rejected++;
+    return -1;
+}
+
+/** @brief Oldest waiting request of the highest priority, or -1 (lock held) */
+static int slot_next(void)
+{
+    int best = -1;
+    for (int i = 0; i < SD_IO_SLOTS; i++) {
+        const request_t *r = &s_slots[i];
+        if (r->state != SLOT_QUEUED) continue;
+        if (best < 0 || r->prio < s_slots[best].prio ||
+            (r->prio == s_slots[best].prio && (int32_t)(r->seq - s_slots[best].seq) < 0)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/** @brief Waiting request that a new one of @p type on @p path / @p fd can merge into */
+static int slot_find_mergeable(req_type_t type, const char *path, int fd)
+{
+    for (int i = 0; i < SD_IO_SLOTS; i++) {
+        const request_t *r = &s_slots[i];
+        if (r->state != SLOT_QUEUED || r->type != type) continue;
+        if (type == REQ_WRITE && strcmp(r->path, path) == 0) return i;
+        if (type == REQ_FSYNC && r->fd == fd) return i;
+    }
+    return -1;
+}
+
+static uint32_t count_pending(void)
+{
+    uint32_t n = 0;
+    for (int i = 0; i < SD_IO_SLOTS; i++) {
+        if (s_slots[i].state == SLOT_QUEUED || s_slots[i].state == SLOT_ACTIVE) n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Queue a request, or merge it into a waiting one of the same target
+ *
+ * On failure the caller still owns @p data.
+ */
+static esp_err_t enqueue(req_type_t type, const char *path, int fd, char *data, size_t len,
+                         sd_io_prio_t prio, sd_io_done_cb_t cb, void *ctx)
+{
+    if (!s_task) return ESP_ERR_INVALID_STATE;
+    if (prio >= SD_IO_PRIO_COUNT) prio = SD_IO_PRIO_LOW;
+    if (path && strlen(path) >= SD_IO_PATH_MAX) return ESP_ERR_INVALID_ARG;
+
+    char *replaced = NULL;
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    int target = type == REQ_READ ? -1 : slot_find_mergeable(type, path, fd);
+    int slot = (target < 0 || cb) ? slot_alloc() : target;
+    if (slot < 0) {
+        ret = ESP_ERR_NO_MEM;
+    } else if (target >= 0) {
+        // Newer data replaces the waiting write; the request keeps its place
+        request_t *t = &s_slots[target];
+        if (type == REQ_WRITE) {
+            replaced = t->data;
+            t->data = data;
+            t->len = len;
+        }
+        if (prio < t->prio) t->prio = prio;
+        s_stats.prio[prio].merged++;
+        if (cb) {
+            request_t *m = &s_slots[slot];
+            memset(m, 0, sizeof(*m));
+            m->state = SLOT_MERGED;
+            m->merged_into = target;
+            m->prio = prio;
+            m->cb = cb;
+            m->ctx = ctx;
+        }
+    } else {
+        request_t *r = &s_slots[slot];
+        memset(r, 0, sizeof(*r));
+        r->state = SLOT_QUEUED;
+        r->type = type;
+        r->prio = prio;
+        r->fd = fd;
+        r->seq = s_seq++;
+        if (path) strlcpy(r->path, path, sizeof(r->path));
+        r->data = data;
+        r->len = len;
+        r->cb = cb;
+        r->ctx = ctx;
+        r->queued_us = esp_timer_get_time();
+    }
+    s_stats.queued = count_pending();
+
+    xSemaphoreGive(s_lock);
+    free(replaced);
+    if (ret == ESP_OK) {
+        xTaskNotifyGive(s_task);
+    } else {
+        ESP_LOGE(TAG, "Request queue full, dropped %s", path ? path : "fsync");
+    }
+    return ret;
+}
+
+// ============================================================================
+// SD task
+// ============================================================================
+
+static void record(request_t *r, esp_err_t result, int64_t started_us, int64_t done_us)
+{
+    sd_io_prio_stats_t *ps = &s_stats.prio[r->prio];
+    uint32_t wait = (uint32_t)(started_us - r->queued_us);
+    uint32_t service = (uint32_t)(done_us - started_us);
+    ps->completed++;
+    if (result != ESP_OK && result != ESP_ERR_NOT_FOUND) ps->failed++;
+    ps->wait_total_us += wait;
+    ps->service_total_us += service;
+    if (wait > ps->wait_max_us) ps->wait_max_us = wait;
+    if (service > ps->service_max_us) ps->service_max_us = service;
+    ps->bytes += r->len;
+}
+
+static void io_task(void *arg)
+{
+    typedef struct {
+        sd_io_done_cb_t cb;
+        void *ctx;
+    } waiter_t;
+    static waiter_t waiters[SD_IO_SLOTS];
+
+    while (1) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        int idx = slot_next();
+        if (idx >= 0) s_slots[idx].state = SLOT_ACTIVE;
+        xSemaphoreGive(s_lock);
+
+        if (idx < 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        // Only this task touches an ACTIVE slot; merging skips it
+        request_t *r = &s_slots[idx];
+        int64_t started_us = esp_timer_get_time();
+        esp_err_t result = ESP_FAIL;
+        char *out = NULL;
+        size_t out_len = 0;
+        switch (r->type) {
+            case REQ_READ:
+                result = do_read(r->path, &out, &out_len);
+                r->len = out_len;
+                break;
+            case REQ_WRITE:
+                result = do_write(r->path, r->data, r->len);
+                free(r->data);
+                r->data = NULL;
+                break;
+            case REQ_FSYNC:
+                result = fsync(r->fd) == 0 ? ESP_OK : ESP_FAIL;
+                break;
+        }
+        int64_t done_us = esp_timer_get_time();
+        ESP_LOGD(TAG, "%s %s: %s, %d bytes, waited %d us, took %d us",
+                 r->type == REQ_READ ? "read" : r->type == REQ_WRITE ? "write" : "fsync",
+                 r->path, esp_err_to_name(result), (int)r->len,
+                 (int)(started_us - r->queued_us), (int)(done_us - started_us));
+
+        // Release the slot and any merged into it, then run the callbacks
+        sd_io_done_cb_t cb = r->cb;
+        void *ctx = r->ctx;
+        int n_waiters = 0;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        record(r, result, started_us, done_us);
+        r->state = SLOT_FREE;
+        for (int i = 0; i < SD_IO_SLOTS; i++) {
+            request_t *m = &s_slots[i];
+            if (m->state != SLOT_MERGED || m->merged_into != idx) continue;
+            waiters[n_waiters].cb = m->cb;
+            waiters[n_waiters].ctx = m->ctx;
+            n_waiters++;
+            m->state = SLOT_FREE;
+        }
+        s_stats.queued = count_pending();
+        xSemaphoreGive(s_lock);
+
+        if (cb) {
+            cb(result, out, out_len, ctx);
+        } else {
+            free(out);
+        }
+        for (int i = 0; i < n_waiters; i++) {
+            waiters[i].cb(result, NULL, 0, waiters[i].ctx);
+        }
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t sd_io_init(void)
+{
+    if (s_task) return ESP_OK;
+
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) return ESP_ERR_NO_MEM;
+
+    if (xTaskCreate(io_task, "sd_io", SD_IO_TASK_STACK, NULL,
+                    SD_IO_TASK_PRIORITY, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create SD task");
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "SD I/O service started (%d request slots)", SD_IO_SLOTS);
+    return ESP_OK;
+}
+
+esp_err_t sd_io_read(const char *path, sd_io_prio_t prio, sd_io_done_cb_t cb, void *ctx)
+{
+    if (!path || !cb) return ESP_ERR_INVALID_ARG;
+    return enqueue(REQ_READ, path, -1, NULL, 0, prio, cb, ctx);
+}
+
+esp_err_t sd_io_write(const char *path, char *data, size_t len, sd_io_prio_t prio,
+                      sd_io_done_cb_t cb, void *ctx)
+{
+    esp_err_t ret = (!path || (!data && len > 0)) ? ESP_ERR_INVALID_ARG
+                  : enqueue(REQ_WRITE, path, -1, data, len, prio, cb, ctx);
+    if (ret != ESP_OK) free(data);
+    return ret;
+}
+
+esp_err_t sd_io_fsync(int fd, sd_io_prio_t prio, sd_io_done_cb_t cb, void *ctx)
+{
+    if (fd < 0) return ESP_ERR_INVALID_ARG;
+    return enqueue(REQ_FSYNC, NULL, fd, NULL, 0, prio, cb, ctx);
+}
+
+/// Completion of a _sync call
+typedef struct {
+    SemaphoreHandle_t done;
+    esp_err_t result;
+    char *data;
+    size_t len;
+} sync_wait_t;
+
+static void sync_done_cb(esp_err_t result, char *data, size_t len, void *ctx)
+{
+    sync_wait_t *w = ctx;
+    w->result = result;
+    w->data = data;
+    w->len = len;
+    xSemaphoreGive(w->done);
+}
+
+esp_err_t sd_io_read_sync(const char *path, char **out, size_t *out_len)
+{
+    if (!path || !out) return ESP_ERR_INVALID_ARG;
+    *out = NULL;
+
+    size_t len = 0;
+    esp_err_t ret;
+    if (!s_task || xTaskGetCurrentTaskHandle() == s_task) {
+        ret = do_read(path, out, &len);     // not started, or a completion callback
+    } else {
+        sync_wait_t w = { .done = xSemaphoreCreateBinary(), .result = ESP_FAIL };
+        if (!w.done) return ESP_ERR_NO_MEM;
+        ret = sd_io_read(path, SD_IO_PRIO_HIGH, sync_done_cb, &w);
+        if (ret == ESP_OK) {
+            xSemaphoreTake(w.done, portMAX_DELAY);
+            ret = w.result;
+            *out = w.data;
+            len = w.len;
+        }
+        vSemaphoreDelete(w.done);
+    }
+    if (out_len) *out_len = len;
+    return ret;
+}
+
+esp_err_t sd_io_write_sync(const char *path, char *data, size_t len)
+{
+    if (!s_task || xTaskGetCurrentTaskHandle() == s_task) {
+        esp_err_t ret = do_write(path, data, len);
+        free(data);
+        return ret;
+    }
+
+    sync_wait_t w = { .done = xSemaphoreCreateBinary(), .result = ESP_FAIL };
+    if (!w.done) {
+        free(data);
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = sd_io_write(path, data, len, SD_IO_PRIO_HIGH, sync_done_cb, &w);
+    if (ret == ESP_OK) {
+        xSemaphoreTake(w.done, portMAX_DELAY);
+        ret = w.result;
+    }
+    vSemaphoreDelete(w.done);
+    return ret;
+}
+
+esp_err_t sd_io_flush(TickType_t timeout)
+{
+    if (!s_task) return ESP_OK;
+
+    TickType_t start = xTaskGetTickCount();
+    while (1) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        uint32_t pending = count_pending();
+        xSemaphoreGive(s_lock);
+        if (pending == 0) return ESP_OK;
+        if (xTaskGetTickCount() - start >= timeout) return ESP_ERR_TIMEOUT;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+void sd_io_get_stats(sd_io_stats_t *out)
+{
+    if (!out) return;
+    if (!s_lock) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,149 @@
+/**
+ * @file sd_io.h
+ * @brief SD card I/O service
+ *
+ * One task owns the card.  Other tasks queue whole-file reads, atomic
+ * whole-file writes and fsyncs, in two priorities, and get the result in a
+ * completion callback that runs on the SD task.  A write to a path that
+ * already has a write waiting replaces that write's data, and an fsync of
+ * a descriptor that already has one waiting is merged into it, so a burst
+ * of saves costs one card write.  The callbacks of merged requests run when
+ * the surviving request completes, with its result.
+ *
+ * The executor and the LVGL task only ever queue.  Boot code that needs the
+ * data before it can continue uses the _sync variants, which queue and wait
+ * (or do the I/O directly before sd_io_init() and inside a callback).
+ */
+
+#ifndef SD_IO_H_
+#define SD_IO_H_
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Request priority; HIGH requests are served first, FIFO within a level */
+typedef enum {
+    SD_IO_PRIO_HIGH = 0,        ///< User-visible loads and saves
+    SD_IO_PRIO_LOW,             ///< Config fsyncs and diagnostics
+    SD_IO_PRIO_COUNT
+} sd_io_prio_t;
+
+/**
+ * @brief Completion callback (runs on the SD task; keep it short)
+ *
+ * @param result ESP_OK, ESP_ERR_NOT_FOUND for a missing file, ESP_ERR_NO_MEM
+ *               or ESP_FAIL
+ * @param data   Reads: NUL-terminated file contents, owned by the callback
+ *               (release with free()); NULL for writes, fsyncs and errors
+ * @param len    Bytes in @p data, not counting the terminator
+ * @param ctx    Caller context
+ */
+typedef void (*sd_io_done_cb_t)(esp_err_t result, char *data, size_t len, void *ctx);
+
+/** @brief Latency of the requests of one priority since boot */
+typedef struct {
+    uint32_t completed;
+    uint32_t merged;            ///< Requests folded into another one
+    uint32_t failed;
+    uint32_t wait_max_us;       ///< Queued → started
+    uint32_t service_max_us;    ///< Started → completed
+    uint64_t wait_total_us;
+    uint64_t service_total_us;
+    uint64_t bytes;
+} sd_io_prio_stats_t;
+
+typedef struct {
+    sd_io_prio_stats_t prio[SD_IO_PRIO_COUNT];
+    uint32_t queued;            ///< Requests waiting now
+    uint32_t rejected;          ///< Queue full
+} sd_io_stats_t;
+
+/**
+ * @brief Start the SD task; call once the card is mounted
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t sd_io_init(void);
+
+/**
+ * @brief Queue a whole-file read
+ *
+ * @param path File path (copied)
+ * @param prio Priority
+ * @param cb   Completion callback (required; receives the data)
+ * @param ctx  Passed to @p cb
+ * @return ESP_OK if queued; ESP_ERR_INVALID_STATE before sd_io_init(),
+ *         ESP_ERR_NO_MEM if the queue is full
+ */
+esp_err_t sd_io_read(const char *path, sd_io_prio_t prio, sd_io_done_cb_t cb, void *ctx);
+
+/**
+ * @brief Queue an atomic whole-file write (written to "<path>.tmp", then renamed)
+ *
+ * @param path File path (copied)
+ * @param data Contents; ownership passes to the service, which releases it
+ *             with free() - also when queueing fails
+ * @param len  Bytes in @p data
+ * @param prio Priority
+ * @param cb   Completion callback, or NULL
+ * @param ctx  Passed to @p cb
+ * @return ESP_OK if queued (or merged into a waiting write of @p path)
+ */
+esp_err_t sd_io_write(const char *path, char *data, size_t len, sd_io_prio_t prio,
+                      sd_io_done_cb_t cb, void *ctx);
+
+/**
+ * @brief Queue an fsync of an open descriptor on the card
+ *
+ * @param fd   Descriptor; must stay open until the callback (if any) runs
+ * @param prio Priority
+ * @param cb   Completion callback, or NULL
+ * @param ctx  Passed to @p cb
+ * @return ESP_OK if queued (or merged into a waiting fsync of @p fd)
+ */
+esp_err_t sd_io_fsync(int fd, sd_io_prio_t prio, sd_io_done_cb_t cb, void *ctx);
+
+/**
+ * @brief Read a whole file and wait for it (boot paths only)
+ *
+ * @param path     File path
+ * @param out      NUL-terminated contents, release with free()
+ * @param out_len  Bytes read, or NULL
+ * @return ESP_OK, ESP_ERR_NOT_FOUND, ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t sd_io_read_sync(const char *path, char **out, size_t *out_len);
+
+/**
+ * @brief Write a whole file atomically and wait for it
+ *
+ * @param path File path
+ * @param data Contents; ownership passes to the service (see sd_io_write())
+ * @param len  Bytes in @p data
+ * @return Result of the write
+ */
+esp_err_t sd_io_write_sync(const char *path, char *data, size_t len);
+
+/**
+ * @brief Wait until every request queued so far has completed
+ *
+ * @param timeout Ticks to wait
+ * @return ESP_OK, or ESP_ERR_TIMEOUT
+ */
+esp_err_t sd_io_flush(TickType_t timeout);
+
+/**
+ * @brief Snapshot the request statistics
+ */
+void sd_io_get_stats(sd_io_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SD_IO_H_
@@ -0,0 +1,119 @@
+/**
+ * @file trace.c
+ * @brief Binary trace ring for the event → UI pipeline
+ *
+ * The head counter runs freely; a record's slot is its claim number masked
+ * by the ring size (rounded down to a power of two).  Writers never wait,
+ * so a record being filled while the ring is dumped may come out torn —
+ * recording is paused for the dump to keep that to the few writers already
+ * inside trace_record().  The dump copies the ring into PSRAM and hands the
+ * copy to the SD task, so the caller never waits for the card.
+ */
+
+#include "trace.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "trace";
+
+#define TRACE_MAGIC         "LCTR"
+#define TRACE_VERSION       1
+#define TRACE_HEADER_SIZE   16
+
+static trace_record_t *s_ring = NULL;
+static uint32_t s_mask = 0;             ///< Ring size - 1
+static uint32_t s_head = 0;             ///< Records ever claimed (atomic)
+static volatile bool s_paused = false;
+
+void trace_init(void)
+{
+#if CONFIG_TRACE_RING_RECORDS > 0
+    if (s_ring) return;
+
+    uint32_t size = 1;
+    while (size * 2 <= CONFIG_TRACE_RING_RECORDS) size *= 2;
+
+    s_ring = heap_caps_calloc(size, sizeof(trace_record_t), MALLOC_CAP_SPIRAM);
+    if (!s_ring) {
+        ESP_LOGW(TAG, "No PSRAM for %d trace records — tracing off", (int)size);
+        return;
+    }
+    s_mask = size - 1;
+    ESP_LOGI(TAG, "Trace ring: %d records (%d KB)",
+             (int)size, (int)(size * sizeof(trace_record_t) / 1024));
+#endif
+}
+
+void trace_record(trace_stage_t stage, trace_kind_t kind, uint16_t index, uint64_t event_id)
+{
+    if (!s_ring || s_paused) return;
+
+    uint32_t n = __atomic_fetch_add(&s_head, 1, __ATOMIC_RELAXED);
+    trace_record_t *r = &s_ring[n & s_mask];
+    r->time_us = (uint32_t)esp_timer_get_time();
+    r->stage = (uint8_t)stage;
+    r->kind = (uint8_t)kind;
+    r->index = index;
+    r->event_id = event_id;
+}
+
+/** @brief Copy header and records [head - count, head) oldest first into @p out */
+static void copy_ring(uint8_t *out, uint32_t head, uint32_t count)
+{
+    uint32_t size = s_mask + 1;
+    uint32_t lost = head - count;
+
+    uint16_t version = TRACE_VERSION, rec_size = sizeof(trace_record_t);
+    memcpy(out, TRACE_MAGIC, 4);
+    memcpy(out + 4, &version, 2);
+    memcpy(out + 6, &rec_size, 2);
+    memcpy(out + 8, &count, 4);
+    memcpy(out + 12, &lost, 4);
+    out += TRACE_HEADER_SIZE;
+
+    // Up to two contiguous runs: to the end of the ring, then from its start
+    uint32_t first = (head - count) & s_mask;
+    uint32_t run = count < size - first ? count : size - first;
+    memcpy(out, &s_ring[first], run * sizeof(trace_record_t));
+    memcpy(out + run * sizeof(trace_record_t), s_ring, (count - run) * sizeof(trace_record_t));
+}
+
+esp_err_t trace_dump(const char *path, size_t *records, sd_io_done_cb_t cb, void *ctx)
+{
+    if (records) *records = 0;
+    if (!s_ring) return ESP_ERR_NOT_SUPPORTED;
+
+    // Sized for a full ring, before pausing, so recording stops only for the copy
+    size_t max_len = TRACE_HEADER_SIZE + (size_t)(s_mask + 1) * sizeof(trace_record_t);
+    uint8_t *buf = heap_caps_malloc(max_len, MALLOC_CAP_SPIRAM);
+    if (!buf) {
+        ESP_LOGE(TAG, "No PSRAM for a %d KB trace copy", (int)(max_len / 1024));
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_paused = true;
+    vTaskDelay(1);      // let writers already past the pause check finish
+
+    uint32_t head = __atomic_load_n(&s_head, __ATOMIC_RELAXED);
+    uint32_t count = head <= s_mask ? head : s_mask + 1;
+    copy_ring(buf, head, count);
+
+    s_paused = false;
+
+    // The SD task writes the copy and frees it
+    size_t len = TRACE_HEADER_SIZE + (size_t)count * sizeof(trace_record_t);
+    esp_err_t ret = sd_io_write(path, (char *)buf, len, SD_IO_PRIO_LOW, cb, ctx);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to queue %s: %s", path, esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "Queued %d records for %s (%d lost to wrap-around)",
+             (int)count, path, (int)(head - count));
+    if (records) *records = count;
+    return ESP_OK;
+}
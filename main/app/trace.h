@@ -0,0 +1,94 @@
+/**
+ * @file trace.h
+ * @brief Binary trace ring for the event → UI pipeline
+ *
+ * Fixed-size records (timestamp, stage, element, event ID) written into a
+ * PSRAM ring by any task without taking a lock: a writer claims a slot with
+ * one atomic increment and fills it in place.  Enabled by
+ * CONFIG_TRACE_RING_RECORDS (menuconfig → Diagnostics); when 0 the TRACE()
+ * macro compiles to nothing.
+ *
+ * The ring is dumped to the SD card on demand (Diagnostics tab) and decoded
+ * on a PC with tools/trace_decode.py, which pairs records by element and
+ * prints per-stage latency percentiles.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "esp_err.h"
+#include "sd_io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Pipeline stage of a record (stable values — the decoder knows them) */
+typedef enum {
+    TRACE_RX = 1,           ///< Event report / producer identified reached the handler
+    TRACE_ROUTE,            ///< Event matched to a turnout or block
+    TRACE_APPLY,            ///< Manager state updated (mutex released)
+    TRACE_UI_SCHED,         ///< Element marked dirty for the UI
+    TRACE_UI_APPLY,         ///< Element redrawn on the LVGL task
+    TRACE_FLUSH_DONE,       ///< UI flush finished (index = elements redrawn)
+    TRACE_TX,               ///< Event produced on the bus
+} trace_stage_t;
+
+/** @brief Kind of element a record's index refers to */
+typedef enum {
+    TRACE_KIND_NONE = 0,
+    TRACE_KIND_TURNOUT,
+    TRACE_KIND_BLOCK,
+} trace_kind_t;
+
+/** @brief One trace record (16 bytes, little-endian in the dump) */
+typedef struct {
+    uint32_t time_us;       ///< Low 32 bits of esp_timer_get_time()
+    uint8_t  stage;         ///< trace_stage_t
+    uint8_t  kind;          ///< trace_kind_t
+    uint16_t index;         ///< Manager index, or a count for TRACE_FLUSH_DONE
+    uint64_t event_id;      ///< LCC event, 0 where the stage has none
+} trace_record_t;
+
+/**
+ * @brief Allocate the ring (call once at boot; no-op when disabled)
+ */
+void trace_init(void);
+
+/**
+ * @brief Append a record.  Safe from any task; never blocks.
+ */
+void trace_record(trace_stage_t stage, trace_kind_t kind, uint16_t index, uint64_t event_id);
+
+/**
+ * @brief Queue the ring, oldest record first, for writing to a file
+ *
+ * Recording pauses while the ring is copied into PSRAM; the SD task then
+ * writes the copy (sd_io_write(), low priority), so the caller does not
+ * wait for the card.  File layout: 16-byte header ("LCTR", u16 version,
+ * u16 record size, u32 record count, u32 records lost to wrap-around)
+ * followed by the records.
+ *
+ * @param path    Destination file (e.g. "/sdcard/trace.bin")
+ * @param records Out (optional): records in the copy
+ * @param cb      Completion callback (runs on the SD task), or NULL
+ * @param ctx     Passed to @p cb
+ * @return ESP_OK if queued, ESP_ERR_NOT_SUPPORTED when tracing is disabled,
+ *         ESP_ERR_NO_MEM, or the sd_io_write() error
+ */
+esp_err_t trace_dump(const char *path, size_t *records, sd_io_done_cb_t cb, void *ctx);
+
+#if CONFIG_TRACE_RING_RECORDS > 0
+#define TRACE(stage, kind, index, event_id) \
+    trace_record((stage), (kind), (uint16_t)(index), (event_id))
+#else
+#define TRACE(stage, kind, index, event_id) do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H_
@@ -7,10 +7,25 @@
  *   - LCC event handler (updates state from network events)
  *   - UI layer (reads state for display, sends commands)
  *   - Persistence layer (load/save to SD)
+ *
+ * The array is a growable PSRAM arena (psram_array).  It only grows inside
+ * the mutex, so the pointer from turnout_manager_get_all() is stable for as
+ * long as the caller holds the lock.  LCC events are routed through an
+ * open-addressing hash of event ID → array index, rebuilt whenever indices
+ * change, so routing cost does not grow with the turnout count.
+ *
+ * Readers that need the whole table (renderers, save, query sweeps) take an
+ * immutable snapshot instead of the mutex.  Every change bumps s_version;
+ * the first acquire after a change copies the table once under the mutex
+ * and publishes the copy, so a burst of state events costs one copy, not
+ * one per event.  A snapshot is freed when its last holder releases it.
  */
 
 #include "turnout_manager.h"
 #include "turnout_storage.h"
+#include "psram_array.h"
+#include "trace.h"
+#include "lock_prof.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "esp_heap_caps.h"
@@ -26,16 +41,221 @@ static const char *TAG = "turnout_mgr";
 // Internal state
 // ============================================================================
 
-static turnout_t *s_turnouts = NULL;    ///< Allocated from PSRAM to save internal SRAM
+static turnout_t *s_turnouts = NULL;    ///< Growable PSRAM array
 static size_t s_count = 0;
+static size_t s_capacity = 0;
 static uint32_t s_next_turnout_id = 1;
 static SemaphoreHandle_t s_mutex = NULL;
+
+/// Mutex take / give, per call site when CONFIG_LOCK_PROFILER is set
+#define MUTEX_TAKE()    LOCK_PROF_TAKE(LOCK_PROF_TURNOUT, s_mutex, portMAX_DELAY)
+#define MUTEX_GIVE()    LOCK_PROF_GIVE(LOCK_PROF_TURNOUT, s_mutex)
 static turnout_state_callback_t s_state_callback = NULL;
 
+/// Upper bounds (ms) of the command latency buckets; the last is open-ended
+static const uint32_t s_latency_bounds_ms[TURNOUT_LATENCY_BUCKETS - 1] = {
+    50, 100, 200, 500, 1000, 2000, 5000
+};
+static uint32_t s_latency_hist[TURNOUT_LATENCY_BUCKETS];
+
+#define EVENT_SLOT_EMPTY    0xFFFF
+
+/// Event ID → turnout index hash (linear probing, kept at most 50% full).
+/// psram_array capacities double from a power of two, so the size is one.
+/// Empty when allocation failed; lookups then scan.
+static uint16_t *s_event_slots = NULL;
+static size_t s_event_slot_count = 0;
+
+/// Table version, bumped under the mutex by every change
+static uint32_t s_version = 0;
+
+/// Latest published snapshot; holds one reference of its own
+static turnout_snapshot_t *s_snapshot = NULL;
+
+/// Guards loading s_snapshot together with taking a reference
+static portMUX_TYPE s_snapshot_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ============================================================================
+// Event index (call with the mutex held)
+// ============================================================================
+
+static size_t event_hash(uint64_t event_id)
+{
+    event_id ^= event_id >> 33;
+    event_id *= 0xff51afd7ed558ccdULL;
+    event_id ^= event_id >> 33;
+    return (size_t)event_id;
+}
+
+static bool turnout_has_event(size_t index, uint64_t event_id)
+{
+    return s_turnouts[index].event_normal == event_id ||
+           s_turnouts[index].event_reverse == event_id;
+}
+
+/**
+ * @brief Add one event of turnout @p index; the first turnout to claim an
+ *        event keeps it, matching the order of a linear scan
+ */
+static void event_index_insert(uint64_t event_id, size_t index)
+{
+    size_t mask = s_event_slot_count - 1;
+    for (size_t s = event_hash(event_id) & mask;; s = (s + 1) & mask) {
+        if (s_event_slots[s] == EVENT_SLOT_EMPTY) {
+            s_event_slots[s] = (uint16_t)index;
+            return;
+        }
+        if (turnout_has_event(s_event_slots[s], event_id)) return;
+    }
+}
+
+static void event_index_rebuild(void)
+{
+    size_t needed = s_count * 4;
+    if (!psram_array_reserve((void **)&s_event_slots, &s_event_slot_count,
+                             needed, sizeof(s_event_slots[0]))) {
+        ESP_LOGW(TAG, "Event index allocation failed — routing by linear scan");
+        psram_array_free((void **)&s_event_slots, &s_event_slot_count);
+        return;
+    }
+    if (!s_event_slots) return;
+
+    memset(s_event_slots, 0xFF, s_event_slot_count * sizeof(s_event_slots[0]));
+    for (size_t i = 0; i < s_count; i++) {
+        event_index_insert(s_turnouts[i].event_normal, i);
+        event_index_insert(s_turnouts[i].event_reverse, i);
+    }
+}
+
+/**
+ * @brief Index of the first turnout using @p event_id, or -1
+ */
+static int event_index_find(uint64_t event_id)
+{
+    if (!s_event_slots) {
+        for (size_t i = 0; i < s_count; i++) {
+            if (turnout_has_event(i, event_id)) return (int)i;
+        }
+        return -1;
+    }
+
+    size_t mask = s_event_slot_count - 1;
+    for (size_t s = event_hash(event_id) & mask;; s = (s + 1) & mask) {
+        uint16_t idx = s_event_slots[s];
+        if (idx == EVENT_SLOT_EMPTY) return -1;
+        if (turnout_has_event(idx, event_id)) return (int)idx;
+    }
+}
+
+// ============================================================================
+// Snapshots
+// ============================================================================
+
+/** @brief Record a change to the table (mutex held) */
+static void table_changed(void)
+{
+    __atomic_add_fetch(&s_version, 1, __ATOMIC_RELEASE);
+}
+
+/** @brief Current snapshot with a reference taken, or NULL */
+static turnout_snapshot_t *snapshot_ref_current(void)
+{
+    portENTER_CRITICAL(&s_snapshot_lock);
+    turnout_snapshot_t *snap = s_snapshot;
+    if (snap) __atomic_add_fetch(&snap->refs, 1, __ATOMIC_RELAXED);
+    portEXIT_CRITICAL(&s_snapshot_lock);
+    return snap;
+}
+
+/** @brief Copy the table and publish it unless the current copy is up to date (mutex held) */
+static void snapshot_publish(void)
+{
+    if (s_snapshot && s_snapshot->version == s_version) return;
+
+    turnout_snapshot_t *snap = heap_caps_malloc(sizeof(*snap) + s_count * sizeof(turnout_t),
+                                                MALLOC_CAP_SPIRAM);
+    if (!snap) {
+        ESP_LOGW(TAG, "No memory for a %d-turnout snapshot", (int)s_count);
+        return;
+    }
+    snap->version = s_version;
+    snap->refs = 1;
+    snap->count = s_count;
+    if (s_count) memcpy(snap->turnouts, s_turnouts, s_count * sizeof(turnout_t));
+
+    portENTER_CRITICAL(&s_snapshot_lock);
+    turnout_snapshot_t *old = s_snapshot;
+    s_snapshot = snap;
+    portEXIT_CRITICAL(&s_snapshot_lock);
+    turnout_manager_snapshot_release(old);
+}
+
+const turnout_snapshot_t *turnout_manager_snapshot_acquire(void)
+{
+    turnout_snapshot_t *snap = snapshot_ref_current();
+    if (snap && snap->version == __atomic_load_n(&s_version, __ATOMIC_ACQUIRE)) return snap;
+    if (!s_mutex) return snap;
+
+    turnout_manager_snapshot_release(snap);
+    MUTEX_TAKE();
+    snapshot_publish();
+    MUTEX_GIVE();
+
+    return snapshot_ref_current();
+}
+
+/**
+ * @brief Snapshot at least as new as the table was at the call, or NULL
+ *
+ * NULL when the copy could not be allocated (acquire then hands back an
+ * older snapshot).  Changes made after the call may or may not be in it.
+ */
+static const turnout_snapshot_t *snapshot_acquire_since_call(void)
+{
+    uint32_t version = __atomic_load_n(&s_version, __ATOMIC_ACQUIRE);
+    const turnout_snapshot_t *snap = turnout_manager_snapshot_acquire();
+    if (snap && (int32_t)(snap->version - version) < 0) {
+        turnout_manager_snapshot_release(snap);
+        return NULL;
+    }
+    return snap;
+}
+
+void turnout_manager_snapshot_release(const turnout_snapshot_t *snap)
+{
+    if (!snap) return;
+    turnout_snapshot_t *s = (turnout_snapshot_t *)snap;
+    if (__atomic_sub_fetch(&s->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        heap_caps_free(s);
+    }
+}
+
 // ============================================================================
 // Public API
 // ============================================================================
 
+/**
+ * @brief The merged list of a JMRI import is written (SD task)
+ *
+ * Only now is roster.xml renamed to roster_bak.xml, so it is not imported
+ * again next boot.  If the write failed the roster stays, and the next
+ * boot imports it again.  The SD task owns the card, so it renames here.
+ */
+static void jmri_import_saved_cb(esp_err_t result, char *data, size_t len, void *ctx)
+{
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Imported turnouts not saved (%s); roster.xml kept",
+                 esp_err_to_name(result));
+        return;
+    }
+    ESP_LOGI(TAG, "Saved the imported turnouts");
+    if (rename(TURNOUT_JMRI_IMPORT_PATH, "/sdcard/roster_bak.xml") == 0) {
+        ESP_LOGI(TAG, "Renamed roster.xml to roster_bak.xml");
+    } else {
+        ESP_LOGW(TAG, "Could not rename roster.xml: %s", strerror(errno));
+    }
+}
+
 esp_err_t turnout_manager_init(void)
 {
     if (!s_mutex) {
@@ -46,28 +266,15 @@ esp_err_t turnout_manager_init(void)
         }
     }
 
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
-
-    /* Allocate turnout array from PSRAM (saves ~10KB internal SRAM) */
-    if (!s_turnouts) {
-        s_turnouts = heap_caps_calloc(TURNOUT_MAX_COUNT, sizeof(turnout_t),
-                                      MALLOC_CAP_SPIRAM);
-        if (!s_turnouts) {
-            ESP_LOGW(TAG, "PSRAM alloc failed, falling back to internal RAM");
-            s_turnouts = calloc(TURNOUT_MAX_COUNT, sizeof(turnout_t));
-        }
-        if (!s_turnouts) {
-            ESP_LOGE(TAG, "Failed to allocate turnout array");
-            xSemaphoreGive(s_mutex);
-            return ESP_ERR_NO_MEM;
-        }
-    }
+    MUTEX_TAKE();
 
-    memset(s_turnouts, 0, TURNOUT_MAX_COUNT * sizeof(turnout_t));
+    /* The array grows in PSRAM as turnouts are loaded or added */
+    if (s_turnouts) memset(s_turnouts, 0, s_capacity * sizeof(turnout_t));
     s_count = 0;
 
+    int64_t t0 = esp_timer_get_time();
     size_t loaded = 0;
-    esp_err_t ret = turnout_storage_load(s_turnouts, TURNOUT_MAX_COUNT, &loaded);
+    esp_err_t ret = turnout_storage_load(&s_turnouts, &s_capacity, &loaded);
     if (ret == ESP_OK) {
         s_count = loaded;
         ESP_LOGI(TAG, "Loaded %d turnouts from storage", (int)s_count);
@@ -90,23 +297,20 @@ esp_err_t turnout_manager_init(void)
 
     // Import from JMRI XML if present (supplements existing turnouts)
     size_t before_import = s_count;
-    esp_err_t jmri_ret = turnout_storage_import_jmri(s_turnouts, &s_count,
-                                                      TURNOUT_MAX_COUNT);
+    esp_err_t jmri_ret = turnout_storage_import_jmri(&s_turnouts, &s_capacity, &s_count);
     if (jmri_ret == ESP_OK && s_count > before_import) {
         ESP_LOGI(TAG, "JMRI import added %d new turnouts (total: %d)",
                  (int)(s_count - before_import), (int)s_count);
-        // Save merged list so future boots don't re-import
-        turnout_storage_save(s_turnouts, s_count);
-
-        // Rename roster.xml → roster_bak.xml so it isn't re-imported next boot
-        if (rename(TURNOUT_JMRI_IMPORT_PATH, "/sdcard/roster_bak.xml") == 0) {
-            ESP_LOGI(TAG, "Renamed roster.xml to roster_bak.xml");
-        } else {
-            ESP_LOGW(TAG, "Could not rename roster.xml: %s", strerror(errno));
-        }
+        // Save the merged list; roster.xml is retired once it is on the card
+        turnout_storage_save(s_turnouts, s_count, jmri_import_saved_cb, NULL);
     }
 
-    xSemaphoreGive(s_mutex);
+    event_index_rebuild();
+    table_changed();
+    ESP_LOGI(TAG, "Turnout store: %d turnouts, capacity %d, ready in %d ms",
+             (int)s_count, (int)s_capacity, (int)((esp_timer_get_time() - t0) / 1000));
+
+    MUTEX_GIVE();
     return ret;
 }
 
@@ -117,9 +321,9 @@ void turnout_manager_set_state_callback(turnout_state_callback_t cb)
 
 size_t turnout_manager_get_count(void)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
     size_t count = s_count;
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
     return count;
 }
 
@@ -127,13 +331,13 @@ esp_err_t turnout_manager_get_by_index(size_t index, turnout_t *out)
 {
     if (!out) return ESP_ERR_INVALID_ARG;
 
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
     if (index >= s_count) {
-        xSemaphoreGive(s_mutex);
+        MUTEX_GIVE();
         return ESP_ERR_INVALID_ARG;
     }
     *out = s_turnouts[index];
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
     return ESP_OK;
 }
 
@@ -146,11 +350,11 @@ void turnout_manager_get_all(const turnout_t **out_turnouts, size_t *out_count)
 
 int turnout_manager_add(uint64_t event_normal, uint64_t event_reverse, const char *name)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
 
     if (s_count >= TURNOUT_MAX_COUNT) {
         ESP_LOGW(TAG, "Turnout limit reached (%d)", TURNOUT_MAX_COUNT);
-        xSemaphoreGive(s_mutex);
+        MUTEX_GIVE();
         return -1;
     }
 
@@ -159,11 +363,17 @@ int turnout_manager_add(uint64_t event_normal, uint64_t event_reverse, const cha
         if (s_turnouts[i].event_normal == event_normal ||
             s_turnouts[i].event_reverse == event_reverse) {
             ESP_LOGW(TAG, "Duplicate event ID - turnout already exists at index %d", (int)i);
-            xSemaphoreGive(s_mutex);
+            MUTEX_GIVE();
             return -1;
         }
     }
 
+    if (!psram_array_reserve((void **)&s_turnouts, &s_capacity, s_count + 1,
+                             sizeof(turnout_t))) {
+        MUTEX_GIVE();
+        return -1;
+    }
+
     int idx = (int)s_count;
     turnout_t *t = &s_turnouts[idx];
     memset(t, 0, sizeof(turnout_t));
@@ -183,18 +393,25 @@ int turnout_manager_add(uint64_t event_normal, uint64_t event_reverse, const cha
     t->id = s_next_turnout_id++;
 
     s_count++;
+    if (s_event_slots && s_count * 4 <= s_event_slot_count) {
+        event_index_insert(event_normal, (size_t)idx);
+        event_index_insert(event_reverse, (size_t)idx);
+    } else {
+        event_index_rebuild();
+    }
+    table_changed();
     ESP_LOGI(TAG, "Added turnout '%s' at index %d", t->name, idx);
 
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
     return idx;
 }
 
 esp_err_t turnout_manager_remove(size_t index)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
 
     if (index >= s_count) {
-        xSemaphoreGive(s_mutex);
+        MUTEX_GIVE();
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -208,8 +425,10 @@ esp_err_t turnout_manager_remove(size_t index)
 
     // Clear the last slot
     memset(&s_turnouts[s_count], 0, sizeof(turnout_t));
+    event_index_rebuild();
+    table_changed();
 
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
     return ESP_OK;
 }
 
@@ -217,41 +436,43 @@ esp_err_t turnout_manager_rename(size_t index, const char *name)
 {
     if (!name) return ESP_ERR_INVALID_ARG;
 
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
     if (index >= s_count) {
-        xSemaphoreGive(s_mutex);
+        MUTEX_GIVE();
         return ESP_ERR_INVALID_ARG;
     }
 
     strncpy(s_turnouts[index].name, name, sizeof(s_turnouts[index].name) - 1);
     s_turnouts[index].name[sizeof(s_turnouts[index].name) - 1] = '\0';
+    table_changed();
 
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
     return ESP_OK;
 }
 
 esp_err_t turnout_manager_flip_polarity(size_t index)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
     if (index >= s_count) {
-        xSemaphoreGive(s_mutex);
+        MUTEX_GIVE();
         return ESP_ERR_INVALID_ARG;
     }
 
     uint64_t tmp = s_turnouts[index].event_normal;
     s_turnouts[index].event_normal = s_turnouts[index].event_reverse;
     s_turnouts[index].event_reverse = tmp;
+    table_changed();
 
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
     return ESP_OK;
 }
 
 esp_err_t turnout_manager_swap(size_t index_a, size_t index_b)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
 
     if (index_a >= s_count || index_b >= s_count) {
-        xSemaphoreGive(s_mutex);
+        MUTEX_GIVE();
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -259,26 +480,44 @@ esp_err_t turnout_manager_swap(size_t index_a, size_t index_b)
         turnout_t tmp = s_turnouts[index_a];
         s_turnouts[index_a] = s_turnouts[index_b];
         s_turnouts[index_b] = tmp;
+        event_index_rebuild();
+        table_changed();
     }
 
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
     return ESP_OK;
 }
 
+/** @brief Count a confirmed command in the latency histogram (mutex held) */
+static void record_confirmation(turnout_t *t, int64_t now_us)
+{
+    if (!t->command_pending) return;
+
+    uint32_t ms = (uint32_t)((now_us - t->command_sent_us) / 1000);
+    size_t b = 0;
+    while (b < TURNOUT_LATENCY_BUCKETS - 1 && ms >= s_latency_bounds_ms[b]) b++;
+    s_latency_hist[b]++;
+}
+
 void turnout_manager_set_state_by_event(uint64_t event_id, turnout_state_t state)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
 
-    for (size_t i = 0; i < s_count; i++) {
+    int found = event_index_find(event_id);
+    if (found >= 0) {
+        size_t i = (size_t)found;
         turnout_t *t = &s_turnouts[i];
         
         if (event_id == t->event_normal) {
             t->state = TURNOUT_STATE_NORMAL;
             t->last_update_us = esp_timer_get_time();
+            record_confirmation(t, t->last_update_us);
             t->command_pending = false;
+            table_changed();
             ESP_LOGD(TAG, "Turnout '%s' -> NORMAL", t->name);
             
-            xSemaphoreGive(s_mutex);
+            MUTEX_GIVE();
+            TRACE(TRACE_APPLY, TRACE_KIND_TURNOUT, i, event_id);
             if (s_state_callback) {
                 s_state_callback((int)i, TURNOUT_STATE_NORMAL);
             }
@@ -288,10 +527,13 @@ void turnout_manager_set_state_by_event(uint64_t event_id, turnout_state_t state
         if (event_id == t->event_reverse) {
             t->state = TURNOUT_STATE_REVERSE;
             t->last_update_us = esp_timer_get_time();
+            record_confirmation(t, t->last_update_us);
             t->command_pending = false;
+            table_changed();
             ESP_LOGD(TAG, "Turnout '%s' -> REVERSE", t->name);
             
-            xSemaphoreGive(s_mutex);
+            MUTEX_GIVE();
+            TRACE(TRACE_APPLY, TRACE_KIND_TURNOUT, i, event_id);
             if (s_state_callback) {
                 s_state_callback((int)i, TURNOUT_STATE_REVERSE);
             }
@@ -299,58 +541,64 @@ void turnout_manager_set_state_by_event(uint64_t event_id, turnout_state_t state
         }
     }
 
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
     // Event not matched to any turnout - may be discovered by the discovery handler
 }
 
 void turnout_manager_set_pending(size_t index, bool pending)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
     if (index < s_count) {
         s_turnouts[index].command_pending = pending;
+        if (pending) s_turnouts[index].command_sent_us = esp_timer_get_time();
+        table_changed();
     }
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
 }
 
-int turnout_manager_find_by_event(uint64_t event_id)
+void turnout_manager_get_command_stats(turnout_command_stats_t *out)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
-    
+    MUTEX_TAKE();
+    out->pending = 0;
     for (size_t i = 0; i < s_count; i++) {
-        if (s_turnouts[i].event_normal == event_id ||
-            s_turnouts[i].event_reverse == event_id) {
-            xSemaphoreGive(s_mutex);
-            return (int)i;
-        }
+        if (s_turnouts[i].command_pending) out->pending++;
     }
+    memcpy(out->latency_hist, s_latency_hist, sizeof(s_latency_hist));
+    MUTEX_GIVE();
+}
 
-    xSemaphoreGive(s_mutex);
-    return -1;
+int turnout_manager_find_by_event(uint64_t event_id)
+{
+    MUTEX_TAKE();
+    int index = event_index_find(event_id);
+    MUTEX_GIVE();
+    return index;
 }
 
 int turnout_manager_find_by_id(uint32_t id)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
 
     for (size_t i = 0; i < s_count; i++) {
         if (s_turnouts[i].id == id) {
-            xSemaphoreGive(s_mutex);
+            MUTEX_GIVE();
             return (int)i;
         }
     }
 
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
     return -1;
 }
 
-void turnout_manager_check_stale(uint32_t timeout_ms)
+int64_t turnout_manager_check_stale(uint32_t timeout_ms)
 {
-    if (timeout_ms == 0) return;
+    if (timeout_ms == 0) return -1;
 
     int64_t now_us = esp_timer_get_time();
     int64_t threshold_us = (int64_t)timeout_ms * 1000;
+    int64_t next_us = -1;
 
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
 
     for (size_t i = 0; i < s_count; i++) {
         turnout_t *t = &s_turnouts[i];
@@ -359,38 +607,58 @@ void turnout_manager_check_stale(uint32_t timeout_ms)
         if (t->last_update_us > 0 &&
             (t->state == TURNOUT_STATE_NORMAL || t->state == TURNOUT_STATE_REVERSE)) {
             
-            if ((now_us - t->last_update_us) > threshold_us) {
+            if ((now_us - t->last_update_us) >= threshold_us) {
                 t->state = TURNOUT_STATE_STALE;
+                table_changed();
                 ESP_LOGW(TAG, "Turnout '%s' marked STALE (no update for %lu ms)",
                          t->name, (unsigned long)timeout_ms);
                 
                 if (s_state_callback) {
                     // Release lock before callback to avoid deadlock
-                    xSemaphoreGive(s_mutex);
+                    MUTEX_GIVE();
                     s_state_callback((int)i, TURNOUT_STATE_STALE);
-                    xSemaphoreTake(s_mutex, portMAX_DELAY);
+                    MUTEX_TAKE();
                 }
+            } else if (next_us < 0 || t->last_update_us + threshold_us < next_us) {
+                next_us = t->last_update_us + threshold_us;
             }
         }
     }
 
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
+    return next_us;
 }
 
 esp_err_t turnout_manager_save(void)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
-    esp_err_t ret = turnout_storage_save(s_turnouts, s_count);
-    xSemaphoreGive(s_mutex);
+    // The SD write runs on a snapshot, so the executor is not held up by it.
+    // State events after the call may come in meanwhile; they are saved by
+    // the next save.  Only when the copy failed does it fall back to the lock.
+    const turnout_snapshot_t *snap = snapshot_acquire_since_call();
+    if (!snap) {
+        MUTEX_TAKE();
+        esp_err_t ret = turnout_storage_save(s_turnouts, s_count, NULL, NULL);
+        MUTEX_GIVE();
+        return ret;
+    }
+    esp_err_t ret = turnout_storage_save(snap->turnouts, snap->count, NULL, NULL);
+    turnout_manager_snapshot_release(snap);
     return ret;
 }
 
+#if CONFIG_LOCK_PROFILER
+void turnout_manager_lock_at(const char *func, int line)
+{
+    lock_prof_take(LOCK_PROF_TURNOUT, s_mutex, portMAX_DELAY, false, func, line);
+}
+#else
 void turnout_manager_lock(void)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    MUTEX_TAKE();
 }
+#endif
 
 void turnout_manager_unlock(void)
 {
-    xSemaphoreGive(s_mutex);
+    MUTEX_GIVE();
 }
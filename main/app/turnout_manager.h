@@ -11,6 +11,7 @@
 #define TURNOUT_MANAGER_H_
 
 #include "esp_err.h"
+#include "sdkconfig.h"
 #include "../ui/ui_common.h"
 #include <stddef.h>
 #include <stdbool.h>
@@ -65,13 +66,48 @@ esp_err_t turnout_manager_get_by_index(size_t index, turnout_t *out);
  * @brief Get a pointer to the internal turnout array (read-only access)
  * 
  * Caller MUST hold the turnout manager lock while accessing this pointer.
- * Use turnout_manager_lock() / turnout_manager_unlock().
+ * Use turnout_manager_lock() / turnout_manager_unlock().  Readers that
+ * walk the whole table should prefer turnout_manager_snapshot_acquire().
  * 
  * @param out_turnouts Output pointer to array
  * @param out_count Output count
  */
 void turnout_manager_get_all(const turnout_t **out_turnouts, size_t *out_count);
 
+/**
+ * @brief Immutable copy of the turnout table
+ *
+ * Taken with turnout_manager_snapshot_acquire() and returned with
+ * turnout_manager_snapshot_release().  Never changes while held, so a
+ * reader can walk it for as long as it likes without the manager lock.
+ * Indices match the manager's array as of @ref version.
+ */
+typedef struct {
+    uint32_t version;           ///< Table version the copy was taken at
+    uint32_t refs;              ///< Holders; the manager keeps one on the latest copy
+    size_t count;
+    turnout_t turnouts[];
+} turnout_snapshot_t;
+
+/**
+ * @brief Take a reference to the latest snapshot
+ *
+ * Lock-free when the table has not changed since the last snapshot.
+ * Otherwise the table is copied once under the lock and published.
+ *
+ * @return Snapshot to release later, or NULL before turnout_manager_init()
+ *         or when no copy could ever be allocated.  After a failed copy the
+ *         previous, older snapshot is returned.
+ */
+const turnout_snapshot_t *turnout_manager_snapshot_acquire(void);
+
+/**
+ * @brief Release a snapshot from turnout_manager_snapshot_acquire()
+ *
+ * @param snap Snapshot (NULL is ignored)
+ */
+void turnout_manager_snapshot_release(const turnout_snapshot_t *snap);
+
 /**
  * @brief Add a new turnout
  * 
@@ -138,6 +174,26 @@ void turnout_manager_set_state_by_event(uint64_t event_id, turnout_state_t state
  */
 void turnout_manager_set_pending(size_t index, bool pending);
 
+/** @brief Number of command latency histogram buckets */
+#define TURNOUT_LATENCY_BUCKETS 8
+
+/**
+ * @brief Turnout command statistics
+ *
+ * A command is timed from turnout_manager_set_pending(true) to the state
+ * event that clears it.  Bucket upper bounds are 50, 100, 200, 500, 1000,
+ * 2000 and 5000 ms; the last bucket counts everything slower.
+ */
+typedef struct {
+    uint32_t pending;                                   ///< Commands awaiting confirmation now
+    uint32_t latency_hist[TURNOUT_LATENCY_BUCKETS];     ///< Confirmations since boot, by latency
+} turnout_command_stats_t;
+
+/**
+ * @brief Snapshot the command statistics
+ */
+void turnout_manager_get_command_stats(turnout_command_stats_t *out);
+
 /**
  * @brief Find a turnout by event ID
  * 
@@ -158,11 +214,13 @@ int turnout_manager_find_by_id(uint32_t id);
  * @brief Check for stale turnouts and update their state
  * 
  * Any turnout with last_update_us older than timeout_ms will be marked STALE.
- * Call periodically from the main loop.
+ * Called by the main task at the deadline it returns.
  * 
  * @param timeout_ms Stale timeout in milliseconds
+ * @return esp_timer_get_time() at which the next turnout goes stale, or -1
+ *         if none can (no turnout has a current state, or timeout_ms is 0)
  */
-void turnout_manager_check_stale(uint32_t timeout_ms);
+int64_t turnout_manager_check_stale(uint32_t timeout_ms);
 
 /**
  * @brief Save current turnout definitions to SD card
@@ -176,8 +234,14 @@ esp_err_t turnout_manager_save(void);
  * 
  * Must be held when accessing the array pointer from get_all().
  * Do NOT hold this while doing lengthy operations.
+ * With CONFIG_LOCK_PROFILER this is a macro that passes the call site.
  */
+#if CONFIG_LOCK_PROFILER
+void turnout_manager_lock_at(const char *func, int line);
+#define turnout_manager_lock() turnout_manager_lock_at(__func__, __LINE__)
+#else
 void turnout_manager_lock(void);
+#endif
 
 /**
  * @brief Unlock the turnout manager mutex
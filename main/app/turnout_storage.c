@@ -20,17 +20,14 @@
  */
 
 #include "turnout_storage.h"
+#include "psram_array.h"
+#include "lcc_id.h"
+#include "sd_io.h"
 #include "cJSON.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
-
-/** @brief Max attempts for SD card file open (card may need wake-up) */
-#define SD_OPEN_MAX_RETRIES  3
-#define SD_OPEN_RETRY_MS     100
 
 static const char *TAG = "turnout_storage";
 
@@ -57,77 +54,51 @@ static void format_event_id(uint64_t event_id, char *buf)
              (unsigned)(event_id & 0xFF));
 }
 
-/**
- * @brief Parse a dotted hex event ID string to 64-bit value
- * 
- * @param str Input string (e.g., "05.01.01.01.22.60.00.00")
- * @param out_id Output event ID
- * @return true on success
- */
-static bool parse_event_id(const char *str, uint64_t *out_id)
+/** @brief Completion of a save queued without a callback (SD task) */
+static void save_done_cb(esp_err_t result, char *data, size_t len, void *ctx)
 {
-    if (!str || !out_id) return false;
-
-    unsigned int bytes[8];
-    if (sscanf(str, "%02x.%02x.%02x.%02x.%02x.%02x.%02x.%02x",
-               &bytes[0], &bytes[1], &bytes[2], &bytes[3],
-               &bytes[4], &bytes[5], &bytes[6], &bytes[7]) == 8) {
-        *out_id = ((uint64_t)bytes[0] << 56) |
-                  ((uint64_t)bytes[1] << 48) |
-                  ((uint64_t)bytes[2] << 40) |
-                  ((uint64_t)bytes[3] << 32) |
-                  ((uint64_t)bytes[4] << 24) |
-                  ((uint64_t)bytes[5] << 16) |
-                  ((uint64_t)bytes[6] << 8) |
-                  ((uint64_t)bytes[7]);
-        return true;
-    }
-
-    // Also try plain hex: "0501010122600000"
-    char *endptr;
-    uint64_t val = strtoull(str, &endptr, 16);
-    if (endptr != str && *endptr == '\0') {
-        *out_id = val;
-        return true;
+    if (result == ESP_OK) {
+        ESP_LOGI(TAG, "Saved %d turnouts to SD card", (int)(uintptr_t)ctx);
+    } else {
+        ESP_LOGE(TAG, "Failed to write turnouts.json: %s", esp_err_to_name(result));
     }
-
-    return false;
 }
 
 // ============================================================================
 // Public API
 // ============================================================================
 
-esp_err_t turnout_storage_load(turnout_t *turnouts, size_t max_count, size_t *out_count)
+esp_err_t turnout_storage_load(turnout_t **turnouts, size_t *capacity, size_t *out_count)
 {
-    if (!turnouts || !out_count) return ESP_ERR_INVALID_ARG;
+    if (!turnouts || !capacity || !out_count) return ESP_ERR_INVALID_ARG;
     *out_count = 0;
 
-    struct stat st;
-    if (stat(TURNOUT_STORAGE_PATH, &st) != 0) {
+    char *buf = NULL;
+    esp_err_t ret = sd_io_read_sync(TURNOUT_STORAGE_PATH, &buf, NULL);
+    if (ret == ESP_ERR_NOT_FOUND) {
         ESP_LOGI(TAG, "turnouts.json not found - starting with empty list");
-        return ESP_ERR_NOT_FOUND;
+        return ret;
     }
-
-    FILE *f = fopen(TURNOUT_STORAGE_PATH, "r");
-    if (!f) {
-        ESP_LOGE(TAG, "Failed to open %s", TURNOUT_STORAGE_PATH);
-        return ESP_FAIL;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read %s: %s", TURNOUT_STORAGE_PATH, esp_err_to_name(ret));
+        return ret;
     }
 
-    // Read entire file
-    char *buf = malloc(st.st_size + 1);
-    if (!buf) {
-        fclose(f);
-        return ESP_ERR_NO_MEM;
+    ret = turnout_storage_parse(buf, turnouts, capacity, out_count);
+    free(buf);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Loaded %d turnouts from SD card", (int)*out_count);
     }
-    size_t read_sz = fread(buf, 1, st.st_size, f);
-    fclose(f);
-    buf[read_sz] = '\0';
+    return ret;
+}
 
-    // Parse JSON
-    cJSON *root = cJSON_Parse(buf);
-    free(buf);
+esp_err_t turnout_storage_parse(const char *json, turnout_t **turnouts, size_t *capacity,
+                                size_t *out_count)
+{
+    if (!json || !turnouts || !capacity || !out_count) return ESP_ERR_INVALID_ARG;
+    *out_count = 0;
+
+    cJSON *root = cJSON_Parse(json);
     if (!root) {
         ESP_LOGE(TAG, "Failed to parse turnouts.json");
         return ESP_FAIL;
@@ -140,15 +111,25 @@ esp_err_t turnout_storage_load(turnout_t *turnouts, size_t max_count, size_t *ou
         return ESP_FAIL;
     }
 
+    // Size the array once for the whole file
+    size_t max_count = (size_t)cJSON_GetArraySize(arr);
+    if (max_count > TURNOUT_MAX_COUNT) {
+        ESP_LOGW(TAG, "turnouts.json has %d turnouts, truncating to %d",
+                 (int)max_count, TURNOUT_MAX_COUNT);
+        max_count = TURNOUT_MAX_COUNT;
+    }
+    if (!psram_array_reserve((void **)turnouts, capacity, max_count, sizeof(turnout_t))) {
+        ESP_LOGW(TAG, "Out of memory for %d turnouts, loading %d",
+                 (int)max_count, (int)*capacity);
+        max_count = *capacity;
+    }
+
     size_t count = 0;
     cJSON *item;
     cJSON_ArrayForEach(item, arr) {
-        if (count >= max_count) {
-            ESP_LOGW(TAG, "Turnout limit reached (%d), ignoring remaining", (int)max_count);
-            break;
-        }
+        if (count >= max_count) break;
 
-        turnout_t *t = &turnouts[count];
+        turnout_t *t = &(*turnouts)[count];
         memset(t, 0, sizeof(turnout_t));
 
         // Name
@@ -163,11 +144,11 @@ esp_err_t turnout_storage_load(turnout_t *turnouts, size_t max_count, size_t *ou
         cJSON *ev_normal = cJSON_GetObjectItem(item, "event_normal");
         cJSON *ev_reverse = cJSON_GetObjectItem(item, "event_reverse");
 
-        if (!cJSON_IsString(ev_normal) || !parse_event_id(ev_normal->valuestring, &t->event_normal)) {
+        if (!cJSON_IsString(ev_normal) || !lcc_id_parse_event(ev_normal->valuestring, &t->event_normal)) {
             ESP_LOGW(TAG, "Skipping turnout '%s' - invalid event_normal", t->name);
             continue;
         }
-        if (!cJSON_IsString(ev_reverse) || !parse_event_id(ev_reverse->valuestring, &t->event_reverse)) {
+        if (!cJSON_IsString(ev_reverse) || !lcc_id_parse_event(ev_reverse->valuestring, &t->event_reverse)) {
             ESP_LOGW(TAG, "Skipping turnout '%s' - invalid event_reverse", t->name);
             continue;
         }
@@ -198,11 +179,11 @@ esp_err_t turnout_storage_load(turnout_t *turnouts, size_t max_count, size_t *ou
 
     cJSON_Delete(root);
     *out_count = count;
-    ESP_LOGI(TAG, "Loaded %d turnouts from SD card", (int)count);
     return ESP_OK;
 }
 
-esp_err_t turnout_storage_save(const turnout_t *turnouts, size_t count)
+esp_err_t turnout_storage_save(const turnout_t *turnouts, size_t count,
+                               sd_io_done_cb_t cb, void *ctx)
 {
     if (!turnouts && count > 0) return ESP_ERR_INVALID_ARG;
 
@@ -243,34 +224,13 @@ esp_err_t turnout_storage_save(const turnout_t *turnouts, size_t count)
     cJSON_Delete(root);
     if (!json_str) return ESP_ERR_NO_MEM;
 
-    FILE *f = NULL;
-    for (int attempt = 0; attempt < SD_OPEN_MAX_RETRIES; attempt++) {
-        f = fopen(TURNOUT_STORAGE_PATH, "w");
-        if (f) break;
-        ESP_LOGW(TAG, "SD card open failed (attempt %d/%d), retrying...",
-                 attempt + 1, SD_OPEN_MAX_RETRIES);
-        vTaskDelay(pdMS_TO_TICKS(SD_OPEN_RETRY_MS));
-    }
-    if (!f) {
-        cJSON_free(json_str);
-        ESP_LOGE(TAG, "Failed to open %s for writing after %d attempts",
-                 TURNOUT_STORAGE_PATH, SD_OPEN_MAX_RETRIES);
-        return ESP_FAIL;
+    // The SD task writes it and frees json_str
+    esp_err_t ret = sd_io_write(TURNOUT_STORAGE_PATH, json_str, strlen(json_str), SD_IO_PRIO_HIGH,
+                                cb ? cb : save_done_cb, cb ? ctx : (void *)(uintptr_t)count);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to queue turnouts.json: %s", esp_err_to_name(ret));
     }
-
-    size_t len = strlen(json_str);
-    size_t written = fwrite(json_str, 1, len, f);
-    fflush(f);
-    fclose(f);
-    cJSON_free(json_str);
-
-    if (written != len) {
-        ESP_LOGE(TAG, "Failed to write complete turnouts.json");
-        return ESP_FAIL;
-    }
-
-    ESP_LOGI(TAG, "Saved %d turnouts to SD card", (int)count);
-    return ESP_OK;
+    return ret;
 }
 
 // ============================================================================
@@ -320,11 +280,26 @@ static bool xml_get_attr(const char *tag, const char *attr_name,
     return true;
 }
 
+/** @brief strstr() limited to [start, end) */
+static const char *find_in(const char *start, const char *end, const char *needle)
+{
+    size_t n = strlen(needle);
+    while (end - start >= (ptrdiff_t)n) {
+        const char *p = memchr(start, needle[0], (size_t)(end - start) - n + 1);
+        if (!p) return NULL;
+        if (memcmp(p, needle, n) == 0) return p;
+        start = p + 1;
+    }
+    return NULL;
+}
+
 /**
  * @brief Extract text content between <tag>content</tag>
  *
  * Searches within the region [start, region_end) for <tag_name>...</tag_name>
- * and copies the text content into out_buf.
+ * and copies the text content into out_buf.  The search never leaves the
+ * region, so a missing element costs one pass over its own <turnout> block
+ * rather than over the rest of the file.
  */
 static bool xml_get_element_text(const char *start, const char *region_end,
                                  const char *tag_name,
@@ -335,12 +310,12 @@ static bool xml_get_element_text(const char *start, const char *region_end,
     snprintf(open_tag, sizeof(open_tag), "<%s>", tag_name);
     snprintf(close_tag, sizeof(close_tag), "</%s>", tag_name);
 
-    const char *open = strstr(start, open_tag);
-    if (!open || open >= region_end) return false;
+    const char *open = find_in(start, region_end, open_tag);
+    if (!open) return false;
 
     const char *text_start = open + strlen(open_tag);
-    const char *close = strstr(text_start, close_tag);
-    if (!close || close >= region_end) return false;
+    const char *close = find_in(text_start, region_end, close_tag);
+    if (!close) return false;
 
     size_t len = (size_t)(close - text_start);
     if (len >= buf_len) len = buf_len - 1;
@@ -377,55 +352,59 @@ static bool parse_jmri_system_name(const char *sys_name,
     memcpy(ev1_str, p, len1);
     ev1_str[len1] = '\0';
 
-    if (!parse_event_id(ev1_str, out_ev1)) return false;
+    if (!lcc_id_parse_event(ev1_str, out_ev1)) return false;
 
     // Parse second event ID (after semicolon)
-    if (!parse_event_id(semi + 1, out_ev2)) return false;
+    if (!lcc_id_parse_event(semi + 1, out_ev2)) return false;
 
     return true;
 }
 
-esp_err_t turnout_storage_import_jmri(turnout_t *turnouts, size_t *count,
-                                      size_t max_count)
+esp_err_t turnout_storage_import_jmri(turnout_t **turnouts, size_t *capacity,
+                                      size_t *count)
 {
-    if (!turnouts || !count) return ESP_ERR_INVALID_ARG;
+    if (!turnouts || !capacity || !count) return ESP_ERR_INVALID_ARG;
 
-    struct stat st;
-    if (stat(TURNOUT_JMRI_IMPORT_PATH, &st) != 0) {
+    char *buf = NULL;
+    esp_err_t ret = sd_io_read_sync(TURNOUT_JMRI_IMPORT_PATH, &buf, NULL);
+    if (ret == ESP_ERR_NOT_FOUND) {
         ESP_LOGI(TAG, "No JMRI import file found at %s", TURNOUT_JMRI_IMPORT_PATH);
-        return ESP_ERR_NOT_FOUND;
+        return ret;
     }
-
-    FILE *f = fopen(TURNOUT_JMRI_IMPORT_PATH, "r");
-    if (!f) {
-        ESP_LOGE(TAG, "Failed to open %s", TURNOUT_JMRI_IMPORT_PATH);
-        return ESP_FAIL;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read %s: %s", TURNOUT_JMRI_IMPORT_PATH, esp_err_to_name(ret));
+        return ret;
     }
 
-    // Read entire file
-    char *buf = malloc(st.st_size + 1);
-    if (!buf) {
-        fclose(f);
-        ESP_LOGE(TAG, "Not enough memory for JMRI file (%ld bytes)",
-                 (long)st.st_size);
-        return ESP_ERR_NO_MEM;
+    size_t before = *count;
+    ret = turnout_storage_parse_jmri(buf, turnouts, capacity, count);
+    free(buf);
+
+    if (*count > before) {
+        ESP_LOGI(TAG, "Imported %d new turnouts from JMRI file", (int)(*count - before));
+    } else {
+        ESP_LOGI(TAG, "No new turnouts to import from JMRI file");
     }
-    size_t read_sz = fread(buf, 1, st.st_size, f);
-    fclose(f);
-    buf[read_sz] = '\0';
+    return ret;
+}
+
+esp_err_t turnout_storage_parse_jmri(const char *xml, turnout_t **turnouts, size_t *capacity,
+                                     size_t *count)
+{
+    if (!xml || !turnouts || !capacity || !count) return ESP_ERR_INVALID_ARG;
 
     // Find the turnouts section:  <turnouts class="...openlcb...">
-    const char *turnout_section = strstr(buf, "OlcbTurnoutManager");
+    const char *turnout_section = strstr(xml, "OlcbTurnoutManager");
     if (!turnout_section) {
         // Try generic turnouts tag
-        turnout_section = buf;
+        turnout_section = xml;
     }
 
     size_t imported = 0;
     const char *cursor = turnout_section;
 
     while ((cursor = strstr(cursor, "<turnout ")) != NULL) {
-        if (*count >= max_count) {
+        if (*count >= TURNOUT_MAX_COUNT) {
             ESP_LOGW(TAG, "Turnout limit reached, stopping JMRI import");
             break;
         }
@@ -491,13 +470,17 @@ esp_err_t turnout_storage_import_jmri(turnout_t *turnouts, size_t *count,
         }
 
         // Skip if already exists
-        if (event_already_exists(turnouts, *count, ev_normal, ev_reverse)) {
+        if (event_already_exists(*turnouts, *count, ev_normal, ev_reverse)) {
             cursor = block_end;
             continue;
         }
 
         // Add new turnout
-        turnout_t *t = &turnouts[*count];
+        if (!psram_array_reserve((void **)turnouts, capacity, *count + 1, sizeof(turnout_t))) {
+            ESP_LOGW(TAG, "Out of memory, stopping JMRI import");
+            break;
+        }
+        turnout_t *t = &(*turnouts)[*count];
         memset(t, 0, sizeof(turnout_t));
 
         if (user_name[0]) {
@@ -515,7 +498,7 @@ esp_err_t turnout_storage_import_jmri(turnout_t *turnouts, size_t *count,
         (*count)++;
         imported++;
 
-        ESP_LOGI(TAG, "JMRI import: '%s' N=%016llx R=%016llx%s",
+        ESP_LOGD(TAG, "JMRI import: '%s' N=%016llx R=%016llx%s",
                  t->name,
                  (unsigned long long)ev_normal,
                  (unsigned long long)ev_reverse,
@@ -524,13 +507,5 @@ esp_err_t turnout_storage_import_jmri(turnout_t *turnouts, size_t *count,
         cursor = block_end;
     }
 
-    free(buf);
-
-    if (imported > 0) {
-        ESP_LOGI(TAG, "Imported %d new turnouts from JMRI file", (int)imported);
-    } else {
-        ESP_LOGI(TAG, "No new turnouts to import from JMRI file");
-    }
-
     return ESP_OK;
 }
@@ -10,6 +10,7 @@
 #define TURNOUT_STORAGE_H_
 
 #include "esp_err.h"
+#include "sd_io.h"
 #include "../ui/ui_common.h"
 #include <stddef.h>
 
@@ -26,42 +27,73 @@ extern "C" {
 /**
  * @brief Load turnout definitions from SD card
  * 
- * Reads /sdcard/turnouts.json and populates the turnouts array.
+ * Reads /sdcard/turnouts.json and populates the turnouts array, growing it
+ * (psram_array) to the number of entries, up to TURNOUT_MAX_COUNT.
  * States are set to TURNOUT_STATE_UNKNOWN (actual state comes from LCC queries).
  * 
- * @param turnouts Output array to populate
- * @param max_count Maximum entries the array can hold
+ * @param turnouts  In/out: growable array to populate
+ * @param capacity  In/out: capacity of @p turnouts in elements
  * @param out_count Output: number of turnouts loaded
  * @return ESP_OK on success, ESP_ERR_NOT_FOUND if file missing
  */
-esp_err_t turnout_storage_load(turnout_t *turnouts, size_t max_count, size_t *out_count);
+esp_err_t turnout_storage_load(turnout_t **turnouts, size_t *capacity, size_t *out_count);
+
+/**
+ * @brief Parse turnouts.json text (the body of turnout_storage_load)
+ *
+ * @param json      NUL-terminated file contents
+ * @param turnouts  In/out: growable array to populate
+ * @param capacity  In/out: capacity of @p turnouts in elements
+ * @param out_count Output: number of turnouts parsed
+ * @return ESP_OK, or ESP_FAIL if the text is not a turnout list
+ */
+esp_err_t turnout_storage_parse(const char *json, turnout_t **turnouts, size_t *capacity,
+                                size_t *out_count);
 
 /**
  * @brief Save turnout definitions to SD card
  * 
- * Writes the turnout array to /sdcard/turnouts.json.
+ * Serializes the turnout array and queues the write of /sdcard/turnouts.json
+ * with the SD I/O service (sd_io.h); the caller does not wait for the card.
  * Only persists name, event IDs, and user_order - state is transient.
  * 
  * @param turnouts Array of turnout definitions
  * @param count Number of turnouts to save
- * @return ESP_OK on success
+ * @param cb    Completion callback (runs on the SD task), or NULL to log
+ *              the result
+ * @param ctx   Passed to @p cb
+ * @return ESP_OK if queued; @p cb is then called with the write's result
  */
-esp_err_t turnout_storage_save(const turnout_t *turnouts, size_t count);
+esp_err_t turnout_storage_save(const turnout_t *turnouts, size_t count,
+                               sd_io_done_cb_t cb, void *ctx);
 
 /**
  * @brief Import turnouts from a JMRI XML file on SD card
  *
  * Parses /sdcard/roster.xml looking for <turnout> elements.
- * New turnouts (not already present by event ID) are appended to the array.
+ * New turnouts (not already present by event ID) are appended to the array,
+ * which grows as needed up to TURNOUT_MAX_COUNT.
  * Respects the JMRI "inverted" attribute by swapping normal/reverse events.
  *
- * @param turnouts  Array with existing turnouts (new ones appended)
+ * @param turnouts  In/out: growable array with existing turnouts (new ones appended)
+ * @param capacity  In/out: capacity of @p turnouts in elements
  * @param count     Current number of turnouts (updated on return)
- * @param max_count Maximum capacity of the array
  * @return ESP_OK on success, ESP_ERR_NOT_FOUND if file missing
  */
-esp_err_t turnout_storage_import_jmri(turnout_t *turnouts, size_t *count,
-                                      size_t max_count);
+esp_err_t turnout_storage_import_jmri(turnout_t **turnouts, size_t *capacity,
+                                      size_t *count);
+
+/**
+ * @brief Parse JMRI XML text (the body of turnout_storage_import_jmri)
+ *
+ * @param xml       NUL-terminated file contents
+ * @param turnouts  In/out: growable array (new turnouts appended)
+ * @param capacity  In/out: capacity of @p turnouts in elements
+ * @param count     Current number of turnouts (updated on return)
+ * @return ESP_OK
+ */
+esp_err_t turnout_storage_parse_jmri(const char *xml, turnout_t **turnouts, size_t *capacity,
+                                     size_t *count);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,72 @@
+/**
+ * @file turnout_stress.c
+ * @brief Synthetic turnout load for scale testing
+ *
+ * Synthetic turnouts use a private event range and are named "Stress N".
+ * They live in RAM only, but any edit that saves the turnout list writes
+ * them to turnouts.json — use a scratch SD card.
+ */
+
+#include "turnout_stress.h"
+#include "turnout_manager.h"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+
+static const char *TAG = "turnout_stress";
+
+/// Event range for synthetic turnouts (normal = base + 2n, reverse = + 1)
+#define STRESS_EVENT_BASE   0x0501010122FF0000ULL
+
+/// Routing passes over every event, to average out cache effects
+#define STRESS_ROUTE_PASSES 4
+
+void turnout_stress_run(void)
+{
+    size_t target = CONFIG_TURNOUT_STRESS_COUNT;
+    if (target == 0) return;
+
+    // --- Add ---
+    size_t start = turnout_manager_get_count();
+    int64_t t0 = esp_timer_get_time();
+    for (size_t n = start; n < target; n++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Stress %u", (unsigned)(n + 1));
+        uint64_t ev = STRESS_EVENT_BASE + 2 * n;
+        if (turnout_manager_add(ev, ev + 1, name) < 0) break;
+    }
+    size_t count = turnout_manager_get_count();
+    int64_t add_us = esp_timer_get_time() - t0;
+    ESP_LOGI(TAG, "Added %d synthetic turnouts (total %d) in %d ms",
+             (int)(count - start), (int)count, (int)(add_us / 1000));
+
+    // --- Route: hits on both events of every synthetic turnout ---
+    size_t routed = 0;
+    t0 = esp_timer_get_time();
+    for (int pass = 0; pass < STRESS_ROUTE_PASSES; pass++) {
+        for (size_t n = start; n < count; n++) {
+            uint64_t ev = STRESS_EVENT_BASE + 2 * n;
+            turnout_manager_set_state_by_event(ev, TURNOUT_STATE_NORMAL);
+            turnout_manager_set_state_by_event(ev + 1, TURNOUT_STATE_REVERSE);
+            routed += 2;
+        }
+    }
+    int64_t hit_us = esp_timer_get_time() - t0;
+
+    // --- Route: misses (events no turnout uses, the common bus case) ---
+    size_t missed = 0;
+    t0 = esp_timer_get_time();
+    for (size_t n = 0; n < count * 2; n++) {
+        turnout_manager_find_by_event(STRESS_EVENT_BASE + 2 * target + n);
+        missed++;
+    }
+    int64_t miss_us = esp_timer_get_time() - t0;
+
+    if (routed && missed) {
+        ESP_LOGI(TAG, "Routing at %d turnouts: hit %d ns/event, miss %d ns/event",
+                 (int)count, (int)(hit_us * 1000 / (int64_t)routed),
+                 (int)(miss_us * 1000 / (int64_t)missed));
+    }
+    ESP_LOGI(TAG, "Switchboard refresh time is logged by ui_turnouts when the tab is built");
+}
@@ -0,0 +1,32 @@
+/**
+ * @file turnout_stress.h
+ * @brief Synthetic turnout load for scale testing
+ *
+ * Enabled by CONFIG_TURNOUT_STRESS_COUNT (menuconfig → Diagnostics).  At
+ * boot the turnout store is topped up with synthetic turnouts and the
+ * load, event-routing and switchboard-refresh paths are timed and logged,
+ * so a large club layout can be exercised without building one.
+ */
+
+#ifndef TURNOUT_STRESS_H_
+#define TURNOUT_STRESS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Add synthetic turnouts up to CONFIG_TURNOUT_STRESS_COUNT and log
+ *        add and event-routing timings
+ *
+ * Call after turnout_manager_init() and before the state callback is
+ * registered, so routing is measured without queuing UI updates.
+ * Does nothing when the option is 0.
+ */
+void turnout_stress_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TURNOUT_STRESS_H_
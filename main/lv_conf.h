@@ -17,9 +17,31 @@
 #define LV_FONT_FMT_TXT_LARGE 0
 
 /* Memory settings */
+#include "sdkconfig.h"
+#if CONFIG_LVGL_POOL_ALLOC
+/* Size-class pools in internal RAM, larger blocks in PSRAM (ui/lvgl_alloc.c) */
+#define LV_MEM_CUSTOM 1
+#define LV_MEM_CUSTOM_INCLUDE <stddef.h>
+#define LV_MEM_CUSTOM_ALLOC   lvgl_alloc_malloc
+#define LV_MEM_CUSTOM_FREE    lvgl_alloc_free
+#define LV_MEM_CUSTOM_REALLOC lvgl_alloc_realloc
+#if !defined(__ASSEMBLER__)
+#include <stddef.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+void *lvgl_alloc_malloc(size_t size);
+void lvgl_alloc_free(void *ptr);
+void *lvgl_alloc_realloc(void *ptr, size_t size);
+#ifdef __cplusplus
+}
+#endif
+#endif
+#else
 #define LV_MEM_CUSTOM 0
 #define LV_MEM_SIZE (96 * 1024U)          /* 96KB — headroom for builder object churn */
 #define LV_MEM_ADR 0
+#endif
 
 /* Display settings */
 #define LV_DISP_DEF_REFR_PERIOD 16  /* ~60 FPS for smooth scrolling */
@@ -5,6 +5,11 @@
  * Orchestrates hardware init, SD card loading, LCC/OpenMRN startup, and
  * LVGL UI creation.  All display / screen code lives in the ui/ layer;
  * this file only wires modules together and runs the main loop.
+ *
+ * The main loop is event-driven (app/scheduler.c): it sleeps until the
+ * screen timeout, stale expiry, refresh or heartbeat deadline comes due or
+ * another task kicks a job.  State query sweeps run in their own task, so a
+ * long sweep does not hold up the screen timeout.
  */
 
 #include <string.h>
@@ -13,6 +18,7 @@
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "driver/i2c.h"
 
@@ -24,14 +30,28 @@
 
 // UI
 #include "ui_common.h"
+#include "ui_dirty.h"
+#include "render_bench.h"
+#include "churn_bench.h"
+#include "mem_budget.h"
 
 // App modules
 #include "app/turnout_manager.h"
+#include "app/turnout_stress.h"
+#include "app/block_manager.h"
+#include "app/occupancy_load.h"
+#include "app/bus_load.h"
 #include "app/panel_layout.h"
+#include "app/route_bench.h"
+#include "app/app_bench.h"
 #include "app/lcc_node.h"
 #include "app/screen_timeout.h"
+#include "app/scheduler.h"
+#include "app/sd_io.h"
 #include "app/bootloader_hal.h"
 #include "app/panel_storage.h"
+#include "app/panel_history.h"
+#include "app/trace.h"
 
 // Reset-reason detection (bootloader check)
 #if defined(CONFIG_IDF_TARGET_ESP32S3)
@@ -42,6 +62,13 @@
 
 static const char *TAG = "main";
 
+#define STATUS_LOG_MS       30000   ///< Heartbeat status log interval
+#define SWEEP_TASK_STACK    4096
+#define SWEEP_TASK_PRIO     1       ///< As the main task, which used to run the sweeps
+
+/// A turnout goes stale after this many refresh periods without an update
+#define STALE_REFRESH_PERIODS   2
+
 // Hardware handles (global — referenced by ui_common.c)
 ch422g_handle_t        s_ch422g    = NULL;
 esp_lcd_panel_handle_t s_lcd_panel = NULL;
@@ -136,26 +163,23 @@ static esp_err_t init_hardware(void)
 /* ========================================================================= */
 
 /**
- * @brief LVGL-safe callback: update both the switchboard tile and panel diagram
+ * @brief Turnout state callback — runs on LCC executor, marks the switchboard
+ *        tile and panel diagram for the next coalesced UI flush
  */
-static void ui_turnouts_update_tile_async(void *param)
+static void turnout_state_changed_cb(int index, turnout_state_t new_state)
 {
-    uint32_t packed = (uint32_t)(uintptr_t)param;
-    int index            = (int)(packed >> 8);
-    turnout_state_t state = (turnout_state_t)(packed & 0xFF);
-
-    ui_turnouts_update_tile(index, state);
-    ui_panel_update_turnout(index, state);
+    (void)new_state;    /* the flush reads the current state */
+    ui_dirty_mark(UI_DIRTY_TURNOUT, (size_t)index);
 }
 
 /**
- * @brief Turnout state callback — runs on LCC executor, schedules LVGL update
+ * @brief Block state callback — runs on LCC executor, marks the occupancy
+ *        overlay for the next coalesced UI flush
  */
-static void turnout_state_changed_cb(int index, turnout_state_t new_state)
+static void block_state_changed_cb(int index, block_state_t new_state)
 {
-    uint32_t packed = ((uint32_t)index << 8) | (uint32_t)new_state;
-    lv_async_call((lv_async_cb_t)ui_turnouts_update_tile_async,
-                  (void *)(uintptr_t)packed);
+    (void)new_state;
+    ui_dirty_mark(UI_DIRTY_BLOCK, (size_t)index);
 }
 
 /**
@@ -186,14 +210,101 @@ static void discovery_cb(uint64_t event_id, uint8_t state)
  */
 static void register_all_turnout_events(void)
 {
-    size_t count = turnout_manager_get_count();
+    const turnout_snapshot_t *snap = turnout_manager_snapshot_acquire();
+    size_t count = snap ? snap->count : 0;
     ESP_LOGI(TAG, "Registering %d turnout event pairs with LCC node", (int)count);
     
     for (size_t i = 0; i < count; i++) {
-        turnout_t t;
-        if (turnout_manager_get_by_index(i, &t) == ESP_OK) {
-            lcc_node_register_turnout_events(t.event_normal, t.event_reverse);
-        }
+        lcc_node_register_turnout_events(snap->turnouts[i].event_normal,
+                                         snap->turnouts[i].event_reverse);
+    }
+    turnout_manager_snapshot_release(snap);
+}
+
+// ============================================================================
+// Main loop jobs (run by the main task from scheduler_wait())
+// ============================================================================
+
+static bool    s_sweep_running = false;
+static int64_t s_sweep_started_us = 0;
+
+/**
+ * @brief Query sweep task: paced IdentifyProducer for every turnout and block
+ */
+static void sweep_task(void *arg)
+{
+    lcc_node_query_all_turnout_states();
+    lcc_node_query_all_block_states();
+    scheduler_kick(SCHEDULER_SWEEP_DONE);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Arm the next refresh one interval after the last sweep started
+ *
+ * A sweep that takes longer than the interval is followed by the next one
+ * as soon as it ends.
+ */
+static void schedule_refresh(void)
+{
+    if (s_sweep_running) return;    // re-armed when the sweep ends
+
+    uint16_t refresh_sec = lcc_node_get_stale_timeout_sec();
+    if (refresh_sec == 0) {
+        scheduler_cancel(SCHEDULER_REFRESH);
+        return;
+    }
+    scheduler_at(SCHEDULER_REFRESH, s_sweep_started_us + (int64_t)refresh_sec * 1000000);
+}
+
+/**
+ * @brief Start a state query sweep unless one is running
+ */
+static void start_sweep(void)
+{
+    if (s_sweep_running) return;
+
+    s_sweep_started_us = esp_timer_get_time();
+    if (lcc_node_get_status() != LCC_STATUS_RUNNING) {
+        schedule_refresh();
+        return;
+    }
+    if (xTaskCreate(sweep_task, "lcc_sweep", SWEEP_TASK_STACK, NULL,
+                    SWEEP_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGW(TAG, "Could not start the state query sweep");
+        schedule_refresh();
+        return;
+    }
+    s_sweep_running = true;
+}
+
+/**
+ * @brief Mark expired turnouts STALE and arm the next expiry (FR-023)
+ *
+ * A turnout is re-queried at least once per refresh interval, or once per
+ * sweep when a sweep takes longer, so it goes stale after
+ * STALE_REFRESH_PERIODS of those without an update.  A refresh interval of
+ * 0 disables both.
+ */
+static void check_stale(void)
+{
+    uint32_t refresh_ms = (uint32_t)lcc_node_get_stale_timeout_sec() * 1000;
+    if (refresh_ms == 0) {
+        scheduler_cancel(SCHEDULER_STALE);
+        return;
+    }
+
+    lcc_node_stats_t stats;
+    lcc_node_get_stats(&stats);
+    uint32_t period_ms = refresh_ms > stats.turnout_sweep_ms ? refresh_ms : stats.turnout_sweep_ms;
+    uint32_t stale_ms = STALE_REFRESH_PERIODS * period_ms;
+
+    int64_t next = turnout_manager_check_stale(stale_ms);
+    if (next >= 0) {
+        scheduler_at(SCHEDULER_STALE, next);
+    } else {
+        // Nothing can expire sooner than a state received from now on
+        scheduler_after_ms(SCHEDULER_STALE, stale_ms);
     }
 }
 
@@ -261,6 +372,9 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+    /* ---- Pipeline trace ring (Diagnostics config) ---- */
+    trace_init();
+
     /* ---- Hardware (I2C, CH422G, SD, LCD, Touch) ---- */
     ret = init_hardware();
     if (ret != ESP_OK) {
@@ -272,6 +386,12 @@ void app_main(void)
         ui_splash_show_sd_error();   /* never returns */
     }
 
+    /* ---- SD card I/O service (owns the card from here on) ---- */
+    ret = sd_io_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "SD I/O service init failed: %s", esp_err_to_name(ret));
+    }
+
     /* ---- Turnout manager (loads turnouts.json) ---- */
     ret = turnout_manager_init();
     if (ret != ESP_OK) {
@@ -279,6 +399,7 @@ void app_main(void)
     } else {
         ESP_LOGI(TAG, "Loaded %d turnouts", (int)turnout_manager_get_count());
     }
+    turnout_stress_run();
 
     /* ---- Panel layout (loads panel.json) ---- */
     panel_layout_t *layout = panel_layout_get();
@@ -289,9 +410,18 @@ void app_main(void)
         ESP_LOGI(TAG, "Panel layout: %d items, %d tracks",
                  (int)layout->item_count, (int)layout->track_count);
     }
+    panel_history_init();
+    route_bench_run();
+    app_bench_run();
+
+    /* ---- Occupancy blocks (defined in panel.json) ---- */
+    if (block_manager_init() == ESP_OK) {
+        block_manager_sync(layout);
+    }
 
     /* ---- Wire up cross-module callbacks ---- */
     turnout_manager_set_state_callback(turnout_state_changed_cb);
+    block_manager_set_state_callback(block_state_changed_cb);
     lcc_node_set_discovery_callback(discovery_cb);
 
     /* ---- Splash image (direct framebuffer, pre-LVGL) ---- */
@@ -326,39 +456,67 @@ void app_main(void)
         while (1) vTaskDelay(pdMS_TO_TICKS(5000));
     }
 
+    mem_budget_checkpoint(MEM_CP_BOOT, 0);
+    render_bench_run();
+    churn_bench_run();
     ui_show_main();
+    mem_budget_nav_soak();
 
-    if (lcc_node_get_status() == LCC_STATUS_RUNNING) {
-        lcc_node_query_all_turnout_states();
-    }
+    occupancy_load_start();
+    bus_load_start();
 
     ESP_LOGI(TAG, "Init complete — entering main loop");
 
     /* ---- Main loop ---- */
-    TickType_t last_status  = xTaskGetTickCount();
-    TickType_t last_refresh = xTaskGetTickCount();
+    ESP_ERROR_CHECK(scheduler_init());
+    scheduler_kick(SCHEDULER_SCREEN);
+    scheduler_kick(SCHEDULER_REFRESH);      // initial state query
+    scheduler_after_ms(SCHEDULER_TELEMETRY, STATUS_LOG_MS);
 
     while (1) {
-        screen_timeout_tick();
-        vTaskDelay(pdMS_TO_TICKS(500));
-
-        /* Periodic state re-query (stale timeout interval) */
-        uint16_t refresh_sec = lcc_node_get_stale_timeout_sec();
-        if (refresh_sec > 0 &&
-            (xTaskGetTickCount() - last_refresh) >=
-                pdMS_TO_TICKS((uint32_t)refresh_sec * 1000)) {
-            last_refresh = xTaskGetTickCount();
-            lcc_node_query_all_turnout_states();
-        }
+        uint32_t due = scheduler_wait();
 
-        /* Heartbeat status log every 30 s */
-        if ((xTaskGetTickCount() - last_status) >= pdMS_TO_TICKS(30000)) {
-            last_status = xTaskGetTickCount();
-            ESP_LOGI(TAG, "heap=%lu LCC=%s screen=%s turnouts=%d",
+        if (due & SCHEDULER_BIT(SCHEDULER_CONFIG)) {
+            screen_timeout_set_duration(lcc_node_get_screen_timeout_sec());
+            schedule_refresh();
+            due |= SCHEDULER_BIT(SCHEDULER_STALE);
+        }
+        if (due & SCHEDULER_BIT(SCHEDULER_SCREEN)) {
+            screen_timeout_tick();
+            int64_t deadline = screen_timeout_next_deadline_us();
+            if (deadline >= 0) {
+                scheduler_at(SCHEDULER_SCREEN, deadline);
+            } else {
+                scheduler_cancel(SCHEDULER_SCREEN);
+            }
+        }
+        if (due & SCHEDULER_BIT(SCHEDULER_REFRESH)) {
+            start_sweep();
+        }
+        if (due & SCHEDULER_BIT(SCHEDULER_SWEEP_DONE)) {
+            s_sweep_running = false;
+            schedule_refresh();
+            due |= SCHEDULER_BIT(SCHEDULER_STALE);
+        }
+        if (due & SCHEDULER_BIT(SCHEDULER_STALE)) {
+            check_stale();
+        }
+        if (due & SCHEDULER_BIT(SCHEDULER_TELEMETRY)) {
+            scheduler_after_ms(SCHEDULER_TELEMETRY, STATUS_LOG_MS);
+            sd_io_stats_t sd;
+            sd_io_get_stats(&sd);
+            ESP_LOGI(TAG, "heap=%lu LCC=%s screen=%s turnouts=%d wakeups=%lu "
+                     "sd=%lu/%lu done, %lu merged, max wait %lu/%lu us",
                      esp_get_free_heap_size(),
                      lcc_node_get_status() == LCC_STATUS_RUNNING ? "ok" : "off",
                      screen_timeout_is_screen_on() ? "on" : "off",
-                     (int)turnout_manager_get_count());
+                     (int)turnout_manager_get_count(),
+                     (unsigned long)scheduler_get_wakeups(),
+                     (unsigned long)sd.prio[SD_IO_PRIO_HIGH].completed,
+                     (unsigned long)sd.prio[SD_IO_PRIO_LOW].completed,
+                     (unsigned long)(sd.prio[SD_IO_PRIO_HIGH].merged + sd.prio[SD_IO_PRIO_LOW].merged),
+                     (unsigned long)sd.prio[SD_IO_PRIO_HIGH].wait_max_us,
+                     (unsigned long)sd.prio[SD_IO_PRIO_LOW].wait_max_us);
         }
     }
 }
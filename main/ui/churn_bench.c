@@ -0,0 +1,166 @@
+/**
+ * @file churn_bench.c
+ * @brief LVGL allocator churn benchmark
+ *
+ * The mix keeps up to MIX_SLOTS blocks live and picks a slot per
+ * operation: an empty slot is allocated, a full one is resized one time in
+ * eight and freed otherwise.  Sizes follow what LVGL asks for: mostly
+ * objects, style properties and timers, some widgets and label text, and a
+ * few child arrays and draw buffers.  The seed is fixed, so every build
+ * replays the same sequence.
+ *
+ * The widget cycles build off-screen, so no frame is rendered and only
+ * object creation, styling and deletion are timed.  As in the memory
+ * budget soak, the first cycle sets the baseline for the growth check,
+ * after first-use allocations.  The UI lock is held throughout.
+ */
+
+#include "churn_bench.h"
+#include "lvgl_alloc.h"
+#include "ui_common.h"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "churn_bench";
+
+#if CONFIG_LVGL_CHURN_CYCLES > 0
+
+#define MIX_SLOTS       256         ///< Live blocks at most (~35 KB on average)
+#define MIX_OPS         20000
+#define MIX_SEED        0x2545F491u
+#define WIDGETS         100         ///< Buttons per widget cycle
+#define LEAK_BYTES      256         ///< Heap growth over the cycles
+
+static uint32_t s_rng;
+
+static uint32_t rng(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+/** @brief Request size with LVGL's profile */
+static size_t mix_size(void)
+{
+    uint32_t r = rng() % 100;
+    if (r < 60) return 8 + rng() % 57;          // objects, style properties, timers
+    if (r < 90) return 65 + rng() % 192;        // widgets, label text
+    return 257 + rng() % 3840;                  // child arrays, draw scratch buffers
+}
+
+static const char *allocator_name(void)
+{
+#if CONFIG_LVGL_POOL_ALLOC
+    return "size-class pools + PSRAM";
+#elif LV_MEM_CUSTOM == 0
+    return "LVGL built-in pool";
+#else
+    return "system malloc";
+#endif
+}
+
+static void run_mix(void)
+{
+    void **slots = calloc(MIX_SLOTS, sizeof(void *));
+    if (!slots) return;
+
+    uint32_t allocs = 0, reallocs = 0, frees = 0, failed = 0;
+    s_rng = MIX_SEED;
+    int64_t t0 = esp_timer_get_time();
+    for (int op = 0; op < MIX_OPS; op++) {
+        uint32_t i = rng() % MIX_SLOTS;
+        if (!slots[i]) {
+            size_t size = mix_size();
+            slots[i] = lv_mem_alloc(size);
+            if (slots[i]) {
+                memset(slots[i], 0xA5, size < 16 ? size : 16);
+                allocs++;
+            } else {
+                failed++;
+            }
+        } else if (rng() % 8 == 0) {
+            void *p = lv_mem_realloc(slots[i], mix_size());
+            if (p) {
+                slots[i] = p;
+                reallocs++;
+            } else {
+                failed++;
+            }
+        } else {
+            lv_mem_free(slots[i]);
+            slots[i] = NULL;
+            frees++;
+        }
+    }
+    int64_t us = esp_timer_get_time() - t0;
+
+    lv_mem_monitor_t mon;
+    lvgl_alloc_monitor(&mon);
+    for (int i = 0; i < MIX_SLOTS; i++) lv_mem_free(slots[i]);
+    free(slots);
+
+    ESP_LOGI(TAG, "mix: %d ops (%u alloc, %u realloc, %u free, %u failed) in %d us, "
+             "%d ns/op; %d KB live at the end, frag %d%%",
+             MIX_OPS, (unsigned)allocs, (unsigned)reallocs, (unsigned)frees,
+             (unsigned)failed, (int)us, (int)(us * 1000 / MIX_OPS),
+             (int)((mon.total_size - mon.free_size) / 1024), (int)mon.frag_pct);
+}
+
+static void run_widgets(int cycles)
+{
+    lv_mem_monitor_t first = { 0 }, last;
+    int64_t total_us = 0;
+    uint32_t worst_us = 0;
+
+    for (int c = 0; c < cycles; c++) {
+        int64_t t0 = esp_timer_get_time();
+        lv_obj_t *scr = lv_obj_create(NULL);
+        for (int w = 0; w < WIDGETS; w++) {
+            lv_obj_t *btn = lv_btn_create(scr);
+            lv_obj_set_pos(btn, (w % 10) * 80, (w / 10) * 48);
+            lv_obj_set_size(btn, 76, 44);
+            lv_obj_set_style_bg_color(btn, lv_color_hex(0x2196F3 + w), LV_PART_MAIN);
+            lv_obj_t *label = lv_label_create(btn);
+            lv_label_set_text_fmt(label, "T%d", c * WIDGETS + w);
+            lv_obj_center(label);
+        }
+        lv_obj_del(scr);
+        uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        total_us += us;
+        if (us > worst_us) worst_us = us;
+        if (c == 0) lvgl_alloc_monitor(&first);
+    }
+    lvgl_alloc_monitor(&last);
+
+    int32_t growth = (int32_t)((last.total_size - last.free_size) -
+                               (first.total_size - first.free_size));
+    ESP_LOGI(TAG, "widgets: %d cycles of %d buttons, %d us avg / %d us max per cycle; "
+             "peak %d KB, frag %d%%, growth %+d B",
+             cycles, WIDGETS, (int)(total_us / cycles), (int)worst_us,
+             (int)(last.max_used / 1024), (int)last.frag_pct, (int)growth);
+    if (cycles > 1 && growth > LEAK_BYTES) {
+        ESP_LOGE(TAG, "Possible leak: LVGL heap grew %d B over %d cycles",
+                 (int)growth, cycles - 1);
+    }
+}
+
+#endif
+
+void churn_bench_run(void)
+{
+#if CONFIG_LVGL_CHURN_CYCLES > 0
+    ESP_LOGI(TAG, "Allocator: %s", allocator_name());
+    ui_lock();
+    run_mix();
+    run_widgets(CONFIG_LVGL_CHURN_CYCLES);
+    ui_unlock();
+#if CONFIG_LVGL_POOL_ALLOC
+    lvgl_alloc_dump();
+#endif
+#endif
+}
@@ -0,0 +1,34 @@
+/**
+ * @file churn_bench.h
+ * @brief LVGL allocator churn benchmark
+ *
+ * Enabled by CONFIG_LVGL_CHURN_CYCLES (menuconfig → Diagnostics).  Right
+ * after LVGL starts, a fixed pseudo-random mix of allocations, resizes and
+ * frees with LVGL's size profile is replayed through lv_mem_alloc(), and a
+ * screen of styled buttons is built and deleted the configured number of
+ * times.  Time per operation and per cycle, heap use, peak, fragmentation
+ * and growth over the cycles are logged.  The benchmark runs against
+ * whichever allocator is built, so CONFIG_LVGL_POOL_ALLOC on and off are
+ * compared across two builds.
+ */
+
+#ifndef CHURN_BENCH_H_
+#define CHURN_BENCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Run the benchmark
+ *
+ * Call after ui_init() and before ui_show_main().  Nothing is shown on the
+ * display.  Does nothing when the option is 0.
+ */
+void churn_bench_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHURN_BENCH_H_
@@ -0,0 +1,380 @@
+/**
+ * @file lvgl_alloc.c
+ * @brief LVGL allocator: size-class pools in internal RAM, large blocks in PSRAM
+ *
+ * The arena is cut into SLAB_SIZE slabs.  A slab belongs to one size class
+ * while any of its blocks is in use and goes back to the shared free-slab
+ * stack when the last one is freed, so a screen of labels can reuse the
+ * slabs a screen of buttons left behind.  Freeing a pool block needs no
+ * header: the slab index is the block's offset in the arena.  Heap blocks
+ * carry an 8-byte header with their size.
+ *
+ * lv_async_call() reaches the allocator from the LCC executor and the SD
+ * task without the UI lock, so the pool operations run under a spinlock.
+ * They are a few loads and stores; the heap calls run outside it.
+ */
+
+#include "lvgl_alloc.h"
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "lvgl_alloc";
+
+#if CONFIG_LVGL_POOL_ALLOC
+
+#define SLAB_SIZE       2048
+#define SLAB_COUNT      (CONFIG_LVGL_POOL_KB * 1024 / SLAB_SIZE)
+#define SLAB_FREE       0xFF            ///< cls of a slab no class owns
+#define LIST_END        (-1)
+#define LARGE_MAGIC     0x4C564C41u     ///< "LVLA"
+
+static const uint16_t s_class_size[LVGL_ALLOC_CLASSES] = {
+    8, 16, 24, 32, 40, 48, 64, 80, 96, 128, 160, 192, 256,
+};
+
+/// Size class of a request, indexed by (size + 7) / 8
+static uint8_t s_class_of[LVGL_ALLOC_SMALL_MAX / 8 + 1];
+
+typedef struct {
+    uint8_t  cls;               ///< Owning class, or SLAB_FREE
+    uint16_t used;              ///< Blocks handed out
+    uint16_t fresh;             ///< Blocks carved so far (the rest were never used)
+    int16_t  prev, next;        ///< Class partial list; next also links free slabs
+    void    *free;              ///< Freed blocks, linked through their first word
+} slab_t;
+
+/// In front of every heap block
+typedef struct {
+    uint32_t size;              ///< Usable bytes
+    uint32_t magic;
+} large_hdr_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t *s_arena = NULL;
+static uint8_t *s_arena_end = NULL;
+static slab_t s_slabs[SLAB_COUNT];
+static int16_t s_free_slabs = LIST_END;
+static int16_t s_partial[LVGL_ALLOC_CLASSES];   ///< Owned slabs with a free block
+static lvgl_alloc_stats_t s_stats;
+
+static inline bool in_arena(const void *p)
+{
+    return (const uint8_t *)p >= s_arena && (const uint8_t *)p < s_arena_end;
+}
+
+static inline uint16_t blocks_per_slab(int cls)
+{
+    return SLAB_SIZE / s_class_size[cls];
+}
+
+static void note_used(void)
+{
+    s_stats.used = s_stats.pool_used + s_stats.large_used;
+    if (s_stats.used > s_stats.peak) s_stats.peak = s_stats.used;
+}
+
+// ============================================================================
+// Pools (s_lock held)
+// ============================================================================
+
+static void partial_push(int cls, int i)
+{
+    s_slabs[i].prev = LIST_END;
+    s_slabs[i].next = s_partial[cls];
+    if (s_partial[cls] != LIST_END) s_slabs[s_partial[cls]].prev = i;
+    s_partial[cls] = i;
+}
+
+static void partial_unlink(int cls, int i)
+{
+    slab_t *s = &s_slabs[i];
+    if (s->prev != LIST_END) s_slabs[s->prev].next = s->next;
+    else s_partial[cls] = s->next;
+    if (s->next != LIST_END) s_slabs[s->next].prev = s->prev;
+}
+
+static void *pool_alloc(size_t size)
+{
+    int cls = s_class_of[(size + 7) / 8];
+    int i = s_partial[cls];
+    if (i == LIST_END) {
+        i = s_free_slabs;
+        if (i == LIST_END) return NULL;
+        s_free_slabs = s_slabs[i].next;
+        slab_t *s = &s_slabs[i];
+        s->cls = (uint8_t)cls;
+        s->used = 0;
+        s->fresh = 0;
+        s->free = NULL;
+        partial_push(cls, i);
+        s_stats.slabs_used++;
+        s_stats.classes[cls].slabs++;
+    }
+
+    slab_t *s = &s_slabs[i];
+    uint16_t bsize = s_class_size[cls];
+    void *p;
+    if (s->free) {
+        p = s->free;
+        s->free = *(void **)p;
+    } else {
+        p = s_arena + (size_t)i * SLAB_SIZE + (size_t)s->fresh * bsize;
+        s->fresh++;
+    }
+    if (++s->used == blocks_per_slab(cls)) partial_unlink(cls, i);
+
+    lvgl_alloc_class_t *c = &s_stats.classes[cls];
+    c->allocs++;
+    if (++c->live > c->peak) c->peak = c->live;
+    s_stats.pool_used += bsize;
+    note_used();
+    return p;
+}
+
+static void pool_free(void *p)
+{
+    int i = (int)(((uint8_t *)p - s_arena) / SLAB_SIZE);
+    slab_t *s = &s_slabs[i];
+    int cls = s->cls;
+    bool was_full = s->used == blocks_per_slab(cls);
+
+    *(void **)p = s->free;
+    s->free = p;
+    s->used--;
+    s_stats.classes[cls].live--;
+    s_stats.pool_used -= s_class_size[cls];
+    note_used();
+
+    if (s->used == 0) {
+        // Hand the slab back for any class
+        if (!was_full) partial_unlink(cls, i);
+        s->cls = SLAB_FREE;
+        s->next = s_free_slabs;
+        s_free_slabs = i;
+        s_stats.slabs_used--;
+        s_stats.classes[cls].slabs--;
+    } else if (was_full) {
+        partial_push(cls, i);
+    }
+}
+
+// ============================================================================
+// Heap blocks
+// ============================================================================
+
+static void *heap_alloc(size_t size)
+{
+    large_hdr_t *h = heap_caps_malloc(sizeof(*h) + size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!h) h = heap_caps_malloc(sizeof(*h) + size, MALLOC_CAP_8BIT);
+    if (!h) return NULL;
+    h->size = (uint32_t)size;
+    h->magic = LARGE_MAGIC;
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.large_used += h->size;
+    s_stats.large_count++;
+    note_used();
+    portEXIT_CRITICAL(&s_lock);
+    return h + 1;
+}
+
+static void heap_free(void *p)
+{
+    large_hdr_t *h = (large_hdr_t *)p - 1;
+    if (h->magic != LARGE_MAGIC) {
+        ESP_LOGE(TAG, "free of %p: not an LVGL block, leaked", p);
+        return;
+    }
+    h->magic = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.large_used -= h->size;
+    s_stats.large_count--;
+    note_used();
+    portEXIT_CRITICAL(&s_lock);
+    heap_caps_free(h);
+}
+
+static size_t block_size(const void *p)
+{
+    if (in_arena(p)) {
+        return s_class_size[s_slabs[((const uint8_t *)p - s_arena) / SLAB_SIZE].cls];
+    }
+    return ((const large_hdr_t *)p - 1)->size;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void lvgl_alloc_init(void)
+{
+    if (s_arena) return;
+
+    for (size_t i = 0, c = 0; i < sizeof(s_class_of); i++) {
+        while (s_class_size[c] < i * 8) c++;
+        s_class_of[i] = (uint8_t)c;
+    }
+    for (int c = 0; c < LVGL_ALLOC_CLASSES; c++) {
+        s_partial[c] = LIST_END;
+        s_stats.classes[c].size = s_class_size[c];
+    }
+
+    uint8_t *arena = heap_caps_aligned_alloc(8, SLAB_COUNT * SLAB_SIZE,
+                                             MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!arena) {
+        ESP_LOGE(TAG, "No internal RAM for a %d KB arena; LVGL uses the PSRAM heap",
+                 CONFIG_LVGL_POOL_KB);
+        return;
+    }
+    for (int i = 0; i < SLAB_COUNT; i++) {
+        s_slabs[i].cls = SLAB_FREE;
+        s_slabs[i].next = i + 1 < SLAB_COUNT ? i + 1 : LIST_END;
+    }
+    s_free_slabs = 0;
+    s_stats.arena_size = SLAB_COUNT * SLAB_SIZE;
+    s_stats.slab_size = SLAB_SIZE;
+    s_arena_end = arena + SLAB_COUNT * SLAB_SIZE;
+    s_arena = arena;
+    ESP_LOGI(TAG, "%d KB arena: %d slabs of %d B, %d classes up to %d B; larger in PSRAM",
+             CONFIG_LVGL_POOL_KB, SLAB_COUNT, SLAB_SIZE, LVGL_ALLOC_CLASSES,
+             LVGL_ALLOC_SMALL_MAX);
+}
+
+void *lvgl_alloc_malloc(size_t size)
+{
+    if (size == 0) size = 1;
+
+    if (size <= LVGL_ALLOC_SMALL_MAX && s_arena) {
+        portENTER_CRITICAL(&s_lock);
+        void *p = pool_alloc(size);
+        if (!p) s_stats.fallbacks++;
+        portEXIT_CRITICAL(&s_lock);
+        if (p) return p;
+    }
+
+    void *p = heap_alloc(size);
+    if (!p) {
+        portENTER_CRITICAL(&s_lock);
+        s_stats.failures++;
+        portEXIT_CRITICAL(&s_lock);
+    }
+    return p;
+}
+
+void lvgl_alloc_free(void *ptr)
+{
+    if (!ptr) return;
+    if (in_arena(ptr)) {
+        portENTER_CRITICAL(&s_lock);
+        pool_free(ptr);
+        portEXIT_CRITICAL(&s_lock);
+    } else {
+        heap_free(ptr);
+    }
+}
+
+void *lvgl_alloc_realloc(void *ptr, size_t size)
+{
+    if (!ptr) return lvgl_alloc_malloc(size);
+    if (size == 0) {
+        lvgl_alloc_free(ptr);
+        return NULL;
+    }
+
+    // Stay put while the block fits and is not mostly slack
+    size_t old = block_size(ptr);
+    if (in_arena(ptr)) {
+        if (size <= LVGL_ALLOC_SMALL_MAX && s_class_size[s_class_of[(size + 7) / 8]] == old) {
+            return ptr;
+        }
+    } else if (size <= old && size > old / 2 && size > LVGL_ALLOC_SMALL_MAX) {
+        return ptr;
+    }
+
+    void *p = lvgl_alloc_malloc(size);
+    if (!p) return NULL;     // the old block stays valid
+    memcpy(p, ptr, size < old ? size : old);
+    lvgl_alloc_free(ptr);
+    return p;
+}
+
+void lvgl_alloc_get_stats(lvgl_alloc_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+
+    out->pool_stranded = out->slabs_used * SLAB_SIZE - out->pool_used;
+    uint32_t pool_free = out->arena_size - out->pool_used;
+    out->pool_frag_pct = pool_free ? (uint8_t)((uint64_t)out->pool_stranded * 100 / pool_free) : 0;
+
+    size_t free_b = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    size_t big = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+    out->large_frag_pct = free_b ? (uint8_t)(100 - (uint64_t)big * 100 / free_b) : 0;
+}
+
+void lvgl_alloc_dump(void)
+{
+    lvgl_alloc_stats_t st;
+    lvgl_alloc_get_stats(&st);
+    ESP_LOGI(TAG, "pools %u / %u KB in %u slabs (%u%% of free pool stranded), "
+             "heap %u KB in %u blocks (PSRAM frag %u%%), peak %u KB, "
+             "%u fallbacks, %u failures",
+             (unsigned)(st.pool_used / 1024), (unsigned)(st.arena_size / 1024),
+             (unsigned)st.slabs_used, (unsigned)st.pool_frag_pct,
+             (unsigned)(st.large_used / 1024), (unsigned)st.large_count,
+             (unsigned)st.large_frag_pct, (unsigned)(st.peak / 1024),
+             (unsigned)st.fallbacks, (unsigned)st.failures);
+    for (int c = 0; c < LVGL_ALLOC_CLASSES; c++) {
+        const lvgl_alloc_class_t *cl = &st.classes[c];
+        if (cl->allocs == 0) continue;
+        ESP_LOGI(TAG, "  %3u B: %5u live (peak %5u) in %3u slabs, %u allocs",
+                 (unsigned)cl->size, (unsigned)cl->live, (unsigned)cl->peak,
+                 (unsigned)cl->slabs, (unsigned)cl->allocs);
+    }
+}
+
+#else
+
+void lvgl_alloc_init(void)
+{
+}
+
+void lvgl_alloc_get_stats(lvgl_alloc_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+}
+
+void lvgl_alloc_dump(void)
+{
+    ESP_LOGI(TAG, "LVGL pool allocator disabled (CONFIG_LVGL_POOL_ALLOC)");
+}
+
+#endif
+
+void lvgl_alloc_monitor(lv_mem_monitor_t *mon)
+{
+#if LV_MEM_CUSTOM == 0
+    lv_mem_monitor(mon);
+#elif CONFIG_LVGL_POOL_ALLOC
+    lvgl_alloc_stats_t st;
+    lvgl_alloc_get_stats(&st);
+    memset(mon, 0, sizeof(*mon));
+    mon->total_size = st.arena_size + st.large_used;
+    mon->free_size = st.arena_size - st.pool_used;
+    mon->free_biggest_size = st.slabs_used * st.slab_size < st.arena_size ? st.slab_size : 0;
+    mon->used_cnt = st.large_count;
+    for (int c = 0; c < LVGL_ALLOC_CLASSES; c++) mon->used_cnt += st.classes[c].live;
+    mon->max_used = st.peak;
+    mon->used_pct = mon->total_size
+                  ? (uint8_t)((uint64_t)st.used * 100 / mon->total_size) : 0;
+    mon->frag_pct = st.pool_frag_pct;
+#else
+    memset(mon, 0, sizeof(*mon));   // LVGL on the system allocator
+#endif
+}
@@ -0,0 +1,100 @@
+/**
+ * @file lvgl_alloc.h
+ * @brief LVGL allocator: size-class pools in internal RAM, large blocks in PSRAM
+ *
+ * Enabled by CONFIG_LVGL_POOL_ALLOC (menuconfig → LVGL Settings), which
+ * makes lv_conf.h route LVGL's allocations here instead of its fixed
+ * LV_MEM_SIZE pool.  Requests up to LVGL_ALLOC_SMALL_MAX bytes — objects,
+ * styles, labels' text, timers — come from per-size-class slabs carved out
+ * of one internal RAM arena; larger ones (draw scratch buffers, child and
+ * style arrays of big screens) go to the PSRAM heap.
+ *
+ * lvgl_alloc_monitor() fills an lv_mem_monitor_t from whichever allocator
+ * is built, so the diagnostics read one API.
+ */
+
+#ifndef LVGL_ALLOC_H_
+#define LVGL_ALLOC_H_
+
+#include "lvgl.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Largest request served from the size-class pools
+#define LVGL_ALLOC_SMALL_MAX    256
+
+/// Number of size classes (8 to LVGL_ALLOC_SMALL_MAX bytes)
+#define LVGL_ALLOC_CLASSES      13
+
+/** @brief One size class */
+typedef struct {
+    uint16_t size;              ///< Block size (bytes)
+    uint16_t slabs;             ///< Slabs held now
+    uint32_t live;              ///< Blocks in use
+    uint32_t peak;              ///< Most blocks in use at once
+    uint32_t allocs;            ///< Blocks handed out since boot
+} lvgl_alloc_class_t;
+
+/** @brief Allocator statistics (bytes unless noted) */
+typedef struct {
+    uint32_t arena_size;        ///< Internal RAM arena for the pools
+    uint32_t slab_size;
+    uint32_t slabs_used;        ///< Slabs owned by a class
+    uint32_t pool_used;         ///< Block bytes in use in the pools
+    uint32_t pool_stranded;     ///< Free block bytes inside owned slabs
+    uint32_t large_used;        ///< Requested bytes in heap blocks
+    uint32_t large_count;       ///< Heap blocks live
+    uint32_t used;              ///< pool_used + large_used
+    uint32_t peak;              ///< Highest @c used since boot
+    uint32_t fallbacks;         ///< Small requests sent to the heap (pools full)
+    uint32_t failures;          ///< Requests nothing could serve
+    uint8_t  pool_frag_pct;     ///< Free pool memory only one class can use
+    uint8_t  large_frag_pct;    ///< PSRAM heap: 100 - largest block / free
+    lvgl_alloc_class_t classes[LVGL_ALLOC_CLASSES];
+} lvgl_alloc_stats_t;
+
+/**
+ * @brief Reserve the pool arena; call before lv_init()
+ *
+ * Without it (or if the arena cannot be allocated) every request goes to
+ * the heap.  Does nothing when CONFIG_LVGL_POOL_ALLOC is off.
+ */
+void lvgl_alloc_init(void);
+
+/** @brief LV_MEM_CUSTOM_ALLOC (any task; pool operations hold a spinlock) */
+void *lvgl_alloc_malloc(size_t size);
+
+/** @brief LV_MEM_CUSTOM_FREE */
+void lvgl_alloc_free(void *ptr);
+
+/** @brief LV_MEM_CUSTOM_REALLOC */
+void *lvgl_alloc_realloc(void *ptr, size_t size);
+
+/**
+ * @brief Snapshot the statistics
+ *
+ * Zeroed when CONFIG_LVGL_POOL_ALLOC is off.
+ */
+void lvgl_alloc_get_stats(lvgl_alloc_stats_t *out);
+
+/**
+ * @brief lv_mem_monitor() for either allocator
+ *
+ * With the pools: total is the arena plus live heap blocks, free is the
+ * arena not in use, and frag_pct is the pools' fragmentation.  Call with
+ * the UI lock held, as for lv_mem_monitor().
+ */
+void lvgl_alloc_monitor(lv_mem_monitor_t *mon);
+
+/** @brief Log the statistics and every size class */
+void lvgl_alloc_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LVGL_ALLOC_H_
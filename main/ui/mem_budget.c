@@ -0,0 +1,188 @@
+/**
+ * @file mem_budget.c
+ * @brief Memory budget checkpoints per screen and per feature
+ *
+ * The budgets are ceilings for regressions, not measurements: the LVGL
+ * heap per screen as a share of its size, an internal RAM floor
+ * (CONFIG_MEM_BUDGET_INTERNAL_KB) and a DMA block large enough for an SD
+ * transfer.  A miss is logged as an error and counted in the soak summary.
+ *
+ * The leak check compares the snapshot after the first soak cycle, once
+ * first-use allocations (fonts, styles, timers) are done, with the one
+ * after the last cycle.  The LCC executor keeps running during the soak,
+ * so the heap tolerances allow for its allocations; the LVGL pool is only
+ * touched under the UI lock and gets a tight one.
+ *
+ * The LVGL heap's size is lvgl_alloc_monitor()'s total: LV_MEM_SIZE for
+ * LVGL's own pool, or the pool allocator's arena plus the PSRAM blocks it
+ * holds (CONFIG_LVGL_POOL_ALLOC).  LVGL on the system allocator reports
+ * no size, and its budget is not checked.
+ */
+
+#include "mem_budget.h"
+#include "ui_common.h"
+#include "lvgl_alloc.h"
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+
+static const char *TAG = "mem_budget";
+
+#define BUDGET_DMA_BLOCK        (8 * 1024)   ///< Smallest acceptable DMA block
+#define LEAK_LVGL_BYTES         256          ///< LVGL pool growth over the soak
+#define LEAK_INTERNAL_BYTES     (2 * 1024)   ///< Internal RAM loss over the soak
+#define LEAK_PSRAM_BYTES        (8 * 1024)   ///< PSRAM loss over the soak
+#define SOAK_SETTLE_MS          30           ///< Let LVGL render between screens
+
+typedef struct {
+    const char *name;
+    uint8_t lvgl_pct;       ///< LVGL heap ceiling, % of its size
+} budget_t;
+
+static const budget_t s_budgets[MEM_CP_COUNT] = {
+    [MEM_CP_BOOT]     = { "boot",     10 },
+    [MEM_CP_PANEL]    = { "panel",    60 },
+    [MEM_CP_SETTINGS] = { "settings", 85 },
+    [MEM_CP_BUILDER]  = { "builder",  80 },
+    [MEM_CP_NAV_SOAK] = { "nav soak", 60 },
+};
+
+/// Worst value seen per checkpoint, for the soak summary
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t lvgl_used_max;
+    uint32_t internal_free_min;
+} cp_stats_t;
+
+static cp_stats_t s_stats[MEM_CP_COUNT];
+static bool s_quiet = false;    ///< Soak in progress: log misses only
+static uint32_t s_leaks = 0;    ///< Soaks that flagged a possible leak
+
+void mem_budget_snapshot(mem_snapshot_t *out)
+{
+    out->internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    out->internal_min = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    out->dma_largest = heap_caps_get_largest_free_block(MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    out->psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    lv_mem_monitor_t mon;
+    ui_lock();
+    lvgl_alloc_monitor(&mon);
+    ui_unlock();
+    out->lvgl_size = (uint32_t)mon.total_size;
+    out->lvgl_used = (uint32_t)(mon.total_size - mon.free_size);
+    out->lvgl_peak = (uint32_t)mon.max_used;
+    out->lvgl_frag = mon.frag_pct;
+}
+
+void mem_budget_checkpoint(mem_checkpoint_t cp, size_t items)
+{
+    if (cp >= MEM_CP_COUNT) return;
+    const budget_t *b = &s_budgets[cp];
+    mem_snapshot_t m;
+    mem_budget_snapshot(&m);
+
+    cp_stats_t *st = &s_stats[cp];
+    if (st->hits == 0 || m.lvgl_used > st->lvgl_used_max) st->lvgl_used_max = m.lvgl_used;
+    if (st->hits == 0 || m.internal_free < st->internal_free_min) st->internal_free_min = m.internal_free;
+    st->hits++;
+
+    if (!s_quiet) {
+        ESP_LOGI(TAG, "%-8s %3d items: internal %d KB (min %d KB, DMA block %d KB), "
+                 "PSRAM %d KB, LVGL %d KB (peak %d KB, frag %d%%)",
+                 b->name, (int)items, (int)(m.internal_free / 1024),
+                 (int)(m.internal_min / 1024), (int)(m.dma_largest / 1024),
+                 (int)(m.psram_free / 1024), (int)(m.lvgl_used / 1024),
+                 (int)(m.lvgl_peak / 1024), (int)m.lvgl_frag);
+    }
+
+    bool miss = false;
+    uint32_t lvgl_budget = (uint32_t)((uint64_t)m.lvgl_size * b->lvgl_pct / 100);
+    if (m.lvgl_size > 0 && m.lvgl_used > lvgl_budget) {
+        ESP_LOGE(TAG, "%s: LVGL heap %d B over budget %d B (%d%% of %d B)",
+                 b->name, (int)m.lvgl_used, (int)lvgl_budget, (int)b->lvgl_pct,
+                 (int)m.lvgl_size);
+        miss = true;
+    }
+    if (m.internal_free < CONFIG_MEM_BUDGET_INTERNAL_KB * 1024) {
+        ESP_LOGE(TAG, "%s: internal RAM %d KB free, budget floor %d KB",
+                 b->name, (int)(m.internal_free / 1024), CONFIG_MEM_BUDGET_INTERNAL_KB);
+        miss = true;
+    }
+    if (m.dma_largest < BUDGET_DMA_BLOCK) {
+        ESP_LOGE(TAG, "%s: largest DMA block %d B, need %d B",
+                 b->name, (int)m.dma_largest, BUDGET_DMA_BLOCK);
+        miss = true;
+    }
+    if (miss) st->misses++;
+}
+
+void mem_budget_feature(const char *name, size_t items, mem_snapshot_t *since)
+{
+    mem_snapshot_t now;
+    mem_budget_snapshot(&now);
+    if (!s_quiet) {
+        int32_t added = (int32_t)(now.lvgl_used - since->lvgl_used);
+        if (items > 0) {
+            ESP_LOGI(TAG, "  %-10s LVGL %+6d B for %d items (%d B/item)",
+                     name, (int)added, (int)items, (int)(added / (int32_t)items));
+        } else {
+            ESP_LOGI(TAG, "  %-10s LVGL %+6d B", name, (int)added);
+        }
+    }
+    *since = now;
+}
+
+void mem_budget_nav_soak(void)
+{
+#if CONFIG_MEM_BUDGET_NAV_CYCLES > 0
+    const int cycles = CONFIG_MEM_BUDGET_NAV_CYCLES;
+    mem_snapshot_t first = { 0 }, last;
+
+    ESP_LOGI(TAG, "Navigation soak: %d cycles settings (builder) -> panel", cycles);
+    s_quiet = true;
+    for (int i = 0; i < cycles; i++) {
+        ui_show_settings_at_tab(2);
+        vTaskDelay(pdMS_TO_TICKS(SOAK_SETTLE_MS));
+        ui_show_main();
+        vTaskDelay(pdMS_TO_TICKS(SOAK_SETTLE_MS));
+        if (i == 0) mem_budget_snapshot(&first);
+    }
+    s_quiet = false;
+    mem_budget_snapshot(&last);
+    mem_budget_checkpoint(MEM_CP_NAV_SOAK, panel_layout_get()->item_count);
+
+    int32_t lvgl_growth = (int32_t)(last.lvgl_used - first.lvgl_used);
+    int32_t internal_loss = (int32_t)(first.internal_free - last.internal_free);
+    int32_t psram_loss = (int32_t)(first.psram_free - last.psram_free);
+    ESP_LOGI(TAG, "Over %d cycles: LVGL %+d B, internal %+d B, PSRAM %+d B",
+             cycles - 1, (int)lvgl_growth, (int)-internal_loss, (int)-psram_loss);
+    if (cycles > 1 && (lvgl_growth > LEAK_LVGL_BYTES ||
+                       internal_loss > LEAK_INTERNAL_BYTES ||
+                       psram_loss > LEAK_PSRAM_BYTES)) {
+        ESP_LOGE(TAG, "Possible leak across navigations: %d B LVGL, %d B internal, "
+                 "%d B PSRAM per cycle",
+                 (int)(lvgl_growth / (cycles - 1)), (int)(internal_loss / (cycles - 1)),
+                 (int)(psram_loss / (cycles - 1)));
+        s_leaks++;
+    }
+
+    for (int cp = 0; cp < MEM_CP_COUNT; cp++) {
+        const cp_stats_t *st = &s_stats[cp];
+        if (st->hits == 0) continue;
+        ESP_LOGI(TAG, "%-8s %4d checks, %d over budget, LVGL max %d KB, internal min %d KB",
+                 s_budgets[cp].name, (int)st->hits, (int)st->misses,
+                 (int)(st->lvgl_used_max / 1024), (int)(st->internal_free_min / 1024));
+    }
+#endif
+}
+
+uint32_t mem_budget_misses(void)
+{
+    uint32_t n = s_leaks;
+    for (int cp = 0; cp < MEM_CP_COUNT; cp++) n += s_stats[cp].misses;
+    return n;
+}
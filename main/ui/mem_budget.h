@@ -0,0 +1,89 @@
+/**
+ * @file mem_budget.h
+ * @brief Memory budget checkpoints per screen and per feature
+ *
+ * At each checkpoint — boot, panel shown, builder scene built, settings
+ * shown, after the navigation soak — internal RAM, DMA-capable RAM, PSRAM and the LVGL pool
+ * are snapshotted, logged and checked against the budgets in mem_budget.c.
+ * Building the settings screen also logs what each tab added to the LVGL
+ * pool, so the builder's cost per layout item is visible.
+ *
+ * With CONFIG_MEM_BUDGET_NAV_CYCLES > 0 (menuconfig → Diagnostics) the soak
+ * navigates settings (builder tab) → panel that many times at boot and
+ * flags any growth between the first and last cycle as a possible leak.
+ * At 0 only the soak is left out; the checkpoints always run.
+ */
+
+#ifndef MEM_BUDGET_H_
+#define MEM_BUDGET_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Where a snapshot is taken */
+typedef enum {
+    MEM_CP_BOOT = 0,        ///< LVGL running, no screen built
+    MEM_CP_PANEL,           ///< Panel screen built
+    MEM_CP_SETTINGS,        ///< Settings screen built (all four tabs)
+    MEM_CP_BUILDER,         ///< Builder scene built or rebuilt
+    MEM_CP_NAV_SOAK,        ///< Back on the panel after the navigation soak
+    MEM_CP_COUNT
+} mem_checkpoint_t;
+
+/** @brief One memory snapshot (bytes) */
+typedef struct {
+    uint32_t internal_free;     ///< Internal RAM free
+    uint32_t internal_min;      ///< Internal RAM lowest free since boot
+    uint32_t dma_largest;       ///< Largest DMA-capable internal block
+    uint32_t psram_free;        ///< PSRAM free
+    uint32_t lvgl_size;         ///< LVGL heap size (0 = unknown, not checked)
+    uint32_t lvgl_used;         ///< LVGL pool in use
+    uint32_t lvgl_peak;         ///< LVGL pool high-water mark
+    uint8_t  lvgl_frag;         ///< LVGL pool fragmentation (%)
+} mem_snapshot_t;
+
+/** @brief Take a snapshot (takes the UI lock for the LVGL pool) */
+void mem_budget_snapshot(mem_snapshot_t *out);
+
+/**
+ * @brief Snapshot, log and check the budgets for a checkpoint
+ *
+ * @param cp    Checkpoint
+ * @param items Layout items on screen (logged only)
+ */
+void mem_budget_checkpoint(mem_checkpoint_t cp, size_t items);
+
+/**
+ * @brief Log what a feature added to the LVGL pool since @p since
+ *
+ * @p since is refreshed afterwards, so consecutive features chain.
+ *
+ * @param name  Feature name (e.g. "builder")
+ * @param items Items the feature created, for a per-item cost (0 = none)
+ * @param since Snapshot taken before the feature was built
+ */
+void mem_budget_feature(const char *name, size_t items, mem_snapshot_t *since);
+
+/**
+ * @brief Run the navigation soak and log the leak check
+ *
+ * Call from the main task after ui_show_main(); leaves the panel shown.
+ */
+void mem_budget_nav_soak(void);
+
+/**
+ * @brief Budget misses so far, plus one per leak the soak flagged
+ *
+ * The host build's mem_budget_check exits non-zero when this is not 0.
+ */
+uint32_t mem_budget_misses(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_BUDGET_H_
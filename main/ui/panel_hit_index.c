@@ -0,0 +1,499 @@
+/**
+ * @file panel_hit_index.c
+ * @brief Spatial index for panel builder hit-testing
+ *
+ * World space is divided into PANEL_HIT_CELL_SIZE buckets; coordinates
+ * outside the grid clamp to the edge cells, which keeps queries correct
+ * (clamping is monotonic) at the cost of fuller edge buckets.
+ *
+ * Each target is a node in its bucket's list and in its element's owner
+ * chain, so an element is re-bucketed by unlinking its own nodes only.
+ * Points (connection points, bodies, endpoints) take one node.  A track
+ * takes one node per cell visited by samples taken every half cell along
+ * the segment; track queries widen their cell range by one sample step so
+ * a segment passing between samples is still found.
+ *
+ * The element tables and the node pool are growable PSRAM arrays sized by
+ * the layout; node indices are 16-bit, so the pool stops at NODE_LIMIT.
+ */
+
+#include "panel_hit_index.h"
+#include "app/psram_array.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "panel_hit_index";
+
+#define GRID_COLS       24          ///< 960 px wide
+#define GRID_ROWS       14          ///< 560 px tall
+#define NODE_POOL_INITIAL 2048      ///< Nodes reserved at init
+#define NODE_NIL        0xFFFF
+#define NODE_LIMIT      NODE_NIL    ///< Usable node indices are below NIL
+#define TRACK_STEP      (PANEL_HIT_CELL_SIZE / 2)   ///< Track sample spacing
+#define ITEM_BODY_SLOT  3           ///< item_rec_t pts[3] holds the body centre
+
+typedef struct {
+    uint16_t next;          ///< Next node in the same bucket
+    uint16_t owner_next;    ///< Next node of the same element
+    uint16_t cell;          ///< Bucket this node is linked into
+    uint16_t index;         ///< Element index
+    uint8_t  kind;          ///< panel_hit_kind_t
+    uint8_t  point;         ///< Connection point (CONN_POINT)
+} hit_node_t;
+
+/** Leading fields of every element record */
+typedef struct {
+    uint16_t    head;       ///< First node of the owner chain
+    bool        set;        ///< Geometry is valid and indexed
+} elem_hdr_t;
+
+typedef struct {
+    elem_hdr_t  hdr;
+    lv_point_t  pts[4];     ///< Entry, normal, reverse, body centre
+} item_rec_t;
+
+typedef struct {
+    elem_hdr_t  hdr;
+    lv_point_t  pt;
+} ep_rec_t;
+
+typedef struct {
+    elem_hdr_t  hdr;
+    lv_point_t  seg[2];
+} track_rec_t;
+
+typedef struct {
+    uint16_t    buckets[GRID_COLS * GRID_ROWS];
+    hit_node_t *nodes;
+    size_t      node_capacity;  ///< Allocated nodes
+    size_t      node_count;     ///< Nodes threaded into the pool (<= NODE_LIMIT)
+    uint16_t    free_head;
+    bool        overflow;   ///< Pool ran out — some targets are unindexed
+
+    item_rec_t *items;
+    size_t      item_count;
+    size_t      item_capacity;
+
+    ep_rec_t   *eps;
+    size_t      ep_count;
+    size_t      ep_capacity;
+
+    track_rec_t *tracks;
+    size_t      track_count;
+    size_t      track_capacity;
+} hit_index_t;
+
+static hit_index_t *s_idx = NULL;
+
+/** View of one element family's table, for code shared by all three */
+typedef struct {
+    void    **recs;
+    size_t   *count;
+    size_t   *capacity;
+    size_t    rec_size;
+} family_t;
+
+static family_t family_of(panel_hit_elem_t elem)
+{
+    family_t f;
+    switch (elem) {
+    case PANEL_HIT_ELEM_ITEM:
+        f = (family_t){ (void **)&s_idx->items, &s_idx->item_count,
+                        &s_idx->item_capacity, sizeof(item_rec_t) };
+        break;
+    case PANEL_HIT_ELEM_ENDPOINT:
+        f = (family_t){ (void **)&s_idx->eps, &s_idx->ep_count,
+                        &s_idx->ep_capacity, sizeof(ep_rec_t) };
+        break;
+    default:
+        f = (family_t){ (void **)&s_idx->tracks, &s_idx->track_count,
+                        &s_idx->track_capacity, sizeof(track_rec_t) };
+        break;
+    }
+    return f;
+}
+
+static elem_hdr_t *family_hdr(const family_t *f, size_t i)
+{
+    return (elem_hdr_t *)((uint8_t *)*f->recs + i * f->rec_size);
+}
+
+// ============================================================================
+// Buckets and Nodes
+// ============================================================================
+
+static int cell_coord(int32_t v, int limit)
+{
+    if (v < 0) return 0;
+    v /= PANEL_HIT_CELL_SIZE;
+    return v >= limit ? limit - 1 : (int)v;
+}
+
+static uint16_t cell_of(lv_point_t pt)
+{
+    return (uint16_t)(cell_coord(pt.y, GRID_ROWS) * GRID_COLS + cell_coord(pt.x, GRID_COLS));
+}
+
+/**
+ * @brief Thread nodes [node_count, node_capacity) onto the free list
+ */
+static void pool_thread_new(void)
+{
+    size_t limit = s_idx->node_capacity < NODE_LIMIT ? s_idx->node_capacity : NODE_LIMIT;
+    for (size_t n = limit; n-- > s_idx->node_count;) {
+        s_idx->nodes[n].next = s_idx->free_head;
+        s_idx->free_head = (uint16_t)n;
+    }
+    s_idx->node_count = limit;
+}
+
+/**
+ * @brief Grow the node pool once the free list is empty
+ * @return true if free nodes are available
+ */
+static bool pool_grow(void)
+{
+    if (s_idx->node_count >= NODE_LIMIT) return false;
+    if (!psram_array_reserve((void **)&s_idx->nodes, &s_idx->node_capacity,
+                             s_idx->node_count + 1, sizeof(s_idx->nodes[0]))) {
+        return false;
+    }
+    pool_thread_new();
+    return true;
+}
+
+/**
+ * @brief Link a new node into its bucket and the element's owner chain
+ */
+static void node_add(uint16_t *owner_head, panel_hit_kind_t kind, uint8_t point,
+                     size_t index, uint16_t cell)
+{
+    if (s_idx->free_head == NODE_NIL && !s_idx->overflow) pool_grow();
+
+    uint16_t n = s_idx->free_head;
+    if (n == NODE_NIL) {
+        if (!s_idx->overflow) {
+            ESP_LOGW(TAG, "Node pool exhausted — falling back to linear hit-testing");
+        }
+        s_idx->overflow = true;
+        return;
+    }
+    hit_node_t *node = &s_idx->nodes[n];
+    s_idx->free_head = node->next;
+
+    node->kind = (uint8_t)kind;
+    node->point = point;
+    node->index = (uint16_t)index;
+    node->cell = cell;
+    node->next = s_idx->buckets[cell];
+    s_idx->buckets[cell] = n;
+    node->owner_next = *owner_head;
+    *owner_head = n;
+}
+
+/**
+ * @brief Unlink and free all nodes of one element
+ */
+static void element_unlink(uint16_t *owner_head)
+{
+    uint16_t n = *owner_head;
+    while (n != NODE_NIL) {
+        hit_node_t *node = &s_idx->nodes[n];
+        uint16_t *link = &s_idx->buckets[node->cell];
+        while (*link != n) {
+            link = &s_idx->nodes[*link].next;
+        }
+        *link = node->next;
+
+        uint16_t owner_next = node->owner_next;
+        node->next = s_idx->free_head;
+        s_idx->free_head = n;
+        n = owner_next;
+    }
+    *owner_head = NODE_NIL;
+}
+
+/**
+ * @brief Rewrite the element index carried by nodes of elements [from, count)
+ */
+static void family_renumber(const family_t *f, size_t from)
+{
+    for (size_t j = from; j < *f->count; j++) {
+        for (uint16_t n = family_hdr(f, j)->head; n != NODE_NIL; n = s_idx->nodes[n].owner_next) {
+            s_idx->nodes[n].index = (uint16_t)j;
+        }
+    }
+}
+
+// ============================================================================
+// Distance
+// ============================================================================
+
+static int32_t dist_sq_point(lv_point_t p, lv_point_t q)
+{
+    int32_t dx = p.x - q.x;
+    int32_t dy = p.y - q.y;
+    return dx * dx + dy * dy;
+}
+
+static int32_t dist_sq_segment(lv_point_t p, lv_point_t a, lv_point_t b)
+{
+    int32_t dx = b.x - a.x;
+    int32_t dy = b.y - a.y;
+    int64_t len_sq = (int64_t)dx * dx + (int64_t)dy * dy;
+
+    // Beyond either end the nearest point is that end
+    int64_t t = (int64_t)(p.x - a.x) * dx + (int64_t)(p.y - a.y) * dy;
+    if (len_sq == 0 || t <= 0) return dist_sq_point(p, a);
+    if (t >= len_sq) return dist_sq_point(p, b);
+
+    // Perpendicular distance from the cross product, rounded — projecting
+    // onto a truncated integer point would overstate it by up to a pixel
+    int64_t cross = (int64_t)(p.x - a.x) * dy - (int64_t)(p.y - a.y) * dx;
+    return (int32_t)((cross * cross + len_sq / 2) / len_sq);
+}
+
+/**
+ * @brief Distance from @p pt to one target, or -1 if the element is unset
+ */
+static int32_t target_dist_sq(panel_hit_kind_t kind, size_t index, uint8_t point, lv_point_t pt)
+{
+    switch (kind) {
+    case PANEL_HIT_CONN_POINT:
+        return dist_sq_point(pt, s_idx->items[index].pts[point]);
+    case PANEL_HIT_ITEM_BODY:
+        return dist_sq_point(pt, s_idx->items[index].pts[ITEM_BODY_SLOT]);
+    case PANEL_HIT_ENDPOINT:
+        return dist_sq_point(pt, s_idx->eps[index].pt);
+    case PANEL_HIT_TRACK:
+        return dist_sq_segment(pt, s_idx->tracks[index].seg[0], s_idx->tracks[index].seg[1]);
+    }
+    return -1;
+}
+
+/**
+ * @brief Replace @p best if this target is at least as close
+ * @return true if @p best was replaced
+ */
+static bool consider(panel_hit_kind_t kind, size_t index, uint8_t point, lv_point_t pt,
+                     panel_hit_t *best)
+{
+    int32_t d = target_dist_sq(kind, index, point, pt);
+    if (d < 0 || d > best->dist_sq) return false;
+
+    best->kind = kind;
+    best->index = (uint16_t)index;
+    best->point = (panel_point_type_t)point;
+    best->dist_sq = d;
+    return true;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t panel_hit_index_init(void)
+{
+    if (s_idx) return ESP_OK;
+
+    s_idx = heap_caps_calloc(1, sizeof(*s_idx), MALLOC_CAP_SPIRAM);
+    if (!s_idx) {
+        ESP_LOGW(TAG, "PSRAM alloc failed, falling back to internal RAM");
+        s_idx = calloc(1, sizeof(*s_idx));
+    }
+    if (!s_idx) {
+        ESP_LOGE(TAG, "Failed to allocate hit index");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (!psram_array_reserve((void **)&s_idx->nodes, &s_idx->node_capacity,
+                             NODE_POOL_INITIAL, sizeof(s_idx->nodes[0]))) {
+        free(s_idx);
+        s_idx = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    panel_hit_index_clear();
+    ESP_LOGI(TAG, "Hit index: %dx%d buckets, %u nodes reserved",
+             GRID_COLS, GRID_ROWS, (unsigned)s_idx->node_count);
+    return ESP_OK;
+}
+
+void panel_hit_index_clear(void)
+{
+    if (!s_idx) return;
+
+    // Element tables keep their capacity; insert() initialises each slot
+    memset(s_idx->buckets, 0xFF, sizeof(s_idx->buckets));
+    s_idx->item_count = s_idx->ep_count = s_idx->track_count = 0;
+
+    s_idx->free_head = NODE_NIL;
+    s_idx->node_count = 0;
+    pool_thread_new();
+    s_idx->overflow = false;
+}
+
+void panel_hit_index_insert(panel_hit_elem_t elem, size_t index)
+{
+    if (!s_idx) return;
+
+    family_t f = family_of(elem);
+    if (index > *f.count) return;
+    if (!psram_array_reserve(f.recs, f.capacity, *f.count + 1, f.rec_size)) return;
+
+    size_t tail = *f.count - index;
+    uint8_t *recs = *f.recs;
+    memmove(recs + (index + 1) * f.rec_size, recs + index * f.rec_size, tail * f.rec_size);
+    elem_hdr_t *hdr = family_hdr(&f, index);
+    hdr->head = NODE_NIL;
+    hdr->set = false;
+    (*f.count)++;
+    family_renumber(&f, index + 1);
+}
+
+void panel_hit_index_remove(panel_hit_elem_t elem, size_t index)
+{
+    if (!s_idx) return;
+
+    family_t f = family_of(elem);
+    if (index >= *f.count) return;
+
+    element_unlink(&family_hdr(&f, index)->head);
+    (*f.count)--;
+    size_t tail = *f.count - index;
+    uint8_t *recs = *f.recs;
+    memmove(recs + index * f.rec_size, recs + (index + 1) * f.rec_size, tail * f.rec_size);
+    family_renumber(&f, index);
+}
+
+void panel_hit_index_set_item(size_t index, const lv_point_t pts[3], lv_point_t centre)
+{
+    if (!s_idx || index >= s_idx->item_count) return;
+
+    item_rec_t *rec = &s_idx->items[index];
+    lv_point_t *geom = rec->pts;
+    if (rec->hdr.set && memcmp(geom, pts, 3 * sizeof(lv_point_t)) == 0 &&
+        geom[ITEM_BODY_SLOT].x == centre.x && geom[ITEM_BODY_SLOT].y == centre.y) {
+        return;     // unchanged (e.g. zoom re-tessellation)
+    }
+
+    element_unlink(&rec->hdr.head);
+    memcpy(geom, pts, 3 * sizeof(lv_point_t));
+    geom[ITEM_BODY_SLOT] = centre;
+    rec->hdr.set = true;
+
+    for (uint8_t p = 0; p < 3; p++) {
+        node_add(&rec->hdr.head, PANEL_HIT_CONN_POINT, p, index, cell_of(pts[p]));
+    }
+    node_add(&rec->hdr.head, PANEL_HIT_ITEM_BODY, 0, index, cell_of(centre));
+}
+
+void panel_hit_index_set_endpoint(size_t index, lv_point_t pt)
+{
+    if (!s_idx || index >= s_idx->ep_count) return;
+
+    ep_rec_t *rec = &s_idx->eps[index];
+    if (rec->hdr.set && rec->pt.x == pt.x && rec->pt.y == pt.y) {
+        return;
+    }
+
+    element_unlink(&rec->hdr.head);
+    rec->pt = pt;
+    rec->hdr.set = true;
+    node_add(&rec->hdr.head, PANEL_HIT_ENDPOINT, 0, index, cell_of(pt));
+}
+
+void panel_hit_index_set_track(size_t index, lv_point_t a, lv_point_t b)
+{
+    if (!s_idx || index >= s_idx->track_count) return;
+
+    track_rec_t *rec = &s_idx->tracks[index];
+    lv_point_t *seg = rec->seg;
+    if (rec->hdr.set && seg[0].x == a.x && seg[0].y == a.y &&
+        seg[1].x == b.x && seg[1].y == b.y) {
+        return;
+    }
+
+    element_unlink(&rec->hdr.head);
+    seg[0] = a;
+    seg[1] = b;
+    rec->hdr.set = true;
+
+    // Sample every half cell; consecutive samples usually share a bucket
+    int32_t dx = b.x - a.x;
+    int32_t dy = b.y - a.y;
+    int32_t span = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+    int32_t steps = span / TRACK_STEP + 1;
+    uint16_t last = NODE_NIL;
+    for (int32_t s = 0; s <= steps; s++) {
+        lv_point_t p = {
+            .x = (lv_coord_t)(a.x + dx * s / steps),
+            .y = (lv_coord_t)(a.y + dy * s / steps),
+        };
+        uint16_t cell = cell_of(p);
+        if (cell != last) {
+            node_add(&rec->hdr.head, PANEL_HIT_TRACK, 0, index, cell);
+            last = cell;
+        }
+    }
+}
+
+void panel_hit_index_unset(panel_hit_elem_t elem, size_t index)
+{
+    if (!s_idx) return;
+
+    family_t f = family_of(elem);
+    if (index >= *f.count) return;
+
+    elem_hdr_t *hdr = family_hdr(&f, index);
+    element_unlink(&hdr->head);
+    hdr->set = false;
+}
+
+bool panel_hit_index_nearest(panel_hit_kind_t kind, lv_point_t pt, int16_t radius,
+                             panel_hit_t *out)
+{
+    if (!s_idx) return false;
+
+    panel_hit_t best = { .dist_sq = (int32_t)radius * radius };
+    bool found = false;
+
+    if (s_idx->overflow) {
+        // Linear fallback over the stored geometry
+        panel_hit_elem_t elem = kind == PANEL_HIT_ENDPOINT ? PANEL_HIT_ELEM_ENDPOINT
+                              : kind == PANEL_HIT_TRACK    ? PANEL_HIT_ELEM_TRACK
+                                                           : PANEL_HIT_ELEM_ITEM;
+        family_t f = family_of(elem);
+        uint8_t points = kind == PANEL_HIT_CONN_POINT ? 3 : 1;
+        for (size_t i = 0; i < *f.count; i++) {
+            if (!family_hdr(&f, i)->set) continue;
+            for (uint8_t p = 0; p < points; p++) {
+                found |= consider(kind, i, p, pt, &best);
+            }
+        }
+    } else {
+        // Samples are up to TRACK_STEP apart per axis, so any point of a
+        // track lies within TRACK_STEP * sqrt(2) / 2 of a sampled bucket
+        int16_t slack = kind == PANEL_HIT_TRACK ? TRACK_STEP : 0;
+        int c0 = cell_coord(pt.x - radius - slack, GRID_COLS);
+        int c1 = cell_coord(pt.x + radius + slack, GRID_COLS);
+        int r0 = cell_coord(pt.y - radius - slack, GRID_ROWS);
+        int r1 = cell_coord(pt.y + radius + slack, GRID_ROWS);
+
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                uint16_t n = s_idx->buckets[r * GRID_COLS + c];
+                for (; n != NODE_NIL; n = s_idx->nodes[n].next) {
+                    const hit_node_t *node = &s_idx->nodes[n];
+                    if (node->kind != (uint8_t)kind) continue;
+                    found |= consider(kind, node->index, node->point, pt, &best);
+                }
+            }
+        }
+    }
+
+    if (found) *out = best;
+    return found;
+}
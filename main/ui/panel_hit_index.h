@@ -0,0 +1,97 @@
+/**
+ * @file panel_hit_index.h
+ * @brief Spatial index for panel builder hit-testing
+ *
+ * A uniform grid of buckets over world space holding every turnout
+ * connection point, turnout body, endpoint and track segment of the layout.
+ * Taps resolve with nearest-within-radius queries that only visit the
+ * buckets around the tap, instead of one LVGL hitbox object per target.
+ *
+ * Element indices follow the panel_layout_t arrays: the builder calls
+ * insert/remove when an element is added or removed (later indices shift)
+ * and set_* whenever an element's geometry changes.  Element tables and the
+ * node pool grow in PSRAM with the layout; if the pool cannot grow, queries
+ * fall back to a linear scan of the stored geometry, so results stay correct.
+ */
+
+#ifndef PANEL_HIT_INDEX_H_
+#define PANEL_HIT_INDEX_H_
+
+#include "panel_layout.h"
+#include "lvgl.h"
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Bucket edge length in world pixels */
+#define PANEL_HIT_CELL_SIZE     40
+
+/** @brief Kind of hit target */
+typedef enum {
+    PANEL_HIT_CONN_POINT = 0,   ///< Turnout connection point (point = panel_point_type_t)
+    PANEL_HIT_ITEM_BODY,        ///< Turnout symbol centre
+    PANEL_HIT_ENDPOINT,         ///< Track endpoint
+    PANEL_HIT_TRACK,            ///< Track segment (distance to the segment)
+} panel_hit_kind_t;
+
+/** @brief Element family, i.e. which layout array an index refers to */
+typedef enum {
+    PANEL_HIT_ELEM_ITEM = 0,
+    PANEL_HIT_ELEM_ENDPOINT,
+    PANEL_HIT_ELEM_TRACK,
+} panel_hit_elem_t;
+
+/** @brief Query result */
+typedef struct {
+    panel_hit_kind_t   kind;
+    uint16_t           index;       ///< Layout array index
+    panel_point_type_t point;       ///< Connection point (CONN_POINT only)
+    int32_t            dist_sq;     ///< Squared world distance to the tap
+} panel_hit_t;
+
+/**
+ * @brief Allocate the bucket grid and initial node pool (PSRAM preferred)
+ */
+esp_err_t panel_hit_index_init(void);
+
+/** @brief Remove every element */
+void panel_hit_index_clear(void);
+
+/** @brief Open an empty slot at @p index, shifting later elements up */
+void panel_hit_index_insert(panel_hit_elem_t elem, size_t index);
+
+/** @brief Drop the element at @p index, shifting later elements down */
+void panel_hit_index_remove(panel_hit_elem_t elem, size_t index);
+
+/**
+ * @brief Set a turnout's world geometry
+ * @param pts    Entry, normal and reverse connection points
+ * @param centre Symbol centre (body hit target)
+ */
+void panel_hit_index_set_item(size_t index, const lv_point_t pts[3], lv_point_t centre);
+
+/** @brief Set an endpoint's world position */
+void panel_hit_index_set_endpoint(size_t index, lv_point_t pt);
+
+/** @brief Set a track segment's world end points */
+void panel_hit_index_set_track(size_t index, lv_point_t a, lv_point_t b);
+
+/** @brief Make an element untappable (e.g. a track with a dangling end) */
+void panel_hit_index_unset(panel_hit_elem_t elem, size_t index);
+
+/**
+ * @brief Find the nearest target of one kind within @p radius of @p pt
+ * @return true if a target was found (@p out filled)
+ */
+bool panel_hit_index_nearest(panel_hit_kind_t kind, lv_point_t pt, int16_t radius,
+                             panel_hit_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PANEL_HIT_INDEX_H_
@@ -0,0 +1,253 @@
+/**
+ * @file render_bench.c
+ * @brief Render benchmark for the panel, switchboard and builder screens
+ *
+ * The generated layouts come from route_bench_build_layout() with turnout
+ * IDs far above any real turnout, so every generated turnout renders in
+ * the "unknown" state and the pixel hash does not depend on bus traffic.
+ * The switchboard lists the real turnouts, so its hash only compares
+ * between runs with the same turnouts.json.
+ *
+ * The saved layout is swapped out of the panel_layout singleton for the
+ * run and swapped back at the end.  The UI lock is held throughout, so the
+ * LVGL task never sees a half-built screen; frames are forced with
+ * lv_refr_now() and the flush callback is wrapped to hash the pixels.
+ */
+
+#include "render_bench.h"
+#include "ui_common.h"
+#include "lvgl_alloc.h"
+#include "app/route_bench.h"
+#include "sdkconfig.h"
+#include "cJSON.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static const char *TAG = "render_bench";
+
+#define BENCH_RESULT_PATH   "/sdcard/render_bench.json"
+#define BENCH_GOLDEN_PATH   "/sdcard/render_golden.json"
+
+/// Generated turnout IDs start above this (real IDs count up from 1)
+#define BENCH_ID_BASE       0x70000000u
+
+/// Partial frame: a turnout-sized square in the middle of the screen
+#define BENCH_PARTIAL_SIZE  64
+
+static const uint16_t s_sizes[] = { 10, 50, 100, 200, 500 };
+
+typedef struct {
+    const char *screen;
+    uint16_t items;
+    uint32_t build_us;
+    uint32_t full_us;
+    uint32_t partial_us;
+    uint32_t objects;
+    uint32_t heap_used;
+    uint32_t heap_peak;
+    uint32_t hash;
+} bench_case_t;
+
+static void (*s_flush_orig)(lv_disp_drv_t *, const lv_area_t *, lv_color_t *) = NULL;
+static bool s_hashing = false;
+static uint32_t s_hash = 0;
+
+/** @brief Flush wrapper: hash the area and its pixels, then flush as usual */
+static void hash_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    if (s_hashing) {
+        uint32_t px = (uint32_t)lv_area_get_width(area) * (uint32_t)lv_area_get_height(area);
+        s_hash = esp_rom_crc32_le(s_hash, (const uint8_t *)area, sizeof(*area));
+        s_hash = esp_rom_crc32_le(s_hash, (const uint8_t *)color_map, px * sizeof(lv_color_t));
+    }
+    s_flush_orig(drv, area, color_map);
+}
+
+static uint32_t count_objects(lv_obj_t *obj)
+{
+    uint32_t n = 1;
+    uint32_t children = lv_obj_get_child_cnt(obj);
+    for (uint32_t i = 0; i < children; i++) n += count_objects(lv_obj_get_child(obj, i));
+    return n;
+}
+
+/** @brief Measure the screen just built: frames, objects, heap */
+static void measure(bench_case_t *c, int64_t build_start_us)
+{
+    c->build_us = (uint32_t)(esp_timer_get_time() - build_start_us);
+
+    lv_disp_t *disp = lv_disp_get_default();
+    lv_obj_t *scr = lv_scr_act();
+    c->objects = count_objects(scr);
+
+    // Full frame, hashed
+    lv_obj_invalidate(scr);
+    s_hash = 0;
+    s_hashing = true;
+    int64_t t0 = esp_timer_get_time();
+    lv_refr_now(disp);
+    c->full_us = (uint32_t)(esp_timer_get_time() - t0);
+    s_hashing = false;
+    c->hash = s_hash;
+
+    // Partial frame
+    lv_coord_t cx = lv_disp_get_hor_res(disp) / 2, cy = lv_disp_get_ver_res(disp) / 2;
+    lv_area_t area = { cx - BENCH_PARTIAL_SIZE / 2, cy - BENCH_PARTIAL_SIZE / 2,
+                       cx + BENCH_PARTIAL_SIZE / 2 - 1, cy + BENCH_PARTIAL_SIZE / 2 - 1 };
+    lv_obj_invalidate_area(scr, &area);
+    t0 = esp_timer_get_time();
+    lv_refr_now(disp);
+    c->partial_us = (uint32_t)(esp_timer_get_time() - t0);
+
+    lv_mem_monitor_t mon;
+    lvgl_alloc_monitor(&mon);
+    c->heap_used = (uint32_t)(mon.total_size - mon.free_size);
+    c->heap_peak = (uint32_t)mon.max_used;
+
+    ESP_LOGI(TAG, "%-11s %3d items: build %6d us, full %6d us, partial %5d us, "
+             "%4d objects, heap %d KB, hash %08x",
+             c->screen, (int)c->items, (int)c->build_us, (int)c->full_us,
+             (int)c->partial_us, (int)c->objects, (int)(c->heap_used / 1024),
+             (unsigned)c->hash);
+}
+
+/** @brief Compare hashes against a previous result file, if one exists */
+static void check_golden(const bench_case_t *cases, size_t count)
+{
+    struct stat st;
+    if (stat(BENCH_GOLDEN_PATH, &st) != 0) return;
+
+    FILE *f = fopen(BENCH_GOLDEN_PATH, "r");
+    if (!f) return;
+    char *buf = malloc(st.st_size + 1);
+    if (!buf) {
+        fclose(f);
+        return;
+    }
+    size_t read_sz = fread(buf, 1, st.st_size, f);
+    fclose(f);
+    buf[read_sz] = '\0';
+    cJSON *root = cJSON_Parse(buf);
+    free(buf);
+    if (!root) {
+        ESP_LOGW(TAG, "%s is not valid JSON", BENCH_GOLDEN_PATH);
+        return;
+    }
+
+    size_t compared = 0, changed = 0;
+    cJSON *golden = cJSON_GetObjectItem(root, "cases");
+    cJSON *g;
+    cJSON_ArrayForEach(g, golden) {
+        cJSON *screen = cJSON_GetObjectItem(g, "screen");
+        cJSON *items = cJSON_GetObjectItem(g, "items");
+        cJSON *hash = cJSON_GetObjectItem(g, "hash");
+        if (!cJSON_IsString(screen) || !cJSON_IsNumber(items) || !cJSON_IsString(hash)) continue;
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(cases[i].screen, screen->valuestring) != 0 ||
+                cases[i].items != items->valueint) continue;
+            compared++;
+            uint32_t want = (uint32_t)strtoul(hash->valuestring, NULL, 16);
+            if (want != cases[i].hash) {
+                changed++;
+                ESP_LOGW(TAG, "Rendering changed: %s, %d items (%08x, golden %08x)",
+                         cases[i].screen, (int)cases[i].items, (unsigned)cases[i].hash,
+                         (unsigned)want);
+            }
+        }
+    }
+    cJSON_Delete(root);
+    ESP_LOGI(TAG, "Golden hashes: %d compared, %d changed", (int)compared, (int)changed);
+}
+
+static void write_results(const bench_case_t *cases, size_t count)
+{
+    FILE *f = fopen(BENCH_RESULT_PATH, "w");
+    if (!f) {
+        ESP_LOGW(TAG, "Cannot create %s", BENCH_RESULT_PATH);
+        return;
+    }
+    fprintf(f, "{\n  \"lvgl\": \"%d.%d.%d\",\n  \"cases\": [\n",
+            LVGL_VERSION_MAJOR, LVGL_VERSION_MINOR, LVGL_VERSION_PATCH);
+    for (size_t i = 0; i < count; i++) {
+        const bench_case_t *c = &cases[i];
+        fprintf(f, "    {\"screen\": \"%s\", \"items\": %u, \"build_us\": %u, "
+                "\"full_us\": %u, \"partial_us\": %u, \"objects\": %u, "
+                "\"heap_used\": %u, \"heap_peak\": %u, \"hash\": \"%08x\"}%s\n",
+                c->screen, (unsigned)c->items, (unsigned)c->build_us,
+                (unsigned)c->full_us, (unsigned)c->partial_us, (unsigned)c->objects,
+                (unsigned)c->heap_used, (unsigned)c->heap_peak, (unsigned)c->hash,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    ESP_LOGI(TAG, "Results written to %s", BENCH_RESULT_PATH);
+}
+
+void render_bench_run(void)
+{
+#if CONFIG_RENDER_BENCH
+    lv_disp_t *disp = lv_disp_get_default();
+    if (!disp) return;
+
+    const size_t sizes = sizeof(s_sizes) / sizeof(s_sizes[0]);
+    bench_case_t cases[sizeof(s_sizes) / sizeof(s_sizes[0]) * 3];
+    size_t count = 0;
+
+    ui_lock();
+    s_flush_orig = disp->driver->flush_cb;
+    disp->driver->flush_cb = hash_flush_cb;
+
+    panel_layout_t *live = panel_layout_get();
+    panel_layout_t saved = *live;
+
+    for (size_t s = 0; s < sizes; s++) {
+        panel_layout_t generated = { .index = { .valid = true } };
+        if (!route_bench_build_layout(&generated, s_sizes[s], BENCH_ID_BASE)) {
+            ESP_LOGE(TAG, "Out of memory for a %d-turnout layout", (int)s_sizes[s]);
+            panel_layout_free(&generated);
+            break;
+        }
+        // The previous generated layout is only freed once no screen shows it
+        panel_layout_t previous = *live;
+        *live = generated;
+
+        // Switchboard and builder are tabs of the same settings screen
+        bench_case_t *c = &cases[count++];
+        *c = (bench_case_t){ .screen = "switchboard", .items = s_sizes[s] };
+        int64_t t0 = esp_timer_get_time();
+        ui_show_settings_at_tab(0);
+        measure(c, t0);
+        if (s > 0) panel_layout_free(&previous);
+
+        c = &cases[count++];
+        *c = (bench_case_t){ .screen = "builder", .items = s_sizes[s] };
+        t0 = esp_timer_get_time();
+        ui_show_settings_at_tab(2);
+        measure(c, t0);
+
+        c = &cases[count++];
+        *c = (bench_case_t){ .screen = "panel", .items = s_sizes[s] };
+        t0 = esp_timer_get_time();
+        ui_create_panel_screen();
+        measure(c, t0);
+    }
+
+    // The panel screen still shows the last generated layout: detach it so
+    // state updates skip it until the caller's ui_show_main() rebuilds it
+    ui_panel_invalidate();
+    panel_layout_t last = *live;
+    *live = saved;
+    if (count) panel_layout_free(&last);
+
+    disp->driver->flush_cb = s_flush_orig;
+    ui_unlock();
+
+    write_results(cases, count);
+    check_golden(cases, count);
+#endif
+}
@@ -0,0 +1,34 @@
+/**
+ * @file render_bench.h
+ * @brief Render benchmark for the panel, switchboard and builder screens
+ *
+ * Enabled by CONFIG_RENDER_BENCH (menuconfig → Diagnostics).  Right after
+ * LVGL starts, each screen is built over generated layouts of 10 to 500
+ * turnouts and rendered to the display: build time, full and partial
+ * frame time, object count and LVGL heap use are measured, and a CRC of
+ * every flushed pixel identifies what was drawn.  Results are written to
+ * /sdcard/render_bench.json; if /sdcard/render_golden.json (a previous
+ * result) exists, differing hashes are logged as rendering changes.
+ */
+
+#ifndef RENDER_BENCH_H_
+#define RENDER_BENCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Run the benchmark, then leave the saved layout in place
+ *
+ * Call after ui_init() and before ui_show_main().  The screen flickers
+ * through the generated layouts for a few seconds.  Does nothing when the
+ * option is off.
+ */
+void render_bench_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RENDER_BENCH_H_
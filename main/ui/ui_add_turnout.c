@@ -11,6 +11,7 @@
 #include "app/turnout_manager.h"
 #include "app/turnout_storage.h"
 #include "app/lcc_node.h"
+#include "app/lcc_id.h"
 #include "esp_log.h"
 #include <string.h>
 #include <stdio.h>
@@ -60,26 +61,6 @@ static int               s_pair_count = 0;
 // Helpers
 // ============================================================================
 
-/**
- * @brief Parse a dotted-hex event ID string (e.g. "05.01.01.01.22.60.00.00")
- *        into a uint64_t.
- */
-static bool parse_event_id_str(const char *str, uint64_t *out)
-{
-    if (!str || !out) return false;
-
-    unsigned int b[8];
-    if (sscanf(str, "%02x.%02x.%02x.%02x.%02x.%02x.%02x.%02x",
-               &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &b[6], &b[7]) == 8) {
-        *out = ((uint64_t)b[0] << 56) | ((uint64_t)b[1] << 48) |
-               ((uint64_t)b[2] << 40) | ((uint64_t)b[3] << 32) |
-               ((uint64_t)b[4] << 24) | ((uint64_t)b[5] << 16) |
-               ((uint64_t)b[6] << 8)  | ((uint64_t)b[7]);
-        return true;
-    }
-    return false;
-}
-
 static void format_event_id_str(uint64_t id, char *buf, size_t buf_len)
 {
     snprintf(buf, buf_len, "%02X.%02X.%02X.%02X.%02X.%02X.%02X.%02X",
@@ -154,11 +135,11 @@ static void add_btn_cb(lv_event_t *e)
 
     // Parse event IDs
     uint64_t ev_normal, ev_reverse;
-    if (!parse_event_id_str(normal_str, &ev_normal)) {
+    if (!lcc_id_parse_event(normal_str, &ev_normal)) {
         show_status("Invalid NORMAL event ID format\n(use XX.XX.XX.XX.XX.XX.XX.XX)", lv_color_hex(0xF44336));
         return;
     }
-    if (!parse_event_id_str(reverse_str, &ev_reverse)) {
+    if (!lcc_id_parse_event(reverse_str, &ev_reverse)) {
         show_status("Invalid REVERSE event ID format\n(use XX.XX.XX.XX.XX.XX.XX.XX)", lv_color_hex(0xF44336));
         return;
     }
@@ -4,6 +4,7 @@
  */
 
 #include "ui_common.h"
+#include "lvgl_alloc.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_timer.h"
@@ -12,6 +13,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include <string.h>
 
 // Board drivers
 #include "waveshare_lcd.h"
@@ -19,6 +21,7 @@
 
 // App modules
 #include "app/screen_timeout.h"
+#include "app/lock_prof.h"
 
 static const char *TAG = "ui_common";
 
@@ -27,6 +30,14 @@ static lv_disp_t *s_disp = NULL;
 static lv_indev_t *s_touch_indev = NULL;
 static SemaphoreHandle_t s_lvgl_mutex = NULL;
 
+// Multi-touch gesture hook (LVGL 8 input devices track a single point)
+static ui_multitouch_cb_t s_multitouch_cb = NULL;
+static bool s_multitouch_active = false;
+
+// Render statistics (LVGL task only — written by the monitor callback and
+// the task loop, read by the diagnostics tab from an LVGL timer)
+static ui_render_stats_t s_render_stats;
+
 // Hardware handles (from main)
 extern esp_lcd_panel_handle_t s_lcd_panel;
 extern esp_lcd_touch_handle_t s_touch;
@@ -35,6 +46,7 @@ extern esp_lcd_touch_handle_t s_touch;
 static void lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map);
 static void lvgl_touch_cb(lv_indev_drv_t *drv, lv_indev_data_t *data);
 static void lvgl_tick_timer_cb(void *arg);
+static void lvgl_monitor_cb(lv_disp_drv_t *drv, uint32_t time_ms, uint32_t px);
 static void lvgl_task(void *arg);
 
 /**
@@ -54,6 +66,18 @@ static void lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
     lv_disp_flush_ready(drv);
 }
 
+/**
+ * @brief LVGL monitor callback - called after each refresh that redrew pixels
+ */
+static void lvgl_monitor_cb(lv_disp_drv_t *drv, uint32_t time_ms, uint32_t px)
+{
+    (void)drv;
+    (void)px;
+    s_render_stats.frames++;
+    s_render_stats.render_ms += time_ms;
+    if (time_ms > s_render_stats.max_frame_ms) s_render_stats.max_frame_ms = time_ms;
+}
+
 /**
  * @brief LVGL touch read callback
  */
@@ -64,13 +88,16 @@ static void lvgl_touch_cb(lv_indev_drv_t *drv, lv_indev_data_t *data)
     // Read touch data
     esp_lcd_touch_read_data(touch);
 
-    // Get touch data using new API
-    esp_lcd_touch_point_data_t point_data;
+    // Get touch data using new API (GT911 reports several points)
+    esp_lcd_touch_point_data_t point_data[UI_TOUCH_MAX_POINTS];
     uint8_t point_cnt = 0;
     
-    esp_err_t ret = esp_lcd_touch_get_data(touch, &point_data, &point_cnt, 1);
+    esp_err_t ret = esp_lcd_touch_get_data(touch, point_data, &point_cnt, UI_TOUCH_MAX_POINTS);
+    if (ret != ESP_OK) {
+        point_cnt = 0;
+    }
 
-    if (ret == ESP_OK && point_cnt > 0) {
+    if (point_cnt > 0) {
         // Notify screen timeout module of touch activity (may trigger wake)
         screen_timeout_notify_activity();
 
@@ -81,13 +108,27 @@ static void lvgl_touch_cb(lv_indev_drv_t *drv, lv_indev_data_t *data)
             return;
         }
 
-        data->point.x = point_data.x;
-        data->point.y = point_data.y;
+        data->point.x = point_data[0].x;
+        data->point.y = point_data[0].y;
         data->state = LV_INDEV_STATE_PRESSED;
         
     } else {
         data->state = LV_INDEV_STATE_RELEASED;
     }
+
+    // Forward two-finger gestures (and their end) to the registered handler
+    if (s_multitouch_cb && (point_cnt >= 2 || s_multitouch_active)) {
+        lv_point_t points[UI_TOUCH_MAX_POINTS];
+        for (uint8_t i = 0; i < point_cnt; i++) {
+            points[i].x = (lv_coord_t)point_data[i].x;
+            points[i].y = (lv_coord_t)point_data[i].y;
+        }
+        bool consumed = s_multitouch_cb(points, point_cnt);
+        s_multitouch_active = point_cnt >= 2 && consumed;
+        if (s_multitouch_active && s_touch_indev) {
+            lv_indev_wait_release(s_touch_indev);
+        }
+    }
 }
 
 /**
@@ -107,9 +148,11 @@ static void lvgl_task(void *arg)
 
     while (1) {
         // Lock mutex
-        if (xSemaphoreTakeRecursive(s_lvgl_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        if (LOCK_PROF_TAKE_RECURSIVE(LOCK_PROF_LVGL, s_lvgl_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+            int64_t t0 = esp_timer_get_time();
             uint32_t task_delay_ms = lv_timer_handler();
-            xSemaphoreGiveRecursive(s_lvgl_mutex);
+            s_render_stats.handler_us += (uint32_t)(esp_timer_get_time() - t0);
+            LOCK_PROF_GIVE_RECURSIVE(LOCK_PROF_LVGL, s_lvgl_mutex);
             
             // Clamp delay
             if (task_delay_ms > UI_LVGL_TASK_MAX_DELAY_MS) {
@@ -139,7 +182,8 @@ esp_err_t ui_init(lv_disp_t **disp, lv_indev_t **touch_indev)
     s_lvgl_mutex = xSemaphoreCreateRecursiveMutex();
     ESP_RETURN_ON_FALSE(s_lvgl_mutex != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create mutex");
 
-    // Initialize LVGL
+    // Initialize LVGL (the pool allocator, if built, must exist first)
+    lvgl_alloc_init();
     lv_init();
 
     // Allocate draw buffers (in SPIRAM for better performance)
@@ -159,6 +203,7 @@ esp_err_t ui_init(lv_disp_t **disp, lv_indev_t **touch_indev)
     disp_drv.hor_res = CONFIG_LCD_H_RES;
     disp_drv.ver_res = CONFIG_LCD_V_RES;
     disp_drv.flush_cb = lvgl_flush_cb;
+    disp_drv.monitor_cb = lvgl_monitor_cb;
     disp_drv.draw_buf = &disp_buf;
     disp_drv.user_data = s_lcd_panel;
     
@@ -209,6 +254,15 @@ esp_err_t ui_init(lv_disp_t **disp, lv_indev_t **touch_indev)
     return ESP_OK;
 }
 
+#if CONFIG_LOCK_PROFILER
+bool ui_lock_at(const char *func, int line)
+{
+    if (s_lvgl_mutex == NULL) {
+        return false;
+    }
+    return lock_prof_take(LOCK_PROF_LVGL, s_lvgl_mutex, portMAX_DELAY, true, func, line) == pdTRUE;
+}
+#else
 bool ui_lock(void)
 {
     if (s_lvgl_mutex == NULL) {
@@ -216,10 +270,23 @@ bool ui_lock(void)
     }
     return xSemaphoreTakeRecursive(s_lvgl_mutex, portMAX_DELAY) == pdTRUE;
 }
+#endif
 
 void ui_unlock(void)
 {
     if (s_lvgl_mutex != NULL) {
-        xSemaphoreGiveRecursive(s_lvgl_mutex);
+        LOCK_PROF_GIVE_RECURSIVE(LOCK_PROF_LVGL, s_lvgl_mutex);
     }
 }
+
+void ui_set_multitouch_handler(ui_multitouch_cb_t cb)
+{
+    s_multitouch_cb = cb;
+    s_multitouch_active = false;
+}
+
+void ui_take_render_stats(ui_render_stats_t *out)
+{
+    *out = s_render_stats;
+    memset(&s_render_stats, 0, sizeof(s_render_stats));
+}
@@ -7,6 +7,7 @@
 
 #include "lvgl.h"
 #include "esp_err.h"
+#include "sdkconfig.h"
 #include "esp_lcd_types.h"
 #include <stdint.h>
 #include <stddef.h>
@@ -27,8 +28,11 @@ extern "C" {
 
 /**
  * @brief Maximum number of turnouts the panel can manage
+ *
+ * The turnout array grows on demand in PSRAM, so this costs nothing up
+ * front; it bounds the 16-bit indices used by the manager's event index.
  */
-#define TURNOUT_MAX_COUNT   150
+#define TURNOUT_MAX_COUNT   2000
 
 /**
  * @brief Turnout state enumeration
@@ -54,6 +58,7 @@ typedef struct {
     turnout_state_t state;      ///< Current known state
     int64_t last_update_us;     ///< Timestamp of last state update (esp_timer_get_time)
     bool command_pending;       ///< True when a command has been sent, awaiting confirmation
+    int64_t command_sent_us;    ///< When the pending command was sent (latency histogram)
     uint16_t user_order;        ///< User-assigned display order
 } turnout_t;
 
@@ -93,15 +98,63 @@ void ui_show_main(void);
 /**
  * @brief Lock LVGL mutex (for non-UI task access)
  * 
+ * With CONFIG_LOCK_PROFILER this is a macro that passes the call site.
+ *
  * @return true if locked successfully
  */
+#if CONFIG_LOCK_PROFILER
+bool ui_lock_at(const char *func, int line);
+#define ui_lock() ui_lock_at(__func__, __LINE__)
+#else
 bool ui_lock(void);
+#endif
 
 /**
  * @brief Unlock LVGL mutex
  */
 void ui_unlock(void);
 
+/**
+ * @brief Maximum simultaneous touch points forwarded to the multi-touch handler
+ */
+#define UI_TOUCH_MAX_POINTS 2
+
+/**
+ * @brief Multi-touch gesture handler
+ *
+ * Called from the LVGL touch read (LVGL task, UI lock held) while two or more
+ * fingers are down, and once more with @p count < 2 when the gesture ends.
+ * LVGL itself only tracks the first point.
+ *
+ * @param points Screen coordinates of the touch points
+ * @param count  Number of valid entries in @p points
+ * @return true to consume the gesture — LVGL then ignores the press until
+ *         all fingers are lifted (no click/drag on the object under finger 1)
+ */
+typedef bool (*ui_multitouch_cb_t)(const lv_point_t *points, uint8_t count);
+
+/**
+ * @brief Register (or clear with NULL) the multi-touch gesture handler
+ */
+void ui_set_multitouch_handler(ui_multitouch_cb_t cb);
+
+/**
+ * @brief Display refresh statistics since the last ui_take_render_stats()
+ */
+typedef struct {
+    uint32_t frames;        ///< Refreshes that redrew something
+    uint32_t render_ms;     ///< Total render time of those frames
+    uint32_t max_frame_ms;  ///< Longest single frame
+    uint32_t handler_us;    ///< Time spent in lv_timer_handler() (all LVGL work)
+} ui_render_stats_t;
+
+/**
+ * @brief Copy the render statistics and reset them
+ *
+ * LVGL task only (e.g. from an lv_timer) — the counters are not locked.
+ */
+void ui_take_render_stats(ui_render_stats_t *out);
+
 // ----- Main Screen Functions -----
 
 /**
@@ -175,6 +228,18 @@ void ui_add_turnout_discovery_event(uint64_t event_id, turnout_state_t state);
  */
 void ui_add_turnout_clear_discoveries(void);
 
+// ----- Diagnostics Tab Functions -----
+
+/**
+ * @brief Create the diagnostics tab content
+ *
+ * Live heap, LVGL, render, task and LCC traffic metrics, sampled once a
+ * second while the tab is visible.
+ *
+ * @param parent The tab container to build into
+ */
+void ui_create_diagnostics_tab(lv_obj_t *parent);
+
 // ============================================================================
 // Panel Layout Data Model (types, constants, operations → panel_layout.h)
 // ============================================================================
@@ -204,14 +269,24 @@ void ui_create_panel_screen(void);
 /**
  * @brief Update a turnout's visual state on the panel screen
  *
- * Lightweight update — changes line colors without full re-render.
- * Safe to call from LVGL async context.
+ * Lightweight update — recolours the turnout's legs and the track runs
+ * through it, without a full re-render.  Safe to call from LVGL async context.
  *
  * @param index Turnout index in the manager array
  * @param state New state to display
  */
 void ui_panel_update_turnout(int index, turnout_state_t state);
 
+/**
+ * @brief Update an occupancy block's overlay on the panel screen
+ *
+ * Recolours the tracks the block covers from its current state in the
+ * block manager.  Safe to call from LVGL async context.
+ *
+ * @param index Block index in the block manager array
+ */
+void ui_panel_update_block(int index);
+
 /**
  * @brief Invalidate panel screen tracking pointers
  *
@@ -231,9 +306,9 @@ void ui_panel_refresh(void);
 // ----- Settings Screen Functions -----
 
 /**
- * @brief Show the settings screen (tabview with 3 tabs)
+ * @brief Show the settings screen (tabview with 4 tabs)
  *
- * Creates a screen with: Turnouts, Add Turnout, Panel Builder tabs,
+ * Creates a screen with: Turnouts, Add Turnout, Panel Builder, Diagnostics tabs,
  * plus a back button to return to the control panel.
  */
 void ui_show_settings(void);
@@ -241,7 +316,8 @@ void ui_show_settings(void);
 /**
  * @brief Show the settings screen and jump directly to a specific tab
  *
- * @param tab_idx Zero-based tab index (0=Turnouts, 1=Add Turnout, 2=Panel Builder)
+ * @param tab_idx Zero-based tab index (0=Turnouts, 1=Add Turnout, 2=Panel Builder,
+ *                3=Diagnostics)
  */
 void ui_show_settings_at_tab(uint32_t tab_idx);
 
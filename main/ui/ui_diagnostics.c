@@ -0,0 +1,543 @@
+/**
+ * @file ui_diagnostics.c
+ * @brief Diagnostics Tab - live runtime metrics
+ *
+ * Shows, refreshed once a second:
+ *   - Internal RAM and PSRAM: free, lowest free since boot, largest block
+ *   - LVGL heap usage and fragmentation (lvgl_alloc_monitor)
+ *   - Render rate, frame time and LVGL task load
+ *   - LCC events in / out per second and state query sweep progress
+ *   - Per-task CPU share and stack high-water mark
+ *
+ * Buttons dump the pipeline trace ring (app/trace.h) to the SD card,
+ * start / stop a raw CAN capture (app/can_capture.h) and print the lock
+ * profiler's per-site tables (app/lock_prof.h) to the console; the worst
+ * wait and hold per lock are shown next to the last one.
+ *
+ * Sampling runs from an LVGL timer that exists only while the settings
+ * screen does, and skips its work while another tab is in front, so the
+ * tab costs nothing when nobody is looking at it.  Rates are computed from
+ * counter differences between two samples; the first sample after the tab
+ * is shown only sets the baseline.
+ */
+
+#include "ui_common.h"
+#include "lvgl_alloc.h"
+#include "app/lcc_node.h"
+#include "app/trace.h"
+#include "app/can_capture.h"
+#include "app/lock_prof.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "ui_diag";
+
+// ============================================================================
+// Layout constants
+// ============================================================================
+#define DIAG_PERIOD_MS      1000    // Sample / redraw interval
+#define DIAG_MAX_TASKS      32      // Task snapshot capacity
+#define DIAG_TASK_ROWS      14      // Busiest tasks listed
+#define DIAG_PAD            12
+#define DIAG_SYS_WIDTH      370
+#define DIAG_BTN_Y          278     // First action button row
+#define DIAG_BTN_GAP        48      // Row pitch of the action buttons
+#define DIAG_TRACE_PATH     "/sdcard/trace.bin"
+#define DIAG_CAPTURE_PATH   "/sdcard/can.bin"
+
+#define COLOR_TEXT_DARK     0x212121
+#define COLOR_TEXT_MUTED    0x616161
+#define COLOR_BTN           0x2196F3
+
+// ============================================================================
+// Internal state
+// ============================================================================
+static lv_obj_t *s_parent = NULL;
+static lv_obj_t *s_sys_label = NULL;
+static lv_obj_t *s_task_name = NULL;
+static lv_obj_t *s_task_cpu = NULL;
+static lv_obj_t *s_task_stack = NULL;
+static lv_obj_t *s_trace_label = NULL;
+static size_t s_trace_records = 0;      ///< Records in the queued dump
+static lv_obj_t *s_capture_btn_label = NULL;
+static lv_obj_t *s_capture_label = NULL;
+static bool s_capture_shown = false;    ///< Button reads "Stop capture"
+static lv_obj_t *s_locks_label = NULL;
+static lv_timer_t *s_timer = NULL;
+
+/// Previous sample (rates are differences against it)
+static struct {
+    bool     valid;
+    int64_t  time_us;
+    uint32_t events_in;
+    uint32_t events_out;
+} s_prev;
+
+#if configUSE_TRACE_FACILITY
+/// Task snapshots (PSRAM, allocated while the tab exists)
+typedef struct {
+    UBaseType_t number;         ///< xTaskNumber — stable per task
+    uint32_t    run_time;       ///< Run-time counter at the previous sample
+} task_prev_t;
+
+typedef struct {
+    const char *name;
+    uint32_t    cpu_permille;   ///< Share of one core since the previous sample
+    uint32_t    stack_free;     ///< Lowest free stack ever, bytes
+} task_row_t;
+
+static TaskStatus_t *s_task_status = NULL;
+static task_prev_t *s_task_prev = NULL;
+static size_t s_task_prev_count = 0;
+#endif
+
+// ============================================================================
+// Sampling
+// ============================================================================
+
+/** @brief Format a byte count as B / KB / MB */
+static void fmt_bytes(char *buf, size_t len, size_t bytes)
+{
+    if (bytes >= 1024 * 1024) {
+        snprintf(buf, len, "%u.%u MB", (unsigned)(bytes >> 20),
+                 (unsigned)(((bytes & 0xFFFFF) * 10) >> 20));
+    } else if (bytes >= 1024) {
+        snprintf(buf, len, "%u KB", (unsigned)(bytes >> 10));
+    } else {
+        snprintf(buf, len, "%u B", (unsigned)bytes);
+    }
+}
+
+static int heap_lines(char *buf, size_t len, const char *title, uint32_t caps)
+{
+    char free_s[16], min_s[16], big_s[16];
+    fmt_bytes(free_s, sizeof(free_s), heap_caps_get_free_size(caps));
+    fmt_bytes(min_s, sizeof(min_s), heap_caps_get_minimum_free_size(caps));
+    fmt_bytes(big_s, sizeof(big_s), heap_caps_get_largest_free_block(caps));
+    return snprintf(buf, len, "%s\n  free %s (low %s)\n  largest block %s\n",
+                    title, free_s, min_s, big_s);
+}
+
+static void update_system(int64_t dt_us)
+{
+    char text[768];
+    size_t n = 0;
+
+    n += heap_lines(text + n, sizeof(text) - n, "Internal RAM", MALLOC_CAP_INTERNAL);
+    n += heap_lines(text + n, sizeof(text) - n, "PSRAM", MALLOC_CAP_SPIRAM);
+
+    lv_mem_monitor_t mon;
+    lvgl_alloc_monitor(&mon);
+    if (mon.total_size > 0) {
+        char used_s[16], total_s[16], peak_s[16];
+        fmt_bytes(used_s, sizeof(used_s), mon.total_size - mon.free_size);
+        fmt_bytes(total_s, sizeof(total_s), mon.total_size);
+        fmt_bytes(peak_s, sizeof(peak_s), mon.max_used);
+        n += snprintf(text + n, sizeof(text) - n,
+                      "LVGL heap\n  %s / %s (%u%%), peak %s\n  fragmentation %u%%\n",
+                      used_s, total_s, (unsigned)mon.used_pct, peak_s,
+                      (unsigned)mon.frag_pct);
+    } else {
+        n += snprintf(text + n, sizeof(text) - n,
+                      "LVGL heap\n  system allocator (see heaps above)\n");
+    }
+#if CONFIG_LVGL_POOL_ALLOC
+    lvgl_alloc_stats_t as;
+    lvgl_alloc_get_stats(&as);
+    char large_s[16];
+    fmt_bytes(large_s, sizeof(large_s), as.large_used);
+    n += snprintf(text + n, sizeof(text) - n,
+                  "  pools %u slabs, PSRAM %s in %u blocks\n  %u fallbacks, %u failures\n",
+                  (unsigned)as.slabs_used, large_s, (unsigned)as.large_count,
+                  (unsigned)as.fallbacks, (unsigned)as.failures);
+#endif
+
+    ui_render_stats_t rs;
+    ui_take_render_stats(&rs);
+    uint32_t dt_ms = (uint32_t)(dt_us / 1000);
+    if (dt_ms == 0) dt_ms = 1;
+    uint32_t fps10 = rs.frames * 10000 / dt_ms;
+    n += snprintf(text + n, sizeof(text) - n,
+                  "Render\n  %u.%u fps, frame %u ms avg / %u ms max\n"
+                  "  LVGL task busy %u%%\n",
+                  (unsigned)(fps10 / 10), (unsigned)(fps10 % 10),
+                  (unsigned)(rs.frames ? rs.render_ms / rs.frames : 0),
+                  (unsigned)rs.max_frame_ms,
+                  (unsigned)((uint64_t)rs.handler_us * 100 / (uint64_t)dt_us));
+
+    lcc_node_stats_t ls;
+    lcc_node_get_stats(&ls);
+    uint32_t in_s = (uint32_t)((uint64_t)(ls.events_in - s_prev.events_in) * 1000 / dt_ms);
+    uint32_t out_s = (uint32_t)((uint64_t)(ls.events_out - s_prev.events_out) * 1000 / dt_ms);
+    s_prev.events_in = ls.events_in;
+    s_prev.events_out = ls.events_out;
+
+    const char *sweep = ls.sweep == LCC_SWEEP_TURNOUTS ? "turnouts" :
+                        ls.sweep == LCC_SWEEP_BLOCKS   ? "blocks"   : "idle, last";
+    n += snprintf(text + n, sizeof(text) - n,
+                  "LCC (%s)\n  events in %u/s, out %u/s\n  query sweep: %s %u/%u\n"
+                  "  last sweep: turnouts %u.%u s, blocks %u.%u s",
+                  lcc_node_get_status() == LCC_STATUS_RUNNING ? "online" : "offline",
+                  (unsigned)in_s, (unsigned)out_s, sweep,
+                  (unsigned)ls.sweep_done, (unsigned)ls.sweep_total,
+                  (unsigned)(ls.turnout_sweep_ms / 1000), (unsigned)(ls.turnout_sweep_ms % 1000 / 100),
+                  (unsigned)(ls.block_sweep_ms / 1000), (unsigned)(ls.block_sweep_ms % 1000 / 100));
+
+    lv_label_set_text(s_sys_label, text);
+}
+
+#if configUSE_TRACE_FACILITY
+static int task_row_cmp(const void *a, const void *b)
+{
+    const task_row_t *ra = a, *rb = b;
+    if (ra->cpu_permille != rb->cpu_permille) {
+        return ra->cpu_permille < rb->cpu_permille ? 1 : -1;
+    }
+    return strcmp(ra->name, rb->name);
+}
+
+/** @brief Previous run-time counter of a task, or its current one if new */
+static uint32_t task_prev_run_time(const TaskStatus_t *ts)
+{
+    for (size_t i = 0; i < s_task_prev_count; i++) {
+        if (s_task_prev[i].number == ts->xTaskNumber) return s_task_prev[i].run_time;
+    }
+    return (uint32_t)ts->ulRunTimeCounter;
+}
+
+static void update_tasks(int64_t dt_us)
+{
+    if (!s_task_status) return;
+
+    UBaseType_t count = uxTaskGetSystemState(s_task_status, DIAG_MAX_TASKS, NULL);
+    if (count == 0) {
+        lv_label_set_text_fmt(s_task_name, "More than %d tasks", DIAG_MAX_TASKS);
+        return;
+    }
+
+    task_row_t rows[DIAG_MAX_TASKS];
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *ts = &s_task_status[i];
+        uint32_t ran = (uint32_t)ts->ulRunTimeCounter - task_prev_run_time(ts);
+        rows[i].name = ts->pcTaskName;
+        // The run-time counter ticks in microseconds (esp_timer)
+        rows[i].cpu_permille = (uint32_t)((uint64_t)ran * 1000 / (uint64_t)dt_us);
+        rows[i].stack_free = (uint32_t)ts->usStackHighWaterMark;
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        s_task_prev[i].number = s_task_status[i].xTaskNumber;
+        s_task_prev[i].run_time = (uint32_t)s_task_status[i].ulRunTimeCounter;
+    }
+    s_task_prev_count = count;
+
+    qsort(rows, count, sizeof(rows[0]), task_row_cmp);
+
+    char names[DIAG_TASK_ROWS * 20 + 8], cpu[DIAG_TASK_ROWS * 10 + 8], stack[DIAG_TASK_ROWS * 12 + 8];
+    size_t nn = snprintf(names, sizeof(names), "Task");
+    size_t nc = snprintf(cpu, sizeof(cpu), "CPU");
+    size_t ns = snprintf(stack, sizeof(stack), "Stack free");
+    for (UBaseType_t i = 0; i < count && i < DIAG_TASK_ROWS; i++) {
+        nn += snprintf(names + nn, sizeof(names) - nn, "\n%.16s", rows[i].name);
+        nc += snprintf(cpu + nc, sizeof(cpu) - nc, "\n%u.%u%%",
+                       (unsigned)(rows[i].cpu_permille / 10),
+                       (unsigned)(rows[i].cpu_permille % 10));
+        ns += snprintf(stack + ns, sizeof(stack) - ns, "\n%u B",
+                       (unsigned)rows[i].stack_free);
+    }
+
+    lv_label_set_text(s_task_name, names);
+    lv_label_set_text(s_task_cpu, cpu);
+    lv_label_set_text(s_task_stack, stack);
+}
+#endif
+
+/** @brief Follow a running capture; restore the button once it has closed */
+static void update_capture(void)
+{
+    if (!s_capture_shown) return;
+
+    can_capture_stats_t cs;
+    can_capture_get_stats(&cs);
+    if (cs.running) {
+        lv_label_set_text_fmt(s_capture_label, "%u frames, %u dropped",
+                              (unsigned)cs.frames, (unsigned)cs.dropped);
+        return;
+    }
+    lv_label_set_text_fmt(s_capture_label, "%u frames, %u dropped\n" DIAG_CAPTURE_PATH,
+                          (unsigned)cs.written, (unsigned)cs.dropped);
+    lv_label_set_text(s_capture_btn_label, LV_SYMBOL_PLAY " Capture CAN");
+    s_capture_shown = false;
+}
+
+/** @brief Worst wait and hold over all call sites of each profiled lock */
+static void update_locks(void)
+{
+    char text[128];
+    size_t n = 0;
+    for (int id = 0; id < LOCK_PROF_COUNT && n < sizeof(text); id++) {
+        const lock_prof_stats_t *ls = lock_prof_get((lock_prof_id_t)id);
+        if (!ls) continue;
+        uint32_t wait = 0, hold = 0;
+        uint32_t sites = __atomic_load_n(&ls->site_count, __ATOMIC_ACQUIRE);
+        for (uint32_t i = 0; i < sites; i++) {
+            if (ls->sites[i].wait_max_us > wait) wait = ls->sites[i].wait_max_us;
+            if (ls->sites[i].hold_max_us > hold) hold = ls->sites[i].hold_max_us;
+        }
+        n += snprintf(text + n, sizeof(text) - n, "%s%s: wait %u.%u / hold %u.%u ms",
+                      n ? "\n" : "", ls->name,
+                      (unsigned)(wait / 1000), (unsigned)(wait % 1000 / 100),
+                      (unsigned)(hold / 1000), (unsigned)(hold % 1000 / 100));
+    }
+    if (n) lv_label_set_text(s_locks_label, text);
+}
+
+/** @brief Take the first sample after the tab came into view */
+static void sample_baseline(void)
+{
+    lcc_node_stats_t ls;
+    lcc_node_get_stats(&ls);
+    s_prev.events_in = ls.events_in;
+    s_prev.events_out = ls.events_out;
+    s_prev.time_us = esp_timer_get_time();
+    s_prev.valid = true;
+
+    ui_render_stats_t rs;
+    ui_take_render_stats(&rs);
+
+#if configUSE_TRACE_FACILITY
+    if (s_task_status) {
+        UBaseType_t count = uxTaskGetSystemState(s_task_status, DIAG_MAX_TASKS, NULL);
+        for (UBaseType_t i = 0; i < count; i++) {
+            s_task_prev[i].number = s_task_status[i].xTaskNumber;
+            s_task_prev[i].run_time = (uint32_t)s_task_status[i].ulRunTimeCounter;
+        }
+        s_task_prev_count = count;
+    }
+#endif
+}
+
+static bool tab_is_active(void)
+{
+    // parent = tab page → tabview content → tabview; page index = tab index
+    lv_obj_t *tabview = lv_obj_get_parent(lv_obj_get_parent(s_parent));
+    return tabview && lv_tabview_get_tab_act(tabview) == lv_obj_get_index(s_parent);
+}
+
+static void diag_timer_cb(lv_timer_t *timer)
+{
+    (void)timer;
+    if (!tab_is_active()) {
+        s_prev.valid = false;
+        return;
+    }
+    if (!s_prev.valid) {
+        sample_baseline();
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t dt_us = now - s_prev.time_us;
+    if (dt_us <= 0) return;
+    s_prev.time_us = now;
+
+    update_system(dt_us);
+    update_capture();
+    update_locks();
+#if configUSE_TRACE_FACILITY
+    update_tasks(dt_us);
+#endif
+}
+
+static void trace_written_async(void *arg)
+{
+    if (!s_trace_label) return;     // tab destroyed while the SD task wrote
+    if ((esp_err_t)(intptr_t)arg == ESP_OK) {
+        lv_label_set_text_fmt(s_trace_label, "%u records\n" DIAG_TRACE_PATH,
+                              (unsigned)s_trace_records);
+    } else {
+        lv_label_set_text(s_trace_label, "SD write failed");
+    }
+}
+
+/**
+ * @brief Trace write completion (SD task) - hands the result to the LVGL task
+ */
+static void trace_written_cb(esp_err_t result, char *data, size_t len, void *ctx)
+{
+    (void)data;
+    (void)len;
+    (void)ctx;
+    lv_async_call(trace_written_async, (void *)(intptr_t)result);
+}
+
+static void trace_dump_cb(lv_event_t *e)
+{
+    (void)e;
+    esp_err_t ret = trace_dump(DIAG_TRACE_PATH, &s_trace_records, trace_written_cb, NULL);
+    if (ret == ESP_OK) {
+        lv_label_set_text(s_trace_label, "Writing...");
+    } else if (ret == ESP_ERR_NOT_SUPPORTED) {
+        lv_label_set_text(s_trace_label, "Tracing disabled");
+    } else {
+        lv_label_set_text(s_trace_label, "SD write failed");
+    }
+}
+
+static void locks_dump_cb(lv_event_t *e)
+{
+    (void)e;
+    lock_prof_dump();
+}
+
+static void capture_toggle_cb(lv_event_t *e)
+{
+    (void)e;
+    can_capture_stats_t cs;
+    can_capture_get_stats(&cs);
+    if (cs.running) {
+        can_capture_stop();
+        lv_label_set_text(s_capture_label, "Stopping...");
+        return;
+    }
+
+    esp_err_t ret = can_capture_start(DIAG_CAPTURE_PATH);
+    if (ret == ESP_OK) {
+        lv_label_set_text(s_capture_btn_label, LV_SYMBOL_STOP " Stop capture");
+        lv_label_set_text(s_capture_label, "Capturing...");
+        s_capture_shown = true;
+    } else if (ret == ESP_ERR_NOT_SUPPORTED) {
+        lv_label_set_text(s_capture_label, "Capture disabled");
+    } else {
+        lv_label_set_text(s_capture_label, "Cannot start capture");
+    }
+}
+
+// ============================================================================
+// Tab lifecycle
+// ============================================================================
+
+static void diag_delete_cb(lv_event_t *e)
+{
+    (void)e;
+    if (s_timer) {
+        lv_timer_del(s_timer);
+        s_timer = NULL;
+    }
+#if configUSE_TRACE_FACILITY
+    heap_caps_free(s_task_status);
+    heap_caps_free(s_task_prev);
+    s_task_status = NULL;
+    s_task_prev = NULL;
+    s_task_prev_count = 0;
+#endif
+    s_parent = NULL;
+    s_sys_label = NULL;
+    s_task_name = s_task_cpu = s_task_stack = NULL;
+    s_trace_label = NULL;
+    s_capture_btn_label = s_capture_label = NULL;
+    s_locks_label = NULL;
+}
+
+static lv_obj_t *create_column(lv_obj_t *parent, lv_coord_t x, lv_coord_t width,
+                               const lv_font_t *font, const char *text)
+{
+    lv_obj_t *label = lv_label_create(parent);
+    lv_obj_set_pos(label, x, DIAG_PAD);
+    lv_obj_set_width(label, width);
+    lv_obj_set_style_text_font(label, font, LV_PART_MAIN);
+    lv_obj_set_style_text_color(label, lv_color_hex(COLOR_TEXT_DARK), LV_PART_MAIN);
+    lv_label_set_long_mode(label, LV_LABEL_LONG_CLIP);
+    lv_label_set_text(label, text);
+    return label;
+}
+
+/** @brief Button plus a status label to its right; returns the status label */
+static lv_obj_t *create_action(lv_obj_t *parent, lv_coord_t x, lv_coord_t y,
+                               const char *text, lv_event_cb_t cb, lv_obj_t **btn_label_out)
+{
+    lv_obj_t *btn = lv_btn_create(parent);
+    lv_obj_set_size(btn, 150, 40);
+    lv_obj_set_pos(btn, x, y);
+    lv_obj_set_style_bg_color(btn, lv_color_hex(COLOR_BTN), LV_PART_MAIN);
+    lv_obj_set_style_radius(btn, 6, LV_PART_MAIN);
+    lv_obj_add_event_cb(btn, cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *btn_label = lv_label_create(btn);
+    lv_label_set_text(btn_label, text);
+    lv_obj_set_style_text_font(btn_label, &lv_font_montserrat_14, LV_PART_MAIN);
+    lv_obj_set_style_text_color(btn_label, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+    lv_obj_center(btn_label);
+    if (btn_label_out) *btn_label_out = btn_label;
+
+    lv_obj_t *status = lv_label_create(parent);
+    lv_obj_set_pos(status, x + 162, y + 2);
+    lv_obj_set_style_text_font(status, &lv_font_montserrat_14, LV_PART_MAIN);
+    lv_obj_set_style_text_color(status, lv_color_hex(COLOR_TEXT_MUTED), LV_PART_MAIN);
+    lv_label_set_text(status, "");
+    return status;
+}
+
+void ui_create_diagnostics_tab(lv_obj_t *parent)
+{
+    s_parent = parent;
+    s_prev.valid = false;
+
+    lv_obj_set_style_pad_all(parent, 0, LV_PART_MAIN);
+    lv_obj_clear_flag(parent, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_event_cb(parent, diag_delete_cb, LV_EVENT_DELETE, NULL);
+
+    s_sys_label = create_column(parent, DIAG_PAD, DIAG_SYS_WIDTH,
+                                &lv_font_montserrat_16, "Sampling...");
+
+    lv_coord_t x = DIAG_PAD * 2 + DIAG_SYS_WIDTH;
+    s_task_name  = create_column(parent, x, 170, &lv_font_montserrat_14, "Task");
+    s_task_cpu   = create_column(parent, x + 175, 70, &lv_font_montserrat_14, "CPU");
+    s_task_stack = create_column(parent, x + 250, 120, &lv_font_montserrat_14, "Stack free");
+    lv_obj_set_style_text_align(s_task_cpu, LV_TEXT_ALIGN_RIGHT, LV_PART_MAIN);
+    lv_obj_set_style_text_align(s_task_stack, LV_TEXT_ALIGN_RIGHT, LV_PART_MAIN);
+
+#if configUSE_TRACE_FACILITY
+    s_task_status = heap_caps_malloc(DIAG_MAX_TASKS * sizeof(TaskStatus_t), MALLOC_CAP_SPIRAM);
+    s_task_prev = heap_caps_calloc(DIAG_MAX_TASKS, sizeof(task_prev_t), MALLOC_CAP_SPIRAM);
+    if (!s_task_status || !s_task_prev) {
+        ESP_LOGW(TAG, "No memory for task snapshots — task list disabled");
+        heap_caps_free(s_task_status);
+        heap_caps_free(s_task_prev);
+        s_task_status = NULL;
+        s_task_prev = NULL;
+    }
+#else
+    lv_label_set_text(s_task_name, "Task list needs\nCONFIG_FREERTOS_USE_\nTRACE_FACILITY");
+    lv_obj_set_width(s_task_name, 360);
+    lv_obj_set_style_text_color(s_task_name, lv_color_hex(COLOR_TEXT_MUTED), LV_PART_MAIN);
+    lv_obj_add_flag(s_task_cpu, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(s_task_stack, LV_OBJ_FLAG_HIDDEN);
+#endif
+
+    // Trace dump (copied on the UI task, written by the SD task)
+    s_trace_label = create_action(parent, x, DIAG_BTN_Y, LV_SYMBOL_SAVE " Dump trace",
+                                  trace_dump_cb, NULL);
+    // CAN capture (written by its own task; the label follows its progress)
+    s_capture_label = create_action(parent, x, DIAG_BTN_Y + DIAG_BTN_GAP,
+                                    LV_SYMBOL_PLAY " Capture CAN", capture_toggle_cb,
+                                    &s_capture_btn_label);
+    can_capture_stats_t cs;
+    can_capture_get_stats(&cs);
+    s_capture_shown = cs.running;
+    if (cs.running) lv_label_set_text(s_capture_btn_label, LV_SYMBOL_STOP " Stop capture");
+    // Lock profiler (tables go to the console; worst cases shown here)
+    s_locks_label = create_action(parent, x, DIAG_BTN_Y + 2 * DIAG_BTN_GAP,
+                                  LV_SYMBOL_LIST " Dump locks", locks_dump_cb, NULL);
+#if !CONFIG_LOCK_PROFILER
+    lv_label_set_text(s_locks_label, "Profiler disabled");
+#endif
+
+    s_timer = lv_timer_create(diag_timer_cb, DIAG_PERIOD_MS, NULL);
+    ESP_LOGI(TAG, "Diagnostics tab created");
+}
@@ -0,0 +1,141 @@
+/**
+ * @file ui_dirty.c
+ * @brief Coalesced state-change path from the LCC thread to the UI
+ *
+ * One bitmap per element kind, sized by the manager limits, so marking
+ * never allocates.  Bits and the pending flag are guarded by a spinlock
+ * held for a few instructions; the flush takes each bitmap word and clears
+ * it in one step, then redraws outside the lock.  The pending flag is
+ * cleared before the bitmaps are scanned, so a mark that races the flush
+ * queues another one rather than being lost.
+ */
+
+#include "ui_dirty.h"
+#include "ui_common.h"
+#include "app/turnout_manager.h"
+#include "app/trace.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "ui_dirty";
+
+#define WORD_BITS           32
+#define WORDS(n)            (((n) + WORD_BITS - 1) / WORD_BITS)
+
+static uint32_t s_turnout_bits[WORDS(TURNOUT_MAX_COUNT)];
+static uint32_t s_block_bits[WORDS(PANEL_MAX_BLOCKS)];
+
+static const struct {
+    uint32_t *bits;
+    size_t    limit;
+} s_kinds[UI_DIRTY_KIND_COUNT] = {
+    [UI_DIRTY_TURNOUT] = { s_turnout_bits, TURNOUT_MAX_COUNT },
+    [UI_DIRTY_BLOCK]   = { s_block_bits,   PANEL_MAX_BLOCKS },
+};
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_pending = false;          ///< A flush is queued
+static int64_t s_first_mark_us = 0;     ///< When the queued flush was requested
+static ui_dirty_stats_t s_stats;
+
+// ============================================================================
+// Flush (LVGL task)
+// ============================================================================
+
+static void redraw(ui_dirty_kind_t kind, size_t index)
+{
+    if (kind == UI_DIRTY_BLOCK) {
+        ui_panel_update_block((int)index);
+        TRACE(TRACE_UI_APPLY, TRACE_KIND_BLOCK, index, 0);
+        return;
+    }
+
+    turnout_t t;
+    if (turnout_manager_get_by_index(index, &t) != ESP_OK) return;
+    ui_turnouts_update_tile((int)index, t.state);
+    ui_panel_update_turnout((int)index, t.state);
+    TRACE(TRACE_UI_APPLY, TRACE_KIND_TURNOUT, index,
+          t.state == TURNOUT_STATE_NORMAL  ? t.event_normal :
+          t.state == TURNOUT_STATE_REVERSE ? t.event_reverse : 0);
+}
+
+static void flush_async(void *param)
+{
+    (void)param;
+    int64_t t0 = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    s_pending = false;
+    int64_t marked_us = s_first_mark_us;
+    portEXIT_CRITICAL(&s_lock);
+
+    uint32_t redraws = 0;
+    for (int kind = 0; kind < UI_DIRTY_KIND_COUNT; kind++) {
+        uint32_t *bits = s_kinds[kind].bits;
+        for (size_t w = 0; w < WORDS(s_kinds[kind].limit); w++) {
+            if (!bits[w]) continue;     // racy peek; a missed bit re-queued a flush
+
+            portENTER_CRITICAL(&s_lock);
+            uint32_t word = bits[w];
+            bits[w] = 0;
+            portEXIT_CRITICAL(&s_lock);
+
+            while (word) {
+                int b = __builtin_ctz(word);
+                word &= word - 1;
+                redraw((ui_dirty_kind_t)kind, w * WORD_BITS + (size_t)b);
+                redraws++;
+            }
+        }
+    }
+
+    int64_t t1 = esp_timer_get_time();
+    TRACE(TRACE_FLUSH_DONE, TRACE_KIND_NONE, redraws, 0);
+    uint32_t latency_us = (uint32_t)(t0 - marked_us);
+    uint32_t flush_us = (uint32_t)(t1 - t0);
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.flushes++;
+    s_stats.redraws += redraws;
+    if (latency_us > s_stats.max_latency_us) s_stats.max_latency_us = latency_us;
+    if (flush_us > s_stats.max_flush_us) s_stats.max_flush_us = flush_us;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void ui_dirty_mark(ui_dirty_kind_t kind, size_t index)
+{
+    if ((unsigned)kind >= UI_DIRTY_KIND_COUNT || index >= s_kinds[kind].limit) return;
+
+    portENTER_CRITICAL(&s_lock);
+    s_kinds[kind].bits[index / WORD_BITS] |= 1u << (index % WORD_BITS);
+    s_stats.marks++;
+    bool queue = !s_pending;
+    if (queue) {
+        s_pending = true;
+        s_first_mark_us = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&s_lock);
+    TRACE(TRACE_UI_SCHED, kind == UI_DIRTY_BLOCK ? TRACE_KIND_BLOCK : TRACE_KIND_TURNOUT,
+          index, 0);
+
+    if (queue && lv_async_call(flush_async, NULL) != LV_RES_OK) {
+        ESP_LOGW(TAG, "Could not queue UI flush");
+        portENTER_CRITICAL(&s_lock);
+        s_pending = false;      // the next mark retries
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+void ui_dirty_take_stats(ui_dirty_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    memset(&s_stats, 0, sizeof(s_stats));
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,52 @@
+/**
+ * @file ui_dirty.h
+ * @brief Coalesced state-change path from the LCC thread to the UI
+ *
+ * State callbacks (turnouts, occupancy blocks) run on the LCC executor and
+ * only set a bit per changed element.  The first mark after a flush queues
+ * one lv_async_call; the flush then redraws each marked element once from
+ * its manager's current state.  A burst of N changes costs N bit sets and a
+ * single UI pass, however fast the bus reports them.
+ */
+
+#ifndef UI_DIRTY_H_
+#define UI_DIRTY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Kind of element, i.e. which manager an index refers to */
+typedef enum {
+    UI_DIRTY_TURNOUT = 0,       ///< turnout_manager index
+    UI_DIRTY_BLOCK,             ///< block_manager index
+    UI_DIRTY_KIND_COUNT
+} ui_dirty_kind_t;
+
+/** @brief Flush statistics since the last ui_dirty_take_stats() */
+typedef struct {
+    uint32_t marks;             ///< ui_dirty_mark() calls
+    uint32_t flushes;           ///< UI passes that ran
+    uint32_t redraws;           ///< Elements redrawn (marks after coalescing)
+    uint32_t max_latency_us;    ///< Longest first-mark → flush delay
+    uint32_t max_flush_us;      ///< Longest UI pass
+} ui_dirty_stats_t;
+
+/**
+ * @brief Mark an element for redraw
+ *
+ * Safe from any task (not from ISRs).  Out-of-range indices are ignored.
+ */
+void ui_dirty_mark(ui_dirty_kind_t kind, size_t index);
+
+/** @brief Copy the statistics and reset them */
+void ui_dirty_take_stats(ui_dirty_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UI_DIRTY_H_
@@ -3,11 +3,14 @@
  * @brief Main UI Navigation — Panel Screen (default) and Settings Screen
  *
  * The default screen is the Control Panel (layout diagram). A settings gear
- * icon navigates to a tabview with: Turnouts, Add Turnout, Panel Builder.
+ * icon navigates to a tabview with: Turnouts, Add Turnout, Panel Builder,
+ * Diagnostics.
  * A back button on the settings screen returns to the panel.
  */
 
 #include "ui_common.h"
+#include "mem_budget.h"
+#include "app/turnout_manager.h"
 #include "esp_log.h"
 #include <string.h>
 
@@ -18,12 +21,13 @@ static lv_obj_t *s_tabview = NULL;
 static lv_obj_t *s_tab_turnouts = NULL;
 static lv_obj_t *s_tab_add = NULL;
 static lv_obj_t *s_tab_builder = NULL;
+static lv_obj_t *s_tab_diag = NULL;
 
 // Forward declaration
 static void back_btn_cb(lv_event_t *e);
 
 // ============================================================================
-// Settings Screen (3-tab tabview)
+// Settings Screen (4-tab tabview)
 // ============================================================================
 
 static void ui_create_settings_screen(void)
@@ -64,10 +68,12 @@ static void ui_create_settings_screen(void)
     s_tab_turnouts = lv_tabview_add_tab(s_tabview, "Turnouts");
     s_tab_add = lv_tabview_add_tab(s_tabview, "Add Turnout");
     s_tab_builder = lv_tabview_add_tab(s_tabview, "Panel Builder");
+    s_tab_diag = lv_tabview_add_tab(s_tabview, "Diagnostics");
 
     lv_obj_set_style_bg_color(s_tab_turnouts, lv_color_make(245, 245, 245), LV_PART_MAIN);
     lv_obj_set_style_bg_color(s_tab_add, lv_color_make(245, 245, 245), LV_PART_MAIN);
     lv_obj_set_style_bg_color(s_tab_builder, lv_color_make(245, 245, 245), LV_PART_MAIN);
+    lv_obj_set_style_bg_color(s_tab_diag, lv_color_make(245, 245, 245), LV_PART_MAIN);
 
     // Disable swipe gesture between tabs — horizontal swipe conflicts with
     // drag-and-drop in the Panel Builder canvas. Users switch tabs by tapping.
@@ -77,10 +83,17 @@ static void ui_create_settings_screen(void)
         lv_obj_set_style_pad_all(tv_content, 0, LV_PART_MAIN);
     }
 
-    // Create tab content
+    // Create tab content, logging each tab's share of the LVGL pool
+    mem_snapshot_t mem;
+    mem_budget_snapshot(&mem);
     ui_create_turnouts_tab(s_tab_turnouts);
+    mem_budget_feature("turnouts", turnout_manager_get_count(), &mem);
     ui_create_add_turnout_tab(s_tab_add);
+    mem_budget_feature("add", 0, &mem);
     ui_create_panel_builder_tab(s_tab_builder);
+    mem_budget_feature("builder", panel_layout_get()->item_count, &mem);
+    ui_create_diagnostics_tab(s_tab_diag);
+    mem_budget_feature("diag", 0, &mem);
 
     // Back button — overlaid on top-left of screen, over the tab bar
     lv_obj_t *back_btn = lv_btn_create(scr);
@@ -98,6 +111,7 @@ static void ui_create_settings_screen(void)
     lv_obj_set_style_text_color(back_label, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
     lv_obj_center(back_label);
 
+    mem_budget_checkpoint(MEM_CP_SETTINGS, panel_layout_get()->item_count);
     ESP_LOGI(TAG, "Settings screen created");
     ui_unlock();
 }
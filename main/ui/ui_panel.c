@@ -4,16 +4,22 @@
  *
  * This is the default screen shown on boot. It displays a spatial diagram
  * of turnout Y-shapes at user-defined positions, connected by straight track
- * lines. Tapping a turnout toggles its position via LCC events. A settings
- * gear icon in the upper-right navigates to the settings tabs.
+ * lines. Tapping a turnout toggles its position via LCC events. Tapping two
+ * endpoints lines the route between them (entrance-exit). Tracks in an
+ * occupied block are overlaid in red. A settings gear icon in the
+ * upper-right navigates to the settings tabs.
  */
 
 #include "ui_common.h"
 #include "panel_layout.h"
 #include "panel_geometry.h"
+#include "mem_budget.h"
 #include "app/turnout_manager.h"
+#include "app/block_manager.h"
 #include "app/lcc_node.h"
 #include "app/panel_storage.h"
+#include "app/panel_routes.h"
+#include "app/psram_array.h"
 #include "esp_log.h"
 #include <string.h>
 
@@ -37,17 +43,60 @@ static lv_obj_t *s_empty_btn = NULL;        ///< "Open Panel Builder" button
 
 /// Per-item LVGL objects for lightweight state updates
 #define MAX_LINES_PER_ITEM 2
-static lv_obj_t *s_item_lines[PANEL_MAX_ITEMS][MAX_LINES_PER_ITEM];  ///< line objects per item
-static lv_obj_t *s_item_hitbox[PANEL_MAX_ITEMS];                      ///< clickable overlay per item
-static lv_obj_t *s_track_lines[PANEL_MAX_TRACKS];                     ///< track line objects
+typedef struct {
+    lv_obj_t       *lines[MAX_LINES_PER_ITEM];     ///< Leg line objects
+    lv_obj_t       *hitbox;                        ///< Clickable overlay
+    lv_point_t      points[MAX_LINES_PER_ITEM][2]; ///< Leg points (LVGL line needs persistent data)
+    turnout_state_t state;                         ///< State snapshot taken at render
+    bool            found;                         ///< Turnout exists in the manager
+} panel_item_obj_t;
+
+typedef struct {
+    lv_obj_t   *line;
+    lv_point_t  points[2];
+    uint32_t    stamp;          ///< Last run walk that visited this track
+    bool        lined;          ///< On an end-to-end path set by the turnouts
+    bool        on_route;       ///< Part of the highlighted route
+    bool        occupied;       ///< In an occupied block
+} panel_track_obj_t;
+
+typedef struct {
+    lv_obj_t   *hitbox;         ///< Clickable area (route entrance / exit)
+    lv_obj_t   *dot;            ///< Visible marker
+} panel_endpoint_obj_t;
+
+/// Render records, parallel to the layout arrays.  Grown in PSRAM before a
+/// render creates any line, so the point arrays never move under LVGL.
+static panel_item_obj_t  *s_items = NULL;
+static size_t             s_item_capacity = 0;
+static panel_track_obj_t *s_tracks = NULL;
+static size_t             s_track_capacity = 0;
+static panel_endpoint_obj_t *s_endpoints = NULL;
+static size_t             s_endpoint_capacity = 0;
 static size_t s_rendered_item_count = 0;
 static size_t s_rendered_track_count = 0;
-
-/// Static line point arrays (LVGL line needs persistent point data)
-static lv_point_t s_line_points[PANEL_MAX_ITEMS][MAX_LINES_PER_ITEM][2];
-
-/// Track line point arrays
-static lv_point_t s_track_points[PANEL_MAX_TRACKS][2];
+static size_t s_rendered_endpoint_count = 0;
+
+/// Entrance-exit routing: the first endpoint tap picks the entrance, the
+/// second looks the route up, highlights it and commands its turnouts one
+/// per pace tick (the CDI query pace, so a long route doesn't flood the bus).
+static struct {
+    int                  entrance;  ///< Endpoint index awaiting an exit, -1 = none
+    const panel_route_t *route;     ///< Highlighted route, NULL = none
+    size_t               next_step; ///< Next route step the batch will command
+    lv_timer_t          *timer;     ///< Paced command batch, NULL when idle
+} s_route = { .entrance = -1 };
+
+/// Lined-path colouring.  A "run" is the chain of tracks joined through each
+/// turnout's set leg; a run is lined when no turnout along it is set against
+/// it (or unknown).  A state change re-walks only the runs through that
+/// turnout, so recolouring is O(run length), not O(layout).
+static uint32_t  s_run_stamp = 0;       ///< Current walk; tracks visited carry it
+static uint16_t *s_run = NULL;          ///< Tracks of the run being walked
+static size_t    s_run_count = 0;
+static size_t    s_run_capacity = 0;
+static uint16_t *s_adjacent = NULL;     ///< Tracks at the turnout (or in the block) that changed
+static size_t    s_adjacent_capacity = 0;
 
 // ============================================================================
 // Color Helpers
@@ -58,8 +107,15 @@ static lv_point_t s_track_points[PANEL_MAX_TRACKS][2];
 #define COLOR_UNKNOWN   0x9E9E9E    // Grey
 #define COLOR_STALE     0xF44336    // Red
 #define COLOR_TRACK     0x424242    // Dark grey for track lines
+#define COLOR_TRACK_LINED 0xE0E0E0  // Near-white for lined track
 #define COLOR_PANEL_BG  0x1E1E1E    // Dark background for layout
 #define COLOR_ORPHAN    0x795548    // Brown for unresolved turnouts
+#define COLOR_ENDPOINT  0x757575    // Light grey endpoint markers
+#define COLOR_ROUTE     0x2196F3    // Blue for the selected route
+#define COLOR_OCCUPIED  0xF44336    // Red for track in an occupied block
+
+/** @brief Minimum spacing between route commands (ms) */
+#define ROUTE_PACE_MIN_MS 50
 
 /** @brief Padding (pixels) inside canvas when auto-fitting the layout */
 #define FIT_MARGIN 20
@@ -140,6 +196,262 @@ static void turnout_click_cb(lv_event_t *e)
     lcc_node_send_event(send_event);
 }
 
+// ============================================================================
+// Track Colouring
+// ============================================================================
+
+/** @brief Colour a track line: occupancy, then route highlight, then lined, then plain */
+static void track_apply_color(size_t t)
+{
+    panel_track_obj_t *obj = &s_tracks[t];
+    if (!obj->line) return;
+    uint32_t color = obj->occupied ? COLOR_OCCUPIED :
+                     obj->on_route ? COLOR_ROUTE :
+                     obj->lined    ? COLOR_TRACK_LINED : COLOR_TRACK;
+    lv_obj_set_style_line_color(obj->line, lv_color_hex(color), LV_PART_MAIN);
+}
+
+/** @brief Add the tracks at @p node not yet visited by this walk to the run */
+static bool run_push_node(const panel_ref_t *node)
+{
+    for (uint16_t l = panel_layout_first_link(&s_layout, node); l != PANEL_LINK_NONE;
+         l = panel_layout_next_link(&s_layout, l)) {
+        size_t t = PANEL_LINK_TRACK(l);
+        if (t >= s_rendered_track_count || s_tracks[t].stamp == s_run_stamp) continue;
+        if (!psram_array_reserve((void **)&s_run, &s_run_capacity,
+                                 s_run_count + 1, sizeof(s_run[0]))) {
+            return false;
+        }
+        s_tracks[t].stamp = s_run_stamp;
+        s_run[s_run_count++] = (uint16_t)t;
+    }
+    return true;
+}
+
+/**
+ * @brief Continue the run through one track end
+ * @return false if a turnout there is set against the run (or unknown)
+ */
+static bool run_follow(const panel_ref_t *node)
+{
+    if (!run_push_node(node)) return false;
+    if (node->type != PANEL_REF_TURNOUT) return true;
+
+    int item = panel_layout_find_item(&s_layout, node->id);
+    if (item < 0) return true;                  // dangling end
+    if ((size_t)item >= s_rendered_item_count || !s_items[item].found) return false;
+
+    panel_point_type_t leg;
+    switch (s_items[item].state) {
+        case TURNOUT_STATE_NORMAL:  leg = PANEL_POINT_NORMAL;  break;
+        case TURNOUT_STATE_REVERSE: leg = PANEL_POINT_REVERSE; break;
+        default:                    return false;
+    }
+
+    panel_ref_t through = *node;
+    if (node->point == PANEL_POINT_ENTRY) {
+        through.point = leg;
+    } else if (node->point == leg) {
+        through.point = PANEL_POINT_ENTRY;
+    } else {
+        return false;
+    }
+    return run_push_node(&through);
+}
+
+/**
+ * @brief Walk the run containing track @p start and recolour its tracks
+ *        whose lined state changed.  Bump s_run_stamp before a batch of calls.
+ */
+static void run_resolve(size_t start)
+{
+    if (s_tracks[start].stamp == s_run_stamp) return;
+    if (!psram_array_reserve((void **)&s_run, &s_run_capacity, 1, sizeof(s_run[0]))) return;
+
+    s_tracks[start].stamp = s_run_stamp;
+    s_run[0] = (uint16_t)start;
+    s_run_count = 1;
+
+    bool lined = true;
+    for (size_t k = 0; k < s_run_count; k++) {
+        const panel_track_t *pt = &s_layout.tracks[s_run[k]];
+        lined &= run_follow(&pt->from);
+        lined &= run_follow(&pt->to);
+    }
+
+    for (size_t k = 0; k < s_run_count; k++) {
+        panel_track_obj_t *obj = &s_tracks[s_run[k]];
+        if (obj->lined != lined) {
+            obj->lined = lined;
+            track_apply_color(s_run[k]);
+        }
+    }
+}
+
+/** @brief Collect an element's tracks into s_adjacent, growing it as needed */
+static size_t collect_adjacent(panel_ref_type_t type, uint32_t id)
+{
+    size_t n = panel_layout_collect_tracks(&s_layout, type, id,
+                                           s_adjacent, s_adjacent_capacity);
+    if (n > s_adjacent_capacity) {
+        if (!psram_array_reserve((void **)&s_adjacent, &s_adjacent_capacity,
+                                 n, sizeof(s_adjacent[0]))) {
+            n = s_adjacent_capacity;
+        }
+        n = panel_layout_collect_tracks(&s_layout, type, id, s_adjacent, n);
+    }
+    return n;
+}
+
+/** @brief Recolour the runs through turnout item @p item after its state changed */
+static void runs_update_item(size_t item)
+{
+    size_t n = collect_adjacent(PANEL_REF_TURNOUT, s_layout.items[item].turnout_id);
+
+    s_run_stamp++;
+    for (size_t k = 0; k < n; k++) {
+        if (s_adjacent[k] < s_rendered_track_count) run_resolve(s_adjacent[k]);
+    }
+}
+
+/**
+ * @brief Recolour the tracks of block @p index (block manager array) whose
+ *        occupancy changed
+ */
+static void block_apply(size_t index)
+{
+    block_t b;
+    if (block_manager_get_by_index(index, &b) != ESP_OK) return;
+
+    bool occupied = b.state == BLOCK_STATE_OCCUPIED;
+    size_t n = collect_adjacent(PANEL_REF_BLOCK, b.id);
+    for (size_t k = 0; k < n; k++) {
+        size_t t = s_adjacent[k];
+        if (t < s_rendered_track_count && s_tracks[t].occupied != occupied) {
+            s_tracks[t].occupied = occupied;
+            track_apply_color(t);
+        }
+    }
+}
+
+// ============================================================================
+// Entrance-Exit Routes
+// ============================================================================
+
+static void route_mark_entrance(int index)
+{
+    int old = s_route.entrance;
+    if (old >= 0 && (size_t)old < s_rendered_endpoint_count && s_endpoints[old].dot) {
+        lv_obj_set_style_bg_color(s_endpoints[old].dot, lv_color_hex(COLOR_ENDPOINT), LV_PART_MAIN);
+    }
+    s_route.entrance = index;
+    if (index >= 0 && (size_t)index < s_rendered_endpoint_count && s_endpoints[index].dot) {
+        lv_obj_set_style_bg_color(s_endpoints[index].dot, lv_color_hex(COLOR_ROUTE), LV_PART_MAIN);
+    }
+}
+
+static void route_highlight(const panel_route_t *route, bool on)
+{
+    const uint16_t *tracks = panel_routes_tracks(route);
+    for (size_t k = 0; k < route->track_count; k++) {
+        if (tracks[k] < s_rendered_track_count) {
+            s_tracks[tracks[k]].on_route = on;
+            track_apply_color(tracks[k]);
+        }
+    }
+}
+
+/**
+ * @brief Stop the command batch and drop the highlight and any entrance.
+ *        Call before the route table is rebuilt.
+ */
+static void route_cancel(void)
+{
+    if (s_route.timer) {
+        lv_timer_del(s_route.timer);
+        s_route.timer = NULL;
+    }
+    if (s_route.route) {
+        route_highlight(s_route.route, false);
+        s_route.route = NULL;
+    }
+    route_mark_entrance(-1);
+}
+
+/**
+ * @brief Command the next turnout on the route that is not already lined.
+ *        One command per tick; the timer ends itself after the last step.
+ */
+static void route_batch_timer_cb(lv_timer_t *timer)
+{
+    const panel_route_t *route = s_route.route;
+    const panel_route_step_t *steps = route ? panel_routes_steps(route) : NULL;
+
+    while (route && s_route.next_step < route->step_count) {
+        const panel_route_step_t *step = &steps[s_route.next_step++];
+        if (step->item >= s_layout.item_count) continue;
+
+        int tm_idx = turnout_manager_find_by_id(s_layout.items[step->item].turnout_id);
+        turnout_t t;
+        if (tm_idx < 0 || turnout_manager_get_by_index((size_t)tm_idx, &t) != ESP_OK) continue;
+
+        turnout_state_t want = step->leg == PANEL_POINT_REVERSE ? TURNOUT_STATE_REVERSE
+                                                                : TURNOUT_STATE_NORMAL;
+        if (t.state == want) continue;
+
+        turnout_manager_set_pending((size_t)tm_idx, true);
+        lcc_node_send_event(want == TURNOUT_STATE_REVERSE ? t.event_reverse : t.event_normal);
+        return;
+    }
+
+    lv_timer_del(timer);
+    s_route.timer = NULL;
+    ESP_LOGI(TAG, "Route commands sent");
+}
+
+static void route_start(const panel_route_t *route)
+{
+    route_cancel();
+    s_route.route = route;
+    s_route.next_step = 0;
+    route_highlight(route, true);
+
+    uint32_t pace = lcc_node_get_query_pace_ms();
+    if (pace < ROUTE_PACE_MIN_MS) pace = ROUTE_PACE_MIN_MS;
+    s_route.timer = lv_timer_create(route_batch_timer_cb, pace, NULL);
+    if (s_route.timer) lv_timer_ready(s_route.timer);   // first command now
+}
+
+static void endpoint_click_cb(lv_event_t *e)
+{
+    lv_event_code_t code = lv_event_get_code(e);
+    if (code != LV_EVENT_CLICKED) return;
+
+    size_t ep_idx = (size_t)(uintptr_t)lv_event_get_user_data(e);
+    if (ep_idx >= s_rendered_endpoint_count || ep_idx >= s_layout.endpoint_count) return;
+
+    int entrance = s_route.entrance;
+    if (entrance < 0 || (size_t)entrance >= s_layout.endpoint_count) {
+        route_mark_entrance((int)ep_idx);
+        return;
+    }
+
+    route_mark_entrance(-1);
+    if ((size_t)entrance == ep_idx) return;     // second tap on the entrance cancels
+
+    uint32_t from_id = s_layout.endpoints[entrance].id;
+    uint32_t to_id = s_layout.endpoints[ep_idx].id;
+    const panel_route_t *route = panel_routes_find(from_id, to_id);
+    if (!route) {
+        ESP_LOGW(TAG, "No route from endpoint %u to %u", (unsigned)from_id, (unsigned)to_id);
+        return;
+    }
+
+    ESP_LOGI(TAG, "Route %u -> %u: %d turnouts, %d tracks", (unsigned)from_id,
+             (unsigned)to_id, (int)route->step_count, (int)route->track_count);
+    route_start(route);
+}
+
 // ============================================================================
 // Settings Button Handler
 // ============================================================================
@@ -184,6 +496,20 @@ static void open_builder_btn_cb(lv_event_t *e)
 // Rendering
 // ============================================================================
 
+/**
+ * @brief Drop references to rendered objects without deleting them
+ *        (their screen has been or is about to be cleaned)
+ */
+static void panel_forget_render(void)
+{
+    s_rendered_item_count = 0;
+    s_rendered_track_count = 0;
+    s_rendered_endpoint_count = 0;
+    if (s_items) memset(s_items, 0, s_item_capacity * sizeof(s_items[0]));
+    if (s_tracks) memset(s_tracks, 0, s_track_capacity * sizeof(s_tracks[0]));
+    if (s_endpoints) memset(s_endpoints, 0, s_endpoint_capacity * sizeof(s_endpoints[0]));
+}
+
 /**
  * @brief Clear all rendered objects from the canvas
  */
@@ -191,27 +517,38 @@ static void panel_clear_render(void)
 {
     // Items
     for (size_t i = 0; i < s_rendered_item_count; i++) {
+        panel_item_obj_t *obj = &s_items[i];
         for (int l = 0; l < MAX_LINES_PER_ITEM; l++) {
-            if (s_item_lines[i][l]) {
-                lv_obj_del(s_item_lines[i][l]);
-                s_item_lines[i][l] = NULL;
+            if (obj->lines[l]) {
+                lv_obj_del(obj->lines[l]);
+                obj->lines[l] = NULL;
             }
         }
-        if (s_item_hitbox[i]) {
-            lv_obj_del(s_item_hitbox[i]);
-            s_item_hitbox[i] = NULL;
+        if (obj->hitbox) {
+            lv_obj_del(obj->hitbox);
+            obj->hitbox = NULL;
         }
     }
     s_rendered_item_count = 0;
 
     // Tracks
     for (size_t i = 0; i < s_rendered_track_count; i++) {
-        if (s_track_lines[i]) {
-            lv_obj_del(s_track_lines[i]);
-            s_track_lines[i] = NULL;
+        if (s_tracks[i].line) {
+            lv_obj_del(s_tracks[i].line);
+            s_tracks[i].line = NULL;
         }
     }
     s_rendered_track_count = 0;
+
+    // Endpoints (the dot is a child of the hitbox)
+    for (size_t i = 0; i < s_rendered_endpoint_count; i++) {
+        if (s_endpoints[i].hitbox) {
+            lv_obj_del(s_endpoints[i].hitbox);
+            s_endpoints[i].hitbox = NULL;
+            s_endpoints[i].dot = NULL;
+        }
+    }
+    s_rendered_endpoint_count = 0;
 }
 
 /**
@@ -221,6 +558,7 @@ static void panel_render(void)
 {
     if (!s_canvas) return;
 
+    route_cancel();
     panel_clear_render();
 
     // Show/hide empty state
@@ -236,6 +574,9 @@ static void panel_render(void)
 
     if (empty) return;
 
+    // Routes follow the layout topology; rebuilt only when it changed
+    panel_routes_build(&s_layout);
+
     // --- Compute auto-fit transform (scale + center) ---
     {
         int16_t min_x, min_y, max_x, max_y;
@@ -264,70 +605,85 @@ static void panel_render(void)
         }
     }
 
-    // --- Snapshot turnout states under a single lock (#2: batch lookups) ---
-    turnout_state_t item_states[PANEL_MAX_ITEMS];
-    bool item_found[PANEL_MAX_ITEMS];
+    // --- Size the render records (before any line points at them) ---
+    size_t item_count = s_layout.item_count;
+    size_t track_count = s_layout.track_count;
+    size_t endpoint_count = s_layout.endpoint_count;
+    if (!psram_array_reserve((void **)&s_items, &s_item_capacity,
+                             item_count, sizeof(s_items[0]))) {
+        item_count = s_item_capacity;
+    }
+    if (!psram_array_reserve((void **)&s_tracks, &s_track_capacity,
+                             track_count, sizeof(s_tracks[0]))) {
+        track_count = s_track_capacity;
+    }
+    if (!psram_array_reserve((void **)&s_endpoints, &s_endpoint_capacity,
+                             endpoint_count, sizeof(s_endpoints[0]))) {
+        endpoint_count = s_endpoint_capacity;
+    }
+
+    // --- Turnout states from one table snapshot (#2: batch lookups) ---
     {
-        turnout_manager_lock();
-        const turnout_t *turnouts;
-        size_t turnout_count;
-        turnout_manager_get_all(&turnouts, &turnout_count);
-        for (size_t i = 0; i < s_layout.item_count && i < PANEL_MAX_ITEMS; i++) {
-            item_states[i] = TURNOUT_STATE_UNKNOWN;
-            item_found[i] = false;
+        const turnout_snapshot_t *snap = turnout_manager_snapshot_acquire();
+        const turnout_t *turnouts = snap ? snap->turnouts : NULL;
+        size_t turnout_count = snap ? snap->count : 0;
+        for (size_t i = 0; i < item_count; i++) {
+            s_items[i].state = TURNOUT_STATE_UNKNOWN;
+            s_items[i].found = false;
             for (size_t j = 0; j < turnout_count; j++) {
                 if (turnouts[j].id == s_layout.items[i].turnout_id) {
-                    item_states[i] = turnouts[j].state;
-                    item_found[i] = true;
+                    s_items[i].state = turnouts[j].state;
+                    s_items[i].found = true;
                     break;
                 }
             }
         }
-        turnout_manager_unlock();
+        turnout_manager_snapshot_release(snap);
     }
 
     // --- Render turnout items ---
-    for (size_t i = 0; i < s_layout.item_count && i < PANEL_MAX_ITEMS; i++) {
+    for (size_t i = 0; i < item_count; i++) {
         const panel_item_t *pi = &s_layout.items[i];
+        panel_item_obj_t *obj = &s_items[i];
 
         lv_point_t entry, normal, reverse;
         panel_geometry_get_points(pi, &entry, &normal, &reverse);
 
-        turnout_state_t state = item_states[i];
-        bool has_turnout = item_found[i];
+        turnout_state_t state = obj->state;
+        bool has_turnout = obj->found;
 
         // Entry → Normal line (straight leg)
-        s_line_points[i][0][0].x = fit_x((int16_t)entry.x);
-        s_line_points[i][0][0].y = fit_y((int16_t)entry.y);
-        s_line_points[i][0][1].x = fit_x((int16_t)normal.x);
-        s_line_points[i][0][1].y = fit_y((int16_t)normal.y);
+        obj->points[0][0].x = fit_x((int16_t)entry.x);
+        obj->points[0][0].y = fit_y((int16_t)entry.y);
+        obj->points[0][1].x = fit_x((int16_t)normal.x);
+        obj->points[0][1].y = fit_y((int16_t)normal.y);
 
         int16_t line_w = (int16_t)(4 * s_fit_scale_pct / 100);
         if (line_w < 2) line_w = 2;
 
         lv_obj_t *line_normal = lv_line_create(s_canvas);
-        lv_line_set_points(line_normal, s_line_points[i][0], 2);
+        lv_line_set_points(line_normal, obj->points[0], 2);
         lv_obj_set_style_line_width(line_normal, line_w, LV_PART_MAIN);
         lv_obj_set_style_line_rounded(line_normal, true, LV_PART_MAIN);
         lv_obj_set_style_line_color(line_normal,
             has_turnout ? state_to_color_normal_leg(state) : lv_color_hex(COLOR_ORPHAN),
             LV_PART_MAIN);
-        s_item_lines[i][0] = line_normal;
+        obj->lines[0] = line_normal;
 
         // Entry → Reverse line (diverging leg)
-        s_line_points[i][1][0].x = fit_x((int16_t)entry.x);
-        s_line_points[i][1][0].y = fit_y((int16_t)entry.y);
-        s_line_points[i][1][1].x = fit_x((int16_t)reverse.x);
-        s_line_points[i][1][1].y = fit_y((int16_t)reverse.y);
+        obj->points[1][0].x = fit_x((int16_t)entry.x);
+        obj->points[1][0].y = fit_y((int16_t)entry.y);
+        obj->points[1][1].x = fit_x((int16_t)reverse.x);
+        obj->points[1][1].y = fit_y((int16_t)reverse.y);
 
         lv_obj_t *line_reverse = lv_line_create(s_canvas);
-        lv_line_set_points(line_reverse, s_line_points[i][1], 2);
+        lv_line_set_points(line_reverse, obj->points[1], 2);
         lv_obj_set_style_line_width(line_reverse, line_w, LV_PART_MAIN);
         lv_obj_set_style_line_rounded(line_reverse, true, LV_PART_MAIN);
         lv_obj_set_style_line_color(line_reverse,
             has_turnout ? state_to_color_reverse_leg(state) : lv_color_hex(COLOR_ORPHAN),
             LV_PART_MAIN);
-        s_item_lines[i][1] = line_reverse;
+        obj->lines[1] = line_reverse;
 
         // Clickable hitbox overlay (invisible, touch-friendly size)
         int16_t cx, cy;
@@ -349,7 +705,7 @@ static void panel_render(void)
         lv_obj_clear_flag(hitbox, LV_OBJ_FLAG_SCROLLABLE);
         lv_obj_add_event_cb(hitbox, turnout_click_cb, LV_EVENT_CLICKED,
                            (void *)(uintptr_t)i);
-        s_item_hitbox[i] = hitbox;
+        obj->hitbox = hitbox;
 
         // If turnout not found in manager, show a "?" label
         if (!has_turnout) {
@@ -360,35 +716,85 @@ static void panel_render(void)
             lv_obj_center(q_label);
         }
     }
-    s_rendered_item_count = s_layout.item_count;
+    s_rendered_item_count = item_count;
 
     // --- Render track segments ---
-    for (size_t i = 0; i < s_layout.track_count && i < PANEL_MAX_TRACKS; i++) {
+    for (size_t i = 0; i < track_count; i++) {
         const panel_track_t *pt = &s_layout.tracks[i];
+        panel_track_obj_t *obj = &s_tracks[i];
+        obj->lined = false;
+        obj->on_route = false;
+        obj->occupied = false;
 
         // Resolve track endpoints via shared layout operation
         int16_t x1 = 0, y1 = 0, x2 = 0, y2 = 0;
         if (!panel_layout_resolve_track(&s_layout, pt, &x1, &y1, &x2, &y2)) continue;
 
-        s_track_points[i][0].x = fit_x(x1);
-        s_track_points[i][0].y = fit_y(y1);
-        s_track_points[i][1].x = fit_x(x2);
-        s_track_points[i][1].y = fit_y(y2);
+        obj->points[0].x = fit_x(x1);
+        obj->points[0].y = fit_y(y1);
+        obj->points[1].x = fit_x(x2);
+        obj->points[1].y = fit_y(y2);
 
         int16_t track_w = (int16_t)(4 * s_fit_scale_pct / 100);
         if (track_w < 2) track_w = 2;
 
         lv_obj_t *track_line = lv_line_create(s_canvas);
-        lv_line_set_points(track_line, s_track_points[i], 2);
+        lv_line_set_points(track_line, obj->points, 2);
         lv_obj_set_style_line_width(track_line, track_w, LV_PART_MAIN);
         lv_obj_set_style_line_rounded(track_line, true, LV_PART_MAIN);
         lv_obj_set_style_line_color(track_line, lv_color_hex(COLOR_TRACK), LV_PART_MAIN);
-        s_track_lines[i] = track_line;
+        obj->line = track_line;
+    }
+    s_rendered_track_count = track_count;
+
+    // --- Colour lined runs ---
+    s_run_stamp++;
+    for (size_t i = 0; i < track_count; i++) {
+        run_resolve(i);
+    }
+
+    // --- Occupancy overlay ---
+    size_t block_count = block_manager_get_count();
+    for (size_t i = 0; i < block_count; i++) {
+        block_apply(i);
     }
-    s_rendered_track_count = s_layout.track_count;
 
-    ESP_LOGI(TAG, "Panel rendered: %d items, %d tracks (fit: %d%% offset %d,%d)",
+    // --- Render endpoints (route entrance / exit targets) ---
+    int16_t dot_d = (int16_t)(10 * s_fit_scale_pct / 100);
+    if (dot_d < 6) dot_d = 6;
+    int16_t ep_hb = (int16_t)(40 * s_fit_scale_pct / 100);
+    if (ep_hb < 30) ep_hb = 30;
+    for (size_t i = 0; i < endpoint_count; i++) {
+        const panel_endpoint_t *pe = &s_layout.endpoints[i];
+        int16_t ex = fit_x((int16_t)(pe->grid_x * PANEL_GRID_SIZE));
+        int16_t ey = fit_y((int16_t)(pe->grid_y * PANEL_GRID_SIZE));
+
+        lv_obj_t *hitbox = lv_obj_create(s_canvas);
+        lv_obj_remove_style_all(hitbox);
+        lv_obj_set_size(hitbox, ep_hb, ep_hb);
+        lv_obj_set_pos(hitbox, ex - ep_hb / 2, ey - ep_hb / 2);
+        lv_obj_add_flag(hitbox, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_clear_flag(hitbox, LV_OBJ_FLAG_SCROLLABLE);
+        lv_obj_add_event_cb(hitbox, endpoint_click_cb, LV_EVENT_CLICKED,
+                           (void *)(uintptr_t)i);
+
+        lv_obj_t *dot = lv_obj_create(hitbox);
+        lv_obj_remove_style_all(dot);
+        lv_obj_set_size(dot, dot_d, dot_d);
+        lv_obj_set_style_radius(dot, LV_RADIUS_CIRCLE, LV_PART_MAIN);
+        lv_obj_set_style_bg_color(dot, lv_color_hex(COLOR_ENDPOINT), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(dot, LV_OPA_COVER, LV_PART_MAIN);
+        lv_obj_clear_flag(dot, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_center(dot);
+
+        s_endpoints[i].hitbox = hitbox;
+        s_endpoints[i].dot = dot;
+    }
+    s_rendered_endpoint_count = endpoint_count;
+
+    ESP_LOGI(TAG, "Panel rendered: %d items, %d tracks, %d endpoints (fit: %d%% offset %d,%d)",
              (int)s_rendered_item_count, (int)s_rendered_track_count,
+             (int)s_rendered_endpoint_count,
              (int)s_fit_scale_pct, (int)s_fit_off_x, (int)s_fit_off_y);
 }
 
@@ -413,11 +819,7 @@ void ui_create_panel_screen(void)
     s_panel_screen = scr;
 
     // Reset render state
-    s_rendered_item_count = 0;
-    s_rendered_track_count = 0;
-    memset(s_item_lines, 0, sizeof(s_item_lines));
-    memset(s_item_hitbox, 0, sizeof(s_item_hitbox));
-    memset(s_track_lines, 0, sizeof(s_track_lines));
+    panel_forget_render();
 
     // --- Full-screen canvas area for layout diagram ---
     s_canvas = lv_obj_create(scr);
@@ -465,6 +867,7 @@ void ui_create_panel_screen(void)
 
     // Render the layout
     panel_render();
+    mem_budget_checkpoint(MEM_CP_PANEL, s_rendered_item_count);
 
     ui_unlock();
 
@@ -473,25 +876,36 @@ void ui_create_panel_screen(void)
 
 void ui_panel_update_turnout(int index, turnout_state_t state)
 {
-    // Find which panel items correspond to this turnout manager index
+    // Find the panel item for this turnout manager index (hashed by ID)
     turnout_t t;
     if (turnout_manager_get_by_index((size_t)index, &t) != ESP_OK) return;
 
-    for (size_t i = 0; i < s_rendered_item_count; i++) {
-        if (s_layout.items[i].turnout_id == t.id) {
-            // Update normal leg color
-            if (s_item_lines[i][0]) {
-                lv_obj_set_style_line_color(s_item_lines[i][0],
-                    state_to_color_normal_leg(state), LV_PART_MAIN);
-            }
-            // Update reverse leg color
-            if (s_item_lines[i][1]) {
-                lv_obj_set_style_line_color(s_item_lines[i][1],
-                    state_to_color_reverse_leg(state), LV_PART_MAIN);
-            }
-            break;  /* Each turnout_id appears at most once in the layout */
-        }
+    int i = panel_layout_find_item(&s_layout, t.id);
+    if (i < 0 || (size_t)i >= s_rendered_item_count) return;
+
+    panel_item_obj_t *obj = &s_items[i];
+    // Update normal leg color
+    if (obj->lines[0]) {
+        lv_obj_set_style_line_color(obj->lines[0],
+            state_to_color_normal_leg(state), LV_PART_MAIN);
+    }
+    // Update reverse leg color
+    if (obj->lines[1]) {
+        lv_obj_set_style_line_color(obj->lines[1],
+            state_to_color_reverse_leg(state), LV_PART_MAIN);
     }
+
+    // Recolour only the runs through this turnout
+    bool changed = obj->state != state || !obj->found;
+    obj->state = state;
+    obj->found = true;
+    if (changed) runs_update_item((size_t)i);
+}
+
+void ui_panel_update_block(int index)
+{
+    if (index < 0) return;
+    block_apply((size_t)index);
 }
 
 void ui_panel_invalidate(void)
@@ -500,11 +914,8 @@ void ui_panel_invalidate(void)
     s_panel_screen = NULL;
     s_empty_label = NULL;
     s_empty_btn = NULL;
-    s_rendered_item_count = 0;
-    s_rendered_track_count = 0;
-    memset(s_item_lines, 0, sizeof(s_item_lines));
-    memset(s_item_hitbox, 0, sizeof(s_item_hitbox));
-    memset(s_track_lines, 0, sizeof(s_track_lines));
+    panel_forget_render();
+    s_route.entrance = -1;      // a running command batch finishes on its own
 }
 
 void ui_panel_refresh(void)
@@ -16,7 +16,12 @@
 #include "panel_geometry.h"
 #include "app/turnout_manager.h"
 #include "app/panel_storage.h"
+#include "app/panel_history.h"
+#include "app/psram_array.h"
+#include "panel_hit_index.h"
+#include "mem_budget.h"
 #include "esp_log.h"
+#include <math.h>
 #include <string.h>
 
 static const char *TAG = "ui_panel_builder";
@@ -31,9 +36,10 @@ static const char *TAG = "ui_panel_builder";
 #define BUILDER_CANVAS_OFFSET_Y BUILDER_TOOLBAR_HEIGHT
 #define BUILDER_NAV_WIDTH       52      ///< Width of zoom/pan navigation bar
 
-#define HITBOX_SIZE             24      ///< Connection point hitbox radius
-#define PLACED_HITBOX_W         70      ///< Placed turnout drag area width
-#define PLACED_HITBOX_H         50      ///< Placed turnout drag area height
+#define HITBOX_SIZE             24      ///< Connection point tap radius
+#define PLACED_HITBOX_W         70      ///< Placed turnout tap/drag diameter
+#define PLACED_HITBOX_H         50      ///< Placed turnout symbol height (label offset)
+#define TRACK_HIT_PAD           12      ///< Track tap distance from the segment
 
 // Zoom/pan constants
 #define ZOOM_MIN    50          ///< Minimum zoom percentage (50% = 0.5x)
@@ -41,6 +47,14 @@ static const char *TAG = "ui_panel_builder";
 #define ZOOM_DEFAULT 100        ///< Default zoom percentage (100% = 1x)
 #define ZOOM_STEP   25          ///< Zoom increment per button press
 #define PAN_STEP    40          ///< Pan increment in pixels per button press
+#define ZOOM_SETTLE_MS      250 ///< Idle time before a previewed zoom is re-tessellated
+#define PINCH_MIN_DIST      40  ///< Minimum finger spacing (px) to start a pinch
+
+// World container: scene objects are laid out in zoomed world space inside
+// one container; panning moves the container, zoom previews scale it.
+#define BUILDER_WORLD_EXTENT    (PANEL_GRID_MAX * PANEL_GRID_SIZE * ZOOM_MAX / 100 + \
+                                 2 * BUILDER_WORLD_MARGIN)  ///< Container size: the whole grid at ZOOM_MAX
+#define BUILDER_WORLD_MARGIN    100     ///< Scene offset so labels left/above x,y=0 stay hit-testable
 
 // Modal dimensions
 #define MODAL_WIDTH             400     ///< Turnout selection modal width
@@ -59,6 +73,7 @@ static const char *TAG = "ui_panel_builder";
 #define COLOR_BTN_DELETE    0xF44336
 #define COLOR_BTN_TRACK     0xFF9800
 #define COLOR_BTN_ADD       0x009688
+#define COLOR_BTN_HISTORY   0x607D8B
 #define COLOR_NORMAL_LINE   0x9E9E9E
 #define COLOR_TRACK_DRAW    0x424242
 #define COLOR_ENDPOINT      0x42A5F5
@@ -78,16 +93,39 @@ static lv_obj_t *s_btn_draw_track = NULL;
 static lv_obj_t *s_btn_save = NULL;
 static lv_obj_t *s_btn_add_turnout = NULL;
 static lv_obj_t *s_btn_add_endpoint = NULL;
+static lv_obj_t *s_btn_undo = NULL;
+static lv_obj_t *s_btn_redo = NULL;
 
 /// Turnout selection modal
 static lv_obj_t *s_modal_overlay = NULL;
 
 /// Zoom/pan viewport state
-static int16_t s_zoom_pct = ZOOM_DEFAULT;   ///< Zoom percentage (100 = 1:1)
-static int16_t s_pan_x = 0;                 ///< Pan offset X in screen pixels
-static int16_t s_pan_y = 0;                 ///< Pan offset Y in screen pixels
+static int16_t s_zoom_pct = ZOOM_DEFAULT;   ///< Committed zoom (baked into scene geometry)
+static int16_t s_pan_x = 0;                 ///< Committed pan offset X in screen pixels
+static int16_t s_pan_y = 0;                 ///< Committed pan offset Y in screen pixels
 static lv_obj_t *s_zoom_label = NULL;       ///< Zoom percentage label
 
+/// Previewed view — ahead of the committed one while a zoom is shown as a
+/// container transform. Settled (re-tessellated) after ZOOM_SETTLE_MS idle
+/// or when a pinch ends.
+static struct {
+    bool        pending;
+    int16_t     zoom_pct;
+    int16_t     pan_x;
+    int16_t     pan_y;
+    lv_timer_t *settle_timer;
+} s_view;
+
+/// Pinch-to-zoom / two-finger pan gesture
+static struct {
+    bool       active;
+    int32_t    start_dist;      ///< Finger spacing at gesture start
+    lv_point_t start_mid;       ///< Canvas-local midpoint at gesture start
+    int16_t    start_zoom;
+    int16_t    start_pan_x;
+    int16_t    start_pan_y;
+} s_pinch;
+
 /// Mode state
 static bool s_placement_mode = false;       ///< Waiting for canvas tap to place turnout
 static int  s_placement_turnout_idx = -1;   ///< Manager index of turnout being placed
@@ -112,44 +150,123 @@ static bool s_dirty = false;
 static lv_obj_t *s_save_label = NULL;
 static lv_timer_t *s_save_flash_timer = NULL;
 
-/// Drag state: when non-NULL, this hitbox is being actively dragged and
-/// must NOT be deleted by builder_clear_canvas(). builder_refresh_canvas()
-/// will skip creating a new hitbox for the dragged item and reuse this one.
-static lv_obj_t *s_drag_active_hitbox = NULL;
-static int       s_drag_active_idx = -1;
-static bool      s_drag_active_is_endpoint = false;
-
-/// Rendered objects on canvas
-#define BUILDER_MAX_LINES (PANEL_MAX_ITEMS * 2)
-static lv_obj_t *s_preview_objs[PANEL_MAX_ITEMS * 8 + PANEL_MAX_ENDPOINTS * 3 + PANEL_MAX_TRACKS * 2 + 4];
-static size_t s_preview_obj_count = 0;
-
-/// Static point arrays for preview lines
-static lv_point_t s_preview_line_pts[BUILDER_MAX_LINES + PANEL_MAX_TRACKS][2];
+/// Retained scene records, parallel to the panel_layout_t arrays.
+/// Objects are created once per element and moved/restyled in place.
+typedef struct {
+    lv_obj_t  *lines[2];        ///< Entry->normal and entry->reverse legs
+    lv_obj_t  *dots[3];         ///< Connection point indicators (entry/normal/reverse)
+    lv_obj_t  *name_lbl;        ///< Turnout name (NULL if turnout not found)
+    lv_point_t pts[2][2];       ///< View-space points backing the two lines
+} scene_item_t;
+
+typedef struct {
+    lv_obj_t  *line;
+    lv_point_t pts[2];
+} scene_track_t;
+
+typedef struct {
+    lv_obj_t  *dot;
+} scene_endpoint_t;
+
+static struct {
+    lv_obj_t        *world;             ///< Container for all layers (pan/zoom transform)
+    lv_obj_t        *layer_items;       ///< Turnout legs and names
+    lv_obj_t        *layer_tracks;      ///< Track lines
+    lv_obj_t        *layer_dots;        ///< Turnout connection point dots
+    lv_obj_t        *layer_endpoints;   ///< Endpoint dots
+    lv_obj_t        *hint;              ///< Mode hint label
+    scene_item_t     *items;            ///< PSRAM records, parallel to layout->items
+    size_t            item_count;
+    size_t            item_capacity;
+    scene_track_t    *tracks;           ///< PSRAM records, parallel to layout->tracks
+    size_t            track_count;
+    size_t            track_capacity;
+    scene_endpoint_t *endpoints;        ///< PSRAM records, parallel to layout->endpoints
+    size_t            endpoint_count;
+    size_t            endpoint_capacity;
+} s_scene;
+
+/// Drag fast path: the tracks attached to the element being dragged are
+/// collected from the layout's track graph once when the drag starts, so
+/// each grid step only moves that element and re-resolves its own tracks —
+/// O(degree), not O(layout).
+static struct {
+    bool     active;
+    bool     is_endpoint;
+    int      index;                     ///< Item or endpoint array index
+    uint16_t start_x;                   ///< Grid position when the drag began
+    uint16_t start_y;
+    size_t   track_count;
+    size_t   track_capacity;
+    uint16_t *tracks;                   ///< Attached track indices (PSRAM, grown on demand)
+} s_drag;
+
+/// Scratch list of attached track indices for move / delete mirroring
+static uint16_t *s_attached = NULL;
+static size_t s_attached_capacity = 0;
+
+/// Target resolved through the hit index when a press lands on the canvas;
+/// the drag and the click that follow act on it.
+static struct {
+    bool        hit;                    ///< false = empty canvas
+    panel_hit_t target;
+} s_press;
+
+/// Zoom-dependent sizes shared by all scene elements
+static struct {
+    int16_t lw_normal;
+    int16_t lw_selected;
+    int16_t lw_track;
+    int16_t hb_w;
+    int16_t hb_h;
+    int16_t ep_hb;
+} s_metrics;
 
 // ============================================================================
 // Forward Declarations
 // ============================================================================
 
-static void builder_refresh_canvas(void);
 static void builder_refresh_toolbar(void);
+static void scene_rebuild(void);
+static void scene_update_all(void);
+static void scene_update_hint(void);
+static void scene_ref_update(const panel_ref_t *ref);
+static void scene_item_add(size_t i, const char *name);
+static void scene_item_update(size_t i);
+static void scene_item_place(size_t i);
+static void scene_item_remove(size_t i);
+static void scene_track_add(size_t i);
+static void scene_track_update(size_t i);
+static bool scene_track_place(size_t i);
+static void scene_track_remove(size_t i);
+static void scene_update_tracks_for(panel_ref_type_t type, uint32_t id);
+static void scene_remove_tracks_for(panel_ref_type_t type, uint32_t id);
+static void scene_endpoint_add(size_t i);
+static void scene_endpoint_update(size_t i);
+static void scene_endpoint_place(size_t i);
+static size_t collect_attached(panel_ref_type_t type, uint32_t id,
+                               uint16_t **out, size_t *capacity);
+static void scene_endpoint_remove(size_t i);
 static void update_zoom_label(void);
+static void builder_view_settle(void);
 
 // ============================================================================
 // Viewport Transform Helpers
 // ============================================================================
 
 /**
- * @brief Transform a world-space coordinate to screen-space (canvas pixel)
+ * @brief Transform a world-space coordinate to scene-space (position inside
+ *        the world container). Pan is applied by moving the container, so
+ *        only the committed zoom is baked into scene coordinates.
  */
-static inline int16_t world_to_view_x(int16_t wx)
+static inline int16_t world_to_scene_x(int16_t wx)
 {
-    return (int16_t)((int32_t)wx * s_zoom_pct / 100 + s_pan_x);
+    return (int16_t)((int32_t)wx * s_zoom_pct / 100 + BUILDER_WORLD_MARGIN);
 }
 
-static inline int16_t world_to_view_y(int16_t wy)
+static inline int16_t world_to_scene_y(int16_t wy)
 {
-    return (int16_t)((int32_t)wy * s_zoom_pct / 100 + s_pan_y);
+    return (int16_t)((int32_t)wy * s_zoom_pct / 100 + BUILDER_WORLD_MARGIN);
 }
 
 /**
@@ -166,25 +283,35 @@ static inline int16_t view_to_world_y(int16_t vy)
 }
 
 /**
- * @brief Transform a world-space lv_point_t to view-space
+ * @brief World-space length of @p px screen pixels at the committed zoom
+ */
+static inline int16_t screen_to_world_len(int16_t px)
+{
+    return (int16_t)((int32_t)px * 100 / s_zoom_pct);
+}
+
+/**
+ * @brief Transform a world-space lv_point_t to scene-space
  */
-static inline lv_point_t world_to_view_pt(const lv_point_t *wp)
+static inline lv_point_t world_to_scene_pt(const lv_point_t *wp)
 {
-    lv_point_t vp;
-    vp.x = world_to_view_x(wp->x);
-    vp.y = world_to_view_y(wp->y);
-    return vp;
+    lv_point_t sp;
+    sp.x = world_to_scene_x(wp->x);
+    sp.y = world_to_scene_y(wp->y);
+    return sp;
 }
 
 /**
- * @brief Convert absolute screen touch point to world-space grid coords.
+ * @brief Convert an absolute screen touch point to world-space pixels.
  *        Uses lv_obj_get_coords() for correct absolute positioning regardless
  *        of how deeply the canvas is nested in the widget hierarchy,
  *        then applies inverse viewport transform.
  */
-static void screen_to_canvas_grid(const lv_point_t *screen_pt,
-                                   int16_t *out_grid_x, int16_t *out_grid_y)
+static lv_point_t screen_to_world(const lv_point_t *screen_pt)
 {
+    // Touch mapping uses the committed view; bake any previewed zoom first
+    builder_view_settle();
+
     lv_area_t canvas_area;
     lv_obj_get_coords(s_canvas, &canvas_area);
 
@@ -193,12 +320,21 @@ static void screen_to_canvas_grid(const lv_point_t *screen_pt,
     int16_t local_y = (int16_t)(screen_pt->y - canvas_area.y1);
 
     // Canvas-local pixel -> world pixel
-    int16_t world_x = view_to_world_x(local_x);
-    int16_t world_y = view_to_world_y(local_y);
+    lv_point_t wp = { view_to_world_x(local_x), view_to_world_y(local_y) };
+    return wp;
+}
+
+/**
+ * @brief Convert absolute screen touch point to world-space grid coords
+ */
+static void screen_to_canvas_grid(const lv_point_t *screen_pt,
+                                   int16_t *out_grid_x, int16_t *out_grid_y)
+{
+    lv_point_t wp = screen_to_world(screen_pt);
 
     // World pixel -> grid snap
-    *out_grid_x = (world_x + PANEL_GRID_SIZE / 2) / PANEL_GRID_SIZE;
-    *out_grid_y = (world_y + PANEL_GRID_SIZE / 2) / PANEL_GRID_SIZE;
+    *out_grid_x = (wp.x + PANEL_GRID_SIZE / 2) / PANEL_GRID_SIZE;
+    *out_grid_y = (wp.y + PANEL_GRID_SIZE / 2) / PANEL_GRID_SIZE;
 }
 
 // ============================================================================
@@ -246,7 +382,7 @@ static void modal_item_click_cb(lv_event_t *e)
 
     modal_close();
     builder_refresh_toolbar();
-    builder_refresh_canvas();
+    scene_update_hint();
 }
 
 static void modal_close_btn_cb(lv_event_t *e)
@@ -373,36 +509,100 @@ static void open_turnout_modal(void)
 // ============================================================================
 
 /**
- * @brief Canvas tap handler — places turnout or starts track connection
+ * @brief Change the selection and restyle only the elements that changed
+ *
+ * Any of the indices may be -1 (nothing of that kind selected).
  */
-static void canvas_click_cb(lv_event_t *e)
+static void builder_set_selection(int item, int track, int endpoint)
 {
-    lv_event_code_t code = lv_event_get_code(e);
-    if (code != LV_EVENT_CLICKED) return;
+    int old_item = s_selected_item;
+    int old_track = s_selected_track;
+    int old_endpoint = s_selected_endpoint;
 
-    lv_indev_t *indev = lv_indev_get_act();
-    if (!indev) return;
+    s_selected_item = item;
+    s_selected_track = track;
+    s_selected_endpoint = endpoint;
 
-    lv_point_t point;
-    lv_indev_get_point(indev, &point);
+    if (old_item != item) {
+        if (old_item >= 0) scene_item_update((size_t)old_item);
+        if (item >= 0) scene_item_update((size_t)item);
+    }
+    if (old_track != track) {
+        if (old_track >= 0) scene_track_update((size_t)old_track);
+        if (track >= 0) scene_track_update((size_t)track);
+    }
+    if (old_endpoint != endpoint) {
+        if (old_endpoint >= 0) scene_endpoint_update((size_t)old_endpoint);
+        if (endpoint >= 0) scene_endpoint_update((size_t)endpoint);
+    }
+}
+
+/**
+ * @brief Handle a tap on a connection point while in track draw mode
+ *
+ * The first tap records the "from" end; the second completes the track.
+ * Only the highlighted element, the new track and the hint are touched.
+ */
+static void builder_track_point_tapped(const panel_ref_t *ref)
+{
+    panel_layout_t *layout = panel_layout_get();
+
+    if (!s_track_first_selected) {
+        s_track_first_selected = true;
+        s_track_from_ref = *ref;
+        ESP_LOGI(TAG, "Track start: %s %u, point %d",
+                 ref->type == PANEL_REF_ENDPOINT ? "endpoint" : "turnout",
+                 (unsigned)ref->id, (int)ref->point);
+        scene_ref_update(&s_track_from_ref);
+        scene_update_hint();
+        return;
+    }
+
+    // Complete the track (ignore a second tap on the same point)
+    bool self_conn = ref->type == s_track_from_ref.type &&
+                     ref->id == s_track_from_ref.id &&
+                     ref->point == s_track_from_ref.point;
+    if (!self_conn) {
+        panel_track_t new_track = { .from = s_track_from_ref, .to = *ref };
+        if (panel_layout_add_track(layout, &new_track)) {
+            panel_edit_t edit = {
+                .type = PANEL_EDIT_ADD_TRACK,
+                .index = (uint16_t)(layout->track_count - 1),
+                .track = new_track,
+            };
+            panel_history_record(layout, &edit);
+            s_dirty = true;
+            scene_track_add(layout->track_count - 1);
+            builder_refresh_toolbar();
+        }
+    }
+
+    s_track_first_selected = false;
+    scene_ref_update(&s_track_from_ref);
+    scene_update_hint();
+}
 
+/**
+ * @brief Tap on empty canvas — places turnout/endpoint or clears selection
+ */
+static void builder_canvas_tapped(const lv_point_t *point)
+{
     // Convert screen touch to canvas grid coordinates
     int16_t grid_x, grid_y;
-    screen_to_canvas_grid(&point, &grid_x, &grid_y);
+    screen_to_canvas_grid(point, &grid_x, &grid_y);
 
-    // Clamp to canvas bounds
-    int16_t max_gx = BUILDER_CANVAS_WIDTH / PANEL_GRID_SIZE;
-    int16_t max_gy = BUILDER_CANVAS_HEIGHT / PANEL_GRID_SIZE;
+    // Clamp to the world grid (panned and zoomed, the canvas shows any part of it)
     if (grid_x < 0) grid_x = 0;
     if (grid_y < 0) grid_y = 0;
-    if (grid_x > max_gx) grid_x = max_gx;
-    if (grid_y > max_gy) grid_y = max_gy;
+    if (grid_x > PANEL_GRID_MAX) grid_x = PANEL_GRID_MAX;
+    if (grid_y > PANEL_GRID_MAX) grid_y = PANEL_GRID_MAX;
 
     if (s_placement_mode && s_placement_turnout_idx >= 0) {
         // Place the turnout
         turnout_t t;
         if (turnout_manager_get_by_index((size_t)s_placement_turnout_idx, &t) != ESP_OK) {
             s_placement_mode = false;
+            scene_update_hint();
             return;
         }
 
@@ -412,19 +612,26 @@ static void canvas_click_cb(lv_event_t *e)
                                          (uint16_t)grid_x, (uint16_t)grid_y);
         if (idx < 0) {
             s_placement_mode = false;
+            scene_update_hint();
             return;
         }
 
         ESP_LOGI(TAG, "Placed turnout '%s' at grid (%d, %d)", t.name, grid_x, grid_y);
 
+        panel_edit_t edit = {
+            .type = PANEL_EDIT_ADD_ITEM,
+            .index = (uint16_t)idx,
+            .item_new = layout->items[idx],
+        };
+        panel_history_record(layout, &edit);
+
         s_placement_mode = false;
         s_placement_turnout_idx = -1;
-        s_selected_item = idx;
-        s_selected_endpoint = -1;
-        s_selected_track = -1;
         s_dirty = true;
 
-        builder_refresh_canvas();
+        scene_item_add((size_t)idx, t.name);
+        builder_set_selection(idx, -1, -1);
+        scene_update_hint();
         builder_refresh_toolbar();
         return;
     }
@@ -435,53 +642,47 @@ static void canvas_click_cb(lv_event_t *e)
         size_t ep_idx = 0;
         if (!panel_layout_add_endpoint(layout, (uint16_t)grid_x, (uint16_t)grid_y, &ep_idx)) {
             s_placement_endpoint_mode = false;
+            scene_update_hint();
             return;
         }
 
+        panel_edit_t edit = {
+            .type = PANEL_EDIT_ADD_ENDPOINT,
+            .index = (uint16_t)ep_idx,
+            .ep_new = layout->endpoints[ep_idx],
+        };
+        panel_history_record(layout, &edit);
+
         s_placement_endpoint_mode = false;
-        s_selected_endpoint = (int)ep_idx;
-        s_selected_item = -1;
-        s_selected_track = -1;
         s_dirty = true;
 
-        builder_refresh_canvas();
+        scene_endpoint_add(ep_idx);
+        builder_set_selection(-1, -1, (int)ep_idx);
+        scene_update_hint();
         builder_refresh_toolbar();
         return;
     }
 
     // Otherwise deselect current item, track, and endpoint
-    s_selected_item = -1;
-    s_selected_track = -1;
-    s_selected_endpoint = -1;
-    builder_refresh_canvas();
+    builder_set_selection(-1, -1, -1);
     builder_refresh_toolbar();
 }
 
 /**
- * @brief Find the nearest connection point on a placed item to a screen touch.
+ * @brief Find the nearest connection point on a placed item to a world position
  */
-static panel_point_type_t find_nearest_point(const panel_item_t *pi,
-                                              const lv_point_t *screen_pt)
+static panel_point_type_t find_nearest_point(const panel_item_t *pi, lv_point_t wp)
 {
-    lv_area_t canvas_area;
-    lv_obj_get_coords(s_canvas, &canvas_area);
-
-    // Convert screen touch to view-space, then to world-space for comparison
-    int16_t touch_vx = (int16_t)(screen_pt->x - canvas_area.x1);
-    int16_t touch_vy = (int16_t)(screen_pt->y - canvas_area.y1);
-    int16_t touch_x = view_to_world_x(touch_vx);
-    int16_t touch_y = view_to_world_y(touch_vy);
-
     lv_point_t entry, normal_pt, reverse_pt;
     panel_geometry_get_points(pi, &entry, &normal_pt, &reverse_pt);
 
     // Squared distances to each connection point
-    int32_t d_entry   = (int32_t)(touch_x - entry.x)     * (touch_x - entry.x)
-                      + (int32_t)(touch_y - entry.y)     * (touch_y - entry.y);
-    int32_t d_normal  = (int32_t)(touch_x - normal_pt.x) * (touch_x - normal_pt.x)
-                      + (int32_t)(touch_y - normal_pt.y) * (touch_y - normal_pt.y);
-    int32_t d_reverse = (int32_t)(touch_x - reverse_pt.x) * (touch_x - reverse_pt.x)
-                      + (int32_t)(touch_y - reverse_pt.y) * (touch_y - reverse_pt.y);
+    int32_t d_entry   = (int32_t)(wp.x - entry.x)     * (wp.x - entry.x)
+                      + (int32_t)(wp.y - entry.y)     * (wp.y - entry.y);
+    int32_t d_normal  = (int32_t)(wp.x - normal_pt.x) * (wp.x - normal_pt.x)
+                      + (int32_t)(wp.y - normal_pt.y) * (wp.y - normal_pt.y);
+    int32_t d_reverse = (int32_t)(wp.x - reverse_pt.x) * (wp.x - reverse_pt.x)
+                      + (int32_t)(wp.y - reverse_pt.y) * (wp.y - reverse_pt.y);
 
     if (d_normal <= d_entry && d_normal <= d_reverse) return PANEL_POINT_NORMAL;
     if (d_reverse <= d_entry && d_reverse <= d_normal) return PANEL_POINT_REVERSE;
@@ -489,315 +690,264 @@ static panel_point_type_t find_nearest_point(const panel_item_t *pi,
 }
 
 /**
- * @brief Placed turnout click — select it, or in track draw mode find nearest
- *        connection point as fallback (dots are preferred but hitbox catches
- *        taps that miss a dot).
+ * @brief Resolve a screen touch to the builder element under it.
+ *
+ * Queries the hit index in the scene's z-order: endpoints, then connection
+ * points (draw mode) or tracks, then turnout bodies.  Tap radii are screen
+ * pixels, so they stay finger-sized at every zoom.  In draw mode a body hit
+ * becomes its nearest connection point, so a tap that misses a dot still
+ * picks one.
+ *
+ * @return false if the touch is on empty canvas
  */
-static void placed_item_click_cb(lv_event_t *e)
+static bool builder_hit_test(const lv_point_t *screen_pt, panel_hit_t *out)
 {
-    lv_event_code_t code = lv_event_get_code(e);
-    if (code != LV_EVENT_CLICKED) return;
-
-    int idx = (int)(uintptr_t)lv_event_get_user_data(e);
+    lv_point_t wp = screen_to_world(screen_pt);     // settles a zoom preview
     panel_layout_t *layout = panel_layout_get();
-    if (idx < 0 || (size_t)idx >= layout->item_count) return;
-
-    if (s_draw_track_mode) {
-        // Determine nearest connection point to the touch position
-        lv_indev_t *indev = lv_indev_get_act();
-        panel_point_type_t nearest = PANEL_POINT_ENTRY;
-        if (indev) {
-            lv_point_t touch;
-            lv_indev_get_point(indev, &touch);
-            nearest = find_nearest_point(&layout->items[idx], &touch);
-        }
 
-        uint32_t tid = layout->items[idx].turnout_id;
+    if (panel_hit_index_nearest(PANEL_HIT_ENDPOINT, wp,
+                                screen_to_world_len(s_metrics.ep_hb / 2), out)) {
+        return out->index < layout->endpoint_count;
+    }
 
-        if (!s_track_first_selected) {
-            s_track_first_selected = true;
-            s_track_from_ref = (panel_ref_t){
-                .type = PANEL_REF_TURNOUT, .id = tid, .point = nearest
-            };
-            ESP_LOGI(TAG, "Track start: item %d, point %d", idx, (int)nearest);
-        } else {
-            // Complete the track
-            bool self_conn = s_track_from_ref.type == PANEL_REF_TURNOUT &&
-                             tid == s_track_from_ref.id &&
-                             nearest == s_track_from_ref.point;
-            if (!self_conn) {
-                panel_track_t new_track = {
-                    .from = s_track_from_ref,
-                    .to   = { .type = PANEL_REF_TURNOUT, .id = tid, .point = nearest }
-                };
-                if (panel_layout_add_track(layout, &new_track)) {
-                    s_dirty = true;
-                }
-            }
-            s_track_first_selected = false;
-            builder_refresh_canvas();
+    if (s_draw_track_mode) {
+        if (panel_hit_index_nearest(PANEL_HIT_CONN_POINT, wp,
+                                    screen_to_world_len(HITBOX_SIZE), out)) {
+            return out->index < layout->item_count;
         }
-        return;
+    } else if (panel_hit_index_nearest(PANEL_HIT_TRACK, wp,
+                                       screen_to_world_len(TRACK_HIT_PAD), out)) {
+        return out->index < layout->track_count;
     }
 
-    ESP_LOGI(TAG, "Selected placed item %d", idx);
-    s_selected_item = idx;
-    s_selected_track = -1;
-    s_selected_endpoint = -1;
-    builder_refresh_canvas();
-    builder_refresh_toolbar();
+    if (!panel_hit_index_nearest(PANEL_HIT_ITEM_BODY, wp,
+                                 screen_to_world_len(s_metrics.hb_w / 2), out) ||
+        out->index >= layout->item_count) {
+        return false;
+    }
+    if (s_draw_track_mode) {
+        out->kind = PANEL_HIT_CONN_POINT;
+        out->point = find_nearest_point(&layout->items[out->index], wp);
+    }
+    return true;
 }
 
 /**
- * @brief Placed turnout drag handler — reposition with grid snap.
- *        Does NOT call builder_refresh_canvas() to avoid destroying the
- *        hitbox that is actively being pressed. Instead, moves just the
- *        hitbox widget for visual feedback. Full redraw happens on release.
+ * @brief Tap on a builder element — select it, or use it as a track
+ *        connection in draw mode
  */
-static void placed_item_drag_cb(lv_event_t *e)
+static void builder_element_tapped(const panel_hit_t *hit)
 {
-    lv_event_code_t code = lv_event_get_code(e);
-    if (code != LV_EVENT_PRESSING) return;
-    if (s_draw_track_mode) return;  // No drag while drawing tracks
-
-    int idx = (int)(uintptr_t)lv_event_get_user_data(e);
     panel_layout_t *layout = panel_layout_get();
-    if (idx < 0 || (size_t)idx >= layout->item_count) return;
+    int idx = hit->index;
 
-    lv_indev_t *indev = lv_indev_get_act();
-    if (!indev) return;
+    switch (hit->kind) {
+    case PANEL_HIT_ENDPOINT: {
+        const panel_endpoint_t *ep = &layout->endpoints[idx];
+        if (s_draw_track_mode) {
+            panel_ref_t ref = {
+                .type = PANEL_REF_ENDPOINT, .id = ep->id, .point = PANEL_POINT_ENTRY
+            };
+            builder_track_point_tapped(&ref);
+            return;
+        }
+        ESP_LOGI(TAG, "Selected endpoint %d (id=%u)", idx, (unsigned)ep->id);
+        builder_set_selection(-1, -1, idx);
+        break;
+    }
 
-    lv_point_t point;
-    lv_indev_get_point(indev, &point);
+    case PANEL_HIT_CONN_POINT: {
+        panel_ref_t ref = {
+            .type = PANEL_REF_TURNOUT, .id = layout->items[idx].turnout_id, .point = hit->point
+        };
+        builder_track_point_tapped(&ref);
+        return;
+    }
 
-    // Convert screen touch to canvas grid coordinates
-    int16_t grid_x, grid_y;
-    screen_to_canvas_grid(&point, &grid_x, &grid_y);
-
-    // Clamp to canvas bounds
-    int16_t max_gx = BUILDER_CANVAS_WIDTH / PANEL_GRID_SIZE;
-    int16_t max_gy = BUILDER_CANVAS_HEIGHT / PANEL_GRID_SIZE;
-    if (grid_x < 1) grid_x = 1;
-    if (grid_y < 1) grid_y = 1;
-    if (grid_x > max_gx - 1) grid_x = max_gx - 1;
-    if (grid_y > max_gy - 1) grid_y = max_gy - 1;
-
-    // Register the dragged hitbox so builder_clear_canvas() preserves it
-    if (!s_drag_active_hitbox) {
-        s_drag_active_hitbox = lv_event_get_target(e);
-        s_drag_active_idx = idx;
-    }
-
-    if (layout->items[idx].grid_x != (uint16_t)grid_x ||
-        layout->items[idx].grid_y != (uint16_t)grid_y) {
-        layout->items[idx].grid_x = (uint16_t)grid_x;
-        layout->items[idx].grid_y = (uint16_t)grid_y;
-        s_selected_item = idx;
-        s_dirty = true;
+    case PANEL_HIT_TRACK:
+        if (s_selected_track == idx) {
+            // Deselect
+            builder_set_selection(-1, -1, -1);
+        } else {
+            builder_set_selection(-1, idx, -1);
+        }
+        ESP_LOGI(TAG, "Track selection: %d", s_selected_track);
+        break;
 
-        // Full redraw — lines, labels, dots all update live.
-        // The active hitbox is protected from deletion by builder_clear_canvas()
-        // and reused by builder_refresh_canvas().
-        builder_refresh_canvas();
+    case PANEL_HIT_ITEM_BODY:
+        ESP_LOGI(TAG, "Selected placed item %d", idx);
+        builder_set_selection(idx, -1, -1);
+        break;
     }
+    builder_refresh_toolbar();
 }
 
 /**
- * @brief Placed turnout drag release handler — clear drag state and
- *        do a final clean canvas redraw.
+ * @brief Start a drag: select the element and collect its adjacency list
  */
-static void placed_item_release_cb(lv_event_t *e)
+static void builder_drag_begin(bool is_endpoint, int idx)
 {
-    lv_event_code_t code = lv_event_get_code(e);
-    if (code != LV_EVENT_RELEASED && code != LV_EVENT_PRESS_LOST) return;
-    if (s_draw_track_mode) return;
+    panel_layout_t *layout = panel_layout_get();
 
-    // Clear drag-active state so the next refresh creates a fresh hitbox
-    s_drag_active_hitbox = NULL;
-    s_drag_active_idx = -1;
-    s_drag_active_is_endpoint = false;
+    panel_ref_type_t type;
+    uint32_t id;
+    if (is_endpoint) {
+        type = PANEL_REF_ENDPOINT;
+        id = layout->endpoints[idx].id;
+        s_drag.start_x = layout->endpoints[idx].grid_x;
+        s_drag.start_y = layout->endpoints[idx].grid_y;
+        builder_set_selection(-1, -1, idx);
+    } else {
+        type = PANEL_REF_TURNOUT;
+        id = layout->items[idx].turnout_id;
+        s_drag.start_x = layout->items[idx].grid_x;
+        s_drag.start_y = layout->items[idx].grid_y;
+        builder_set_selection(idx, -1, -1);
+    }
 
-    // Final clean redraw
-    builder_refresh_canvas();
-    builder_refresh_toolbar();
+    s_drag.active = true;
+    s_drag.is_endpoint = is_endpoint;
+    s_drag.index = idx;
+    s_drag.track_count = collect_attached(type, id, &s_drag.tracks, &s_drag.track_capacity);
 }
 
 /**
- * @brief Connection point click — for track drawing mode
+ * @brief One drag step: move the dragged element and its attached tracks only
  */
-static void conn_point_click_cb(lv_event_t *e)
+static void builder_drag_step(void)
 {
-    lv_event_code_t code = lv_event_get_code(e);
-    if (code != LV_EVENT_CLICKED) return;
-    if (!s_draw_track_mode) return;
-
-    uint32_t packed = (uint32_t)(uintptr_t)lv_event_get_user_data(e);
-    int item_idx = (int)(packed >> 8);
-    panel_point_type_t pt = (panel_point_type_t)(packed & 0xFF);
-
-    panel_layout_t *layout = panel_layout_get();
-    if (item_idx < 0 || (size_t)item_idx >= layout->item_count) return;
-
-    uint32_t tid = layout->items[item_idx].turnout_id;
-
-    if (!s_track_first_selected) {
-        s_track_first_selected = true;
-        s_track_from_ref = (panel_ref_t){
-            .type = PANEL_REF_TURNOUT, .id = tid, .point = pt
-        };
-        ESP_LOGI(TAG, "Track start: item %d, point %d", item_idx, (int)pt);
-        builder_refresh_canvas();
+    if (s_drag.is_endpoint) {
+        scene_endpoint_place((size_t)s_drag.index);
     } else {
-        // Complete the track
-        if (tid != s_track_from_ref.id || pt != s_track_from_ref.point ||
-            s_track_from_ref.type != PANEL_REF_TURNOUT) {
-            panel_track_t new_track = {
-                .from = s_track_from_ref,
-                .to   = { .type = PANEL_REF_TURNOUT, .id = tid, .point = pt }
-            };
-            if (panel_layout_add_track(layout, &new_track)) {
-                s_dirty = true;
-            }
-        }
-        s_track_first_selected = false;
-        builder_refresh_canvas();
+        scene_item_place((size_t)s_drag.index);
+    }
+    for (size_t i = 0; i < s_drag.track_count; i++) {
+        scene_track_place(s_drag.tracks[i]);
     }
 }
 
 /**
- * @brief Track segment click handler — select/deselect a track section
+ * @brief Finish a drag: commit the move to the builder state
  */
-static void track_click_cb(lv_event_t *e)
+static void builder_drag_end(void)
 {
-    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    if (s_draw_track_mode) return;  // Don't select tracks while drawing new ones
-
-    int track_idx = (int)(uintptr_t)lv_event_get_user_data(e);
+    if (!s_drag.active) return;
+    s_drag.active = false;
 
-    if (s_selected_track == track_idx) {
-        // Deselect
-        s_selected_track = -1;
+    panel_layout_t *layout = panel_layout_get();
+    panel_edit_t edit = { .index = (uint16_t)s_drag.index };
+    bool moved;
+    if (s_drag.is_endpoint) {
+        const panel_endpoint_t *ep = &layout->endpoints[s_drag.index];
+        moved = ep->grid_x != s_drag.start_x || ep->grid_y != s_drag.start_y;
+        edit.type = PANEL_EDIT_UPDATE_ENDPOINT;
+        edit.ep_new = *ep;
+        edit.ep_old = *ep;
+        edit.ep_old.grid_x = s_drag.start_x;
+        edit.ep_old.grid_y = s_drag.start_y;
     } else {
-        s_selected_track = track_idx;
-        s_selected_item = -1;
-        s_selected_endpoint = -1;
+        const panel_item_t *pi = &layout->items[s_drag.index];
+        moved = pi->grid_x != s_drag.start_x || pi->grid_y != s_drag.start_y;
+        edit.type = PANEL_EDIT_UPDATE_ITEM;
+        edit.item_new = *pi;
+        edit.item_old = *pi;
+        edit.item_old.grid_x = s_drag.start_x;
+        edit.item_old.grid_y = s_drag.start_y;
     }
 
-    ESP_LOGI(TAG, "Track selection: %d", s_selected_track);
-    builder_refresh_canvas();
+    if (moved) {
+        panel_history_record(layout, &edit);
+        s_dirty = true;
+        ESP_LOGI(TAG, "Moved %s %d", s_drag.is_endpoint ? "endpoint" : "item", s_drag.index);
+    }
     builder_refresh_toolbar();
 }
 
-// ============================================================================
-// Endpoint Event Handlers
-// ============================================================================
-
 /**
- * @brief Endpoint click — select it, or use as track connection in draw mode
+ * @brief Drag the pressed turnout or endpoint with grid snap.
+ *        Each grid step goes through the drag fast path.
  */
-static void placed_endpoint_click_cb(lv_event_t *e)
+static void builder_press_drag(const lv_point_t *point)
 {
-    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
+    bool is_endpoint;
+    if (s_press.target.kind == PANEL_HIT_ENDPOINT) {
+        is_endpoint = true;
+    } else if (s_press.target.kind == PANEL_HIT_ITEM_BODY) {
+        is_endpoint = false;
+    } else {
+        return;     // Tracks and connection points don't drag
+    }
 
-    int idx = (int)(uintptr_t)lv_event_get_user_data(e);
     panel_layout_t *layout = panel_layout_get();
-    if (idx < 0 || (size_t)idx >= layout->endpoint_count) return;
-
-    const panel_endpoint_t *ep = &layout->endpoints[idx];
+    int idx = s_press.target.index;
+    size_t count = is_endpoint ? layout->endpoint_count : layout->item_count;
+    if ((size_t)idx >= count) return;
 
-    if (s_draw_track_mode) {
-        if (!s_track_first_selected) {
-            s_track_first_selected = true;
-            s_track_from_ref = (panel_ref_t){
-                .type = PANEL_REF_ENDPOINT, .id = ep->id, .point = PANEL_POINT_ENTRY
-            };
-            ESP_LOGI(TAG, "Track start: endpoint %u", (unsigned)ep->id);
-            builder_refresh_canvas();
-        } else {
-            // Complete track to this endpoint
-            bool self_conn = s_track_from_ref.type == PANEL_REF_ENDPOINT &&
-                             s_track_from_ref.id == ep->id;
-            if (!self_conn) {
-                panel_track_t new_track = {
-                    .from = s_track_from_ref,
-                    .to   = { .type = PANEL_REF_ENDPOINT, .id = ep->id, .point = PANEL_POINT_ENTRY }
-                };
-                if (panel_layout_add_track(layout, &new_track)) {
-                    s_dirty = true;
-                }
-            }
-            s_track_first_selected = false;
-            builder_refresh_canvas();
-        }
-        return;
+    // Convert screen touch to canvas grid coordinates
+    int16_t grid_x, grid_y;
+    screen_to_canvas_grid(point, &grid_x, &grid_y);
+
+    // Clamp to the world grid; turnouts keep a one-cell margin for their legs
+    int16_t margin = is_endpoint ? 0 : 1;
+    int16_t max_g = PANEL_GRID_MAX - margin;
+    if (grid_x < margin) grid_x = margin;
+    if (grid_y < margin) grid_y = margin;
+    if (grid_x > max_g) grid_x = max_g;
+    if (grid_y > max_g) grid_y = max_g;
+
+    uint16_t *gx = is_endpoint ? &layout->endpoints[idx].grid_x : &layout->items[idx].grid_x;
+    uint16_t *gy = is_endpoint ? &layout->endpoints[idx].grid_y : &layout->items[idx].grid_y;
+    if (*gx == (uint16_t)grid_x && *gy == (uint16_t)grid_y) return;
+
+    if (!s_drag.active || s_drag.is_endpoint != is_endpoint || s_drag.index != idx) {
+        builder_drag_begin(is_endpoint, idx);
     }
-
-    ESP_LOGI(TAG, "Selected endpoint %d (id=%u)", idx, (unsigned)ep->id);
-    s_selected_endpoint = idx;
-    s_selected_item = -1;
-    s_selected_track = -1;
-    builder_refresh_canvas();
-    builder_refresh_toolbar();
+    *gx = (uint16_t)grid_x;
+    *gy = (uint16_t)grid_y;
+    builder_drag_step();
 }
 
 /**
- * @brief Endpoint drag handler — reposition with grid snap
+ * @brief Canvas input handler — the single entry point for builder taps.
+ *
+ * The press resolves its target once through the hit index; PRESSING drags
+ * that target and the click acts on it (or on the empty canvas).  Placement
+ * modes take every tap, even on top of existing elements.
  */
-static void placed_endpoint_drag_cb(lv_event_t *e)
+static void canvas_input_cb(lv_event_t *e)
 {
-    if (lv_event_get_code(e) != LV_EVENT_PRESSING) return;
-    if (s_draw_track_mode) return;
-
-    int idx = (int)(uintptr_t)lv_event_get_user_data(e);
-    panel_layout_t *layout = panel_layout_get();
-    if (idx < 0 || (size_t)idx >= layout->endpoint_count) return;
-
     lv_indev_t *indev = lv_indev_get_act();
     if (!indev) return;
 
     lv_point_t point;
     lv_indev_get_point(indev, &point);
 
-    int16_t grid_x, grid_y;
-    screen_to_canvas_grid(&point, &grid_x, &grid_y);
-
-    int16_t max_gx = BUILDER_CANVAS_WIDTH / PANEL_GRID_SIZE;
-    int16_t max_gy = BUILDER_CANVAS_HEIGHT / PANEL_GRID_SIZE;
-    if (grid_x < 0) grid_x = 0;
-    if (grid_y < 0) grid_y = 0;
-    if (grid_x > max_gx) grid_x = max_gx;
-    if (grid_y > max_gy) grid_y = max_gy;
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_PRESSED:
+        s_press.hit = !s_placement_mode && !s_placement_endpoint_mode &&
+                      builder_hit_test(&point, &s_press.target);
+        break;
 
-    if (!s_drag_active_hitbox) {
-        s_drag_active_hitbox = lv_event_get_target(e);
-        s_drag_active_idx = idx;
-        s_drag_active_is_endpoint = true;
-    }
+    case LV_EVENT_PRESSING:
+        if (s_press.hit && !s_draw_track_mode) builder_press_drag(&point);
+        break;
 
-    if (layout->endpoints[idx].grid_x != (uint16_t)grid_x ||
-        layout->endpoints[idx].grid_y != (uint16_t)grid_y) {
-        layout->endpoints[idx].grid_x = (uint16_t)grid_x;
-        layout->endpoints[idx].grid_y = (uint16_t)grid_y;
-        s_selected_endpoint = idx;
-        s_dirty = true;
-        builder_refresh_canvas();
-    }
-}
+    case LV_EVENT_RELEASED:
+    case LV_EVENT_PRESS_LOST:
+        builder_drag_end();
+        break;
 
-/**
- * @brief Endpoint drag release
- */
-static void placed_endpoint_release_cb(lv_event_t *e)
-{
-    lv_event_code_t code = lv_event_get_code(e);
-    if (code != LV_EVENT_RELEASED && code != LV_EVENT_PRESS_LOST) return;
-    if (s_draw_track_mode) return;
+    case LV_EVENT_CLICKED:
+        if (s_press.hit) {
+            builder_element_tapped(&s_press.target);
+        } else {
+            builder_canvas_tapped(&point);
+        }
+        break;
 
-    s_drag_active_hitbox = NULL;
-    s_drag_active_idx = -1;
-    s_drag_active_is_endpoint = false;
-    builder_refresh_canvas();
-    builder_refresh_toolbar();
+    default:
+        break;
+    }
 }
 
 /**
@@ -807,13 +957,145 @@ static void add_endpoint_btn_cb(lv_event_t *e)
 {
     if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
 
+    bool was_drawing = s_draw_track_mode;
     s_placement_endpoint_mode = true;
     s_placement_mode = false;
     s_draw_track_mode = false;
     s_track_first_selected = false;
 
     builder_refresh_toolbar();
-    builder_refresh_canvas();
+    if (was_drawing) {
+        scene_update_all();
+    } else {
+        scene_update_hint();
+    }
+}
+
+// ============================================================================
+// Undo / Redo
+// ============================================================================
+
+/**
+ * @brief Apply a journal edit to the layout and the scene.
+ *        Mirrors the interactive edit paths (scene removal before layout
+ *        removal), then selects the element the edit touched.
+ */
+static void builder_apply_edit(const panel_edit_t *edit)
+{
+    panel_layout_t *layout = panel_layout_get();
+    size_t idx = edit->index;
+    int sel_item = -1, sel_track = -1, sel_endpoint = -1;
+    bool ok = true;
+
+    // Indices shift under the edit; start from a clean selection
+    builder_set_selection(-1, -1, -1);
+    if (s_track_first_selected) {
+        s_track_first_selected = false;
+        scene_ref_update(&s_track_from_ref);
+    }
+
+    switch (edit->type) {
+    case PANEL_EDIT_ADD_ITEM: {
+        ok = panel_layout_insert_item(layout, idx, &edit->item_new);
+        if (!ok) break;
+        turnout_t t;
+        int ti = turnout_manager_find_by_id(edit->item_new.turnout_id);
+        bool named = ti >= 0 && turnout_manager_get_by_index((size_t)ti, &t) == ESP_OK;
+        scene_item_add(idx, named ? t.name : NULL);
+        sel_item = (int)idx;
+        break;
+    }
+    case PANEL_EDIT_REMOVE_ITEM:
+        ok = idx < layout->item_count;
+        if (!ok) break;
+        scene_remove_tracks_for(PANEL_REF_TURNOUT, layout->items[idx].turnout_id);
+        scene_item_remove(idx);
+        panel_layout_remove_item(layout, idx);
+        break;
+    case PANEL_EDIT_UPDATE_ITEM:
+        ok = idx < layout->item_count;
+        if (!ok) break;
+        layout->items[idx] = edit->item_new;
+        scene_item_update(idx);
+        scene_update_tracks_for(PANEL_REF_TURNOUT, edit->item_new.turnout_id);
+        sel_item = (int)idx;
+        break;
+    case PANEL_EDIT_ADD_ENDPOINT:
+        ok = panel_layout_insert_endpoint(layout, idx, &edit->ep_new);
+        if (!ok) break;
+        scene_endpoint_add(idx);
+        sel_endpoint = (int)idx;
+        break;
+    case PANEL_EDIT_REMOVE_ENDPOINT:
+        ok = idx < layout->endpoint_count;
+        if (!ok) break;
+        scene_remove_tracks_for(PANEL_REF_ENDPOINT, layout->endpoints[idx].id);
+        scene_endpoint_remove(idx);
+        panel_layout_remove_endpoint(layout, idx);
+        break;
+    case PANEL_EDIT_UPDATE_ENDPOINT:
+        ok = idx < layout->endpoint_count;
+        if (!ok) break;
+        layout->endpoints[idx] = edit->ep_new;
+        scene_endpoint_update(idx);
+        scene_update_tracks_for(PANEL_REF_ENDPOINT, edit->ep_new.id);
+        sel_endpoint = (int)idx;
+        break;
+    case PANEL_EDIT_ADD_TRACK:
+        ok = panel_layout_insert_track(layout, idx, &edit->track);
+        if (!ok) break;
+        scene_track_add(idx);
+        sel_track = (int)idx;
+        break;
+    case PANEL_EDIT_REMOVE_TRACK:
+        ok = idx < layout->track_count;
+        if (!ok) break;
+        scene_track_remove(idx);
+        panel_layout_remove_track(layout, idx);
+        break;
+    }
+
+    // Tracks cascade-deleted with a restored element go back where they were
+    for (uint16_t i = 0; ok && i < edit->track_count; i++) {
+        size_t ti = edit->tracks[i].index;
+        if (panel_layout_insert_track(layout, ti, &edit->tracks[i].track)) {
+            scene_track_add(ti);
+        }
+    }
+
+    if (!ok) {
+        // Layout changed behind the journal's back — its indices are stale
+        ESP_LOGW(TAG, "Undo journal out of sync (edit %d, index %u) — cleared",
+                 (int)edit->type, (unsigned)idx);
+        panel_history_clear();
+    } else {
+        s_dirty = true;
+        builder_set_selection(sel_item, sel_track, sel_endpoint);
+    }
+    scene_update_hint();
+    builder_refresh_toolbar();
+}
+
+static void undo_cb(lv_event_t *e)
+{
+    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
+
+    panel_edit_t edit;
+    if (panel_history_undo(&edit)) {
+        ESP_LOGI(TAG, "Undo (edit %d)", (int)edit.type);
+        builder_apply_edit(&edit);
+    }
+}
+
+static void redo_cb(lv_event_t *e)
+{
+    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
+
+    panel_edit_t edit;
+    if (panel_history_redo(&edit)) {
+        ESP_LOGI(TAG, "Redo (edit %d)", (int)edit.type);
+        builder_apply_edit(&edit);
+    }
 }
 
 // ============================================================================
@@ -828,14 +1110,22 @@ static void rotate_cb(lv_event_t *e)
     panel_layout_t *layout = panel_layout_get();
     if ((size_t)s_selected_item >= layout->item_count) return;
 
-    layout->items[s_selected_item].rotation =
-        (layout->items[s_selected_item].rotation + 1) & 0x07;
+    panel_item_t *item = &layout->items[s_selected_item];
+    panel_edit_t edit = {
+        .type = PANEL_EDIT_UPDATE_ITEM,
+        .index = (uint16_t)s_selected_item,
+        .item_old = *item,
+    };
+    item->rotation = (item->rotation + 1) & 0x07;
+    edit.item_new = *item;
+    panel_history_record(layout, &edit);
     s_dirty = true;
 
-    ESP_LOGI(TAG, "Rotated item %d to %d", s_selected_item,
-             layout->items[s_selected_item].rotation);
+    ESP_LOGI(TAG, "Rotated item %d to %d", s_selected_item, item->rotation);
 
-    builder_refresh_canvas();
+    scene_item_update((size_t)s_selected_item);
+    scene_update_tracks_for(PANEL_REF_TURNOUT, item->turnout_id);
+    builder_refresh_toolbar();
 }
 
 static void mirror_cb(lv_event_t *e)
@@ -846,14 +1136,23 @@ static void mirror_cb(lv_event_t *e)
     panel_layout_t *layout = panel_layout_get();
     if ((size_t)s_selected_item >= layout->item_count) return;
 
-    layout->items[s_selected_item].mirrored =
-        !layout->items[s_selected_item].mirrored;
+    panel_item_t *item = &layout->items[s_selected_item];
+    panel_edit_t edit = {
+        .type = PANEL_EDIT_UPDATE_ITEM,
+        .index = (uint16_t)s_selected_item,
+        .item_old = *item,
+    };
+    item->mirrored = !item->mirrored;
+    edit.item_new = *item;
+    panel_history_record(layout, &edit);
     s_dirty = true;
 
     ESP_LOGI(TAG, "Mirrored item %d: %s", s_selected_item,
-             layout->items[s_selected_item].mirrored ? "yes" : "no");
+             item->mirrored ? "yes" : "no");
 
-    builder_refresh_canvas();
+    scene_item_update((size_t)s_selected_item);
+    scene_update_tracks_for(PANEL_REF_TURNOUT, item->turnout_id);
+    builder_refresh_toolbar();
 }
 
 static void delete_item_cb(lv_event_t *e)
@@ -864,20 +1163,35 @@ static void delete_item_cb(lv_event_t *e)
 
     // Delete selected track segment
     if (s_selected_track >= 0 && (size_t)s_selected_track < layout->track_count) {
-        panel_layout_remove_track(layout, (size_t)s_selected_track);
-        s_dirty = true;
+        size_t idx = (size_t)s_selected_track;
+        panel_edit_t edit = {
+            .type = PANEL_EDIT_REMOVE_TRACK,
+            .index = (uint16_t)idx,
+            .track = layout->tracks[idx],
+        };
+        panel_history_record(layout, &edit);
         s_selected_track = -1;
-        builder_refresh_canvas();
+        scene_track_remove(idx);
+        panel_layout_remove_track(layout, idx);
+        s_dirty = true;
         builder_refresh_toolbar();
         return;
     }
 
     // Delete selected endpoint (cascade removes connected tracks)
     if (s_selected_endpoint >= 0 && (size_t)s_selected_endpoint < layout->endpoint_count) {
-        panel_layout_remove_endpoint(layout, (size_t)s_selected_endpoint);
-        s_dirty = true;
+        size_t idx = (size_t)s_selected_endpoint;
+        panel_edit_t edit = {
+            .type = PANEL_EDIT_REMOVE_ENDPOINT,
+            .index = (uint16_t)idx,
+            .ep_old = layout->endpoints[idx],
+        };
+        panel_history_record(layout, &edit);   // before the cascade
         s_selected_endpoint = -1;
-        builder_refresh_canvas();
+        scene_remove_tracks_for(PANEL_REF_ENDPOINT, layout->endpoints[idx].id);
+        scene_endpoint_remove(idx);
+        panel_layout_remove_endpoint(layout, idx);
+        s_dirty = true;
         builder_refresh_toolbar();
         return;
     }
@@ -886,13 +1200,21 @@ static void delete_item_cb(lv_event_t *e)
     if (s_selected_item < 0) return;
     if ((size_t)s_selected_item >= layout->item_count) return;
 
-    panel_layout_remove_item(layout, (size_t)s_selected_item);
-
-    s_dirty = true;
+    size_t idx = (size_t)s_selected_item;
+    panel_edit_t edit = {
+        .type = PANEL_EDIT_REMOVE_ITEM,
+        .index = (uint16_t)idx,
+        .item_old = layout->items[idx],
+    };
+    panel_history_record(layout, &edit);       // before the cascade
     s_selected_item = -1;
     s_selected_track = -1;
     s_selected_endpoint = -1;
-    builder_refresh_canvas();
+    scene_remove_tracks_for(PANEL_REF_TURNOUT, layout->items[idx].turnout_id);
+    scene_item_remove(idx);
+    panel_layout_remove_item(layout, idx);
+
+    s_dirty = true;
     builder_refresh_toolbar();
 }
 
@@ -909,7 +1231,8 @@ static void toggle_draw_track_cb(lv_event_t *e)
     ESP_LOGI(TAG, "Draw track mode: %s", s_draw_track_mode ? "ON" : "OFF");
 
     builder_refresh_toolbar();
-    builder_refresh_canvas();
+    // Dot visibility and size change on every element
+    scene_update_all();
 }
 
 static void add_turnout_btn_cb(lv_event_t *e)
@@ -917,12 +1240,18 @@ static void add_turnout_btn_cb(lv_event_t *e)
     if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
 
     // Exit other modes
+    bool was_drawing = s_draw_track_mode;
     s_draw_track_mode = false;
     s_track_first_selected = false;
     s_placement_endpoint_mode = false;
 
     open_turnout_modal();
     builder_refresh_toolbar();
+    if (was_drawing) {
+        scene_update_all();
+    } else {
+        scene_update_hint();
+    }
 }
 
 /**
@@ -941,26 +1270,22 @@ static void save_flash_timer_cb(lv_timer_t *timer)
     s_save_flash_timer = NULL;
 }
 
-static void save_cb(lv_event_t *e)
+/**
+ * @brief Show the outcome of a save on the Save button (LVGL task)
+ */
+static void show_save_result(esp_err_t ret)
 {
-    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    if (!s_dirty) return;  // Nothing to save
-
-    panel_layout_t *layout = panel_layout_get();
-    esp_err_t ret = panel_storage_save(layout);
+    if (!s_btn_save) return;  // Builder torn down while the write was queued
 
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Panel layout saved");
-        s_dirty = false;
 
         // Brief "Saved!" flash on the button
         if (s_save_label) {
             lv_label_set_text(s_save_label, LV_SYMBOL_OK " Saved!");
         }
-        if (s_btn_save) {
-            lv_obj_set_style_bg_color(s_btn_save, lv_color_hex(0x2E7D32), LV_PART_MAIN);
-            lv_obj_set_style_bg_opa(s_btn_save, LV_OPA_COVER, LV_PART_MAIN);
-        }
+        lv_obj_set_style_bg_color(s_btn_save, lv_color_hex(0x2E7D32), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(s_btn_save, LV_OPA_COVER, LV_PART_MAIN);
         builder_refresh_toolbar();
 
         // Restore after 1.5 seconds
@@ -971,15 +1296,14 @@ static void save_cb(lv_event_t *e)
         lv_timer_set_repeat_count(s_save_flash_timer, 1);
     } else {
         ESP_LOGE(TAG, "Failed to save panel layout: %s", esp_err_to_name(ret));
+        s_dirty = true;  // Still unsaved; let the user retry
 
         // Flash red error indication
         if (s_save_label) {
             lv_label_set_text(s_save_label, LV_SYMBOL_WARNING " Error");
         }
-        if (s_btn_save) {
-            lv_obj_set_style_bg_color(s_btn_save, lv_color_hex(COLOR_BTN_DELETE), LV_PART_MAIN);
-            lv_obj_set_style_bg_opa(s_btn_save, LV_OPA_COVER, LV_PART_MAIN);
-        }
+        lv_obj_set_style_bg_color(s_btn_save, lv_color_hex(COLOR_BTN_DELETE), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(s_btn_save, LV_OPA_COVER, LV_PART_MAIN);
         if (s_save_flash_timer) {
             lv_timer_del(s_save_flash_timer);
         }
@@ -988,6 +1312,38 @@ static void save_cb(lv_event_t *e)
     }
 }
 
+static void save_result_async(void *arg)
+{
+    show_save_result((esp_err_t)(intptr_t)arg);
+}
+
+/**
+ * @brief Save completion (SD task) - hands the result to the LVGL task
+ */
+static void save_done_cb(esp_err_t result, char *data, size_t len, void *ctx)
+{
+    (void)data;
+    (void)len;
+    (void)ctx;
+    lv_async_call(save_result_async, (void *)(intptr_t)result);
+}
+
+static void save_cb(lv_event_t *e)
+{
+    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
+    if (!s_dirty) return;  // Nothing to save
+
+    // Serialized now, written by the SD task; the button flashes on completion
+    panel_layout_t *layout = panel_layout_get();
+    esp_err_t ret = panel_storage_save(layout, save_done_cb, NULL);
+    if (ret == ESP_OK) {
+        s_dirty = false;
+        builder_refresh_toolbar();
+    } else {
+        show_save_result(ret);
+    }
+}
+
 // ============================================================================
 // Zoom/Pan Button Callbacks
 // ============================================================================
@@ -996,81 +1352,176 @@ static void update_zoom_label(void)
 {
     if (s_zoom_label) {
         char buf[16];
-        snprintf(buf, sizeof(buf), "%d%%", s_zoom_pct);
+        snprintf(buf, sizeof(buf), "%d%%", s_view.pending ? s_view.zoom_pct : s_zoom_pct);
         lv_label_set_text(s_zoom_label, buf);
     }
 }
 
-static void zoom_in_cb(lv_event_t *e)
+/**
+ * @brief Position the world container for a view relative to the committed
+ *        zoom. Scene geometry is baked at s_zoom_pct, so a different zoom is
+ *        shown by scaling the container about its top-left corner.
+ */
+static void builder_view_apply(int16_t zoom_pct, int16_t pan_x, int16_t pan_y)
 {
-    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    if (s_zoom_pct < ZOOM_MAX) {
-        // Zoom towards center of canvas
-        int16_t cx = BUILDER_CANVAS_WIDTH / 2;
-        int16_t cy = BUILDER_CANVAS_HEIGHT / 2;
-        int16_t old_zoom = s_zoom_pct;
-        s_zoom_pct += ZOOM_STEP;
-        if (s_zoom_pct > ZOOM_MAX) s_zoom_pct = ZOOM_MAX;
-        // Adjust pan so center stays fixed
-        s_pan_x = (int16_t)(cx - (int32_t)(cx - s_pan_x) * s_zoom_pct / old_zoom);
-        s_pan_y = (int16_t)(cy - (int32_t)(cy - s_pan_y) * s_zoom_pct / old_zoom);
-        update_zoom_label();
-        builder_refresh_canvas();
-    }
+    int32_t margin = (int32_t)BUILDER_WORLD_MARGIN * zoom_pct / s_zoom_pct;
+    lv_obj_set_style_transform_zoom(s_scene.world,
+        (lv_coord_t)((int32_t)LV_IMG_ZOOM_NONE * zoom_pct / s_zoom_pct), LV_PART_MAIN);
+    lv_obj_set_pos(s_scene.world, (lv_coord_t)(pan_x - margin), (lv_coord_t)(pan_y - margin));
 }
 
-static void zoom_out_cb(lv_event_t *e)
+/**
+ * @brief Show a new view. A pure pan (zoom unchanged) is committed at once —
+ *        it only moves the container. A zoom change is previewed as a
+ *        container transform and left pending until builder_view_settle().
+ */
+static void builder_view_set(int16_t zoom_pct, int16_t pan_x, int16_t pan_y)
 {
-    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    if (s_zoom_pct > ZOOM_MIN) {
-        int16_t cx = BUILDER_CANVAS_WIDTH / 2;
-        int16_t cy = BUILDER_CANVAS_HEIGHT / 2;
-        int16_t old_zoom = s_zoom_pct;
-        s_zoom_pct -= ZOOM_STEP;
-        if (s_zoom_pct < ZOOM_MIN) s_zoom_pct = ZOOM_MIN;
-        s_pan_x = (int16_t)(cx - (int32_t)(cx - s_pan_x) * s_zoom_pct / old_zoom);
-        s_pan_y = (int16_t)(cy - (int32_t)(cy - s_pan_y) * s_zoom_pct / old_zoom);
-        update_zoom_label();
-        builder_refresh_canvas();
+    if (zoom_pct < ZOOM_MIN) zoom_pct = ZOOM_MIN;
+    if (zoom_pct > ZOOM_MAX) zoom_pct = ZOOM_MAX;
+
+    if (zoom_pct == s_zoom_pct) {
+        s_view.pending = false;
+        s_pan_x = pan_x;
+        s_pan_y = pan_y;
+    } else {
+        s_view.pending = true;
+        s_view.zoom_pct = zoom_pct;
+        s_view.pan_x = pan_x;
+        s_view.pan_y = pan_y;
+    }
+    if (s_scene.world) {
+        builder_view_apply(zoom_pct, pan_x, pan_y);
+    }
+    update_zoom_label();
+}
+
+/**
+ * @brief Commit a pending (previewed) zoom: drop the container transform and
+ *        re-tessellate the scene at the new zoom. No-op when nothing is pending.
+ */
+static void builder_view_settle(void)
+{
+    if (s_view.settle_timer) {
+        lv_timer_del(s_view.settle_timer);
+        s_view.settle_timer = NULL;
+    }
+    if (!s_view.pending) return;
+
+    s_view.pending = false;
+    s_zoom_pct = s_view.zoom_pct;
+    s_pan_x = s_view.pan_x;
+    s_pan_y = s_view.pan_y;
+    if (s_scene.world) {
+        builder_view_apply(s_zoom_pct, s_pan_x, s_pan_y);
+    }
+    scene_update_all();
+    update_zoom_label();
+}
+
+static void view_settle_timer_cb(lv_timer_t *timer)
+{
+    (void)timer;
+    s_view.settle_timer = NULL;     // one-shot, deleted by LVGL after this call
+    builder_view_settle();
+}
+
+/**
+ * @brief (Re)start the idle timer that settles a previewed zoom, so repeated
+ *        zoom presses re-tessellate once after the last one.
+ */
+static void builder_view_settle_later(void)
+{
+    if (!s_view.pending) return;
+    if (s_view.settle_timer) {
+        lv_timer_reset(s_view.settle_timer);
+        return;
     }
+    s_view.settle_timer = lv_timer_create(view_settle_timer_cb, ZOOM_SETTLE_MS, NULL);
+    lv_timer_set_repeat_count(s_view.settle_timer, 1);
+}
+
+/**
+ * @brief Current (possibly previewed) view
+ */
+static void builder_view_get(int16_t *zoom_pct, int16_t *pan_x, int16_t *pan_y)
+{
+    *zoom_pct = s_view.pending ? s_view.zoom_pct : s_zoom_pct;
+    *pan_x = s_view.pending ? s_view.pan_x : s_pan_x;
+    *pan_y = s_view.pending ? s_view.pan_y : s_pan_y;
+}
+
+/**
+ * @brief Zoom by a step about the canvas centre
+ */
+static void builder_zoom_step(int16_t step)
+{
+    int16_t zoom, pan_x, pan_y;
+    builder_view_get(&zoom, &pan_x, &pan_y);
+
+    int16_t new_zoom = zoom + step;
+    if (new_zoom > ZOOM_MAX) new_zoom = ZOOM_MAX;
+    if (new_zoom < ZOOM_MIN) new_zoom = ZOOM_MIN;
+    if (new_zoom == zoom) return;
+
+    // Adjust pan so center stays fixed
+    int16_t cx = BUILDER_CANVAS_WIDTH / 2;
+    int16_t cy = BUILDER_CANVAS_HEIGHT / 2;
+    pan_x = (int16_t)(cx - (int32_t)(cx - pan_x) * new_zoom / zoom);
+    pan_y = (int16_t)(cy - (int32_t)(cy - pan_y) * new_zoom / zoom);
+
+    builder_view_set(new_zoom, pan_x, pan_y);
+    builder_view_settle_later();
+}
+
+static void builder_pan_step(int16_t dx, int16_t dy)
+{
+    int16_t zoom, pan_x, pan_y;
+    builder_view_get(&zoom, &pan_x, &pan_y);
+    builder_view_set(zoom, pan_x + dx, pan_y + dy);
+}
+
+static void zoom_in_cb(lv_event_t *e)
+{
+    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
+    builder_zoom_step(ZOOM_STEP);
+}
+
+static void zoom_out_cb(lv_event_t *e)
+{
+    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
+    builder_zoom_step(-ZOOM_STEP);
 }
 
 static void zoom_reset_cb(lv_event_t *e)
 {
     if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    s_zoom_pct = ZOOM_DEFAULT;
-    s_pan_x = 0;
-    s_pan_y = 0;
-    update_zoom_label();
-    builder_refresh_canvas();
+    builder_view_set(ZOOM_DEFAULT, 0, 0);
+    builder_view_settle();
 }
 
 static void pan_left_cb(lv_event_t *e)
 {
     if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    s_pan_x += PAN_STEP;
-    builder_refresh_canvas();
+    builder_pan_step(PAN_STEP, 0);
 }
 
 static void pan_right_cb(lv_event_t *e)
 {
     if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    s_pan_x -= PAN_STEP;
-    builder_refresh_canvas();
+    builder_pan_step(-PAN_STEP, 0);
 }
 
 static void pan_up_cb(lv_event_t *e)
 {
     if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    s_pan_y += PAN_STEP;
-    builder_refresh_canvas();
+    builder_pan_step(0, PAN_STEP);
 }
 
 static void pan_down_cb(lv_event_t *e)
 {
     if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    s_pan_y -= PAN_STEP;
-    builder_refresh_canvas();
+    builder_pan_step(0, -PAN_STEP);
 }
 
 static void auto_center_cb(lv_event_t *e)
@@ -1082,11 +1533,8 @@ static void auto_center_cb(lv_event_t *e)
     // Use shared bounds calculation
     int16_t min_x, min_y, max_x, max_y;
     if (!panel_layout_get_bounds(layout, 40, &min_x, &min_y, &max_x, &max_y)) {
-        s_zoom_pct = ZOOM_DEFAULT;
-        s_pan_x = 0;
-        s_pan_y = 0;
-        update_zoom_label();
-        builder_refresh_canvas();
+        builder_view_set(ZOOM_DEFAULT, 0, 0);
+        builder_view_settle();
         return;
     }
 
@@ -1098,385 +1546,841 @@ static void auto_center_cb(lv_event_t *e)
     // Compute zoom to fit
     int16_t zoom_x = (int16_t)((int32_t)BUILDER_CANVAS_WIDTH * 100 / world_w);
     int16_t zoom_y = (int16_t)((int32_t)BUILDER_CANVAS_HEIGHT * 100 / world_h);
-    s_zoom_pct = zoom_x < zoom_y ? zoom_x : zoom_y;
-    if (s_zoom_pct < ZOOM_MIN) s_zoom_pct = ZOOM_MIN;
-    if (s_zoom_pct > ZOOM_MAX) s_zoom_pct = ZOOM_MAX;
+    int16_t zoom = zoom_x < zoom_y ? zoom_x : zoom_y;
+    if (zoom < ZOOM_MIN) zoom = ZOOM_MIN;
+    if (zoom > ZOOM_MAX) zoom = ZOOM_MAX;
 
     // Center the bounding box in the canvas
     int16_t world_cx = (min_x + max_x) / 2;
     int16_t world_cy = (min_y + max_y) / 2;
-    s_pan_x = (int16_t)(BUILDER_CANVAS_WIDTH / 2 - (int32_t)world_cx * s_zoom_pct / 100);
-    s_pan_y = (int16_t)(BUILDER_CANVAS_HEIGHT / 2 - (int32_t)world_cy * s_zoom_pct / 100);
+    int16_t pan_x = (int16_t)(BUILDER_CANVAS_WIDTH / 2 - (int32_t)world_cx * zoom / 100);
+    int16_t pan_y = (int16_t)(BUILDER_CANVAS_HEIGHT / 2 - (int32_t)world_cy * zoom / 100);
 
-    update_zoom_label();
-    builder_refresh_canvas();
+    builder_view_set(zoom, pan_x, pan_y);
+    builder_view_settle();
     ESP_LOGI(TAG, "Auto center: zoom=%d%% pan=(%d,%d)", s_zoom_pct, s_pan_x, s_pan_y);
 }
 
 // ============================================================================
-// Canvas Rendering
+// Pinch-to-Zoom
 // ============================================================================
 
-static void builder_clear_canvas(void)
+static int32_t pinch_distance(const lv_point_t *points)
 {
-    if (!s_canvas) return;
+    int32_t dx = points[1].x - points[0].x;
+    int32_t dy = points[1].y - points[0].y;
+    return (int32_t)sqrtf((float)(dx * dx + dy * dy));
+}
 
-    if (s_drag_active_hitbox) {
-        /* Reparent the in-flight drag hitbox so lv_obj_clean() won't destroy it */
-        lv_obj_set_parent(s_drag_active_hitbox, lv_layer_top());
-        lv_obj_add_flag(s_drag_active_hitbox, LV_OBJ_FLAG_HIDDEN);
+/**
+ * @brief Two-finger gesture handler (runs in the LVGL touch read, lock held).
+ *        Finger spacing sets the zoom relative to gesture start and the
+ *        midpoint pans, keeping the world point under the starting midpoint
+ *        beneath the fingers. The scene is previewed as a container
+ *        transform and re-tessellated once when the gesture ends.
+ */
+static bool builder_multitouch_cb(const lv_point_t *points, uint8_t count)
+{
+    if (count < 2) {
+        if (s_pinch.active) {
+            s_pinch.active = false;
+            builder_view_settle();
+        }
+        return false;
     }
 
-    /* Bulk-delete all canvas children (much faster than per-object lv_obj_del) */
-    lv_obj_clean(s_canvas);
+    if (!s_canvas || !s_scene.world) return false;
 
-    if (s_drag_active_hitbox) {
-        /* Move the hitbox back — builder_refresh_canvas() will reposition it */
-        lv_obj_set_parent(s_drag_active_hitbox, s_canvas);
-        lv_obj_clear_flag(s_drag_active_hitbox, LV_OBJ_FLAG_HIDDEN);
+    lv_area_t canvas_area;
+    lv_obj_get_coords(s_canvas, &canvas_area);
+    lv_point_t mid = {
+        .x = (lv_coord_t)((points[0].x + points[1].x) / 2 - canvas_area.x1),
+        .y = (lv_coord_t)((points[0].y + points[1].y) / 2 - canvas_area.y1),
+    };
+    int32_t dist = pinch_distance(points);
+
+    if (!s_pinch.active) {
+        if (!lv_obj_is_visible(s_canvas) || s_modal_overlay) return false;
+        if (mid.x < 0 || mid.y < 0 ||
+            mid.x >= BUILDER_CANVAS_WIDTH || mid.y >= BUILDER_CANVAS_HEIGHT) return false;
+        if (dist < PINCH_MIN_DIST) return false;
+
+        // The first finger may already have started dragging an element
+        builder_drag_end();
+
+        s_pinch.active = true;
+        s_pinch.start_dist = dist;
+        s_pinch.start_mid = mid;
+        builder_view_get(&s_pinch.start_zoom, &s_pinch.start_pan_x, &s_pinch.start_pan_y);
+        return true;
     }
 
-    s_preview_obj_count = 0;
+    int16_t zoom = (int16_t)((int32_t)s_pinch.start_zoom * dist / s_pinch.start_dist);
+    if (zoom < ZOOM_MIN) zoom = ZOOM_MIN;
+    if (zoom > ZOOM_MAX) zoom = ZOOM_MAX;
+
+    int16_t pan_x = (int16_t)(mid.x - (int32_t)(s_pinch.start_mid.x - s_pinch.start_pan_x) *
+                              zoom / s_pinch.start_zoom);
+    int16_t pan_y = (int16_t)(mid.y - (int32_t)(s_pinch.start_mid.y - s_pinch.start_pan_y) *
+                              zoom / s_pinch.start_zoom);
+
+    builder_view_set(zoom, pan_x, pan_y);
+    return true;
 }
 
-static void add_preview_obj(lv_obj_t *obj)
+// ============================================================================
+// Retained Scene Graph
+// ============================================================================
+//
+// Every layout element owns a fixed set of LVGL objects that are created once
+// and then moved/restyled in place.  Scene arrays are kept parallel to the
+// layout arrays, so element N of the scene is element N of the layout.  The
+// objects are visuals only: taps go to the canvas and are resolved through
+// the hit index (panel_hit_index.h), which the place functions keep in step
+// with the geometry.  Objects are grouped into layer containers so z-order
+// (items < tracks < dots < endpoints < hint) holds no matter in which order
+// elements are added.
+
+/**
+ * @brief Create a transparent, non-clickable layer covering the world
+ *        container (or the container itself when parent is the canvas).
+ *        Taps fall through to the canvas handler.
+ */
+static lv_obj_t *scene_create_layer(lv_obj_t *parent)
+{
+    lv_obj_t *layer = lv_obj_create(parent);
+    lv_obj_remove_style_all(layer);
+    lv_obj_set_size(layer, BUILDER_WORLD_EXTENT, BUILDER_WORLD_EXTENT);
+    lv_obj_set_pos(layer, 0, 0);
+    lv_obj_clear_flag(layer, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+    return layer;
+}
+
+/**
+ * @brief Create a non-clickable round dot
+ */
+static lv_obj_t *scene_create_dot(lv_obj_t *layer, lv_coord_t border_w)
+{
+    lv_obj_t *dot = lv_obj_create(layer);
+    lv_obj_remove_style_all(dot);
+    lv_obj_clear_flag(dot, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_bg_opa(dot, LV_OPA_COVER, LV_PART_MAIN);
+    lv_obj_set_style_radius(dot, LV_RADIUS_CIRCLE, LV_PART_MAIN);
+    lv_obj_set_style_border_width(dot, border_w, LV_PART_MAIN);
+    return dot;
+}
+
+static lv_obj_t *scene_create_line(lv_obj_t *layer, lv_point_t *pts)
+{
+    lv_obj_t *line = lv_line_create(layer);
+    lv_obj_set_style_line_rounded(line, true, LV_PART_MAIN);
+    lv_line_set_points(line, pts, 2);
+    return line;
+}
+
+/**
+ * @brief Collect the tracks attached to an element from the layout's track
+ *        graph, growing @p out as needed
+ * @return Number of indices in @p out (truncated if it could not grow)
+ */
+static size_t collect_attached(panel_ref_type_t type, uint32_t id,
+                               uint16_t **out, size_t *capacity)
 {
-    if (s_preview_obj_count < sizeof(s_preview_objs) / sizeof(s_preview_objs[0])) {
-        s_preview_objs[s_preview_obj_count++] = obj;
+    panel_layout_t *layout = panel_layout_get();
+    size_t n = panel_layout_collect_tracks(layout, type, id, *out, *capacity);
+    if (n <= *capacity) return n;
+
+    if (!psram_array_reserve((void **)out, capacity, n, sizeof((*out)[0]))) {
+        return *capacity;
     }
+    return panel_layout_collect_tracks(layout, type, id, *out, *capacity);
 }
 
-static void builder_refresh_canvas(void)
+/**
+ * @brief Recompute zoom-dependent sizes (call whenever s_zoom_pct changes)
+ */
+static void scene_compute_metrics(void)
 {
-    if (!s_canvas) return;
+    s_metrics.lw_normal = (int16_t)((int32_t)3 * s_zoom_pct / 100);
+    s_metrics.lw_selected = (int16_t)((int32_t)5 * s_zoom_pct / 100);
+    s_metrics.lw_track = (int16_t)((int32_t)3 * s_zoom_pct / 100);
+    if (s_metrics.lw_normal < 1) s_metrics.lw_normal = 1;
+    if (s_metrics.lw_selected < 2) s_metrics.lw_selected = 2;
+    if (s_metrics.lw_track < 1) s_metrics.lw_track = 1;
+
+    s_metrics.hb_w = (int16_t)((int32_t)PLACED_HITBOX_W * s_zoom_pct / 100);
+    s_metrics.hb_h = (int16_t)((int32_t)PLACED_HITBOX_H * s_zoom_pct / 100);
+    if (s_metrics.hb_w < 20) s_metrics.hb_w = 20;
+    if (s_metrics.hb_h < 16) s_metrics.hb_h = 16;
+
+    s_metrics.ep_hb = (int16_t)((int32_t)30 * s_zoom_pct / 100);
+    if (s_metrics.ep_hb < 20) s_metrics.ep_hb = 20;
+}
 
-    builder_clear_canvas();
+/**
+ * @brief Move a line to new view-space points, invalidating the old area
+ */
+static void scene_set_line(lv_obj_t *line, lv_point_t *pts,
+                           lv_point_t a, lv_point_t b)
+{
+    lv_obj_invalidate(line);
+    pts[0] = a;
+    pts[1] = b;
+    lv_line_set_points(line, pts, 2);
+}
+
+// ---------------------------------------------------------------------------
+// Placed turnouts
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Re-point an item's lines at its point arrays after the record
+ *        moved in a shift
+ */
+static void scene_item_reindex(size_t i)
+{
+    scene_item_t *si = &s_scene.items[i];
+    for (int l = 0; l < 2; l++) {
+        lv_line_set_points(si->lines[l], si->pts[l], 2);
+    }
+}
 
+/**
+ * @brief Size of connection dot @p p on item @p i, or 0 when dots are hidden
+ */
+static int scene_item_dot_size(size_t i, const panel_item_t *pi, int p)
+{
+    if ((int)i != s_selected_item && !s_draw_track_mode) return 0;
+
+    int base_dot = s_draw_track_mode ? 20 : 12;
+    int dot_size = (int)((int32_t)base_dot * s_zoom_pct / 100);
+    if (dot_size < 10) dot_size = 10;
+
+    // Highlight the first-selected point in track draw mode (~33% larger)
+    if (s_draw_track_mode && s_track_first_selected &&
+        s_track_from_ref.type == PANEL_REF_TURNOUT &&
+        pi->turnout_id == s_track_from_ref.id &&
+        (int)s_track_from_ref.point == p) {
+        dot_size += dot_size / 3;
+    }
+    return dot_size;
+}
+
+/**
+ * @brief Move item @p i's objects to its current grid position.
+ *        Geometry only — styles are left untouched, so this is the
+ *        per-step work while dragging.
+ */
+static void scene_item_place(size_t i)
+{
     panel_layout_t *layout = panel_layout_get();
-    size_t line_idx = 0;
-
-    // Compute scaled line widths
-    int16_t lw_normal = (int16_t)((int32_t)3 * s_zoom_pct / 100);
-    int16_t lw_selected = (int16_t)((int32_t)5 * s_zoom_pct / 100);
-    int16_t lw_track = (int16_t)((int32_t)3 * s_zoom_pct / 100);
-    if (lw_normal < 1) lw_normal = 1;
-    if (lw_selected < 2) lw_selected = 2;
-    if (lw_track < 1) lw_track = 1;
-
-    // Compute scaled sizes
-    int16_t hb_w = (int16_t)((int32_t)PLACED_HITBOX_W * s_zoom_pct / 100);
-    int16_t hb_h = (int16_t)((int32_t)PLACED_HITBOX_H * s_zoom_pct / 100);
-    if (hb_w < 20) hb_w = 20;
-    if (hb_h < 16) hb_h = 16;
-
-    // Snapshot turnout names under a single lock (#2: batch lookups)
-    static char s_tn_names[PANEL_MAX_ITEMS][32];
-    static bool s_tn_found[PANEL_MAX_ITEMS];
-    {
-        turnout_manager_lock();
-        const turnout_t *turnouts;
-        size_t turnout_count;
-        turnout_manager_get_all(&turnouts, &turnout_count);
-        for (size_t i = 0; i < layout->item_count && i < PANEL_MAX_ITEMS; i++) {
-            s_tn_found[i] = false;
-            for (size_t j = 0; j < turnout_count; j++) {
-                if (turnouts[j].id == layout->items[i].turnout_id) {
-                    memcpy(s_tn_names[i], turnouts[j].name, sizeof(turnouts[j].name));
-                    s_tn_found[i] = true;
-                    break;
-                }
-            }
+    if (i >= s_scene.item_count || i >= layout->item_count) return;
+
+    scene_item_t *si = &s_scene.items[i];
+    const panel_item_t *pi = &layout->items[i];
+
+    // Get world-space points then transform to view-space
+    lv_point_t w_pts[3];
+    panel_geometry_get_points(pi, &w_pts[0], &w_pts[1], &w_pts[2]);
+    lv_point_t pts[3];
+    for (int p = 0; p < 3; p++) {
+        pts[p] = world_to_scene_pt(&w_pts[p]);
+    }
+
+    // Entry -> Normal, Entry -> Reverse
+    for (int l = 0; l < 2; l++) {
+        scene_set_line(si->lines[l], si->pts[l], pts[0], pts[l + 1]);
+    }
+
+    int16_t w_cx, w_cy;
+    panel_geometry_get_center(pi, &w_cx, &w_cy);
+    int16_t vcx = world_to_scene_x(w_cx);
+    int16_t vcy = world_to_scene_y(w_cy);
+    lv_point_t w_centre = { w_cx, w_cy };
+    panel_hit_index_set_item(i, w_pts, w_centre);
+
+    for (int p = 0; p < 3; p++) {
+        int ds = scene_item_dot_size(i, pi, p);
+        if (ds > 0) {
+            lv_obj_set_pos(si->dots[p], pts[p].x - ds / 2, pts[p].y - ds / 2);
         }
-        turnout_manager_unlock();
     }
 
-    // Draw placed items
-    for (size_t i = 0; i < layout->item_count && i < PANEL_MAX_ITEMS; i++) {
-        const panel_item_t *pi = &layout->items[i];
+    // Turnout name label (small, above the symbol)
+    if (si->name_lbl) {
+        lv_obj_set_pos(si->name_lbl, vcx - 30, vcy - s_metrics.hb_h / 2 - 14);
+    }
+}
 
-        // Get world-space points then transform to view-space
-        lv_point_t w_entry, w_normal, w_reverse;
-        panel_geometry_get_points(pi, &w_entry, &w_normal, &w_reverse);
+/**
+ * @brief Restyle item @p i for the current selection/mode, then place it
+ */
+static void scene_item_update(size_t i)
+{
+    panel_layout_t *layout = panel_layout_get();
+    if (i >= s_scene.item_count || i >= layout->item_count) return;
 
-        lv_point_t entry = world_to_view_pt(&w_entry);
-        lv_point_t normal_pt = world_to_view_pt(&w_normal);
-        lv_point_t reverse_pt = world_to_view_pt(&w_reverse);
+    scene_item_t *si = &s_scene.items[i];
+    const panel_item_t *pi = &layout->items[i];
 
-        bool selected = ((int)i == s_selected_item);
-        lv_color_t line_color = selected ? lv_color_hex(COLOR_SELECTED)
-                                         : lv_color_hex(COLOR_NORMAL_LINE);
+    bool selected = ((int)i == s_selected_item);
+    lv_color_t line_color = selected ? lv_color_hex(COLOR_SELECTED)
+                                     : lv_color_hex(COLOR_NORMAL_LINE);
+    int16_t lw = selected ? s_metrics.lw_selected : s_metrics.lw_normal;
 
-        // Entry -> Normal line
-        if (line_idx < BUILDER_MAX_LINES) {
-            s_preview_line_pts[line_idx][0] = entry;
-            s_preview_line_pts[line_idx][1] = normal_pt;
+    for (int l = 0; l < 2; l++) {
+        lv_obj_set_style_line_width(si->lines[l], lw, LV_PART_MAIN);
+        lv_obj_set_style_line_color(si->lines[l], line_color, LV_PART_MAIN);
+    }
 
-            lv_obj_t *line = lv_line_create(s_canvas);
-            lv_line_set_points(line, s_preview_line_pts[line_idx], 2);
-            lv_obj_set_style_line_width(line, selected ? lw_selected : lw_normal, LV_PART_MAIN);
-            lv_obj_set_style_line_rounded(line, true, LV_PART_MAIN);
-            lv_obj_set_style_line_color(line, line_color, LV_PART_MAIN);
-            add_preview_obj(line);
-            line_idx++;
+    // Connection point indicators (visible when selected or in track draw mode)
+    static const uint32_t pt_colors[3] = {
+        0xFFFFFF,   // Entry: white
+        0x4CAF50,   // Normal: green
+        0xFFC107,   // Reverse: amber
+    };
+    int normal_size = scene_item_dot_size(i, pi, -1);   // -1 never matches the highlighted point
+
+    for (int p = 0; p < 3; p++) {
+        lv_obj_t *dot = si->dots[p];
+        int ds = scene_item_dot_size(i, pi, p);
+        if (ds == 0) {
+            lv_obj_add_flag(dot, LV_OBJ_FLAG_HIDDEN);
+            continue;
         }
 
-        // Entry -> Reverse line
-        if (line_idx < BUILDER_MAX_LINES) {
-            s_preview_line_pts[line_idx][0] = entry;
-            s_preview_line_pts[line_idx][1] = reverse_pt;
-
-            lv_obj_t *line = lv_line_create(s_canvas);
-            lv_line_set_points(line, s_preview_line_pts[line_idx], 2);
-            lv_obj_set_style_line_width(line, selected ? lw_selected : lw_normal, LV_PART_MAIN);
-            lv_obj_set_style_line_rounded(line, true, LV_PART_MAIN);
-            lv_obj_set_style_line_color(line, line_color, LV_PART_MAIN);
-            add_preview_obj(line);
-            line_idx++;
-        }
+        bool active = ds != normal_size;
+        lv_obj_set_style_bg_color(dot, lv_color_hex(active ? COLOR_CONN_ACTIVE : pt_colors[p]),
+                                  LV_PART_MAIN);
+        lv_obj_set_size(dot, ds, ds);
+        lv_obj_clear_flag(dot, LV_OBJ_FLAG_HIDDEN);
+    }
 
-        // Clickable/draggable hitbox for this item (view-space)
-        int16_t w_cx, w_cy;
-        panel_geometry_get_center(pi, &w_cx, &w_cy);
-        int16_t vcx = world_to_view_x(w_cx);
-        int16_t vcy = world_to_view_y(w_cy);
-
-        // If this item is being actively dragged, reuse the existing hitbox
-        if (s_drag_active_hitbox && !s_drag_active_is_endpoint && s_drag_active_idx == (int)i) {
-            lv_obj_set_size(s_drag_active_hitbox, hb_w, hb_h);
-            lv_obj_set_pos(s_drag_active_hitbox, vcx - hb_w / 2, vcy - hb_h / 2);
-            add_preview_obj(s_drag_active_hitbox);
-        } else {
-            lv_obj_t *hitbox = lv_obj_create(s_canvas);
-            lv_obj_remove_style_all(hitbox);
-            lv_obj_set_size(hitbox, hb_w, hb_h);
-            lv_obj_set_pos(hitbox, vcx - hb_w / 2, vcy - hb_h / 2);
-            lv_obj_add_flag(hitbox, LV_OBJ_FLAG_CLICKABLE);
-            lv_obj_clear_flag(hitbox, LV_OBJ_FLAG_SCROLLABLE);
-            lv_obj_add_event_cb(hitbox, placed_item_click_cb, LV_EVENT_CLICKED,
-                               (void *)(uintptr_t)i);
-            lv_obj_add_event_cb(hitbox, placed_item_drag_cb, LV_EVENT_PRESSING,
-                               (void *)(uintptr_t)i);
-            lv_obj_add_event_cb(hitbox, placed_item_release_cb, LV_EVENT_RELEASED,
-                               (void *)(uintptr_t)i);
-            lv_obj_add_event_cb(hitbox, placed_item_release_cb, LV_EVENT_PRESS_LOST,
-                               (void *)(uintptr_t)i);
-            add_preview_obj(hitbox);
-        }
+    scene_item_place(i);
+}
 
-        // Connection point indicators (visible when selected or in track draw mode)
-        if (selected || s_draw_track_mode) {
-            lv_point_t pts[3] = { entry, normal_pt, reverse_pt };
-            panel_point_type_t pt_types[3] = {
-                PANEL_POINT_ENTRY, PANEL_POINT_NORMAL, PANEL_POINT_REVERSE
-            };
-            lv_color_t pt_colors[3] = {
-                lv_color_hex(0xFFFFFF),    // Entry: white
-                lv_color_hex(0x4CAF50),    // Normal: green
-                lv_color_hex(0xFFC107),    // Reverse: amber
-            };
+/**
+ * @brief Create the objects for item @p i (does not position them)
+ * @param name Turnout name, or NULL if the turnout is unknown
+ */
+static void scene_item_create(size_t i, const char *name)
+{
+    scene_item_t *si = &s_scene.items[i];
+    memset(si, 0, sizeof(*si));
 
-            int base_dot = s_draw_track_mode ? 20 : 12;
-            int dot_size = (int)((int32_t)base_dot * s_zoom_pct / 100);
-            if (dot_size < 10) dot_size = 10;
-
-            for (int p = 0; p < 3; p++) {
-                int ds = dot_size;
-                lv_obj_t *dot = lv_obj_create(s_canvas);
-                lv_obj_remove_style_all(dot);
-                lv_obj_set_style_bg_color(dot, pt_colors[p], LV_PART_MAIN);
-                lv_obj_set_style_bg_opa(dot, LV_OPA_COVER, LV_PART_MAIN);
-                lv_obj_set_style_radius(dot, LV_RADIUS_CIRCLE, LV_PART_MAIN);
-                lv_obj_set_style_border_width(dot, 1, LV_PART_MAIN);
-                lv_obj_set_style_border_color(dot, lv_color_hex(0x000000), LV_PART_MAIN);
-
-                // Highlight the first-selected point in track draw mode
-                if (s_draw_track_mode && s_track_first_selected &&
-                    s_track_from_ref.type == PANEL_REF_TURNOUT &&
-                    pi->turnout_id == s_track_from_ref.id &&
-                    pt_types[p] == s_track_from_ref.point) {
-                    lv_obj_set_style_bg_color(dot, lv_color_hex(COLOR_CONN_ACTIVE), LV_PART_MAIN);
-                    ds = ds + ds / 3;  // ~33% larger for highlight
-                }
+    for (int l = 0; l < 2; l++) {
+        si->lines[l] = scene_create_line(s_scene.layer_items, si->pts[l]);
+    }
 
-                lv_obj_set_size(dot, ds, ds);
-                lv_obj_set_pos(dot, pts[p].x - ds / 2, pts[p].y - ds / 2);
+    for (int p = 0; p < 3; p++) {
+        lv_obj_t *dot = scene_create_dot(s_scene.layer_dots, 1);
+        lv_obj_set_style_border_color(dot, lv_color_hex(0x000000), LV_PART_MAIN);
+        lv_obj_add_flag(dot, LV_OBJ_FLAG_HIDDEN);
+        si->dots[p] = dot;
+    }
 
-                if (s_draw_track_mode) {
-                    lv_obj_add_flag(dot, LV_OBJ_FLAG_CLICKABLE);
-                    uint32_t packed = ((uint32_t)i << 8) | (uint32_t)pt_types[p];
-                    lv_obj_add_event_cb(dot, conn_point_click_cb, LV_EVENT_CLICKED,
-                                       (void *)(uintptr_t)packed);
-                }
+    if (name) {
+        si->name_lbl = lv_label_create(s_scene.layer_items);
+        lv_label_set_text(si->name_lbl, name);
+        lv_obj_set_style_text_font(si->name_lbl, &lv_font_montserrat_12, LV_PART_MAIN);
+        lv_obj_set_style_text_color(si->name_lbl, lv_color_hex(0xBBBBBB), LV_PART_MAIN);
+    }
+}
 
-                add_preview_obj(dot);
-            }
-        }
+/**
+ * @brief Add the scene element for a layout item inserted at @p i
+ *        (normally appended; undo restores removed items in place)
+ */
+static void scene_item_add(size_t i, const char *name)
+{
+    if (i > s_scene.item_count) return;
+
+    scene_item_t *before = s_scene.items;
+    if (!psram_array_reserve((void **)&s_scene.items, &s_scene.item_capacity,
+                             s_scene.item_count + 1, sizeof(s_scene.items[0]))) {
+        return;
+    }
+    // Growth that moved the array leaves every line pointing at freed points
+    size_t first = (s_scene.items == before) ? i + 1 : 0;
+
+    memmove(&s_scene.items[i + 1], &s_scene.items[i],
+            (s_scene.item_count - i) * sizeof(s_scene.items[0]));
+    s_scene.item_count++;
+    panel_hit_index_insert(PANEL_HIT_ELEM_ITEM, i);
+    for (size_t j = first; j < s_scene.item_count; j++) {
+        if (j != i) scene_item_reindex(j);
+    }
+    scene_item_create(i, name);
+    scene_item_update(i);
+}
+
+/**
+ * @brief Delete item @p i's objects and shift later records down.
+ *        Call before panel_layout_remove_item() so indices still agree.
+ */
+static void scene_item_remove(size_t i)
+{
+    if (i >= s_scene.item_count) return;
+
+    scene_item_t *si = &s_scene.items[i];
+    lv_obj_del(si->lines[0]);
+    lv_obj_del(si->lines[1]);
+    for (int p = 0; p < 3; p++) lv_obj_del(si->dots[p]);
+    if (si->name_lbl) lv_obj_del(si->name_lbl);
+    panel_hit_index_remove(PANEL_HIT_ELEM_ITEM, i);
+
+    s_scene.item_count--;
+    memmove(&s_scene.items[i], &s_scene.items[i + 1],
+            (s_scene.item_count - i) * sizeof(s_scene.items[0]));
+    for (size_t j = i; j < s_scene.item_count; j++) {
+        scene_item_reindex(j);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Track segments
+// ---------------------------------------------------------------------------
+
+static void scene_track_reindex(size_t i)
+{
+    scene_track_t *st = &s_scene.tracks[i];
+    lv_line_set_points(st->line, st->pts, 2);
+}
+
+/**
+ * @brief Move track @p i's line and hit segment to its resolved end points.
+ *        Geometry only; returns false if either end no longer resolves.
+ */
+static bool scene_track_place(size_t i)
+{
+    panel_layout_t *layout = panel_layout_get();
+    if (i >= s_scene.track_count || i >= layout->track_count) return false;
+
+    scene_track_t *st = &s_scene.tracks[i];
+
+    // Resolve via shared layout operation
+    int16_t x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    if (!panel_layout_resolve_track(layout, &layout->tracks[i], &x1, &y1, &x2, &y2)) {
+        panel_hit_index_unset(PANEL_HIT_ELEM_TRACK, i);
+        return false;
+    }
 
-        // Turnout name label (small, above the symbol)
-        if (s_tn_found[i]) {
-            lv_obj_t *name_lbl = lv_label_create(s_canvas);
-            lv_label_set_text(name_lbl, s_tn_names[i]);
-            lv_obj_set_style_text_font(name_lbl, &lv_font_montserrat_12, LV_PART_MAIN);
-            lv_obj_set_style_text_color(name_lbl, lv_color_hex(0xBBBBBB), LV_PART_MAIN);
-            lv_obj_set_pos(name_lbl, vcx - 30, vcy - hb_h / 2 - 14);
-            add_preview_obj(name_lbl);
+    // Transform world-space track endpoints to view-space
+    lv_point_t a = { world_to_scene_x(x1), world_to_scene_y(y1) };
+    lv_point_t b = { world_to_scene_x(x2), world_to_scene_y(y2) };
+    scene_set_line(st->line, st->pts, a, b);
+
+    lv_point_t wa = { x1, y1 };
+    lv_point_t wb = { x2, y2 };
+    panel_hit_index_set_track(i, wa, wb);
+    return true;
+}
+
+/**
+ * @brief Restyle and place track @p i; hides tracks with a dangling end
+ */
+static void scene_track_update(size_t i)
+{
+    if (i >= s_scene.track_count) return;
+
+    scene_track_t *st = &s_scene.tracks[i];
+
+    if (!scene_track_place(i)) {
+        lv_obj_add_flag(st->line, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+
+    bool track_selected = ((int)i == s_selected_track);
+    lv_obj_set_style_line_width(st->line,
+        track_selected ? s_metrics.lw_track + 2 : s_metrics.lw_track, LV_PART_MAIN);
+    lv_obj_set_style_line_color(st->line,
+        lv_color_hex(track_selected ? COLOR_SELECTED : COLOR_TRACK_DRAW), LV_PART_MAIN);
+    lv_obj_clear_flag(st->line, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void scene_track_create(size_t i)
+{
+    scene_track_t *st = &s_scene.tracks[i];
+    memset(st, 0, sizeof(*st));
+
+    st->line = scene_create_line(s_scene.layer_tracks, st->pts);
+}
+
+/**
+ * @brief Add the scene element for a layout track inserted at @p i
+ */
+static void scene_track_add(size_t i)
+{
+    if (i > s_scene.track_count) return;
+
+    scene_track_t *before = s_scene.tracks;
+    if (!psram_array_reserve((void **)&s_scene.tracks, &s_scene.track_capacity,
+                             s_scene.track_count + 1, sizeof(s_scene.tracks[0]))) {
+        return;
+    }
+    size_t first = (s_scene.tracks == before) ? i + 1 : 0;
+
+    memmove(&s_scene.tracks[i + 1], &s_scene.tracks[i],
+            (s_scene.track_count - i) * sizeof(s_scene.tracks[0]));
+    s_scene.track_count++;
+    panel_hit_index_insert(PANEL_HIT_ELEM_TRACK, i);
+    for (size_t j = first; j < s_scene.track_count; j++) {
+        if (j != i) scene_track_reindex(j);
+    }
+    scene_track_create(i);
+    scene_track_update(i);
+}
+
+/**
+ * @brief Delete track @p i's objects and shift later records down.
+ *        Call before the layout removes the track so indices still agree.
+ */
+static void scene_track_remove(size_t i)
+{
+    if (i >= s_scene.track_count) return;
+
+    lv_obj_del(s_scene.tracks[i].line);
+    panel_hit_index_remove(PANEL_HIT_ELEM_TRACK, i);
+
+    s_scene.track_count--;
+    memmove(&s_scene.tracks[i], &s_scene.tracks[i + 1],
+            (s_scene.track_count - i) * sizeof(s_scene.tracks[0]));
+    for (size_t j = i; j < s_scene.track_count; j++) {
+        scene_track_reindex(j);
+    }
+}
+
+/**
+ * @brief Re-resolve every track attached to an element after it moved
+ */
+static void scene_update_tracks_for(panel_ref_type_t type, uint32_t id)
+{
+    size_t n = collect_attached(type, id, &s_attached, &s_attached_capacity);
+    for (size_t k = 0; k < n; k++) {
+        if (s_attached[k] < s_scene.track_count) {
+            scene_track_update(s_attached[k]);
         }
     }
+}
 
-    // Draw track segments BEFORE endpoints so that endpoint/turnout hitboxes
-    // have higher z-order and receive touch priority over track hitboxes.
-    for (size_t i = 0; i < layout->track_count && i < PANEL_MAX_TRACKS; i++) {
-        const panel_track_t *pt = &layout->tracks[i];
-
-        // Resolve via shared layout operation
-        int16_t x1 = 0, y1 = 0, x2 = 0, y2 = 0;
-        if (!panel_layout_resolve_track(layout, pt, &x1, &y1, &x2, &y2)) continue;
-
-        bool track_selected = ((int)i == s_selected_track);
-
-        if (line_idx < BUILDER_MAX_LINES + PANEL_MAX_TRACKS) {
-            // Transform world-space track endpoints to view-space
-            int16_t vx1 = world_to_view_x(x1);
-            int16_t vy1 = world_to_view_y(y1);
-            int16_t vx2 = world_to_view_x(x2);
-            int16_t vy2 = world_to_view_y(y2);
-
-            s_preview_line_pts[line_idx][0].x = vx1;
-            s_preview_line_pts[line_idx][0].y = vy1;
-            s_preview_line_pts[line_idx][1].x = vx2;
-            s_preview_line_pts[line_idx][1].y = vy2;
-
-            lv_color_t track_color = track_selected
-                ? lv_color_hex(COLOR_SELECTED)
-                : lv_color_hex(COLOR_TRACK_DRAW);
-            int16_t tw = track_selected ? lw_track + 2 : lw_track;
-
-            lv_obj_t *track_line = lv_line_create(s_canvas);
-            lv_line_set_points(track_line, s_preview_line_pts[line_idx], 2);
-            lv_obj_set_style_line_width(track_line, tw, LV_PART_MAIN);
-            lv_obj_set_style_line_rounded(track_line, true, LV_PART_MAIN);
-            lv_obj_set_style_line_color(track_line, track_color, LV_PART_MAIN);
-            add_preview_obj(track_line);
-            line_idx++;
-
-            // Invisible clickable hitbox along the track segment for selection.
-            // Compute an axis-aligned bounding box around the line with padding.
-            if (!s_draw_track_mode) {
-                int16_t pad = 12;  // tap padding in pixels
-                int16_t hx = (vx1 < vx2 ? vx1 : vx2) - pad;
-                int16_t hy = (vy1 < vy2 ? vy1 : vy2) - pad;
-                int16_t hw = (vx1 > vx2 ? vx1 - vx2 : vx2 - vx1) + pad * 2;
-                int16_t hh = (vy1 > vy2 ? vy1 - vy2 : vy2 - vy1) + pad * 2;
-                if (hw < 24) { hx -= (24 - hw) / 2; hw = 24; }
-                if (hh < 24) { hy -= (24 - hh) / 2; hh = 24; }
-
-                lv_obj_t *track_hb = lv_obj_create(s_canvas);
-                lv_obj_remove_style_all(track_hb);
-                lv_obj_set_size(track_hb, hw, hh);
-                lv_obj_set_pos(track_hb, hx, hy);
-                lv_obj_add_flag(track_hb, LV_OBJ_FLAG_CLICKABLE);
-                lv_obj_clear_flag(track_hb, LV_OBJ_FLAG_SCROLLABLE);
-                lv_obj_add_event_cb(track_hb, track_click_cb, LV_EVENT_CLICKED,
-                                   (void *)(uintptr_t)i);
-                add_preview_obj(track_hb);
-            }
+/**
+ * @brief Mirror the layout's cascade delete for an element about to be removed.
+ *        Walks backwards so lower indices stay aligned with the layout.
+ */
+static void scene_remove_tracks_for(panel_ref_type_t type, uint32_t id)
+{
+    size_t n = collect_attached(type, id, &s_attached, &s_attached_capacity);
+    for (size_t k = n; k-- > 0;) {
+        if (s_attached[k] < s_scene.track_count) {
+            scene_track_remove(s_attached[k]);
         }
     }
+}
 
-    // Draw endpoints AFTER tracks so their hitboxes have higher z-priority
-    for (size_t i = 0; i < layout->endpoint_count && i < PANEL_MAX_ENDPOINTS; i++) {
-        const panel_endpoint_t *ep = &layout->endpoints[i];
+// ---------------------------------------------------------------------------
+// Endpoints
+// ---------------------------------------------------------------------------
 
-        int16_t wx = (int16_t)(ep->grid_x * PANEL_GRID_SIZE);
-        int16_t wy = (int16_t)(ep->grid_y * PANEL_GRID_SIZE);
-        int16_t vx = world_to_view_x(wx);
-        int16_t vy = world_to_view_y(wy);
+/**
+ * @brief Dot diameter for endpoint @p ep under the current mode
+ */
+static int scene_endpoint_dot_size(const panel_endpoint_t *ep)
+{
+    // Dot size scales with zoom; larger in draw mode for easier tapping
+    int base_dot = s_draw_track_mode ? 20 : 14;
+    int dot_sz = (int)((int32_t)base_dot * s_zoom_pct / 100);
+    if (dot_sz < 8) dot_sz = 8;
+
+    // Highlight the first-selected endpoint in track draw mode
+    if (s_draw_track_mode && s_track_first_selected &&
+        s_track_from_ref.type == PANEL_REF_ENDPOINT && s_track_from_ref.id == ep->id) {
+        dot_sz = dot_sz + dot_sz / 3;
+    }
+    return dot_sz;
+}
 
-        bool ep_selected = ((int)i == s_selected_endpoint);
+/**
+ * @brief Move endpoint @p i's dot and hit point to its grid position (geometry only)
+ */
+static void scene_endpoint_place(size_t i)
+{
+    panel_layout_t *layout = panel_layout_get();
+    if (i >= s_scene.endpoint_count || i >= layout->endpoint_count) return;
 
-        // Dot size scales with zoom; larger in draw mode for easier tapping
-        int base_dot = s_draw_track_mode ? 20 : 14;
-        int dot_sz = (int)((int32_t)base_dot * s_zoom_pct / 100);
-        if (dot_sz < 8) dot_sz = 8;
+    scene_endpoint_t *se = &s_scene.endpoints[i];
+    const panel_endpoint_t *ep = &layout->endpoints[i];
 
-        lv_color_t dot_color = ep_selected ? lv_color_hex(COLOR_SELECTED)
-                                           : lv_color_hex(COLOR_ENDPOINT);
+    lv_point_t wp = {
+        (lv_coord_t)(ep->grid_x * PANEL_GRID_SIZE), (lv_coord_t)(ep->grid_y * PANEL_GRID_SIZE)
+    };
+    int16_t vx = world_to_scene_x(wp.x);
+    int16_t vy = world_to_scene_y(wp.y);
+    int dot_sz = scene_endpoint_dot_size(ep);
 
-        // Highlight the first-selected endpoint in track draw mode
-        if (s_draw_track_mode && s_track_first_selected &&
-            s_track_from_ref.type == PANEL_REF_ENDPOINT && s_track_from_ref.id == ep->id) {
-            dot_color = lv_color_hex(COLOR_CONN_ACTIVE);
-            dot_sz = dot_sz + dot_sz / 3;
-        }
+    lv_obj_set_pos(se->dot, vx - dot_sz / 2, vy - dot_sz / 2);
+    panel_hit_index_set_endpoint(i, wp);
+}
 
-        lv_obj_t *dot = lv_obj_create(s_canvas);
-        lv_obj_remove_style_all(dot);
-        lv_obj_set_style_bg_color(dot, dot_color, LV_PART_MAIN);
-        lv_obj_set_style_bg_opa(dot, LV_OPA_COVER, LV_PART_MAIN);
-        lv_obj_set_style_radius(dot, LV_RADIUS_CIRCLE, LV_PART_MAIN);
-        lv_obj_set_style_border_width(dot, 2, LV_PART_MAIN);
-        lv_obj_set_style_border_color(dot,
-            ep_selected ? lv_color_hex(0xFFFFFF) : lv_color_hex(0x000000), LV_PART_MAIN);
-        lv_obj_set_size(dot, dot_sz, dot_sz);
-        lv_obj_set_pos(dot, vx - dot_sz / 2, vy - dot_sz / 2);
-        add_preview_obj(dot);
-
-        // Hitbox for click/drag
-        int16_t ep_hb = (int16_t)((int32_t)30 * s_zoom_pct / 100);
-        if (ep_hb < 20) ep_hb = 20;
-
-        if (s_drag_active_hitbox && s_drag_active_is_endpoint && s_drag_active_idx == (int)i) {
-            lv_obj_set_size(s_drag_active_hitbox, ep_hb, ep_hb);
-            lv_obj_set_pos(s_drag_active_hitbox, vx - ep_hb / 2, vy - ep_hb / 2);
-            add_preview_obj(s_drag_active_hitbox);
-        } else {
-            lv_obj_t *hitbox = lv_obj_create(s_canvas);
-            lv_obj_remove_style_all(hitbox);
-            lv_obj_set_size(hitbox, ep_hb, ep_hb);
-            lv_obj_set_pos(hitbox, vx - ep_hb / 2, vy - ep_hb / 2);
-            lv_obj_add_flag(hitbox, LV_OBJ_FLAG_CLICKABLE);
-            lv_obj_clear_flag(hitbox, LV_OBJ_FLAG_SCROLLABLE);
-            lv_obj_add_event_cb(hitbox, placed_endpoint_click_cb, LV_EVENT_CLICKED,
-                               (void *)(uintptr_t)i);
-            lv_obj_add_event_cb(hitbox, placed_endpoint_drag_cb, LV_EVENT_PRESSING,
-                               (void *)(uintptr_t)i);
-            lv_obj_add_event_cb(hitbox, placed_endpoint_release_cb, LV_EVENT_RELEASED,
-                               (void *)(uintptr_t)i);
-            lv_obj_add_event_cb(hitbox, placed_endpoint_release_cb, LV_EVENT_PRESS_LOST,
-                               (void *)(uintptr_t)i);
-            add_preview_obj(hitbox);
+/**
+ * @brief Restyle endpoint @p i for the current selection/mode, then place it
+ */
+static void scene_endpoint_update(size_t i)
+{
+    panel_layout_t *layout = panel_layout_get();
+    if (i >= s_scene.endpoint_count || i >= layout->endpoint_count) return;
+
+    scene_endpoint_t *se = &s_scene.endpoints[i];
+    const panel_endpoint_t *ep = &layout->endpoints[i];
+
+    bool ep_selected = ((int)i == s_selected_endpoint);
+    bool ep_active = s_draw_track_mode && s_track_first_selected &&
+                     s_track_from_ref.type == PANEL_REF_ENDPOINT &&
+                     s_track_from_ref.id == ep->id;
+
+    lv_color_t dot_color = ep_active   ? lv_color_hex(COLOR_CONN_ACTIVE)
+                         : ep_selected ? lv_color_hex(COLOR_SELECTED)
+                                       : lv_color_hex(COLOR_ENDPOINT);
+    int dot_sz = scene_endpoint_dot_size(ep);
+
+    lv_obj_set_style_bg_color(se->dot, dot_color, LV_PART_MAIN);
+    lv_obj_set_style_border_color(se->dot,
+        ep_selected ? lv_color_hex(0xFFFFFF) : lv_color_hex(0x000000), LV_PART_MAIN);
+    lv_obj_set_size(se->dot, dot_sz, dot_sz);
+
+    scene_endpoint_place(i);
+}
+
+static void scene_endpoint_create(size_t i)
+{
+    scene_endpoint_t *se = &s_scene.endpoints[i];
+
+    se->dot = scene_create_dot(s_scene.layer_endpoints, 2);
+}
+
+/**
+ * @brief Add the scene element for a layout endpoint inserted at @p i
+ */
+static void scene_endpoint_add(size_t i)
+{
+    if (i > s_scene.endpoint_count) return;
+    if (!psram_array_reserve((void **)&s_scene.endpoints, &s_scene.endpoint_capacity,
+                             s_scene.endpoint_count + 1, sizeof(s_scene.endpoints[0]))) {
+        return;
+    }
+
+    memmove(&s_scene.endpoints[i + 1], &s_scene.endpoints[i],
+            (s_scene.endpoint_count - i) * sizeof(s_scene.endpoints[0]));
+    s_scene.endpoint_count++;
+    panel_hit_index_insert(PANEL_HIT_ELEM_ENDPOINT, i);
+    scene_endpoint_create(i);
+    scene_endpoint_update(i);
+}
+
+/**
+ * @brief Delete endpoint @p i's objects and shift later records down.
+ *        Call before panel_layout_remove_endpoint() so indices still agree.
+ */
+static void scene_endpoint_remove(size_t i)
+{
+    if (i >= s_scene.endpoint_count) return;
+
+    lv_obj_del(s_scene.endpoints[i].dot);
+    panel_hit_index_remove(PANEL_HIT_ELEM_ENDPOINT, i);
+
+    s_scene.endpoint_count--;
+    memmove(&s_scene.endpoints[i], &s_scene.endpoints[i + 1],
+            (s_scene.endpoint_count - i) * sizeof(s_scene.endpoints[0]));
+}
+
+// ---------------------------------------------------------------------------
+// Whole-scene operations
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Restyle whichever element a track reference points at
+ */
+static void scene_ref_update(const panel_ref_t *ref)
+{
+    panel_layout_t *layout = panel_layout_get();
+
+    if (ref->type == PANEL_REF_TURNOUT) {
+        int idx = panel_layout_find_item(layout, ref->id);
+        if (idx >= 0) scene_item_update((size_t)idx);
+        return;
+    }
+
+    for (size_t i = 0; i < layout->endpoint_count; i++) {
+        if (layout->endpoints[i].id == ref->id) {
+            scene_endpoint_update(i);
+            return;
         }
     }
+}
+
+/**
+ * @brief Show the hint for the current placement/draw mode, if any
+ */
+static void scene_update_hint(void)
+{
+    if (!s_scene.hint) return;
+
+    const char *text = NULL;
+    uint32_t color = 0;
 
-    // Show placement/mode hints
     if (s_placement_mode) {
-        lv_obj_t *hint = lv_label_create(s_canvas);
-        lv_label_set_text(hint, "Tap canvas to place turnout");
-        lv_obj_set_style_text_font(hint, &lv_font_montserrat_14, LV_PART_MAIN);
-        lv_obj_set_style_text_color(hint, lv_color_hex(COLOR_BTN_ADD), LV_PART_MAIN);
-        lv_obj_align(hint, LV_ALIGN_BOTTOM_MID, 0, -8);
-        add_preview_obj(hint);
+        text = "Tap canvas to place turnout";
+        color = COLOR_BTN_ADD;
+    } else if (s_placement_endpoint_mode) {
+        text = "Tap canvas to place endpoint";
+        color = COLOR_ENDPOINT;
+    } else if (s_draw_track_mode) {
+        text = s_track_first_selected
+            ? "Now tap a second point to complete the track"
+            : "Tap a connection point on a turnout or endpoint to start a track";
+        color = COLOR_CONN_ACTIVE;
     }
-    if (s_placement_endpoint_mode) {
-        lv_obj_t *hint = lv_label_create(s_canvas);
-        lv_label_set_text(hint, "Tap canvas to place endpoint");
-        lv_obj_set_style_text_font(hint, &lv_font_montserrat_14, LV_PART_MAIN);
-        lv_obj_set_style_text_color(hint, lv_color_hex(COLOR_ENDPOINT), LV_PART_MAIN);
-        lv_obj_align(hint, LV_ALIGN_BOTTOM_MID, 0, -8);
-        add_preview_obj(hint);
+
+    if (!text) {
+        lv_obj_add_flag(s_scene.hint, LV_OBJ_FLAG_HIDDEN);
+        return;
     }
-    if (s_draw_track_mode) {
-        lv_obj_t *hint = lv_label_create(s_canvas);
-        if (s_track_first_selected) {
-            lv_label_set_text(hint, "Now tap a second point to complete the track");
-        } else {
-            lv_label_set_text(hint, "Tap a connection point on a turnout or endpoint to start a track");
+
+    lv_label_set_text_static(s_scene.hint, text);
+    lv_obj_set_style_text_color(s_scene.hint, lv_color_hex(color), LV_PART_MAIN);
+    lv_obj_clear_flag(s_scene.hint, LV_OBJ_FLAG_HIDDEN);
+}
+
+/**
+ * @brief Reposition and restyle every element in place.
+ *        Used when the viewport or a global mode changes; creates no objects.
+ */
+static void scene_update_all(void)
+{
+    if (!s_canvas) return;
+
+    scene_compute_metrics();
+    for (size_t i = 0; i < s_scene.item_count; i++) scene_item_update(i);
+    for (size_t i = 0; i < s_scene.track_count; i++) scene_track_update(i);
+    for (size_t i = 0; i < s_scene.endpoint_count; i++) scene_endpoint_update(i);
+    scene_update_hint();
+}
+
+/**
+ * @brief Discard the scene and rebuild it from the layout model.
+ *        Only needed when the layout changes outside the builder.
+ */
+static void scene_rebuild(void)
+{
+    if (!s_canvas) return;
+
+    if (!s_scene.layer_items) {
+        // Pan/zoom act on this one container; its transform pivots at 0,0
+        s_scene.world = scene_create_layer(s_canvas);
+        lv_obj_set_style_transform_pivot_x(s_scene.world, 0, LV_PART_MAIN);
+        lv_obj_set_style_transform_pivot_y(s_scene.world, 0, LV_PART_MAIN);
+        builder_view_apply(s_zoom_pct, s_pan_x, s_pan_y);
+
+        s_scene.layer_items = scene_create_layer(s_scene.world);
+        s_scene.layer_tracks = scene_create_layer(s_scene.world);
+        s_scene.layer_dots = scene_create_layer(s_scene.world);
+        s_scene.layer_endpoints = scene_create_layer(s_scene.world);
+
+        s_scene.hint = lv_label_create(s_canvas);
+        lv_obj_set_style_text_font(s_scene.hint, &lv_font_montserrat_14, LV_PART_MAIN);
+        lv_obj_align(s_scene.hint, LV_ALIGN_BOTTOM_MID, 0, -8);
+        lv_obj_add_flag(s_scene.hint, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        /* Bulk-delete all layer children (much faster than per-object lv_obj_del) */
+        lv_obj_clean(s_scene.layer_items);
+        lv_obj_clean(s_scene.layer_tracks);
+        lv_obj_clean(s_scene.layer_dots);
+        lv_obj_clean(s_scene.layer_endpoints);
+    }
+    s_scene.item_count = 0;
+    s_scene.track_count = 0;
+    s_scene.endpoint_count = 0;
+    panel_hit_index_clear();
+
+    panel_layout_t *layout = panel_layout_get();
+
+    // Size the records up front so no line's points move during the build
+    size_t item_count = layout->item_count;
+    size_t track_count = layout->track_count;
+    size_t endpoint_count = layout->endpoint_count;
+    if (!psram_array_reserve((void **)&s_scene.items, &s_scene.item_capacity,
+                             item_count, sizeof(s_scene.items[0]))) {
+        item_count = s_scene.item_capacity;
+    }
+    if (!psram_array_reserve((void **)&s_scene.tracks, &s_scene.track_capacity,
+                             track_count, sizeof(s_scene.tracks[0]))) {
+        track_count = s_scene.track_capacity;
+    }
+    if (!psram_array_reserve((void **)&s_scene.endpoints, &s_scene.endpoint_capacity,
+                             endpoint_count, sizeof(s_scene.endpoints[0]))) {
+        endpoint_count = s_scene.endpoint_capacity;
+    }
+
+    // Copy turnout names from one table snapshot (#2: batch lookups) into a
+    // scratch array that only lives for the rebuild
+    typedef struct {
+        char name[32];
+        bool found;
+    } tn_name_t;
+    tn_name_t *tn = NULL;
+    size_t tn_capacity = 0;
+    if (psram_array_reserve((void **)&tn, &tn_capacity, item_count, sizeof(tn[0]))) {
+        const turnout_snapshot_t *snap = turnout_manager_snapshot_acquire();
+        const turnout_t *turnouts = snap ? snap->turnouts : NULL;
+        size_t turnout_count = snap ? snap->count : 0;
+        for (size_t i = 0; i < item_count; i++) {
+            for (size_t j = 0; j < turnout_count; j++) {
+                if (turnouts[j].id == layout->items[i].turnout_id) {
+                    memcpy(tn[i].name, turnouts[j].name, sizeof(turnouts[j].name));
+                    tn[i].found = true;
+                    break;
+                }
+            }
         }
-        lv_obj_set_style_text_font(hint, &lv_font_montserrat_14, LV_PART_MAIN);
-        lv_obj_set_style_text_color(hint, lv_color_hex(COLOR_CONN_ACTIVE), LV_PART_MAIN);
-        lv_obj_align(hint, LV_ALIGN_BOTTOM_MID, 0, -8);
-        add_preview_obj(hint);
+        turnout_manager_snapshot_release(snap);
+    }
+
+    for (size_t i = 0; i < item_count; i++) {
+        scene_item_create(i, (tn && tn[i].found) ? tn[i].name : NULL);
+        s_scene.item_count++;
+        panel_hit_index_insert(PANEL_HIT_ELEM_ITEM, i);
+    }
+    psram_array_free((void **)&tn, &tn_capacity);
+
+    for (size_t i = 0; i < track_count; i++) {
+        scene_track_create(i);
+        s_scene.track_count++;
+        panel_hit_index_insert(PANEL_HIT_ELEM_TRACK, i);
     }
+    for (size_t i = 0; i < endpoint_count; i++) {
+        scene_endpoint_create(i);
+        s_scene.endpoint_count++;
+        panel_hit_index_insert(PANEL_HIT_ELEM_ENDPOINT, i);
+    }
+
+    scene_update_all();
+    mem_budget_checkpoint(MEM_CP_BUILDER, layout->item_count);
+}
+
+/**
+ * @brief Drop the scene's object references after LVGL deleted the canvas.
+ *        The record arrays are kept for the next build.
+ */
+static void scene_forget(void)
+{
+    s_scene.world = NULL;
+    s_scene.layer_items = NULL;
+    s_scene.layer_tracks = NULL;
+    s_scene.layer_dots = NULL;
+    s_scene.layer_endpoints = NULL;
+    s_scene.hint = NULL;
+    s_scene.item_count = 0;
+    s_scene.track_count = 0;
+    s_scene.endpoint_count = 0;
 }
 
 // ============================================================================
@@ -1520,6 +2424,14 @@ static void builder_refresh_toolbar(void)
             s_placement_endpoint_mode ? lv_color_hex(0x0277BD) : lv_color_hex(COLOR_ENDPOINT),
             LV_PART_MAIN);
     }
+    if (s_btn_undo) {
+        lv_obj_set_style_bg_opa(s_btn_undo,
+            panel_history_can_undo() ? LV_OPA_COVER : LV_OPA_50, LV_PART_MAIN);
+    }
+    if (s_btn_redo) {
+        lv_obj_set_style_bg_opa(s_btn_redo,
+            panel_history_can_redo() ? LV_OPA_COVER : LV_OPA_50, LV_PART_MAIN);
+    }
     if (s_btn_save && !s_save_flash_timer) {
         // Only update save appearance if not mid-flash
         lv_obj_set_style_bg_opa(s_btn_save,
@@ -1533,6 +2445,42 @@ static void builder_refresh_toolbar(void)
 // Public API
 // ============================================================================
 
+/**
+ * @brief Canvas teardown (settings screen cleaned). Drops everything that
+ *        would otherwise outlive the LVGL objects it points at.
+ */
+static void canvas_delete_cb(lv_event_t *e)
+{
+    (void)e;
+    ui_set_multitouch_handler(NULL);
+    s_pinch.active = false;
+    if (s_view.settle_timer) {
+        lv_timer_del(s_view.settle_timer);
+        s_view.settle_timer = NULL;
+    }
+    if (s_view.pending) {
+        // Keep the previewed view for the next time the tab is built
+        s_view.pending = false;
+        s_zoom_pct = s_view.zoom_pct;
+        s_pan_x = s_view.pan_x;
+        s_pan_y = s_view.pan_y;
+    }
+    if (s_save_flash_timer) {
+        lv_timer_del(s_save_flash_timer);
+        s_save_flash_timer = NULL;
+    }
+    s_drag.active = false;
+    s_press.hit = false;
+    scene_forget();
+    panel_hit_index_clear();
+    s_canvas = NULL;
+    s_zoom_label = NULL;
+    s_save_label = NULL;
+    s_btn_rotate = s_btn_mirror = s_btn_delete = s_btn_draw_track = NULL;
+    s_btn_save = s_btn_add_turnout = s_btn_add_endpoint = NULL;
+    s_btn_undo = s_btn_redo = NULL;
+}
+
 void ui_create_panel_builder_tab(lv_obj_t *parent)
 {
     ESP_LOGI(TAG, "Creating panel builder tab");
@@ -1545,11 +2493,22 @@ void ui_create_panel_builder_tab(lv_obj_t *parent)
     s_placement_endpoint_mode = false;
     s_draw_track_mode = false;
     s_track_first_selected = false;
-    s_preview_obj_count = 0;
+    scene_forget();
+    s_drag.active = false;
+    s_pinch.active = false;
     s_modal_overlay = NULL;
     s_dirty = false;
     s_save_label = NULL;
     s_save_flash_timer = NULL;
+    s_btn_undo = NULL;
+    s_btn_redo = NULL;
+    s_press.hit = false;
+
+    // Undo history covers one builder session
+    panel_history_clear();
+
+    // Taps are resolved through the hit index (allocated on first use)
+    panel_hit_index_init();
 
     lv_obj_set_style_pad_all(parent, 0, LV_PART_MAIN);
     lv_obj_clear_flag(parent, LV_OBJ_FLAG_SCROLLABLE);
@@ -1641,6 +2600,27 @@ void ui_create_panel_builder_tab(lv_obj_t *parent)
     lv_obj_set_style_text_font(track_lbl, &lv_font_montserrat_14, LV_PART_MAIN);
     lv_obj_center(track_lbl);
 
+    // Undo / Redo buttons
+    s_btn_undo = lv_btn_create(toolbar);
+    lv_obj_set_size(s_btn_undo, 56, 38);
+    lv_obj_set_style_bg_color(s_btn_undo, lv_color_hex(COLOR_BTN_HISTORY), LV_PART_MAIN);
+    lv_obj_set_style_radius(s_btn_undo, 4, LV_PART_MAIN);
+    lv_obj_add_event_cb(s_btn_undo, undo_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *undo_lbl = lv_label_create(s_btn_undo);
+    lv_label_set_text(undo_lbl, "Undo");
+    lv_obj_set_style_text_font(undo_lbl, &lv_font_montserrat_14, LV_PART_MAIN);
+    lv_obj_center(undo_lbl);
+
+    s_btn_redo = lv_btn_create(toolbar);
+    lv_obj_set_size(s_btn_redo, 56, 38);
+    lv_obj_set_style_bg_color(s_btn_redo, lv_color_hex(COLOR_BTN_HISTORY), LV_PART_MAIN);
+    lv_obj_set_style_radius(s_btn_redo, 4, LV_PART_MAIN);
+    lv_obj_add_event_cb(s_btn_redo, redo_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *redo_lbl = lv_label_create(s_btn_redo);
+    lv_label_set_text(redo_lbl, "Redo");
+    lv_obj_set_style_text_font(redo_lbl, &lv_font_montserrat_14, LV_PART_MAIN);
+    lv_obj_center(redo_lbl);
+
     // Save button (moved from sidebar to toolbar)
     s_btn_save = lv_btn_create(toolbar);
     lv_obj_set_size(s_btn_save, 90, 38);
@@ -1662,7 +2642,12 @@ void ui_create_panel_builder_tab(lv_obj_t *parent)
     lv_obj_set_style_bg_opa(s_canvas, LV_OPA_COVER, LV_PART_MAIN);
     lv_obj_clear_flag(s_canvas, LV_OBJ_FLAG_SCROLLABLE);
     lv_obj_add_flag(s_canvas, LV_OBJ_FLAG_CLICKABLE);
-    lv_obj_add_event_cb(s_canvas, canvas_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_event_cb(s_canvas, canvas_input_cb, LV_EVENT_PRESSED, NULL);
+    lv_obj_add_event_cb(s_canvas, canvas_input_cb, LV_EVENT_PRESSING, NULL);
+    lv_obj_add_event_cb(s_canvas, canvas_input_cb, LV_EVENT_RELEASED, NULL);
+    lv_obj_add_event_cb(s_canvas, canvas_input_cb, LV_EVENT_PRESS_LOST, NULL);
+    lv_obj_add_event_cb(s_canvas, canvas_input_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_event_cb(s_canvas, canvas_delete_cb, LV_EVENT_DELETE, NULL);
 
     // ---- Navigation bar (right side, vertical) ----
     lv_obj_t *nav_bar = lv_obj_create(container);
@@ -1722,13 +2707,19 @@ void ui_create_panel_builder_tab(lv_obj_t *parent)
     #undef NAV_BTN
 
     // Initial state
-    builder_refresh_canvas();
+    scene_rebuild();
     builder_refresh_toolbar();
+    ui_set_multitouch_handler(builder_multitouch_cb);
 
     ESP_LOGI(TAG, "Panel builder tab created (full-width canvas, modal turnout selection)");
 }
 
 void ui_panel_builder_refresh(void)
 {
-    builder_refresh_canvas();
+    s_selected_item = -1;
+    s_selected_track = -1;
+    s_selected_endpoint = -1;
+    panel_history_clear();
+    scene_rebuild();
+    builder_refresh_toolbar();
 }
@@ -12,8 +12,10 @@
 #include "esp_lcd_panel_rgb.h"
 #include "esp_heap_caps.h"
 #include "jpeg_decoder.h"
+#include "sd_io.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -28,33 +30,22 @@ esp_err_t ui_splash_show_image(esp_lcd_panel_handle_t panel,
 {
     ESP_LOGI(TAG, "Loading splash image: %s", filepath);
 
-    FILE *file = fopen(filepath, "rb");
-    if (!file) {
+    /* Read into PSRAM by the SD I/O service (chunked, unbuffered) */
+    char *file_data = NULL;
+    size_t file_size = 0;
+    esp_err_t ret = sd_io_read_sync(filepath, &file_data, &file_size);
+    if (ret == ESP_ERR_NOT_FOUND) {
         ESP_LOGW(TAG, "Splash image not found: %s", filepath);
-        return ESP_ERR_NOT_FOUND;
-    }
-
-    fseek(file, 0, SEEK_END);
-    size_t file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    uint8_t *jpeg_buf = heap_caps_malloc(file_size,
-                                         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!jpeg_buf) {
-        ESP_LOGE(TAG, "Failed to allocate %d bytes for JPEG", (int)file_size);
-        fclose(file);
-        return ESP_ERR_NO_MEM;
+        return ret;
     }
-
-    size_t read_size = fread(jpeg_buf, 1, file_size, file);
-    fclose(file);
-    if (read_size != file_size) {
-        free(jpeg_buf);
-        return ESP_FAIL;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read splash image: %s", esp_err_to_name(ret));
+        return ret;
     }
+    uint8_t *jpeg_buf = (uint8_t *)file_data;
 
     /* Validate JPEG header (SOI marker) */
-    if (jpeg_buf[0] != 0xFF || jpeg_buf[1] != 0xD8) {
+    if (file_size < 2 || jpeg_buf[0] != 0xFF || jpeg_buf[1] != 0xD8) {
         ESP_LOGE(TAG, "Invalid JPEG — missing SOI marker");
         free(jpeg_buf);
         return ESP_FAIL;
@@ -103,7 +94,7 @@ esp_err_t ui_splash_show_image(esp_lcd_panel_handle_t panel,
     };
 
     esp_jpeg_image_output_t outimg;
-    esp_err_t ret = esp_jpeg_decode(&cfg, &outimg);
+    ret = esp_jpeg_decode(&cfg, &outimg);
     free(work_buf);
 
     if (ret != ESP_OK) {
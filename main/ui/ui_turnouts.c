@@ -16,6 +16,7 @@
 #include "app/panel_layout.h"
 #include "app/panel_storage.h"
 #include "app/lcc_node.h"
+#include "app/psram_array.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include <string.h>
@@ -50,18 +51,26 @@ static lv_obj_t *s_parent = NULL;
 static lv_obj_t *s_grid_container = NULL;
 static lv_obj_t *s_empty_label = NULL;
 
-// Array of tile objects - indexed same as turnout_manager
-static lv_obj_t *s_tiles[TURNOUT_MAX_COUNT];
-static lv_obj_t *s_tile_names[TURNOUT_MAX_COUNT];
-static lv_obj_t *s_tile_states[TURNOUT_MAX_COUNT];
+// Tile objects - indexed same as turnout_manager, grown in PSRAM
+typedef struct {
+    lv_obj_t *tile;
+    lv_obj_t *name;     ///< Name label (first child)
+    lv_obj_t *state;    ///< State label (second child)
+} tile_obj_t;
+
+static tile_obj_t *s_tiles = NULL;
+static size_t s_tile_capacity = 0;
 static int s_tile_count = 0;
 
-void ui_turnouts_invalidate(void)
+static void tiles_forget(void)
 {
-    memset(s_tiles, 0, sizeof(s_tiles));
-    memset(s_tile_names, 0, sizeof(s_tile_names));
-    memset(s_tile_states, 0, sizeof(s_tile_states));
+    if (s_tiles) memset(s_tiles, 0, s_tile_capacity * sizeof(s_tiles[0]));
     s_tile_count = 0;
+}
+
+void ui_turnouts_invalidate(void)
+{
+    tiles_forget();
     s_grid_container = NULL;
     s_empty_label = NULL;
 }
@@ -142,9 +151,9 @@ static void tile_click_cb(lv_event_t *e)
     lcc_node_send_event(event_to_send);
 
     // Update tile to show pending state (blue border)
-    if (s_tiles[idx]) {
-        lv_obj_set_style_border_color(s_tiles[idx], lv_color_hex(COLOR_PENDING), LV_PART_MAIN);
-        lv_obj_set_style_border_width(s_tiles[idx], 3, LV_PART_MAIN);
+    if (idx < s_tile_count && s_tiles[idx].tile) {
+        lv_obj_set_style_border_color(s_tiles[idx].tile, lv_color_hex(COLOR_PENDING), LV_PART_MAIN);
+        lv_obj_set_style_border_width(s_tiles[idx].tile, 3, LV_PART_MAIN);
     }
 }
 
@@ -186,8 +195,8 @@ static void rename_save_cb(lv_event_t *e)
     turnout_manager_rename((size_t)idx, name_buf);
     turnout_manager_save();
 
-    if (idx < s_tile_count && s_tile_names[idx]) {
-        lv_label_set_text(s_tile_names[idx], name_buf);
+    if (idx < s_tile_count && s_tiles[idx].name) {
+        lv_label_set_text(s_tiles[idx].name, name_buf);
     }
 }
 
@@ -355,7 +364,9 @@ static void delete_confirm_btn_cb(lv_event_t *e)
             ESP_LOGI(TAG, "Removing panel item for deleted turnout (id %u)",
                      (unsigned)t.id);
             panel_layout_remove_item(layout, (size_t)pi);
-            panel_storage_save(layout);
+            panel_storage_save(layout, NULL, NULL);
+            // Builder scene and undo journal index the old layout
+            ui_panel_builder_refresh();
         }
     }
 
@@ -600,14 +611,16 @@ void ui_turnouts_refresh(void)
 
     // Clear existing tiles
     lv_obj_clean(s_grid_container);
-    s_tile_count = 0;
-    memset(s_tiles, 0, sizeof(s_tiles));
-    memset(s_tile_names, 0, sizeof(s_tile_names));
-    memset(s_tile_states, 0, sizeof(s_tile_states));
+    tiles_forget();
 
-    size_t count = turnout_manager_get_count();
+    const turnout_snapshot_t *snap = turnout_manager_snapshot_acquire();
+    size_t count = snap ? snap->count : 0;
+    if (!psram_array_reserve((void **)&s_tiles, &s_tile_capacity, count, sizeof(s_tiles[0]))) {
+        count = s_tile_capacity;
+    }
 
     if (count == 0) {
+        turnout_manager_snapshot_release(snap);
         lv_obj_add_flag(s_grid_container, LV_OBJ_FLAG_HIDDEN);
         lv_obj_clear_flag(s_empty_label, LV_OBJ_FLAG_HIDDEN);
         return;
@@ -616,37 +629,39 @@ void ui_turnouts_refresh(void)
     lv_obj_clear_flag(s_grid_container, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(s_empty_label, LV_OBJ_FLAG_HIDDEN);
 
-    for (size_t i = 0; i < count && i < TURNOUT_MAX_COUNT; i++) {
-        turnout_t t;
-        if (turnout_manager_get_by_index(i, &t) == ESP_OK) {
-            lv_obj_t *tile = create_tile(s_grid_container, (int)i, &t);
-            s_tiles[i] = tile;
+    int64_t t0 = esp_timer_get_time();
+    for (size_t i = 0; i < count; i++) {
+        lv_obj_t *tile = create_tile(s_grid_container, (int)i, &snap->turnouts[i]);
+        s_tiles[i].tile = tile;
 
-            // Find name and state labels (first and second children)
-            s_tile_names[i] = lv_obj_get_child(tile, 0);
-            s_tile_states[i] = lv_obj_get_child(tile, 1);
-        }
+        // Find name and state labels (first and second children)
+        s_tiles[i].name = lv_obj_get_child(tile, 0);
+        s_tiles[i].state = lv_obj_get_child(tile, 1);
     }
+    turnout_manager_snapshot_release(snap);
     s_tile_count = (int)count;
+    ESP_LOGI(TAG, "Built %d tiles in %d ms", s_tile_count,
+             (int)((esp_timer_get_time() - t0) / 1000));
 }
 
 void ui_turnouts_update_tile(int index, turnout_state_t state)
 {
-    if (index < 0 || index >= s_tile_count || !s_tiles[index]) return;
+    if (index < 0 || index >= s_tile_count || !s_tiles[index].tile) return;
 
-    lv_obj_t *tile = s_tiles[index];
+    tile_obj_t *obj = &s_tiles[index];
+    lv_obj_t *tile = obj->tile;
     
     // Update background color
     lv_obj_set_style_bg_color(tile, state_to_bg_color(state), LV_PART_MAIN);
 
     // Update text colors
     lv_color_t text_color = state_to_text_color(state);
-    if (s_tile_names[index]) {
-        lv_obj_set_style_text_color(s_tile_names[index], text_color, LV_PART_MAIN);
+    if (obj->name) {
+        lv_obj_set_style_text_color(obj->name, text_color, LV_PART_MAIN);
     }
-    if (s_tile_states[index]) {
-        lv_label_set_text(s_tile_states[index], state_to_text(state));
-        lv_obj_set_style_text_color(s_tile_states[index], text_color, LV_PART_MAIN);
+    if (obj->state) {
+        lv_label_set_text(obj->state, state_to_text(state));
+        lv_obj_set_style_text_color(obj->state, text_color, LV_PART_MAIN);
     }
 
     // Clear pending indicator when we get a state update
@@ -655,6 +670,6 @@ void ui_turnouts_update_tile(int index, turnout_state_t state)
 
 void ui_turnouts_clear_pending(int index)
 {
-    if (index < 0 || index >= s_tile_count || !s_tiles[index]) return;
-    lv_obj_set_style_border_width(s_tiles[index], 0, LV_PART_MAIN);
+    if (index < 0 || index >= s_tile_count || !s_tiles[index].tile) return;
+    lv_obj_set_style_border_width(s_tiles[index].tile, 0, LV_PART_MAIN);
 }
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""Summarise or replay a CAN capture (can.bin) as GridConnect.
+
+The panel writes the capture from Settings -> Diagnostics -> Capture CAN
+(CONFIG_CAN_CAPTURE_RECORDS > 0).  Copy /sdcard/can.bin to a PC and run:
+
+    python3 tools/can_replay.py can.bin                      # summary
+    python3 tools/can_replay.py can.bin --out frames.txt     # GridConnect file
+    python3 tools/can_replay.py can.bin --tcp localhost:12021 --speed 4
+
+Replay keeps the captured frame spacing scaled by --speed (1 = real time,
+--speed 0 = as fast as the socket accepts), so the same traffic can be fed
+to a panel on the bench through a GridConnect hub (JMRI, or an OpenMRN hub
+with a USB-CAN adapter).  The capture also holds the panel's own frames;
+--skip-alias drops the frames sent from a source alias, which is usually
+what a replay into the panel wants.  Timestamps are the low 32 bits of
+esp_timer (microseconds), so differences are taken modulo 2^32.
+"""
+
+import argparse
+import collections
+import socket
+import struct
+import sys
+import time
+
+MAGIC = b"LCCC"
+HEADER = struct.Struct("<4sHHII")
+RECORD = struct.Struct("<IIB3x8s")
+
+EFF = 0x80000000
+RTR = 0x40000000
+
+# OpenLCB MTIs most often seen on a turnout layout
+MTI_NAMES = {
+    0x100: "Initialization Complete", 0x490: "Verify Node ID (global)",
+    0x170: "Verified Node ID", 0x5B4: "Event Report",
+    0x8F4: "Identify Consumer", 0x4C4: "Consumer Identified (unknown)",
+    0x914: "Identify Producer", 0x544: "Producer Identified (valid)",
+    0x545: "Producer Identified (invalid)", 0x547: "Producer Identified (unknown)",
+    0x970: "Identify Events (global)", 0x828: "Protocol Support Inquiry",
+    0xDE8: "SNIP Request", 0xA08: "SNIP Reply",
+}
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, rec_size, count, dropped = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        sys.exit(f"{path}: not a CAN capture")
+    if version != 1 or rec_size != RECORD.size:
+        sys.exit(f"{path}: unsupported version {version} / record size {rec_size}")
+    if count == 0:
+        # Capture not closed cleanly (power lost): take what was flushed
+        count = (len(data) - HEADER.size) // rec_size
+    frames = []
+    for i in range(count):
+        t, can_id, dlc, payload = RECORD.unpack_from(data, HEADER.size + i * rec_size)
+        frames.append((t, can_id, payload[:min(dlc, 8)]))
+    return frames, dropped
+
+
+def gridconnect(can_id, payload):
+    kind = "R" if can_id & RTR else "N"
+    if can_id & EFF:
+        head = f"X{can_id & 0x1FFFFFFF:08X}"
+    else:
+        head = f"S{can_id & 0x7FF:03X}"
+    return f":{head}{kind}{payload.hex().upper()};"
+
+
+def summary(frames, dropped):
+    if not frames:
+        print("empty capture")
+        return
+    span_us = 0
+    for (a, _, _), (b, _, _) in zip(frames, frames[1:]):
+        span_us += (b - a) & 0xFFFFFFFF
+    seconds = span_us / 1e6
+    print(f"{len(frames)} frames over {seconds:.1f} s"
+          f" ({len(frames) / seconds if seconds else 0:.0f} frames/s), {dropped} dropped")
+
+    mtis = collections.Counter()
+    aliases = collections.Counter()
+    other = collections.Counter()
+    for _, can_id, _ in frames:
+        if not can_id & EFF:
+            other["standard frame"] += 1
+            continue
+        ident = can_id & 0x1FFFFFFF
+        aliases[ident & 0xFFF] += 1
+        if not ident & 0x08000000:
+            other["CAN control (alias allocation)"] += 1
+        elif (ident >> 24) & 7 == 1:
+            mtis[(ident >> 12) & 0xFFF] += 1
+        else:
+            other[f"datagram / stream (type {(ident >> 24) & 7})"] += 1
+
+    print("\nmessages")
+    for mti, n in mtis.most_common():
+        print(f"  {n:>8}  0x{mti:03X} {MTI_NAMES.get(mti, '')}")
+    for name, n in other.most_common():
+        print(f"  {n:>8}  {name}")
+    print("\nbusiest source aliases")
+    for alias, n in aliases.most_common(8):
+        print(f"  {n:>8}  0x{alias:03X}")
+
+
+def replay(frames, write, speed):
+    start_wall = time.monotonic()
+    elapsed_us = 0
+    prev = frames[0][0] if frames else 0
+    for t, can_id, payload in frames:
+        elapsed_us += (t - prev) & 0xFFFFFFFF
+        prev = t
+        if speed > 0:
+            delay = start_wall + elapsed_us / 1e6 / speed - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+        write(gridconnect(can_id, payload) + "\n")
+    return time.monotonic() - start_wall
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("capture", help="can.bin from the panel's SD card")
+    ap.add_argument("--out", help="write GridConnect lines to this file (no pacing)")
+    ap.add_argument("--tcp", metavar="HOST:PORT", help="replay to a GridConnect TCP hub")
+    ap.add_argument("--speed", type=float, default=1.0,
+                    help="replay speed multiple; 0 sends as fast as possible (default 1)")
+    ap.add_argument("--skip-alias", type=lambda s: int(s, 16), action="append", default=[],
+                    help="drop frames from this source alias (hex), e.g. the panel's own")
+    args = ap.parse_args()
+
+    frames, dropped = load(args.capture)
+    if args.skip_alias:
+        skip = set(args.skip_alias)
+        frames = [f for f in frames if not (f[1] & EFF and (f[1] & 0xFFF) in skip)]
+
+    if args.out:
+        with open(args.out, "w") as f:
+            for _, can_id, payload in frames:
+                f.write(gridconnect(can_id, payload) + "\n")
+        print(f"{len(frames)} frames written to {args.out}")
+    elif args.tcp:
+        host, port = args.tcp.rsplit(":", 1)
+        with socket.create_connection((host, int(port))) as s:
+            took = replay(frames, lambda line: s.sendall(line.encode()), args.speed)
+        print(f"{len(frames)} frames replayed in {took:.1f} s")
+    else:
+        summary(frames, dropped)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Decode a pipeline trace dump (trace.bin) into per-stage latencies.
+
+The panel writes the dump from Settings -> Diagnostics -> Dump trace
+(CONFIG_TRACE_RING_RECORDS > 0).  Copy /sdcard/trace.bin to a PC and run:
+
+    python3 tools/trace_decode.py trace.bin [--csv records.csv]
+
+Records are matched along the pipeline as follows:
+
+    tx         -> rx          same event ID (command out, feedback in)
+    rx         -> route       same event ID
+    route      -> apply       same element (turnout / block index)
+    apply      -> ui_sched    same element
+    ui_sched   -> ui_apply    same element (several marks may share one redraw)
+    ui_apply   -> flush_done  next flush end
+
+For each hop the script prints count and p50 / p90 / p99 / max in
+milliseconds, then the end-to-end rx -> ui_apply and tx -> ui_apply totals.
+Timestamps are the low 32 bits of esp_timer (microseconds), so differences
+are taken modulo 2^32.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = b"LCTR"
+HEADER = struct.Struct("<4sHHII")
+RECORD = struct.Struct("<IBBHQ")
+
+STAGES = {1: "rx", 2: "route", 3: "apply", 4: "ui_sched",
+          5: "ui_apply", 6: "flush_done", 7: "tx"}
+KINDS = {0: "-", 1: "turnout", 2: "block"}
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, rec_size, count, lost = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        sys.exit(f"{path}: not a trace dump")
+    if version != 1 or rec_size != RECORD.size:
+        sys.exit(f"{path}: unsupported version {version} / record size {rec_size}")
+    records = []
+    for i in range(count):
+        t, stage, kind, index, event = RECORD.unpack_from(data, HEADER.size + i * rec_size)
+        records.append((t, STAGES.get(stage, f"?{stage}"), KINDS.get(kind, "?"), index, event))
+    return records, lost
+
+
+def elapsed(a, b):
+    return ((b - a) & 0xFFFFFFFF) / 1000.0
+
+
+def pct(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def analyse(records):
+    hops = {name: [] for name in (
+        "tx -> rx", "rx -> route", "route -> apply", "apply -> ui_sched",
+        "ui_sched -> ui_apply", "ui_apply -> flush_done",
+        "rx -> ui_apply (total)", "tx -> ui_apply (total)")}
+
+    tx_by_event = {}        # event -> tx time
+    rx_by_event = {}        # event -> (rx time, tx time or None)
+    route_by_elem = {}      # (kind, index) -> (route time, rx time, tx time)
+    apply_by_elem = {}
+    sched_by_elem = {}      # (kind, index) -> first unredrawn mark (apply info)
+    pending_apply = []      # ui_apply times waiting for the flush end
+
+    for t, stage, kind, index, event in records:
+        elem = (kind, index)
+        if stage == "tx":
+            tx_by_event[event] = t
+        elif stage == "rx":
+            tx = tx_by_event.pop(event, None)
+            if tx is not None:
+                hops["tx -> rx"].append(elapsed(tx, t))
+            rx_by_event[event] = (t, tx)
+        elif stage == "route":
+            rx = rx_by_event.pop(event, None)
+            if rx is not None:
+                hops["rx -> route"].append(elapsed(rx[0], t))
+                route_by_elem[elem] = (t, rx[0], rx[1])
+        elif stage == "apply":
+            route = route_by_elem.pop(elem, None)
+            if route is not None:
+                hops["route -> apply"].append(elapsed(route[0], t))
+                apply_by_elem[elem] = (t, route[1], route[2])
+        elif stage == "ui_sched":
+            applied = apply_by_elem.pop(elem, None)
+            if applied is not None:
+                hops["apply -> ui_sched"].append(elapsed(applied[0], t))
+                sched_by_elem.setdefault(elem, (t, applied[1], applied[2]))
+        elif stage == "ui_apply":
+            sched = sched_by_elem.pop(elem, None)
+            if sched is not None:
+                hops["ui_sched -> ui_apply"].append(elapsed(sched[0], t))
+                hops["rx -> ui_apply (total)"].append(elapsed(sched[1], t))
+                if sched[2] is not None:
+                    hops["tx -> ui_apply (total)"].append(elapsed(sched[2], t))
+            pending_apply.append(t)
+        elif stage == "flush_done":
+            for a in pending_apply:
+                hops["ui_apply -> flush_done"].append(elapsed(a, t))
+            pending_apply.clear()
+    return hops
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("dump", help="trace.bin from the panel's SD card")
+    ap.add_argument("--csv", help="also write the raw records to this CSV file")
+    args = ap.parse_args()
+
+    records, lost = load(args.dump)
+    print(f"{len(records)} records ({lost} overwritten before the dump)")
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            w = csv.writer(f)
+            w.writerow(["time_us", "stage", "kind", "index", "event_id"])
+            for t, stage, kind, index, event in records:
+                w.writerow([t, stage, kind, index, f"{event:016X}"])
+
+    print(f"\n{'hop':<26}{'count':>8}{'p50':>10}{'p90':>10}{'p99':>10}{'max':>10}   (ms)")
+    for name, values in analyse(records).items():
+        if not values:
+            print(f"{name:<26}{0:>8}")
+            continue
+        print(f"{name:<26}{len(values):>8}{pct(values, 50):>10.2f}{pct(values, 90):>10.2f}"
+              f"{pct(values, 99):>10.2f}{max(values):>10.2f}")
+
+
+if __name__ == "__main__":
+    main()